@@ -0,0 +1,621 @@
+//
+// Page generation benchmark program for PDFio.
+//
+// Copyright © 2025 by Michael R Sweet.
+//
+// Licensed under Apache License v2.0.  See the file "LICENSE" for more
+// information.
+//
+// Usage:
+//
+//   ./benchpdfio [-n NUM-PAGES] [-t MAX-THREADS] [-o FILENAME]
+//   ./benchpdfio -i
+//   ./benchpdfio -p [-s NUM-SEGMENTS]
+//
+// Renders the same document using 1, 2, 4, 8, and 16 threads (up to
+// MAX-THREADS) and reports the time and pages per second for each.
+//
+// With "-i", writes 2048x2048 gray and RGB images with 8 and 16-bit alpha
+// channels, and the same color and alpha values as two separate images, and
+// reports the best time of three runs for each.  The difference is the time
+// spent splitting the color and alpha values.
+//
+// With "-p", writes NUM-SEGMENTS path segments using 6, 4, and 2 decimal
+// places and reports the time and bytes per million segments for each.
+//
+
+#include "pdfio-private.h"
+#include "pdfio-content.h"
+#include <math.h>
+#include <sys/time.h>
+
+
+//
+// Local types...
+//
+
+typedef struct bench_s			// Benchmark data
+{
+  pdfio_file_t	*pdf;			// PDF file
+  pdfio_obj_t	*font;			// Font object
+  size_t	num_pages,		// Number of pages to render
+		next_page;		// Next page to render
+  bool		error;			// Did an error occur?
+#ifdef HAVE_PTHREAD
+  pthread_mutex_t mutex;		// Mutex for next page
+#endif // HAVE_PTHREAD
+} bench_t;
+
+
+//
+// Local functions...
+//
+
+static ssize_t	count_bytes(size_t *bytes, const void *data, size_t datalen);
+static double	get_time(void);
+static bool	render_page(bench_t *bench, size_t number);
+static void	*render_pages(bench_t *bench);
+static double	run_bench(const char *filename, size_t num_pages, size_t num_threads);
+static double	run_image(size_t depth, size_t num_colors, bool alpha);
+static double	run_precision(size_t num_segments, int precision, size_t *bytes);
+static int	usage(FILE *fp);
+
+
+//
+// 'main()' - Main entry for benchmark program.
+//
+
+int					// O - Exit status
+main(int  argc,				// I - Number of command-line arguments
+     char *argv[])			// I - Command-line arguments
+{
+  int		i;			// Looping var
+  const char	*filename = "benchpdfio.pdf";
+					// Output filename
+  size_t	num_pages = 200,	// Number of pages
+		max_threads = 16,	// Maximum number of threads
+		num_threads,		// Current number of threads
+		num_segments = 1000000,	// Number of path segments
+		bytes,			// Bytes written
+		depth,			// Image bit depth
+		num_colors;		// Number of image colors
+  double	secs,			// Seconds for run
+		base = 0.0;		// Seconds for one thread
+  bool		images = false,	// Run the image benchmark?
+		precision = false;	// Run the precision benchmark?
+  int		digits,			// Number of decimal places
+		run;			// Current run
+  double	alpha_secs,		// Seconds for alpha image
+		temp;			// Seconds for current run
+
+
+  // Parse command-line...
+  for (i = 1; i < argc; i ++)
+  {
+    if (!strcmp(argv[i], "--help"))
+    {
+      return (usage(stdout));
+    }
+    else if (!strcmp(argv[i], "-i"))
+    {
+      images = true;
+    }
+    else if (!strcmp(argv[i], "-n") && (i + 1) < argc)
+    {
+      i ++;
+      num_pages = (size_t)strtoul(argv[i], NULL, 10);
+    }
+    else if (!strcmp(argv[i], "-o") && (i + 1) < argc)
+    {
+      i ++;
+      filename = argv[i];
+    }
+    else if (!strcmp(argv[i], "-p"))
+    {
+      precision = true;
+    }
+    else if (!strcmp(argv[i], "-s") && (i + 1) < argc)
+    {
+      i ++;
+      num_segments = (size_t)strtoul(argv[i], NULL, 10);
+    }
+    else if (!strcmp(argv[i], "-t") && (i + 1) < argc)
+    {
+      i ++;
+      max_threads = (size_t)strtoul(argv[i], NULL, 10);
+    }
+    else
+    {
+      return (usage(stderr));
+    }
+  }
+
+  if (num_pages < 1 || max_threads < 1 || num_segments < 1)
+    return (usage(stderr));
+
+  if (images)
+  {
+    // Run the image benchmarks...
+    printf("Depth  Colors  Separate    Alpha  Overhead\n");
+
+    for (i = 0; i < 4; i ++)
+    {
+      depth      = i < 2 ? 8 : 16;
+      num_colors = (i & 1) ? 3 : 1;
+
+      for (run = 0, secs = alpha_secs = 0.0; run < 3; run ++)
+      {
+        if ((temp = run_image(depth, num_colors, false)) < 0.0)
+          return (1);
+        else if (run == 0 || temp < secs)
+          secs = temp;
+
+        if ((temp = run_image(depth, num_colors, true)) < 0.0)
+          return (1);
+        else if (run == 0 || temp < alpha_secs)
+          alpha_secs = temp;
+      }
+
+      printf("%5u  %6u  %8.3f  %7.3f  %7.1f%%\n", (unsigned)depth, (unsigned)num_colors, secs, alpha_secs, 100.0 * (alpha_secs - secs) / secs);
+    }
+
+    return (0);
+  }
+
+  if (precision)
+  {
+    // Run the path segment benchmarks...
+    printf("Digits  Seconds      Bytes  Sec/Mseg  Bytes/Mseg\n");
+
+    for (digits = 6; digits >= 2; digits -= 2)
+    {
+      if ((secs = run_precision(num_segments, digits, &bytes)) < 0.0)
+        return (1);
+
+      printf("%6d  %7.3f  %9lu  %8.3f  %10.0f\n", digits, secs, (unsigned long)bytes, 1000000.0 * secs / (double)num_segments, 1000000.0 * (double)bytes / (double)num_segments);
+    }
+
+    return (0);
+  }
+
+#ifndef HAVE_PTHREAD
+  // Only one thread without threading support...
+  max_threads = 1;
+#endif // !HAVE_PTHREAD
+
+  // Run the benchmarks...
+  printf("Threads  Seconds  Pages/sec  Speedup\n");
+
+  for (num_threads = 1; num_threads <= max_threads; num_threads *= 2)
+  {
+    if ((secs = run_bench(filename, num_pages, num_threads)) < 0.0)
+      return (1);
+
+    if (num_threads == 1)
+      base = secs;
+
+    printf("%7u  %7.3f  %9.1f  %6.2fx\n", (unsigned)num_threads, secs, (double)num_pages / secs, base / secs);
+  }
+
+  return (0);
+}
+
+
+//
+// 'count_bytes()' - Count the bytes written to a PDF file.
+//
+
+static ssize_t				// O - Number of bytes "written"
+count_bytes(size_t     *bytes,		// I - Byte counter
+            const void *data,		// I - Data (unused)
+            size_t     datalen)		// I - Length of data
+{
+  (void)data;
+
+  *bytes += datalen;
+
+  return ((ssize_t)datalen);
+}
+
+
+//
+// 'get_time()' - Get the current time in seconds.
+//
+
+static double				// O - Time in seconds
+get_time(void)
+{
+  struct timeval curtime;		// Current time
+
+
+  gettimeofday(&curtime, NULL);
+
+  return ((double)curtime.tv_sec + 0.000001 * (double)curtime.tv_usec);
+}
+
+
+//
+// 'render_page()' - Render a single page with text, graphics, and an image.
+//
+
+static bool				// O - `true` on success, `false` on failure
+render_page(bench_t *bench,		// I - Benchmark data
+            size_t  number)		// I - Page number
+{
+  pdfio_dict_t	*dict;			// Page dictionary
+  pdfio_obj_t	*image;			// Image object
+  pdfio_stream_t *st;			// Page contents stream
+  unsigned char	*pixels,		// Image pixels
+		*pptr;			// Pointer into pixels
+  size_t	x, y,			// Looping vars
+		line;			// Current line
+  double	angle;			// Current angle
+  char		label[64];		// Page label
+  static const size_t size = 256;	// Image size
+
+
+  // Create a unique image for the page...
+  if ((pixels = (unsigned char *)malloc(size * size * 3)) == NULL)
+    return (false);
+
+  for (y = 0, pptr = pixels; y < size; y ++)
+  {
+    for (x = 0; x < size; x ++, pptr += 3)
+    {
+      pptr[0] = (unsigned char)(x + number);
+      pptr[1] = (unsigned char)(y ^ number);
+      pptr[2] = (unsigned char)((x * y) >> 8);
+    }
+  }
+
+  image = pdfioFileCreateImageObjFromData(bench->pdf, pixels, size, size, 3, /*color_data*/NULL, /*alpha*/false, /*interpolate*/false);
+
+  free(pixels);
+
+  if (!image)
+    return (false);
+
+  // Create the page...
+  if ((dict = pdfioDictCreate(bench->pdf)) == NULL)
+    return (false);
+
+  pdfioPageDictAddFont(dict, "F1", bench->font);
+  pdfioPageDictAddImage(dict, "IM1", image);
+
+  if ((st = pdfioFileCreatePage(bench->pdf, dict)) == NULL)
+    return (false);
+
+  // Draw a starburst...
+  pdfioContentSetStrokeColorRGB(st, 0.0, 0.0, 0.5);
+  pdfioContentSetLineWidth(st, 0.5);
+
+  for (line = 0; line < 500; line ++)
+  {
+    angle = 2.0 * M_PI * (double)line / 500.0;
+
+    pdfioContentPathMoveTo(st, 306.0, 500.0);
+    pdfioContentPathLineTo(st, 306.0 + 200.0 * cos(angle), 500.0 + 200.0 * sin(angle));
+  }
+
+  pdfioContentStroke(st);
+
+  // Draw the image...
+  pdfioContentDrawImage(st, "IM1", 178.0, 72.0, 256.0, 256.0);
+
+  // Draw some text...
+  snprintf(label, sizeof(label), "Page %u", (unsigned)(number + 1));
+
+  pdfioContentSetFillColorGray(st, 0.0);
+  pdfioContentTextBegin(st);
+  pdfioContentSetTextFont(st, "F1", 12.0);
+  pdfioContentTextMoveTo(st, 36.0, 36.0);
+
+  for (line = 0; line < 20; line ++)
+  {
+    pdfioContentTextShowf(st, false, "%s, line %u: The quick brown fox jumps over the lazy dog.", label, (unsigned)(line + 1));
+    pdfioContentTextNewLine(st);
+  }
+
+  pdfioContentTextEnd(st);
+
+  return (pdfioStreamClose(st));
+}
+
+
+//
+// 'render_pages()' - Render pages until there are no more left.
+//
+
+static void *				// O - Thread exit status
+render_pages(bench_t *bench)		// I - Benchmark data
+{
+  size_t	number;			// Page number
+
+
+  for (;;)
+  {
+    // Get the next page number...
+#ifdef HAVE_PTHREAD
+    pthread_mutex_lock(&bench->mutex);
+#endif // HAVE_PTHREAD
+
+    number = bench->next_page ++;
+
+#ifdef HAVE_PTHREAD
+    pthread_mutex_unlock(&bench->mutex);
+#endif // HAVE_PTHREAD
+
+    if (number >= bench->num_pages)
+      break;
+
+    // Render it...
+    if (!render_page(bench, number))
+    {
+      bench->error = true;
+      break;
+    }
+  }
+
+  return (NULL);
+}
+
+
+//
+// 'run_bench()' - Render a document using the specified number of threads.
+//
+
+static double				// O - Seconds or `-1.0` on error
+run_bench(const char *filename,		// I - Output filename
+          size_t     num_pages,		// I - Number of pages
+          size_t     num_threads)	// I - Number of threads
+{
+  bench_t	bench;			// Benchmark data
+  double	start;			// Start time
+#ifdef HAVE_PTHREAD
+  size_t	i;			// Looping var
+  pthread_t	threads[64];		// Threads
+#endif // HAVE_PTHREAD
+
+
+  // Create the PDF file...
+  memset(&bench, 0, sizeof(bench));
+  bench.num_pages = num_pages;
+
+  start = get_time();
+
+  if ((bench.pdf = pdfioFileCreate(filename, "2.0", /*media_box*/NULL, /*crop_box*/NULL, /*error_cb*/NULL, /*error_data*/NULL)) == NULL)
+    return (-1.0);
+
+  if ((bench.font = pdfioFileCreateFontObjFromBase(bench.pdf, "Helvetica")) == NULL)
+  {
+    pdfioFileClose(bench.pdf);
+    return (-1.0);
+  }
+
+#ifdef HAVE_PTHREAD
+  if (num_threads > (sizeof(threads) / sizeof(threads[0])))
+    num_threads = sizeof(threads) / sizeof(threads[0]);
+
+  if (num_threads > 1)
+  {
+    // Render pages using multiple threads...
+    if (!pdfioFileSetThreadSafe(bench.pdf, true))
+    {
+      pdfioFileClose(bench.pdf);
+      return (-1.0);
+    }
+
+    pthread_mutex_init(&bench.mutex, NULL);
+
+    for (i = 0; i < num_threads; i ++)
+    {
+      if (pthread_create(threads + i, NULL, (void *(*)(void *))render_pages, &bench))
+      {
+        perror("benchpdfio: Unable to create thread");
+        bench.error = true;
+        break;
+      }
+    }
+
+    while (i > 0)
+      pthread_join(threads[-- i], NULL);
+
+    pthread_mutex_destroy(&bench.mutex);
+  }
+  else
+#endif // HAVE_PTHREAD
+  {
+    // Render pages using the main thread...
+    (void)num_threads;
+
+    render_pages(&bench);
+  }
+
+  if (!pdfioFileClose(bench.pdf) || bench.error)
+  {
+    fprintf(stderr, "benchpdfio: Unable to render \"%s\" using %u thread(s).\n", filename, (unsigned)num_threads);
+    return (-1.0);
+  }
+
+  return (get_time() - start);
+}
+
+
+//
+// 'run_image()' - Write an image with alpha or as separate color and alpha
+//                 images.
+//
+
+static double				// O - Seconds or `-1.0` on error
+run_image(size_t depth,			// I - Bit depth
+          size_t num_colors,		// I - Number of colors
+          bool   alpha)			// I - Write an image with alpha?
+{
+  pdfio_file_t	*pdf;			// PDF file
+  pdfio_image_t	*image;			// Image
+  size_t	bytes = 0,		// Bytes written
+		bpc = depth / 8,	// Bytes per component
+		bpp = num_colors * bpc,	// Bytes per pixel (less alpha)
+		x, y, c;		// Looping vars
+  unsigned char	*data,			// Color and alpha data
+		*colors,		// Pointer to color data
+		*mask;			// Pointer to alpha data
+  double	start;			// Start time
+  static const size_t size = 2048;	// Image size
+
+
+  // Create the image data, either interleaved or as separate color and alpha
+  // values...
+  if ((data = (unsigned char *)malloc(size * size * (bpp + bpc))) == NULL)
+  {
+    perror("benchpdfio: Unable to allocate image data");
+    return (-1.0);
+  }
+
+  for (y = 0, colors = data, mask = data + size * size * bpp; y < size; y ++)
+  {
+    for (x = 0; x < size; x ++)
+    {
+      for (c = 0; c < (bpp + bpc); c ++)
+      {
+        unsigned char v = (unsigned char)(x + y + 37 * c + (((x * 7919 + y * 104729 + c) * 2654435761U) >> 29));
+					// Gradient with a little noise
+
+        if (alpha || c < bpp)
+          *colors++ = v;
+        else
+          *mask++ = v;
+      }
+    }
+  }
+
+  // Write the image(s), discarding the output...
+  start = get_time();
+
+  if ((pdf = pdfioFileCreateOutput((pdfio_output_cb_t)count_bytes, &bytes, "2.0", /*media_box*/NULL, /*crop_box*/NULL, /*error_cb*/NULL, /*error_data*/NULL)) == NULL)
+  {
+    free(data);
+    return (-1.0);
+  }
+
+  if ((image = pdfioFileCreateImage(pdf, size, size, depth, num_colors, /*color_data*/NULL, alpha, /*interpolate*/false)) == NULL || !pdfioImageWriteRows(image, data, size) || !pdfioImageClose(image))
+    goto error;
+
+  if (!alpha && ((image = pdfioFileCreateImage(pdf, size, size, depth, 1, /*color_data*/NULL, /*alpha*/false, /*interpolate*/false)) == NULL || !pdfioImageWriteRows(image, data + size * size * bpp, size) || !pdfioImageClose(image)))
+    goto error;
+
+  if (!pdfioFileClose(pdf))
+  {
+    fprintf(stderr, "benchpdfio: Unable to write %ux%u image.\n", (unsigned)size, (unsigned)size);
+    free(data);
+    return (-1.0);
+  }
+
+  free(data);
+
+  return (get_time() - start);
+
+  // If we get here something went wrong...
+  error:
+
+  pdfioFileClose(pdf);
+  free(data);
+
+  fprintf(stderr, "benchpdfio: Unable to write %ux%u image.\n", (unsigned)size, (unsigned)size);
+
+  return (-1.0);
+}
+
+
+//
+// 'run_precision()' - Write path segments using the specified precision.
+//
+
+static double				// O - Seconds or `-1.0` on error
+run_precision(size_t num_segments,	// I - Number of path segments
+              int    precision,		// I - Number of decimal places
+              size_t *bytes)		// O - Number of bytes written
+{
+  pdfio_file_t	*pdf;			// PDF file
+  pdfio_stream_t *st = NULL;		// Page contents stream
+  size_t	i;			// Looping var
+  double	angle,			// Current angle
+		start;			// Start time
+
+
+  *bytes = 0;
+  start  = get_time();
+
+  // Write the segments to pages of 10000 segments each, discarding the output
+  // so that only the content generation is measured...
+  if ((pdf = pdfioFileCreateOutput((pdfio_output_cb_t)count_bytes, bytes, "2.0", /*media_box*/NULL, /*crop_box*/NULL, /*error_cb*/NULL, /*error_data*/NULL)) == NULL)
+    return (-1.0);
+
+  if (!pdfioFileSetPrecision(pdf, precision))
+    goto error;
+
+  for (i = 0; i < num_segments; i ++)
+  {
+    angle = 0.001 * (double)i;
+
+    if ((i % 10000) == 0)
+    {
+      if (st && (!pdfioContentStroke(st) || !pdfioStreamClose(st)))
+        goto error;
+
+      if ((st = pdfioFileCreatePage(pdf, /*dict*/NULL)) == NULL)
+        goto error;
+
+      pdfioContentSetLineWidth(st, 0.1);
+      pdfioContentPathMoveTo(st, 306.0 + 250.0 * cos(angle), 396.0 + 250.0 * sin(1.7 * angle));
+    }
+    else
+    {
+      pdfioContentPathLineTo(st, 306.0 + 250.0 * cos(angle), 396.0 + 250.0 * sin(1.7 * angle));
+    }
+  }
+
+  if (!pdfioContentStroke(st) || !pdfioStreamClose(st))
+    goto error;
+
+  if (!pdfioFileClose(pdf))
+  {
+    fprintf(stderr, "benchpdfio: Unable to write %u path segments.\n", (unsigned)num_segments);
+    return (-1.0);
+  }
+
+  return (get_time() - start);
+
+  // If we get here something went wrong...
+  error:
+
+  if (st)
+    pdfioStreamClose(st);
+
+  pdfioFileClose(pdf);
+
+  fprintf(stderr, "benchpdfio: Unable to write %u path segments.\n", (unsigned)num_segments);
+
+  return (-1.0);
+}
+
+
+//
+// 'usage()' - Show program usage.
+//
+
+static int				// O - Exit status
+usage(FILE *fp)				// I - Output file
+{
+  fputs("Usage: ./benchpdfio [OPTIONS]\n", fp);
+  fputs("Options:\n", fp);
+  fputs("  --help          Show program help.\n", fp);
+  fputs("  -i              Run the image alpha splitting benchmark.\n", fp);
+  fputs("  -n NUM-PAGES    Set number of pages (default 200).\n", fp);
+  fputs("  -o FILENAME     Set output filename (default 'benchpdfio.pdf').\n", fp);
+  fputs("  -p              Run the path segment precision benchmark.\n", fp);
+  fputs("  -s NUM-SEGMENTS Set number of path segments (default 1000000).\n", fp);
+  fputs("  -t MAX-THREADS  Set maximum number of threads (default 16).\n", fp);
+
+  return (fp == stdout ? 0 : 1);
+}
@@ -307,12 +307,15 @@ pdfioArrayCreate(pdfio_file_t *pdf)	// I - PDF file
 
   a->pdf = pdf;
 
+  _pdfioFileLock(pdf);
+
   if (pdf->num_arrays >= pdf->alloc_arrays)
   {
     pdfio_array_t **temp = realloc(pdf->arrays, (pdf->alloc_arrays + 16) * sizeof(pdfio_array_t *));
 
     if (!temp)
     {
+      _pdfioFileUnlock(pdf);
       free(a);
       return (NULL);
     }
@@ -323,6 +326,8 @@ pdfioArrayCreate(pdfio_file_t *pdf)	// I - PDF file
 
   pdf->arrays[pdf->num_arrays ++] = a;
 
+  _pdfioFileUnlock(pdf);
+
   return (a);
 }
 
@@ -40,6 +40,75 @@ _pdfioFileConsume(pdfio_file_t *pdf,	// I - PDF file
 }
 
 
+//
+// '_pdfioFileCopy()' - Copy raw data from one PDF file to another.
+//
+// This function copies "length" bytes starting at "offset" in the source PDF
+// file to the current position in the destination PDF file.  When possible
+// the data is copied by the operating system without passing through PDFio's
+// buffers, otherwise it is read directly into the destination's write buffer.
+//
+
+bool					// O - `true` on success, `false` on failure
+_pdfioFileCopy(pdfio_file_t *pdf,	// I - Destination PDF file
+               pdfio_file_t *src,	// I - Source PDF file
+               off_t        offset,	// I - Offset in source PDF file
+               size_t       length)	// I - Number of bytes to copy
+{
+  ssize_t	bytes;			// Bytes copied/read
+
+
+  PDFIO_DEBUG("_pdfioFileCopy(pdf=%p, src=%p, offset=%ld, length=%lu)\n", (void *)pdf, (void *)src, (long)offset, (unsigned long)length);
+
+#ifdef HAVE_COPY_FILE_RANGE
+  if (!pdf->output_cb)
+  {
+    // Write any buffered data and then have the kernel copy the data...
+    if (!_pdfioFileFlush(pdf))
+      return (false);
+
+    while (length > 0)
+    {
+      if ((bytes = copy_file_range(src->fd, &offset, pdf->fd, NULL, length, 0)) < 0 && (errno == EINTR || errno == EAGAIN))
+        continue;
+      else if (bytes <= 0)
+        break;				// Not supported, copy the rest below...
+
+      pdf->bufpos += (off_t)bytes;
+      length      -= (size_t)bytes;
+    }
+
+    if (length == 0)
+      return (true);
+  }
+#endif // HAVE_COPY_FILE_RANGE
+
+  // Read the data into the write buffer...
+  if (_pdfioFileSeek(src, offset, SEEK_SET) < 0)
+    return (false);
+
+  while (length > 0)
+  {
+    if (pdf->bufptr >= pdf->bufend && !_pdfioFileFlush(pdf))
+      return (false);
+
+    if ((size_t)(bytes = pdf->bufend - pdf->bufptr) > length)
+      bytes = (ssize_t)length;
+
+    if ((bytes = _pdfioFileRead(src, pdf->bufptr, (size_t)bytes)) <= 0)
+    {
+      _pdfioFileError(pdf, "Unable to read data to copy.");
+      return (false);
+    }
+
+    pdf->bufptr += bytes;
+    length      -= (size_t)bytes;
+  }
+
+  return (true);
+}
+
+
 //
 // '_pdfioFileDefaultError()' - Default error callback.
 //
@@ -191,6 +260,25 @@ _pdfioFileGets(pdfio_file_t *pdf,	// I - PDF file
 }
 
 
+//
+// '_pdfioFileLock()' - Lock a PDF file for exclusive access.
+//
+// Locking is only done for PDF files that are shared between threads.  Locks
+// can be nested.
+//
+
+void
+_pdfioFileLock(pdfio_file_t *pdf)	// I - PDF file
+{
+#ifdef HAVE_PTHREAD
+  if (pdf->threaded)
+    pthread_mutex_lock(&pdf->mutex);
+#else
+  (void)pdf;
+#endif // HAVE_PTHREAD
+}
+
+
 //
 // '_pdfioFilePeek()' - Peek at upcoming data in a PDF file.
 //
@@ -433,6 +521,22 @@ _pdfioFileTell(pdfio_file_t *pdf)	// I - PDF file
 }
 
 
+//
+// '_pdfioFileUnlock()' - Unlock a PDF file.
+//
+
+void
+_pdfioFileUnlock(pdfio_file_t *pdf)	// I - PDF file
+{
+#ifdef HAVE_PTHREAD
+  if (pdf->threaded)
+    pthread_mutex_unlock(&pdf->mutex);
+#else
+  (void)pdf;
+#endif // HAVE_PTHREAD
+}
+
+
 //
 // '_pdfioFileWrite()' - Write to a PDF file.
 //
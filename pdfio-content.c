@@ -16,6 +16,7 @@
 #  include <png.h>
 #endif // HAVE_LIBPNG
 #include <math.h>
+#include <sys/stat.h>
 #ifndef M_PI
 #  define M_PI	3.14159265358979323846264338327950288
 #endif // M_PI
@@ -55,6 +56,8 @@
 #define _PDFIO_PNG_CHUNK_PLTE	0x504c5445	// Palette
 #define _PDFIO_PNG_CHUNK_cHRM	0x6348524d	// Cromacities and white point
 #define _PDFIO_PNG_CHUNK_gAMA	0x67414d41	// Gamma correction
+#define _PDFIO_PNG_CHUNK_iCCP	0x69434350	// ICC color profile
+#define _PDFIO_PNG_CHUNK_sRGB	0x73524742	// Standard RGB color space
 #define _PDFIO_PNG_CHUNK_tRNS	0x74524e53	// Transparency information
 
 #define _PDFIO_PNG_COMPRESSION_FLATE 0	// Flate compression
@@ -75,26 +78,106 @@
 // Local types...
 //
 
-typedef pdfio_obj_t *(*_pdfio_image_func_t)(pdfio_dict_t *dict, int fd);
+typedef struct _pdfio_imgsrc_s		// Image source
+{
+  int		fd;			// File descriptor or `-1` for memory
+  const unsigned char *data,		// Image data in memory, if any
+		*dataptr,		// Current position in memory
+		*dataend;		// End of image data in memory
+} _pdfio_imgsrc_t;
+
+typedef pdfio_obj_t *(*_pdfio_image_func_t)(pdfio_dict_t *dict, _pdfio_imgsrc_t *src);
+
+typedef struct _pdfio_cfont_s		// Shared font cache entry
+{
+  char		*filename;		// Font filename
+  off_t		size;			// Size of font file
+  time_t	mtime;			// Modification time of font file
+  ttf_t		*font;			// TrueType font
+  size_t	refcount;		// Number of font objects using this font
+  unsigned char	*data;			// Flate-compressed font file
+  size_t	datalen;		// Length of compressed font file
+  unsigned char	*cid2gid;		// Flate-compressed CIDToGIDMap, if any
+  size_t	cid2gidlen;		// Length of compressed CIDToGIDMap
+  int		*widths;		// Encoded widths for Unicode fonts, if any
+  size_t	num_widths;		// Number of encoded widths
+  pdfio_file_t	*pdf;			// PDF file loading the font, if any
+} _pdfio_cfont_t;
+
+struct _pdfio_fontmetrics_s		// Font measurement context
+{
+  ttf_t		*ttf;			// TrueType font, if any
+  const short	*base_widths;		// Base font widths, if any
+  int		*widths[256];		// Cached advance widths for each 256 character block of the BMP
+};
+
+struct _pdfio_image_s			// Image being written or read
+{
+  pdfio_file_t	*pdf;			// PDF file
+  pdfio_obj_t	*obj,			// Image object
+		*mask_obj;		// Mask image object, if any
+  pdfio_stream_t *st,			// Image stream
+		*mask_st;		// Mask image stream, if any
+  size_t	width,			// Width in columns
+		height,			// Height in lines
+		depth,			// Bit depth
+		num_colors,		// Number of colors
+		y,			// Number of lines written or read
+		max_lines;		// Maximum lines in buffers
+  bool		alpha,			// Alpha channel?
+		reading;		// Reading the image?
+  unsigned char	*lines,			// Image lines buffer for alpha split or reading
+		*mask_lines;		// Mask lines buffer for alpha split or reading
+  // Reading state...
+  size_t	mask_width,		// Width of mask image, if any
+		mask_height,		// Height of mask image, if any
+		src_colors,		// Number of colors in image data
+		base_colors,		// Number of colors in base color space
+		num_color_key;		// Number of color key mask values
+  unsigned	color_key[8];		// Color key mask ranges
+  uint16_t	*samples;		// Unpacked samples for a line
+  unsigned char	*colors,		// Base colors for a line
+		*alphas,		// Alpha values for a line
+		*palette,		// Indexed color palette, if any
+		decode[4][256];		// Decode lookup tables
+};
 
 
 //
 // Local functions...
 //
 
-static pdfio_obj_t	*copy_jpeg(pdfio_dict_t *dict, int fd);
-static pdfio_obj_t	*copy_png(pdfio_dict_t *dict, int fd);
+static void		cached_font_error_cb(_pdfio_cfont_t *cfont, const char *message);
+static pdfio_obj_t	*copy_image(pdfio_file_t *pdf, _pdfio_imgsrc_t *src, const char *filename, bool interpolate);
+static pdfio_obj_t	*copy_jpeg(pdfio_dict_t *dict, _pdfio_imgsrc_t *src);
+static pdfio_obj_t	*copy_png(pdfio_dict_t *dict, _pdfio_imgsrc_t *src);
+static pdfio_obj_t	*copy_png_chunks(pdfio_dict_t *dict, _pdfio_imgsrc_t *src);
+static void		clear_gstate(pdfio_stream_t *st, _pdfio_gitem_t item);
 static bool		create_cp1252(pdfio_file_t *pdf);
-static pdfio_obj_t	*create_font(pdfio_obj_t *file_obj, ttf_t *font, bool unicode);
+static pdfio_obj_t	*create_font(pdfio_obj_t *file_obj, ttf_t *font, bool unicode, _pdfio_subset_t *subset, _pdfio_cfont_t *cfont);
 static pdfio_obj_t	*create_image(pdfio_dict_t *dict, const unsigned char *data, size_t width, size_t height, size_t depth, size_t num_colors, bool alpha);
+static pdfio_array_t	*create_widths(pdfio_file_t *pdf, const int *widths, size_t num_widths);
+static int		get_advance(pdfio_fontmetrics_t *fm, int ch);
+static const short	*get_base_widths(const char *basefont);
+static _pdfio_cfont_t	*get_cached_font(pdfio_file_t *pdf, const char *filename, int fd, bool unicode);
+static size_t		get_image_colors(const char *cs_name, pdfio_array_t *cs_array);
+static bool		get_resource_digest(pdfio_file_t *pdf, uint8_t *digest, const char *params, pdfio_array_t *colors, const void *data, size_t datalen, int fd);
+static int		*get_widths(ttf_t *font, size_t *num_widths);
+static int		map_cp1252(int ch);
 #ifdef HAVE_LIBPNG
 static void		png_error_func(png_structp pp, png_const_charp message);
 static void		png_read_func(png_structp png_ptr, png_bytep data, size_t length);
 #endif // HAVE_LIBPNG
+static ssize_t		read_image(_pdfio_imgsrc_t *src, void *buffer, size_t bytes);
+static void		release_font(ttf_t *font);
+static bool		rewind_image(_pdfio_imgsrc_t *src);
+static bool		scale_image(pdfio_image_t *image, const unsigned char *data, size_t width, size_t height, size_t bpp);
+static void		split_alpha(unsigned char *colors, unsigned char *alpha, const unsigned char *data, size_t num_pixels, size_t num_colors, size_t bpc);
+static pdfio_image_t	*start_image(pdfio_dict_t *dict, size_t width, size_t height, size_t depth, size_t num_colors, bool alpha);
 static void		ttf_error_cb(pdfio_file_t *pdf, const char *message);
-#ifndef HAVE_LIBPNG
+static void		unpack_samples(uint16_t *samples, const unsigned char *line, size_t count, size_t depth);
+static bool		update_gstate(pdfio_stream_t *st, _pdfio_gitem_t item, const char *op, const char *name, size_t num_values, ...);
 static unsigned		update_png_crc(unsigned crc, const unsigned char *buffer, size_t length);
-#endif // !HAVE_LIBPNG
 static bool		write_array(pdfio_stream_t *st, pdfio_array_t *a);
 static bool		write_dict(pdfio_stream_t *st, pdfio_dict_t *dict);
 static bool		write_string(pdfio_stream_t *st, bool unicode, const char *s, bool *newline);
@@ -141,7 +224,37 @@ static int	_pdfio_cp1252[] =	// CP1252-specific character mapping
   0x0178
 };
 
-#ifndef HAVE_LIBPNG
+static const unsigned char _pdfio_cp1252_rev[128] =
+					// Reverse CP1252 mapping, indexed by
+					// (ch ^ (ch >> 8)) & 127
+{
+  0x86, 0x87, 0x95, 0x99, 0x00, 0x00, 0x85, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x80, 0x00, 0x00, 0x00,
+  0x89, 0x00, 0x00, 0x83, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x8B, 0x9B, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x96, 0x97, 0x00, 0x00, 0x00,
+  0x91, 0x92, 0x82, 0x00, 0x93, 0x94, 0x84, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x88, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x9C, 0x8C, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x98, 0x00,
+  0x9A, 0x8A, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x9F, 0x00, 0x00, 0x8E, 0x00, 0x00, 0x9E
+};
+
+static size_t	font_cache_num = 0,	// Number of fonts in shared cache
+		font_cache_alloc = 0;	// Allocated fonts in shared cache
+static _pdfio_cfont_t **font_cache = NULL;
+					// Shared font cache
+#ifdef HAVE_PTHREAD
+static pthread_mutex_t font_cache_mutex = PTHREAD_MUTEX_INITIALIZER;
+					// Mutex for shared font cache
+#endif // HAVE_PTHREAD
+
 static unsigned png_crc_table[256] =	// CRC-32 table for PNG files
 {
   0x00000000, 0x77073096, 0xee0e612c, 0x990951ba, 0x076dc419, 0x706af48f,
@@ -188,7 +301,6 @@ static unsigned png_crc_table[256] =	// CRC-32 table for PNG files
   0x54de5729, 0x23d967bf, 0xb3667a2e, 0xc4614ab8, 0x5d681b02, 0x2a6f2b94,
   0xb40bbe37, 0xc30c8ea1, 0x5a05df1b, 0x2d02ef8d
 };
-#endif // !HAVE_LIBPNG
 
 
 //
@@ -449,8 +561,10 @@ pdfioArrayCreateColorFromStandard(
         return (pdfioArrayCreateColorFromMatrix(pdf, num_colors, 2.2, srgb_matrix, d65_white_point));
 
     case PDFIO_CS_CGATS001 :
+        _pdfioFileLock(pdf);
         if (!pdf->cgats001_obj)
           pdf->cgats001_obj = pdfioFileCreateICCObjFromData(pdf, CGATS001Compat_v2_micro_icc, sizeof(CGATS001Compat_v2_micro_icc), num_colors);
+        _pdfioFileUnlock(pdf);
 
         return (pdfioArrayCreateColorFromICCObj(pdf, pdf->cgats001_obj));
 
@@ -509,6 +623,8 @@ pdfioContentBeginMarked(
   }
 
   // Make sure we have the MarkInfo dictionary in the catalog...
+  _pdfioFileLock(st->pdf);
+
   if (!st->pdf->markinfo)
   {
     st->pdf->markinfo = pdfioDictCreate(st->pdf);
@@ -516,6 +632,8 @@ pdfioContentBeginMarked(
     pdfioDictSetDict(pdfioObjGetDict(st->pdf->root_obj), "MarkInfo", st->pdf->markinfo);
   }
 
+  _pdfioFileUnlock(st->pdf);
+
   return (true);
 }
 
@@ -606,7 +724,7 @@ pdfioContentMatrixConcat(
     pdfio_stream_t *st,			// I - Stream
     pdfio_matrix_t m)			// I - Transform matrix
 {
-  return (pdfioStreamPrintf(st, "%.6f %.6f %.6f %.6f %.6f %.6f cm\n", m[0][0], m[0][1], m[1][0], m[1][1], m[2][0], m[2][1]));
+  return (_pdfioStreamWriteReals(st, "cm", 6, m[0][0], m[0][1], m[1][0], m[1][1], m[2][0], m[2][1]));
 }
 
 
@@ -625,7 +743,7 @@ pdfioContentMatrixRotate(
 					// Sine
 
 
-  return (pdfioStreamPrintf(st, "%.6f %.6f %.6f %.6f 0 0 cm\n", dcos, -dsin, dsin, dcos));
+  return (_pdfioStreamWriteReals(st, "cm", 6, dcos, -dsin, dsin, dcos, 0.0, 0.0));
 }
 
 
@@ -639,7 +757,7 @@ pdfioContentMatrixScale(
     double         sx,			// I - X scale
     double         sy)			// I - Y scale
 {
-  return (pdfioStreamPrintf(st, "%.6f 0 0 %.6f 0 0 cm\n", sx, sy));
+  return (_pdfioStreamWriteReals(st, "cm", 6, sx, 0.0, 0.0, sy, 0.0, 0.0));
 }
 
 
@@ -653,7 +771,7 @@ pdfioContentMatrixTranslate(
     double         tx,			// I - X offset
     double         ty)			// I - Y offset
 {
-  return (pdfioStreamPrintf(st, "1 0 0 1 %.6f %.6f cm\n", tx, ty));
+  return (_pdfioStreamWriteReals(st, "cm", 6, 1.0, 0.0, 0.0, 1.0, tx, ty));
 }
 
 
@@ -683,7 +801,7 @@ pdfioContentPathCurve(
     double         x3,			// I - X position 3
     double         y3)			// I - Y position 3
 {
-  return (pdfioStreamPrintf(st, "%.6f %.6f %.6f %.6f %.6f %.6f c\n", x1, y1, x2, y2, x3, y3));
+  return (_pdfioStreamWriteCoords(st, "c", 6, x1, y1, x2, y2, x3, y3));
 }
 
 
@@ -699,7 +817,7 @@ pdfioContentPathCurve13(
     double         x3,			// I - X position 3
     double         y3)			// I - Y position 3
 {
-  return (pdfioStreamPrintf(st, "%.6f %.6f %.6f %.6f v\n", x1, y1, x3, y3));
+  return (_pdfioStreamWriteCoords(st, "v", 4, x1, y1, x3, y3));
 }
 
 
@@ -715,7 +833,7 @@ pdfioContentPathCurve23(
     double         x3,			// I - X position 3
     double         y3)			// I - Y position 3
 {
-  return (pdfioStreamPrintf(st, "%.6f %.6f %.6f %.6f y\n", x2, y2, x3, y3));
+  return (_pdfioStreamWriteCoords(st, "y", 4, x2, y2, x3, y3));
 }
 
 
@@ -742,7 +860,7 @@ pdfioContentPathLineTo(
     double         x,			// I - X position
     double         y)			// I - Y position
 {
-  return (pdfioStreamPrintf(st, "%.6f %.6f l\n", x, y));
+  return (_pdfioStreamWriteCoords(st, "l", 2, x, y));
 }
 
 
@@ -756,7 +874,99 @@ pdfioContentPathMoveTo(
     double         x,			// I - X position
     double         y)			// I - Y position
 {
-  return (pdfioStreamPrintf(st, "%.6f %.6f m\n", x, y));
+  return (_pdfioStreamWriteCoords(st, "m", 2, x, y));
+}
+
+
+//
+// 'pdfioContentPathPolygon()' - Add a closed polygon to the current path.
+//
+// This function adds a closed subpath connecting "num_points" points.  The
+// "points" parameter points to an array of X and Y coordinate pairs.
+//
+// @since PDFio v1.7@
+//
+
+bool					// O - `true` on success, `false` on failure
+pdfioContentPathPolygon(
+    pdfio_stream_t *st,			// I - Stream
+    size_t         num_points,		// I - Number of points
+    const double   *points)		// I - X and Y coordinate pairs
+{
+  return (pdfioContentPathPolyline(st, num_points, points) && pdfioContentPathClose(st));
+}
+
+
+//
+// 'pdfioContentPathPolyline()' - Add connected lines to the current path.
+//
+// This function starts a new subpath at the first point and adds straight
+// lines to each of the remaining points.  The "points" parameter points to an
+// array of "num_points" X and Y coordinate pairs.  The operators for all of the
+// points are formatted into a local buffer that is written to the stream in
+// large blocks.
+//
+// @since PDFio v1.7@
+//
+
+bool					// O - `true` on success, `false` on failure
+pdfioContentPathPolyline(
+    pdfio_stream_t *st,			// I - Stream
+    size_t         num_points,		// I - Number of points
+    const double   *points)		// I - X and Y coordinate pairs
+{
+  char		buffer[8192],		// Output buffer
+		*bufptr,		// Pointer into buffer
+		*bufend = buffer + sizeof(buffer) - 64,
+					// End of buffer less room for one point
+		*xend,			// End of X value
+		*yend;			// End of Y value
+  char		op = 'm';		// Current operator
+  int		digits;			// Number of decimal places
+  bool		compact;		// Omit leading zeros?
+
+
+  // Range check input...
+  if (!st || !num_points || !points)
+    return (false);
+
+  digits  = st->pdf->precision;
+  compact = digits < 6;
+
+  // Format the points...
+  for (bufptr = buffer; num_points > 0; num_points --, points += 2, op = 'l')
+  {
+    if (bufptr >= bufend)
+    {
+      // Flush the buffer...
+      if (!pdfioStreamWrite(st, buffer, (size_t)(bufptr - buffer)))
+        return (false);
+
+      bufptr = buffer;
+    }
+
+    if ((xend = _pdfio_ftoa(bufptr, points[0], digits, compact)) != NULL && (yend = _pdfio_ftoa(xend + 1, points[1], digits, compact)) != NULL)
+    {
+      *xend     = ' ';
+      bufptr    = yend;
+      *bufptr++ = ' ';
+      *bufptr++ = op;
+      *bufptr++ = '\n';
+    }
+    else
+    {
+      // Out of range number, flush the buffer and fall back to printf...
+      if (bufptr > buffer && !pdfioStreamWrite(st, buffer, (size_t)(bufptr - buffer)))
+        return (false);
+
+      bufptr = buffer;
+
+      if (!pdfioStreamPrintf(st, "%.6f %.6f %c\n", points[0], points[1], op))
+        return (false);
+    }
+  }
+
+  return (bufptr == buffer || pdfioStreamWrite(st, buffer, (size_t)(bufptr - buffer)));
 }
 
 
@@ -772,7 +982,7 @@ pdfioContentPathRect(
     double         width,		// I - Width
     double         height)		// I - Height
 {
-  return (pdfioStreamPrintf(st, "%.6f %.6f %.6f %.6f re\n", x, y, width, height));
+  return (_pdfioStreamWriteCoords(st, "re", 4, x, y, width, height));
 }
 
 
@@ -784,6 +994,16 @@ bool					// O - `true` on success, `false` on failure
 pdfioContentRestore(
     pdfio_stream_t *st)			// I - Stream
 {
+  if (st && st->gstates)
+  {
+    // Pop the graphics state, forgetting everything if the matching save is
+    // not in this stream...
+    if (st->num_gstates > 1)
+      st->num_gstates --;
+    else
+      st->gstates[0].valid = 0;
+  }
+
   return (pdfioStreamPuts(st, "Q\n"));
 }
 
@@ -795,6 +1015,28 @@ pdfioContentRestore(
 bool					// O - `true` on success, `false` on failure
 pdfioContentSave(pdfio_stream_t *st)	// I - Stream
 {
+  if (st && st->gstates)
+  {
+    // Push a copy of the current graphics state...
+    if (st->num_gstates >= st->alloc_gstates)
+    {
+      _pdfio_gstate_t *temp = (_pdfio_gstate_t *)realloc(st->gstates, (st->alloc_gstates + 8) * sizeof(_pdfio_gstate_t));
+					// New graphics state stack
+
+      if (!temp)
+      {
+        _pdfioFileError(st->pdf, "Unable to allocate memory for graphics state.");
+        return (false);
+      }
+
+      st->gstates       = temp;
+      st->alloc_gstates += 8;
+    }
+
+    st->gstates[st->num_gstates] = st->gstates[st->num_gstates - 1];
+    st->num_gstates ++;
+  }
+
   return (pdfioStreamPuts(st, "q\n"));
 }
 
@@ -814,11 +1056,26 @@ pdfioContentSetDashPattern(
     double         off)			// I - Off length
 {
   if (on <= 0.0 && off <= 0.0)
+  {
+    if (!update_gstate(st, _PDFIO_GITEM_DASH, "d", NULL, 3, phase, 0.0, 0.0))
+      return (true);
+
     return (pdfioStreamPrintf(st, "[] %.6f d\n", phase));
+  }
   else if (fabs(on - off) < 0.001)
+  {
+    if (!update_gstate(st, _PDFIO_GITEM_DASH, "d", NULL, 3, phase, on, on))
+      return (true);
+
     return (pdfioStreamPrintf(st, "[%.6f] %.6f d\n", on, phase));
+  }
   else
+  {
+    if (!update_gstate(st, _PDFIO_GITEM_DASH, "d", NULL, 3, phase, on, off))
+      return (true);
+
     return (pdfioStreamPrintf(st, "[%.6f %.6f] %.6f d\n", on, off, phase));
+  }
 }
 
 
@@ -834,7 +1091,10 @@ pdfioContentSetFillColorDeviceCMYK(
     double         y,			// I - Yellow value (0.0 to 1.0)
     double         k)			// I - Black value (0.0 to 1.0)
 {
-  return (pdfioStreamPrintf(st, "%.6f %.6f %.6f %.6f k\n", c, m, y, k));
+  if (!update_gstate(st, _PDFIO_GITEM_FILL, "k", NULL, 4, c, m, y, k))
+    return (true);
+
+  return (_pdfioStreamWriteReals(st, "k", 4, c, m, y, k));
 }
 
 
@@ -847,7 +1107,10 @@ pdfioContentSetFillColorDeviceGray(
     pdfio_stream_t *st,			// I - Stream
     double         g)			// I - Gray value (0.0 to 1.0)
 {
-  return (pdfioStreamPrintf(st, "%.6f g\n", g));
+  if (!update_gstate(st, _PDFIO_GITEM_FILL, "g", NULL, 1, g))
+    return (true);
+
+  return (_pdfioStreamWriteReals(st, "g", 1, g));
 }
 
 
@@ -862,7 +1125,10 @@ pdfioContentSetFillColorDeviceRGB(
     double         g,			// I - Green value (0.0 to 1.0)
     double         b)			// I - Blue value (0.0 to 1.0)
 {
-  return (pdfioStreamPrintf(st, "%.6f %.6f %.6f rg\n", r, g, b));
+  if (!update_gstate(st, _PDFIO_GITEM_FILL, "rg", NULL, 3, r, g, b))
+    return (true);
+
+  return (_pdfioStreamWriteReals(st, "rg", 3, r, g, b));
 }
 
 
@@ -875,7 +1141,10 @@ pdfioContentSetFillColorGray(
     pdfio_stream_t *st,			// I - Stream
     double         g)			// I - Gray value (0.0 to 1.0)
 {
-  return (pdfioStreamPrintf(st, "%.6f sc\n", g));
+  if (!update_gstate(st, _PDFIO_GITEM_FILL, "sc", NULL, 1, g))
+    return (true);
+
+  return (_pdfioStreamWriteReals(st, "sc", 1, g));
 }
 
 
@@ -890,7 +1159,10 @@ pdfioContentSetFillColorRGB(
     double         g,			// I - Green value (0.0 to 1.0)
     double         b)			// I - Blue value (0.0 to 1.0)
 {
-  return (pdfioStreamPrintf(st, "%.6f %.6f %.6f sc\n", r, g, b));
+  if (!update_gstate(st, _PDFIO_GITEM_FILL, "sc", NULL, 3, r, g, b))
+    return (true);
+
+  return (_pdfioStreamWriteReals(st, "sc", 3, r, g, b));
 }
 
 
@@ -903,6 +1175,9 @@ pdfioContentSetFillColorSpace(
     pdfio_stream_t *st,			// I - Stream
     const char     *name)		// I - Color space name
 {
+  // Setting the color space also sets the initial fill color...
+  clear_gstate(st, _PDFIO_GITEM_FILL);
+
   return (pdfioStreamPrintf(st, "%N cs\n", name));
 }
 
@@ -916,7 +1191,7 @@ pdfioContentSetFlatness(
     pdfio_stream_t *st,			// I - Stream
     double         flatness)		// I - Flatness value (0.0 to 100.0)
 {
-  return (pdfioStreamPrintf(st, "%.6f i\n", flatness));
+  return (_pdfioStreamWriteReals(st, "i", 1, flatness));
 }
 
 
@@ -929,6 +1204,9 @@ pdfioContentSetLineCap(
     pdfio_stream_t  *st,		// I - Stream
     pdfio_linecap_t lc)			// I - Line cap value
 {
+  if (!update_gstate(st, _PDFIO_GITEM_LINE_CAP, "J", NULL, 1, (double)lc))
+    return (true);
+
   return (pdfioStreamPrintf(st, "%d J\n", lc));
 }
 
@@ -942,6 +1220,9 @@ pdfioContentSetLineJoin(
     pdfio_stream_t   *st,		// I - Stream
     pdfio_linejoin_t lj)		// I - Line join value
 {
+  if (!update_gstate(st, _PDFIO_GITEM_LINE_JOIN, "j", NULL, 1, (double)lj))
+    return (true);
+
   return (pdfioStreamPrintf(st, "%d j\n", lj));
 }
 
@@ -955,7 +1236,10 @@ pdfioContentSetLineWidth(
     pdfio_stream_t *st,			// I - Stream
     double         width)		// I - Line width value
 {
-  return (pdfioStreamPrintf(st, "%.6f w\n", width));
+  if (!update_gstate(st, _PDFIO_GITEM_LINE_WIDTH, "w", NULL, 1, width))
+    return (true);
+
+  return (_pdfioStreamWriteReals(st, "w", 1, width));
 }
 
 
@@ -968,7 +1252,63 @@ pdfioContentSetMiterLimit(
     pdfio_stream_t *st,			// I - Stream
     double         limit)		// I - Miter limit value
 {
-  return (pdfioStreamPrintf(st, "%.6f M\n", limit));
+  return (_pdfioStreamWriteReals(st, "M", 1, limit));
+}
+
+
+//
+// 'pdfioContentSetStateTracking()' - Set whether to skip redundant graphics
+//                                    state operators.
+//
+// This function controls whether the stream remembers the current fill and
+// stroke colors, line width, line cap, line join, dash pattern, text font and
+// size, and text matrix.  When tracking is enabled, the `pdfioContentSet...`
+// functions do not write operators that would not change the current state,
+// and the state is saved and restored by the @link pdfioContentSave@ and
+// @link pdfioContentRestore@ functions.  Nothing is written to the stream by
+// this function.  The default is `false`.
+//
+// The state starts out unknown, so the first call of each kind is always
+// written.  Operators written directly using @link pdfioStreamPuts@ or
+// @link pdfioStreamPrintf@ are not tracked, so applications that mix their own
+// graphics state operators with the PDFio content functions should not enable
+// state tracking.
+//
+// @since PDFio v1.7@
+//
+
+bool					// O - `true` on success, `false` on failure
+pdfioContentSetStateTracking(
+    pdfio_stream_t *st,			// I - Stream
+    bool           value)		// I - `true` to skip redundant operators, `false` to write all operators
+{
+  // Range check input...
+  if (!st || st->pdf->mode != _PDFIO_MODE_WRITE)
+    return (false);
+
+  if (value && !st->gstates)
+  {
+    // Start with an unknown graphics state...
+    if ((st->gstates = (_pdfio_gstate_t *)calloc(8, sizeof(_pdfio_gstate_t))) == NULL)
+    {
+      _pdfioFileError(st->pdf, "Unable to allocate memory for graphics state.");
+      return (false);
+    }
+
+    st->num_gstates   = 1;
+    st->alloc_gstates = 8;
+  }
+  else if (!value && st->gstates)
+  {
+    // Stop tracking...
+    free(st->gstates);
+
+    st->gstates       = NULL;
+    st->num_gstates   = 0;
+    st->alloc_gstates = 0;
+  }
+
+  return (true);
 }
 
 
@@ -984,7 +1324,10 @@ pdfioContentSetStrokeColorDeviceCMYK(
     double         y,			// I - Yellow value (0.0 to 1.0)
     double         k)			// I - Black value (0.0 to 1.0)
 {
-  return (pdfioStreamPrintf(st, "%.6f %.6f %.6f %.6f K\n", c, m, y, k));
+  if (!update_gstate(st, _PDFIO_GITEM_STROKE, "K", NULL, 4, c, m, y, k))
+    return (true);
+
+  return (_pdfioStreamWriteReals(st, "K", 4, c, m, y, k));
 }
 
 
@@ -997,7 +1340,10 @@ pdfioContentSetStrokeColorDeviceGray(
     pdfio_stream_t *st,			// I - Stream
     double         g)			// I - Gray value (0.0 to 1.0)
 {
-  return (pdfioStreamPrintf(st, "%.6f G\n", g));
+  if (!update_gstate(st, _PDFIO_GITEM_STROKE, "G", NULL, 1, g))
+    return (true);
+
+  return (_pdfioStreamWriteReals(st, "G", 1, g));
 }
 
 
@@ -1012,7 +1358,10 @@ pdfioContentSetStrokeColorDeviceRGB(
     double         g,			// I - Green value (0.0 to 1.0)
     double         b)			// I - Blue value (0.0 to 1.0)
 {
-  return (pdfioStreamPrintf(st, "%.6f %.6f %.6f RG\n", r, g, b));
+  if (!update_gstate(st, _PDFIO_GITEM_STROKE, "RG", NULL, 3, r, g, b))
+    return (true);
+
+  return (_pdfioStreamWriteReals(st, "RG", 3, r, g, b));
 }
 
 
@@ -1025,7 +1374,10 @@ pdfioContentSetStrokeColorGray(
     pdfio_stream_t *st,			// I - Stream
     double         g)			// I - Gray value (0.0 to 1.0)
 {
-  return (pdfioStreamPrintf(st, "%.6f SC\n", g));
+  if (!update_gstate(st, _PDFIO_GITEM_STROKE, "SC", NULL, 1, g))
+    return (true);
+
+  return (_pdfioStreamWriteReals(st, "SC", 1, g));
 }
 
 
@@ -1040,7 +1392,10 @@ pdfioContentSetStrokeColorRGB(
     double         g,			// I - Green value (0.0 to 1.0)
     double         b)			// I - Blue value (0.0 to 1.0)
 {
-  return (pdfioStreamPrintf(st, "%.6f %.6f %.6f SC\n", r, g, b));
+  if (!update_gstate(st, _PDFIO_GITEM_STROKE, "SC", NULL, 3, r, g, b))
+    return (true);
+
+  return (_pdfioStreamWriteReals(st, "SC", 3, r, g, b));
 }
 
 
@@ -1053,6 +1408,9 @@ pdfioContentSetStrokeColorSpace(
     pdfio_stream_t *st,			// I - Stream
     const char     *name)		// I - Color space name
 {
+  // Setting the color space also sets the initial stroke color...
+  clear_gstate(st, _PDFIO_GITEM_STROKE);
+
   return (pdfioStreamPrintf(st, "%N CS\n", name));
 }
 
@@ -1066,7 +1424,7 @@ pdfioContentSetTextCharacterSpacing(
     pdfio_stream_t *st,			// I - Stream
     double         spacing)		// I - Character spacing
 {
-  return (pdfioStreamPrintf(st, "%.6f Tc\n", spacing));
+  return (_pdfioStreamWriteReals(st, "Tc", 1, spacing));
 }
 
 
@@ -1080,6 +1438,30 @@ pdfioContentSetTextFont(
     const char     *name,		// I - Font name
     double         size)		// I - Font size
 {
+  if (st && st->fonts)
+  {
+    // Track the glyphs used for subset fonts...
+    pdfio_obj_t	*obj = pdfioDictGetObj(st->fonts, name);
+					// Font object
+    size_t	i;			// Looping var
+
+    _pdfioFileLock(st->pdf);
+
+    for (i = 0, st->subset = NULL; i < st->pdf->num_subsets; i ++)
+    {
+      if (st->pdf->subsets[i]->font_obj == obj)
+      {
+        st->subset = st->pdf->subsets[i];
+        break;
+      }
+    }
+
+    _pdfioFileUnlock(st->pdf);
+  }
+
+  if (name && !update_gstate(st, _PDFIO_GITEM_FONT, "Tf", name, 1, size))
+    return (true);
+
   return (pdfioStreamPrintf(st, "%N %.6f Tf\n", name, size));
 }
 
@@ -1093,7 +1475,7 @@ pdfioContentSetTextLeading(
     pdfio_stream_t *st,			// I - Stream
     double         leading)		// I - Leading (line height) value
 {
-  return (pdfioStreamPrintf(st, "%.6f TL\n", leading));
+  return (_pdfioStreamWriteReals(st, "TL", 1, leading));
 }
 
 
@@ -1106,7 +1488,10 @@ pdfioContentSetTextMatrix(
     pdfio_stream_t *st,			// I - Stream
     pdfio_matrix_t m)			// I - Transform matrix
 {
-  return (pdfioStreamPrintf(st, "%.6f %.6f %.6f %.6f %.6f %.6f Tm\n", m[0][0], m[0][1], m[1][0], m[1][1], m[2][0], m[2][1]));
+  if (!update_gstate(st, _PDFIO_GITEM_TEXT_MATRIX, "Tm", NULL, 6, m[0][0], m[0][1], m[1][0], m[1][1], m[2][0], m[2][1]))
+    return (true);
+
+  return (_pdfioStreamWriteReals(st, "Tm", 6, m[0][0], m[0][1], m[1][0], m[1][1], m[2][0], m[2][1]));
 }
 
 
@@ -1132,7 +1517,7 @@ pdfioContentSetTextRise(
     pdfio_stream_t *st,			// I - Stream
     double         rise)		// I - Y offset
 {
-  return (pdfioStreamPrintf(st, "%.6f Ts\n", rise));
+  return (_pdfioStreamWriteReals(st, "Ts", 1, rise));
 }
 
 
@@ -1145,7 +1530,7 @@ pdfioContentSetTextWordSpacing(
     pdfio_stream_t *st,			// I - Stream
     double         spacing)		// I - Spacing between words
 {
-  return (pdfioStreamPrintf(st, "%.6f Tw\n", spacing));
+  return (_pdfioStreamWriteReals(st, "Tw", 1, spacing));
 }
 
 
@@ -1158,7 +1543,7 @@ pdfioContentSetTextXScaling(
     pdfio_stream_t *st,			// I - Stream
     double         percent)		// I - Horizontal scaling in percent
 {
-  return (pdfioStreamPrintf(st, "%.6f Tz\n", percent));
+  return (_pdfioStreamWriteReals(st, "Tz", 1, percent));
 }
 
 
@@ -1181,7 +1566,13 @@ bool					// O - `true` on success, `false` on failure
 pdfioContentTextBegin(
     pdfio_stream_t *st)			// I - Stream
 {
-  return (pdfioStreamPuts(st, "BT\n"));
+  if (!pdfioStreamPuts(st, "BT\n"))
+    return (false);
+
+  // Each text block starts with the identity text matrix...
+  update_gstate(st, _PDFIO_GITEM_TEXT_MATRIX, "Tm", NULL, 6, 1.0, 0.0, 0.0, 1.0, 0.0, 0.0);
+
+  return (true);
 }
 
 
@@ -1192,6 +1583,8 @@ pdfioContentTextBegin(
 bool					// O - `true` on success, `false` on failure
 pdfioContentTextEnd(pdfio_stream_t *st)	// I - Stream
 {
+  clear_gstate(st, _PDFIO_GITEM_TEXT_MATRIX);
+
   return (pdfioStreamPuts(st, "ET\n"));
 }
 
@@ -1203,6 +1596,10 @@ pdfioContentTextEnd(pdfio_stream_t *st)	// I - Stream
 // on "size". The text string must always use the UTF-8 (Unicode) encoding but
 // any control characters (such as newlines) are ignored.
 //
+// Programs that measure a lot of text with the same font should use the
+// @link pdfioFontMetricsCreate@ and @link pdfioFontMetricsMeasure@ functions
+// instead.
+//
 // @since PDFio v1.2@
 //
 
@@ -1227,90 +1624,46 @@ pdfioContentTextMeasure(
     const short	*widths;		// Widths
     int		width = 0;		// Current width
 
-    if (strcmp(basefont, "Symbol") && strcmp(basefont, "Zapf-Dingbats"))
-    {
-      // Map non-CP1282 characters to '?', everything else as-is...
-      tempptr = temp;
+    // Map non-CP1252 characters to '?', everything else as-is, like the
+    // pdfioContentTextShow functions do for all base fonts...
+    tempptr = temp;
 
-      while (*s && tempptr < (temp + sizeof(temp) - 3))
+    while (*s && tempptr < (temp + sizeof(temp) - 3))
+    {
+      if ((*s & 0xe0) == 0xc0)
       {
-	if ((*s & 0xe0) == 0xc0)
-	{
-	  // Two-byte UTF-8
-	  ch = ((s[0] & 0x1f) << 6) | (s[1] & 0x3f);
-	  s += 2;
-	}
-	else if ((*s & 0xf0) == 0xe0)
-	{
-	  // Three-byte UTF-8
-	  ch = ((s[0] & 0x0f) << 12) | ((s[1] & 0x3f) << 6) | (s[2] & 0x3f);
-	  s += 3;
-	}
-	else if ((*s & 0xf8) == 0xf0)
-	{
-	  // Four-byte UTF-8
-	  ch = ((s[0] & 0x07) << 18) | ((s[1] & 0x3f) << 12) | ((s[2] & 0x3f) << 6) | (s[3] & 0x3f);
-	  s += 4;
-	}
-	else
-	{
-	  ch = *s++;
-	}
-
-	if (ch > 255)
-	{
-	  // Try mapping from Unicode to CP1252...
-	  size_t i;			// Looping var
-
-	  for (i = 0; i < (sizeof(_pdfio_cp1252) / sizeof(_pdfio_cp1252[0])); i ++)
-	  {
-	    if (ch == _pdfio_cp1252[i])
-	      break;
-	  }
-
-	  if (i < (sizeof(_pdfio_cp1252) / sizeof(_pdfio_cp1252[0])))
-	    ch = (int)(i + 0x80);	// Extra characters from 0x80 to 0x9f
-	  else
-	    ch = '?';			// Unsupported chars map to ?
-	}
-
-	*tempptr++ = (char)ch;
+	// Two-byte UTF-8
+	ch = ((s[0] & 0x1f) << 6) | (s[1] & 0x3f);
+	s += 2;
+      }
+      else if ((*s & 0xf0) == 0xe0)
+      {
+	// Three-byte UTF-8
+	ch = ((s[0] & 0x0f) << 12) | ((s[1] & 0x3f) << 6) | (s[2] & 0x3f);
+	s += 3;
+      }
+      else if ((*s & 0xf8) == 0xf0)
+      {
+	// Four-byte UTF-8
+	ch = ((s[0] & 0x07) << 18) | ((s[1] & 0x3f) << 12) | ((s[2] & 0x3f) << 6) | (s[3] & 0x3f);
+	s += 4;
+      }
+      else
+      {
+	ch = *s++;
       }
 
-      *tempptr = '\0';
-      s        = temp;
+      if (ch > 255)
+	ch = map_cp1252(ch);		// Try mapping from Unicode to CP1252
+
+      *tempptr++ = (char)ch;
     }
 
+    *tempptr = '\0';
+    s        = temp;
+
     // Choose the appropriate table...
-    if (!strcmp(basefont, "Courier"))
-      widths = courier_widths;
-    else if (!strcmp(basefont, "Courier-Bold"))
-      widths = courier_bold_widths;
-    else if (!strcmp(basefont, "Courier-BoldOblique"))
-      widths = courier_boldoblique_widths;
-    else if (!strcmp(basefont, "Courier-Oblique"))
-      widths = courier_oblique_widths;
-    else if (!strcmp(basefont, "Helvetica"))
-      widths = helvetica_widths;
-    else if (!strcmp(basefont, "Helvetica-Bold"))
-      widths = helvetica_bold_widths;
-    else if (!strcmp(basefont, "Helvetica-BoldOblique"))
-      widths = helvetica_boldoblique_widths;
-    else if (!strcmp(basefont, "Helvetica-Oblique"))
-      widths = helvetica_oblique_widths;
-    else if (!strcmp(basefont, "Symbol"))
-      widths = symbol_widths;
-    else if (!strcmp(basefont, "Times-Bold"))
-      widths = times_bold_widths;
-    else if (!strcmp(basefont, "Times-BoldItalic"))
-      widths = times_bolditalic_widths;
-    else if (!strcmp(basefont, "Times-Italic"))
-      widths = times_italic_widths;
-    else if (!strcmp(basefont, "Times-Roman"))
-      widths = times_roman_widths;
-    else if (!strcmp(basefont, "ZapfDingbats"))
-      widths = zapfdingbats_widths;
-    else
+    if ((widths = get_base_widths(basefont)) == NULL)
       return (0.0);
 
     // Calculate the width using the corresponding table...
@@ -1340,7 +1693,9 @@ pdfioContentTextMoveLine(
     double         tx,			// I - X offset
     double         ty)			// I - Y offset
 {
-  return (pdfioStreamPrintf(st, "%.6f %.6f TD\n", tx, ty));
+  clear_gstate(st, _PDFIO_GITEM_TEXT_MATRIX);
+
+  return (_pdfioStreamWriteCoords(st, "TD", 2, tx, ty));
 }
 
 
@@ -1354,7 +1709,9 @@ pdfioContentTextMoveTo(
     double         tx,			// I - X offset
     double         ty)			// I - Y offset
 {
-  return (pdfioStreamPrintf(st, "%.6f %.6f Td\n", tx, ty));
+  clear_gstate(st, _PDFIO_GITEM_TEXT_MATRIX);
+
+  return (_pdfioStreamWriteCoords(st, "Td", 2, tx, ty));
 }
 
 
@@ -1368,6 +1725,8 @@ bool					// O - `true` on success, `false` on failure
 pdfioContentTextNewLine(
     pdfio_stream_t *st)			// I - Stream
 {
+  clear_gstate(st, _PDFIO_GITEM_TEXT_MATRIX);
+
   return (pdfioStreamPuts(st, "T*\n"));
 }
 
@@ -1382,6 +1741,8 @@ bool					// O - `true` on success, `false` on failure
 pdfioContentTextNextLine(
     pdfio_stream_t *st)			// I - Stream
 {
+  clear_gstate(st, _PDFIO_GITEM_TEXT_MATRIX);
+
   return (pdfioStreamPuts(st, "T*\n"));
 }
 
@@ -1409,6 +1770,9 @@ pdfioContentTextNewLineShow(
   char	op;				// Text operator
 
 
+  // Showing text moves the text matrix...
+  clear_gstate(st, _PDFIO_GITEM_TEXT_MATRIX);
+
   // Write word and/or character spacing as needed...
   if (ws > 0.0 || cs > 0.0)
   {
@@ -1487,6 +1851,9 @@ pdfioContentTextShow(
   bool	newline = false;		// New line?
 
 
+  // Showing text moves the text matrix...
+  clear_gstate(st, _PDFIO_GITEM_TEXT_MATRIX);
+
   // Write the string...
   if (!write_string(st, unicode, s, &newline))
     return (false);
@@ -1524,6 +1891,9 @@ pdfioContentTextShowf(
   vsnprintf(buffer, sizeof(buffer), format, ap);
   va_end(ap);
 
+  // Showing text moves the text matrix...
+  clear_gstate(st, _PDFIO_GITEM_TEXT_MATRIX);
+
   // Write the string...
   if (!write_string(st, unicode, buffer, &newline))
     return (false);
@@ -1555,6 +1925,9 @@ pdfioContentTextShowJustified(
   size_t	i;			// Looping var
 
 
+  // Showing text moves the text matrix...
+  clear_gstate(st, _PDFIO_GITEM_TEXT_MATRIX);
+
   // Write an array of offsets and string fragments...
   if (!pdfioStreamPuts(st, "["))
     return (false);
@@ -1696,7 +2069,7 @@ pdfioFileAddOutputIntent(
 // - "Times-Roman"
 // - "ZapfDingbats"
 //
-// Aside from "Symbol" and "Zapf-Dingbats", Base fonts use the Windows CP1252
+// Aside from "Symbol" and "ZapfDingbats", Base fonts use the Windows CP1252
 // (ISO-8859-1 with additional characters such as the Euro symbol) subset of
 // Unicode.
 //
@@ -1775,6 +2148,9 @@ pdfioFileCreateFontObjFromData(
 		*file_obj = NULL;	// File object
   pdfio_dict_t	*file;			// Font file dictionary
   pdfio_stream_t *st = NULL;		// Font stream
+  uint8_t	digest[32];		// Resource digest
+  bool		cached;			// Use the resource cache?
+  _pdfio_subset_t *subset = NULL;	// Font subset, if any
 
 
   // Range check input...
@@ -1787,9 +2163,28 @@ pdfioFileCreateFontObjFromData(
     return (NULL);
   }
 
+  // Reuse an identical font as needed...
+  if ((cached = get_resource_digest(pdf, digest, unicode ? "font/unicode" : "font", NULL, data, datasize, -1)) && (obj = _pdfioFileFindDigest(pdf, digest)) != NULL)
+    return (obj);
+
+  // Subset Unicode fonts with TrueType outlines as needed, using a copy of the
+  // data since the glyphs are not read until the PDF file is closed...
+  if (pdf->subset_fonts && unicode && datasize > 4 && (!memcmp(data, "\000\001\000\000", 4) || !memcmp(data, "true", 4)))
+  {
+    if ((subset = (_pdfio_subset_t *)calloc(1, sizeof(_pdfio_subset_t))) == NULL || (subset->data = malloc(datasize)) == NULL)
+    {
+      _pdfioFileError(pdf, "Unable to allocate memory for font subset.");
+      free(subset);
+      return (NULL);
+    }
+
+    memcpy(subset->data, data, datasize);
+    data = subset->data;
+  }
+
   // Create a TrueType font object from the data...
   if ((font = ttfCreateData(data, datasize, 0, (ttf_err_cb_t)ttf_error_cb, pdf)) == NULL)
-    return (NULL);
+    goto error;
 
   // Create the font file dictionary and object...
   if ((file = pdfioDictCreate(pdf)) == NULL)
@@ -1800,18 +2195,34 @@ pdfioFileCreateFontObjFromData(
   if ((file_obj = pdfioFileCreateObj(pdf, file)) == NULL)
     goto error;
 
-  if ((st = pdfioObjCreateStream(file_obj, PDFIO_FILTER_FLATE)) == NULL)
-    goto error;
+  if (!subset)
+  {
+    // Embed the whole font...
+    if ((st = pdfioObjCreateStream(file_obj, PDFIO_FILTER_FLATE)) == NULL)
+      goto error;
 
-  if (!pdfioStreamWrite(st, data, datasize))
-    goto error;
+    if (!pdfioStreamWrite(st, data, datasize))
+      goto error;
 
-  pdfioStreamClose(st);
+    pdfioStreamClose(st);
+  }
 
   // Create the font object...
-  if ((obj = create_font(file_obj, font, unicode)) == NULL)
+  if ((obj = create_font(file_obj, font, unicode, subset, /*cfont*/NULL)) == NULL)
+  {
     ttfDelete(font);
 
+    if (subset)
+    {
+      free(subset->data);
+      free(subset);
+    }
+  }
+  else if (cached)
+  {
+    obj = _pdfioFileAddDigest(pdf, digest, obj);
+  }
+
   return (obj);
 
   // If we get here we had an unrecoverable error...
@@ -1824,6 +2235,12 @@ pdfioFileCreateFontObjFromData(
 
   ttfDelete(font);
 
+  if (subset)
+  {
+    free(subset->data);
+    free(subset);
+  }
+
   return (NULL);
 }
 
@@ -1844,7 +2261,7 @@ pdfioFileCreateFontObjFromFile(
     const char   *filename,		// I - Filename
     bool         unicode)		// I - Force Unicode
 {
-  ttf_t		*font;			// TrueType font
+  ttf_t		*font = NULL;		// TrueType font
   pdfio_dict_t	*file;			// Font file dictionary
   pdfio_obj_t	*obj,			// Font object
 		*file_obj = NULL;	// Font file object
@@ -1852,6 +2269,10 @@ pdfioFileCreateFontObjFromFile(
   int		fd = -1;		// File
   unsigned char	buffer[16384];		// Read buffer
   ssize_t	bytes;			// Bytes read
+  uint8_t	digest[32];		// Resource digest
+  bool		cached;			// Use the resource cache?
+  _pdfio_subset_t *subset = NULL;	// Font subset, if any
+  _pdfio_cfont_t *cfont = NULL;		// Cached font, if any
 
 
   // Range check input...
@@ -1870,8 +2291,40 @@ pdfioFileCreateFontObjFromFile(
     return (NULL);
   }
 
-  if ((font = ttfCreate(filename, 0, (ttf_err_cb_t)ttf_error_cb, pdf)) == NULL)
+  // Reuse an identical font as needed...
+  if ((cached = get_resource_digest(pdf, digest, unicode ? "font/unicode" : "font", NULL, NULL, 0, fd)) && (obj = _pdfioFileFindDigest(pdf, digest)) != NULL)
+  {
+    close(fd);
+    return (obj);
+  }
+
+  // Subset Unicode fonts with TrueType outlines as needed...
+  if (pdf->subset_fonts && unicode)
+  {
+    if (read(fd, buffer, 4) == 4 && (!memcmp(buffer, "\000\001\000\000", 4) || !memcmp(buffer, "true", 4)))
+    {
+      if ((subset = (_pdfio_subset_t *)calloc(1, sizeof(_pdfio_subset_t))) == NULL)
+      {
+	_pdfioFileError(pdf, "Unable to allocate memory for font subset.");
+	goto error;
+      }
+    }
+
+    lseek(fd, 0, SEEK_SET);
+  }
+
+  if (pdf->font_cache && !subset)
+  {
+    // Use the shared font cache...
+    if ((cfont = get_cached_font(pdf, filename, fd, unicode)) == NULL)
+      goto error;
+
+    font = cfont->font;
+  }
+  else if ((font = ttfCreate(filename, 0, (ttf_err_cb_t)ttf_error_cb, pdf)) == NULL)
+  {
     goto error;
+  }
 
   // Create the font file dictionary and object...
   if ((file = pdfioDictCreate(pdf)) == NULL)
@@ -1882,24 +2335,50 @@ pdfioFileCreateFontObjFromFile(
   if ((file_obj = pdfioFileCreateObj(pdf, file)) == NULL)
     goto error;
 
-  if ((st = pdfioObjCreateStream(file_obj, PDFIO_FILTER_FLATE)) == NULL)
-    goto error;
+  if (cfont)
+  {
+    // Copy the compressed font from the cache...
+    if ((st = pdfioObjCreateStream(file_obj, PDFIO_FILTER_NONE)) == NULL)
+      goto error;
 
-  while ((bytes = read(fd, buffer, sizeof(buffer))) > 0)
+    if (!pdfioStreamWrite(st, cfont->data, cfont->datalen))
+      goto error;
+
+    pdfioStreamClose(st);
+  }
+  else if (!subset)
   {
-    if (!pdfioStreamWrite(st, buffer, (size_t)bytes))
+    // Embed the whole font...
+    if ((st = pdfioObjCreateStream(file_obj, PDFIO_FILTER_FLATE)) == NULL)
       goto error;
+
+    while ((bytes = read(fd, buffer, sizeof(buffer))) > 0)
+    {
+      if (!pdfioStreamWrite(st, buffer, (size_t)bytes))
+	goto error;
+    }
+
+    pdfioStreamClose(st);
   }
 
   close(fd);
 
-  pdfioStreamClose(st);
-
   // Create the font object...
-  if ((obj = create_font(file_obj, font, unicode)) == NULL)
-    ttfDelete(font);
-
-  return (obj);
+  if ((obj = create_font(file_obj, font, unicode, subset, cfont)) == NULL)
+  {
+    if (cfont)
+      release_font(font);
+    else
+      ttfDelete(font);
+
+    free(subset);
+  }
+  else if (cached)
+  {
+    obj = _pdfioFileAddDigest(pdf, digest, obj);
+  }
+
+  return (obj);
 
   // If we get here we had an unrecoverable error...
   error:
@@ -1912,7 +2391,12 @@ pdfioFileCreateFontObjFromFile(
   else
     pdfioObjClose(file_obj);
 
-  ttfDelete(font);
+  if (cfont)
+    release_font(font);
+  else
+    ttfDelete(font);
+
+  free(subset);
 
   return (NULL);
 }
@@ -1932,6 +2416,9 @@ pdfioFileCreateICCObjFromData(
   pdfio_dict_t	*dict;			// ICC profile dictionary
   pdfio_obj_t	*obj;			// ICC profile object
   pdfio_stream_t *st;			// ICC profile stream
+  char		params[32];		// Resource options
+  uint8_t	digest[32];		// Resource digest
+  bool		cached;			// Use the resource cache?
 
 
   // Range check input...
@@ -1950,6 +2437,12 @@ pdfioFileCreateICCObjFromData(
     return (NULL);
   }
 
+  // Reuse an identical ICC profile as needed...
+  snprintf(params, sizeof(params), "icc %lu", (unsigned long)num_colors);
+
+  if ((cached = get_resource_digest(pdf, digest, params, NULL, data, datalen, -1)) && (obj = _pdfioFileFindDigest(pdf, digest)) != NULL)
+    return (obj);
+
   // Create the ICC profile object...
   if ((dict = pdfioDictCreate(pdf)) == NULL)
     return (NULL);
@@ -1968,6 +2461,9 @@ pdfioFileCreateICCObjFromData(
 
   pdfioStreamClose(st);
 
+  if (obj && cached)
+    obj = _pdfioFileAddDigest(pdf, digest, obj);
+
   return (obj);
 }
 
@@ -1988,6 +2484,9 @@ pdfioFileCreateICCObjFromFile(
   int		fd;			// File
   unsigned char	buffer[16384];		// Read buffer
   ssize_t	bytes;			// Bytes read
+  char		params[32];		// Resource options
+  uint8_t	digest[32];		// Resource digest
+  bool		cached;			// Use the resource cache?
 
 
   // Range check input...
@@ -2013,6 +2512,15 @@ pdfioFileCreateICCObjFromFile(
     return (NULL);
   }
 
+  // Reuse an identical ICC profile as needed...
+  snprintf(params, sizeof(params), "icc %lu", (unsigned long)num_colors);
+
+  if ((cached = get_resource_digest(pdf, digest, params, NULL, NULL, 0, fd)) && (obj = _pdfioFileFindDigest(pdf, digest)) != NULL)
+  {
+    close(fd);
+    return (obj);
+  }
+
   // Create the ICC profile object...
   if ((dict = pdfioDictCreate(pdf)) == NULL)
   {
@@ -2048,10 +2556,98 @@ pdfioFileCreateICCObjFromFile(
   close(fd);
   pdfioStreamClose(st);
 
+  if (cached)
+    obj = _pdfioFileAddDigest(pdf, digest, obj);
+
   return (obj);
 }
 
 
+//
+// 'pdfioFileCreateImage()' - Start writing an image object to a PDF file.
+//
+// This function starts writing an image object to a PDF file one or more lines
+// at a time, so that the whole image never needs to be held in memory.  The
+// "width" and "height" parameters specify the image dimensions.  The "depth"
+// parameter specifies the bits per component (`1`, `2`, `4`, `8`, or `16`) and
+// the "num_colors" parameter specifies the number of color components (`1` for
+// grayscale, `3` for RGB, and `4` for CMYK).  The "alpha" parameter specifies
+// whether each color tuple is followed by an alpha value - images with alpha
+// must use a depth of `8` or `16`.  The "color_data" parameter specifies an
+// optional color space array for the image - if `NULL`, the image is encoded
+// in the corresponding device color space.  The "interpolate" parameter
+// specifies whether to interpolate when scaling the image on the page.
+//
+// The image lines are written using the @link pdfioImageWriteRows@ function,
+// and the image is finished using the @link pdfioImageClose@ function.  Lines
+// with a depth of `16` use big-endian component values and lines with a depth
+// less than `8` are packed with the most significant bits first.
+//
+// Like other streams, no other object can be written to the PDF file while
+// the image is being written unless the file uses staged streams (see
+// @link pdfioFileSetStagedStreams@).  The alpha values are written to a
+// separate "soft mask" image object that is compressed in memory and written
+// when the image is closed.
+//
+// > Note: Images written with this function are not shared using the resource
+// > cache.  PDF/A-1 files do not support alpha-based transparency.
+//
+// @since PDFio v1.7@
+//
+
+pdfio_image_t *				// O - Image or `NULL` on error
+pdfioFileCreateImage(
+    pdfio_file_t  *pdf,			// I - PDF file
+    size_t        width,		// I - Width of image
+    size_t        height,		// I - Height of image
+    size_t        depth,		// I - Bits per component
+    size_t        num_colors,		// I - Number of colors
+    pdfio_array_t *color_data,		// I - Colorspace data or `NULL` for default
+    bool          alpha,		// I - `true` if data contains an alpha channel
+    bool          interpolate)		// I - Interpolate image data?
+{
+  pdfio_dict_t		*dict;		// Image dictionary
+  static const char	*defcolors[] =	// Default ColorSpace values
+  {
+    NULL,
+    "DeviceGray",
+    NULL,
+    "DeviceRGB",
+    "DeviceCMYK"
+  };
+
+
+  if (pdf && pdf->profile >= _PDFIO_PROFILE_PDFA_1A && pdf->profile <= _PDFIO_PROFILE_PDFA_1B && alpha)
+  {
+    _pdfioFileError(pdf, "Images with transparency (alpha channels) are not allowed in PDF/A-1 files.");
+    return (NULL);
+  }
+
+  // Range check input...
+  if (!pdf || !width || !height || num_colors < 1 || num_colors == 2 || num_colors > 4 || (depth != 1 && depth != 2 && depth != 4 && depth != 8 && depth != 16) || (alpha && depth < 8))
+    return (NULL);
+
+  // Create the image dictionary...
+  if ((dict = pdfioDictCreate(pdf)) == NULL)
+    return (NULL);
+
+  pdfioDictSetName(dict, "Type", "XObject");
+  pdfioDictSetName(dict, "Subtype", "Image");
+  pdfioDictSetBoolean(dict, "Interpolate", interpolate);
+  pdfioDictSetNumber(dict, "Width", (double)width);
+  pdfioDictSetNumber(dict, "Height", (double)height);
+  pdfioDictSetNumber(dict, "BitsPerComponent", (double)depth);
+
+  if (color_data)
+    pdfioDictSetArray(dict, "ColorSpace", color_data);
+  else
+    pdfioDictSetName(dict, "ColorSpace", defcolors[num_colors]);
+
+  // Start writing the image object(s)...
+  return (start_image(dict, width, height, depth, num_colors, alpha));
+}
+
+
 //
 // 'pdfioFileCreateImageObjFromData()' - Add image object(s) to a PDF file from memory.
 //
@@ -2082,15 +2678,11 @@ pdfioFileCreateImageObjFromData(
     bool                alpha,		// I - `true` if data contains an alpha channel
     bool                interpolate)	// I - Interpolate image data?
 {
-  pdfio_dict_t		*dict;		// Image dictionary
-  static const char	*defcolors[] =	// Default ColorSpace values
-  {
-    NULL,
-    "DeviceGray",
-    NULL,
-    "DeviceRGB",
-    "DeviceCMYK"
-  };
+  pdfio_image_t		*image;		// Image
+  pdfio_obj_t		*obj;		// Image object
+  char			params[128];	// Resource options
+  uint8_t		digest[32];	// Resource digest
+  bool			cached;		// Use the resource cache?
 
 
   if (pdf && pdf->profile >= _PDFIO_PROFILE_PDFA_1A && pdf->profile <= _PDFIO_PROFILE_PDFA_1B && alpha)
@@ -2103,24 +2695,68 @@ pdfioFileCreateImageObjFromData(
   if (!pdf || !data || !width || !height || num_colors < 1 || num_colors == 2 || num_colors > 4)
     return (NULL);
 
-  // Create the image dictionary...
-  if ((dict = pdfioDictCreate(pdf)) == NULL)
+  // Reuse an identical image as needed...
+  snprintf(params, sizeof(params), "image %lux%lux%lu %d %d", (unsigned long)width, (unsigned long)height, (unsigned long)num_colors, alpha, interpolate);
+
+  if ((cached = get_resource_digest(pdf, digest, params, color_data, data, width * height * (num_colors + (alpha ? 1 : 0)), -1)) && (obj = _pdfioFileFindDigest(pdf, digest)) != NULL)
+    return (obj);
+
+  // Write the image object(s)...
+  if ((image = pdfioFileCreateImage(pdf, width, height, 8, num_colors, color_data, alpha, interpolate)) == NULL)
     return (NULL);
 
-  pdfioDictSetName(dict, "Type", "XObject");
-  pdfioDictSetName(dict, "Subtype", "Image");
-  pdfioDictSetBoolean(dict, "Interpolate", interpolate);
-  pdfioDictSetNumber(dict, "Width", (double)width);
-  pdfioDictSetNumber(dict, "Height", (double)height);
-  pdfioDictSetNumber(dict, "BitsPerComponent", 8);
+  if (!pdfioImageWriteRows(image, data, height))
+  {
+    pdfioImageClose(image);
+    return (NULL);
+  }
+
+  if ((obj = pdfioImageClose(image)) != NULL && cached)
+    obj = _pdfioFileAddDigest(pdf, digest, obj);
+
+  return (obj);
+}
+
+
+//
+// 'pdfioFileCreateImageObjFromEncodedData()' - Add an image object to a PDF
+//                                              file from JPEG or PNG data.
+//
+// This function creates an image object in a PDF file from JPEG or PNG file
+// data in memory, for example an image received over the network.  The
+// "data" and "datalen" parameters specify the JPEG or PNG data, while the
+// "interpolate" parameter specifies whether to interpolate when scaling the
+// image on the page.
+//
+// > Note: PNG data containing transparency cannot be used when producing
+// > PDF/A files.
+//
+// @since PDFio v1.7@
+//
+
+pdfio_obj_t *				// O - Object
+pdfioFileCreateImageObjFromEncodedData(
+    pdfio_file_t        *pdf,		// I - PDF file
+    const unsigned char *data,		// I - JPEG or PNG data
+    size_t              datalen,	// I - Length of JPEG or PNG data
+    bool                interpolate)	// I - Interpolate image data?
+{
+  _pdfio_imgsrc_t	src;		// Image source
 
-  if (color_data)
-    pdfioDictSetArray(dict, "ColorSpace", color_data);
-  else
-    pdfioDictSetName(dict, "ColorSpace", defcolors[num_colors]);
 
-  // Create the image object(s)...
-  return (create_image(dict, data, width, height, 8, num_colors, alpha));
+  PDFIO_DEBUG("pdfioFileCreateImageObjFromEncodedData(pdf=%p, data=%p, datalen=%lu, interpolate=%s)\n", (void *)pdf, (void *)data, (unsigned long)datalen, interpolate ? "true" : "false");
+
+  // Range check input...
+  if (!pdf || !data || !datalen)
+    return (NULL);
+
+  // Copy the image...
+  src.fd      = -1;
+  src.data    = data;
+  src.dataptr = data;
+  src.dataend = data + datalen;
+
+  return (copy_image(pdf, &src, /*filename*/NULL, interpolate));
 }
 
 
@@ -2142,11 +2778,8 @@ pdfioFileCreateImageObjFromFile(
     const char   *filename,		// I - Filename
     bool         interpolate)		// I - Interpolate image data?
 {
-  pdfio_dict_t	*dict;			// Image dictionary
   pdfio_obj_t	*obj;			// Image object
-  int		fd;			// File
-  unsigned char	buffer[32];		// Read buffer
-  _pdfio_image_func_t copy_func = NULL;	// Image copy function
+  _pdfio_imgsrc_t src;			// Image source
 
 
   PDFIO_DEBUG("pdfioFileCreateImageObjFromFile(pdf=%p, filename=\"%s\", interpolate=%s)\n", (void *)pdf, filename, interpolate ? "true" : "false");
@@ -2156,1541 +2789,3828 @@ pdfioFileCreateImageObjFromFile(
     return (NULL);
 
   // Try opening the file...
-  if ((fd = open(filename, O_RDONLY | O_BINARY)) < 0)
+  memset(&src, 0, sizeof(src));
+
+  if ((src.fd = open(filename, O_RDONLY | O_BINARY)) < 0)
   {
     _pdfioFileError(pdf, "Unable to open image file '%s': %s", filename, strerror(errno));
     return (NULL);
   }
 
-  // Read the file header to determine the file format...
-  if (read(fd, buffer, sizeof(buffer)) < (ssize_t)sizeof(buffer))
-  {
-    _pdfioFileError(pdf, "Unable to read header from image file '%s'.", filename);
-    close(fd);
+  // Copy the image, close the file, and return the object...
+  obj = copy_image(pdf, &src, filename, interpolate);
+
+  close(src.fd);
+
+  return (obj);
+}
+
+
+//
+// 'pdfioFileCreateScaledImageObjFromData()' - Add a downsampled image object
+//                                             to a PDF file from memory.
+//
+// This function creates image object(s) in a PDF file from a data buffer in
+// memory like @link pdfioFileCreateImageObjFromData@, but first downsamples
+// the image so that it is no larger than needed for the intended output size.
+// The "box_width" and "box_height" parameters specify the size of the box in
+// points (1/72nd inch) that the image will be drawn into, and the
+// "resolution" parameter specifies the target resolution in pixels per inch.
+//
+// The image is scaled uniformly using area averaging so that its aspect ratio
+// is preserved and the effective resolution is at least "resolution" in both
+// directions when the image is fit within the box.  Images that are already
+// small enough are written unchanged.  Use @link pdfioImageGetWidth@ and
+// @link pdfioImageGetHeight@ to get the dimensions of the resulting image.
+//
+// @since PDFio v1.7@
+//
+
+pdfio_obj_t *				// O - Object
+pdfioFileCreateScaledImageObjFromData(
+    pdfio_file_t        *pdf,		// I - PDF file
+    const unsigned char *data,		// I - Pointer to image data
+    size_t              width,		// I - Width of image
+    size_t              height,		// I - Height of image
+    size_t              num_colors,	// I - Number of colors
+    pdfio_array_t       *color_data,	// I - Colorspace data or `NULL` for default
+    bool                alpha,		// I - `true` if data contains an alpha channel
+    bool                interpolate,	// I - Interpolate image data?
+    double              box_width,	// I - Width of output box in points
+    double              box_height,	// I - Height of output box in points
+    double              resolution)	// I - Target resolution in pixels per inch
+{
+  pdfio_image_t		*image;		// Image
+  pdfio_obj_t		*obj;		// Image object
+  double		scale,		// Scaling factor
+			yscale;		// Vertical scaling factor
+  size_t		out_width,	// Output width
+			out_height;	// Output height
+  char			params[160];	// Resource options
+  uint8_t		digest[32];	// Resource digest
+  bool			cached;		// Use the resource cache?
+
+
+  // Range check input...
+  if (!pdf || !data || !width || !height || num_colors < 1 || num_colors == 2 || num_colors > 4 || box_width <= 0.0 || box_height <= 0.0 || resolution <= 0.0)
     return (NULL);
-  }
 
-  lseek(fd, 0, SEEK_SET);
+  // Compute the output size, using the smaller scaling factor since the image
+  // is fit within the box...
+  scale = box_width * resolution / 72.0 / (double)width;
+  if ((yscale = box_height * resolution / 72.0 / (double)height) < scale)
+    scale = yscale;
 
-  PDFIO_DEBUG("pdfioFileCreateImageObjFromFile: buffer=<%02X%02X%02X%02X%02X%02X%02X%02X%02X%02X%02X%02X%02X%02X%02X%02X%02X%02X%02X%02X%02X%02X%02X%02X%02X%02X%02X%02X%02X%02X%02X%02X>\n", buffer[0], buffer[1], buffer[2], buffer[3], buffer[4], buffer[5], buffer[6], buffer[7], buffer[8], buffer[9], buffer[10], buffer[11], buffer[12], buffer[13], buffer[14], buffer[15], buffer[16], buffer[17], buffer[18], buffer[19], buffer[20], buffer[21], buffer[22], buffer[23], buffer[24], buffer[25], buffer[26], buffer[27], buffer[28], buffer[29], buffer[30], buffer[31]);
+  if ((out_width = (size_t)((double)width * scale + 0.5)) < 1)
+    out_width = 1;
+  if ((out_height = (size_t)((double)height * scale + 0.5)) < 1)
+    out_height = 1;
 
-  if (!memcmp(buffer, "\211PNG\015\012\032\012\000\000\000\015IHDR", 16))
-  {
-    // PNG image...
-    copy_func = copy_png;
-  }
-  else if (!memcmp(buffer, "\377\330\377", 3))
+  PDFIO_DEBUG("pdfioFileCreateScaledImageObjFromData: scale=%g, out_width=%lu, out_height=%lu\n", scale, (unsigned long)out_width, (unsigned long)out_height);
+
+  if (out_width >= width || out_height >= height)
   {
-   // JPEG image...
-    copy_func = copy_jpeg;
+    // No downsampling needed...
+    return (pdfioFileCreateImageObjFromData(pdf, data, width, height, num_colors, color_data, alpha, interpolate));
   }
-  else
+
+  if (pdf->profile >= _PDFIO_PROFILE_PDFA_1A && pdf->profile <= _PDFIO_PROFILE_PDFA_1B && alpha)
   {
-    // Something else that isn't supported...
-    _pdfioFileError(pdf, "Unsupported image file '%s'.", filename);
-    close(fd);
+    _pdfioFileError(pdf, "Images with transparency (alpha channels) are not allowed in PDF/A-1 files.");
     return (NULL);
   }
 
-  // Create the base image dictionary the copy the file into an object...
-  if ((dict = pdfioDictCreate(pdf)) == NULL)
+  // Reuse an identical image as needed...
+  snprintf(params, sizeof(params), "image %lux%lux%lu %d %d %lux%lu", (unsigned long)width, (unsigned long)height, (unsigned long)num_colors, alpha, interpolate, (unsigned long)out_width, (unsigned long)out_height);
+
+  if ((cached = get_resource_digest(pdf, digest, params, color_data, data, width * height * (num_colors + (alpha ? 1 : 0)), -1)) && (obj = _pdfioFileFindDigest(pdf, digest)) != NULL)
+    return (obj);
+
+  // Write the downsampled image object(s)...
+  if ((image = pdfioFileCreateImage(pdf, out_width, out_height, 8, num_colors, color_data, alpha, interpolate)) == NULL)
+    return (NULL);
+
+  if (!scale_image(image, data, width, height, num_colors + (alpha ? 1 : 0)))
   {
-    close(fd);
+    pdfioImageClose(image);
     return (NULL);
   }
 
-  pdfioDictSetName(dict, "Type", "XObject");
-  pdfioDictSetName(dict, "Subtype", "Image");
-  pdfioDictSetBoolean(dict, "Interpolate", interpolate);
-
-  obj = (copy_func)(dict, fd);
-
-  // Close the file and return the object...
-  close(fd);
+  if ((obj = pdfioImageClose(image)) != NULL && cached)
+    obj = _pdfioFileAddDigest(pdf, digest, obj);
 
   return (obj);
 }
 
 
 //
-// 'pdfioImageGetBytesPerLine()' - Get the number of bytes to read for each line.
+// '_pdfioFileWriteSubsets()' - Write the subset fonts for a PDF file.
+//
+// This function writes the font file, CIDToGIDMap, and widths for each
+// subset font using the characters that were shown in the page content
+// streams.
 //
 
-size_t					// O - Number of bytes per line or `0` on error
-pdfioImageGetBytesPerLine(
-    pdfio_obj_t *obj)			// I - Image object
+bool					// O - `true` on success, `false` on failure
+_pdfioFileWriteSubsets(
+    pdfio_file_t *pdf)			// I - PDF file
 {
-  pdfio_dict_t	*params;		// DecodeParms value
-  int		width,			// Width of image
-		bpc,			// BitsPerComponent of image
-		colors;			// Number of colors in image
+  bool		ret = false;		// Return value
+  size_t	i;			// Looping var
+  _pdfio_subset_t *subset;		// Current subset
+  ttf_t		*font;			// TrueType font
+  const int	*cmap;			// Character to glyph map
+  size_t	num_cmap;		// Number of characters
+  int		ch,			// Current character (CID)
+		max_ch,			// Last character used
+		gid,			// Glyph number
+		num_gids;		// Number of glyphs in subset
+  unsigned char	glyphs[8192],		// Glyphs used
+		*data,			// Subset font data
+		*bufptr;		// Pointer into buffer
+  size_t	datasize;		// Size of subset font data
+  unsigned short *gids = NULL;		// Subset glyph numbers
+  unsigned char	*buffer = NULL;		// CIDToGIDMap buffer
+  pdfio_stream_t *st;			// Stream
+  pdfio_array_t	*w_array,		// Width array
+		*temp_array = NULL;	// Widths for a run of characters
+
+
+  if (pdf->num_subsets == 0)
+    return (true);
+
+  // Allocate the glyph number and CIDToGIDMap buffers, which are too large for
+  // the stack of a worker thread...
+  if ((gids = (unsigned short *)malloc(65536 * sizeof(unsigned short))) == NULL || (buffer = (unsigned char *)malloc(131072)) == NULL)
+  {
+    _pdfioFileError(pdf, "Unable to allocate memory for font subsets.");
+    goto done;
+  }
 
+  for (i = 0; i < pdf->num_subsets; i ++)
+  {
+    subset = pdf->subsets[i];
+    font   = (ttf_t *)_pdfioObjGetExtension(subset->font_obj);
+    cmap   = ttfGetCMap(font, &num_cmap);
 
-  if (!obj || obj->value.type != PDFIO_VALTYPE_DICT)
-    return (0);
+    if (num_cmap > 65536)
+      num_cmap = 65536;
 
-  params = pdfioDictGetDict(obj->value.value.dict, "DecodeParms");
-  bpc    = (int)pdfioDictGetNumber(params, "BitsPerComponent");
-  colors = (int)pdfioDictGetNumber(params, "Colors");
-  width  = (int)pdfioDictGetNumber(params, "Columns");
+    // Find the glyphs that are used...
+    memset(glyphs, 0, sizeof(glyphs));
 
-  if (width == 0)
-    width = (int)pdfioDictGetNumber(obj->value.value.dict, "Width");
+    for (ch = 0, max_ch = 0; ch < (int)num_cmap; ch ++)
+    {
+      if ((subset->cids[ch / 8] & (1 << (ch & 7))) && cmap[ch] > 0 && cmap[ch] < 65536)
+      {
+        glyphs[cmap[ch] / 8] |= 1 << (cmap[ch] & 7);
+        max_ch = ch;
+      }
+    }
 
-  if (bpc == 0)
-  {
-    if ((bpc = (int)pdfioDictGetNumber(obj->value.value.dict, "BitsPerComponent")) == 0)
-      bpc = 8;
-  }
+    // Create the subset font, which adds any glyphs used by composite glyphs,
+    // and then number the glyphs in the subset...
+    if ((data = ttfCreateSubset(font, glyphs, &datasize)) == NULL)
+    {
+      _pdfioFileError(pdf, "Unable to create subset of font '%s'.", ttfGetPostScriptName(font));
+      goto done;
+    }
 
-  if (colors == 0)
-  {
-    const char	*cs_name;		// ColorSpace name
-    pdfio_array_t *cs_array;		// ColorSpace array
+    for (gid = 0, num_gids = 0; gid < 65536; gid ++)
+    {
+      gids[gid] = (unsigned short)num_gids;
 
-    if ((cs_name = pdfioDictGetName(obj->value.value.dict, "ColorSpace")) == NULL)
+      if (glyphs[gid / 8] & (1 << (gid & 7)))
+        num_gids ++;
+    }
+
+    // Write the subset font...
+    if ((st = pdfioObjCreateStream(subset->file_obj, PDFIO_FILTER_FLATE)) == NULL)
     {
-      if ((cs_array = pdfioDictGetArray(obj->value.value.dict, "ColorSpace")) != NULL)
-        cs_name = pdfioArrayGetName(cs_array, 0);
+      free(data);
+      goto done;
     }
 
-    if (!cs_name || strstr(cs_name, "RGB"))
-      colors = 3;
-    else if (strstr(cs_name, "CMYK"))
-      colors = 4;
-    else
-      colors = 1;
-  }
+    if (!pdfioStreamWrite(st, data, datasize))
+    {
+      pdfioStreamClose(st);
+      free(data);
+      goto done;
+    }
 
-  if (width < 0)
-  {
-    _pdfioFileError(obj->pdf, "Invalid image width %d.", width);
-    return (0);
-  }
-  else if (bpc != 1 && bpc != 2 && bpc != 4 && bpc != 8 && bpc != 16)
-  {
-    _pdfioFileError(obj->pdf, "Invalid image bits per component %d.", bpc);
-    return (0);
-  }
-  else if (colors < 1 || colors > 4)
-  {
-    _pdfioFileError(obj->pdf, "Invalid image number of colors %d.", colors);
-    return (0);
-  }
-  else
-  {
-    return ((size_t)((width * colors * bpc + 7) / 8));
-  }
-}
+    free(data);
 
+    if (!pdfioStreamClose(st))
+      goto done;
 
-//
-// 'pdfioImageGetHeight()' - Get the height of an image object.
-//
+    // Write the CIDToGIDMap up to the last character used...
+    for (ch = 0, bufptr = buffer; ch <= max_ch; ch ++)
+    {
+      if ((subset->cids[ch / 8] & (1 << (ch & 7))) && cmap[ch] > 0 && cmap[ch] < 65536)
+        gid = gids[cmap[ch]];
+      else
+        gid = 0;
 
-double					// O - Height in lines
-pdfioImageGetHeight(pdfio_obj_t *obj)	// I - Image object
-{
-  if (obj)
-    return (pdfioDictGetNumber(obj->value.value.dict, "Height"));
-  else
-    return (0.0);
-}
+      *bufptr++ = (unsigned char)(gid >> 8);
+      *bufptr++ = (unsigned char)(gid & 255);
+    }
 
+#ifdef DEBUG
+    if ((st = pdfioObjCreateStream(subset->cid2gid_obj, PDFIO_FILTER_NONE)) == NULL)
+#else
+    if ((st = pdfioObjCreateStream(subset->cid2gid_obj, PDFIO_FILTER_FLATE)) == NULL)
+#endif // DEBUG
+      goto done;
 
-//
-// 'pdfioImageGetWidth()' - Get the width of an image object.
-//
+    if (!pdfioStreamWrite(st, buffer, (size_t)(bufptr - buffer)))
+    {
+      pdfioStreamClose(st);
+      goto done;
+    }
 
-double					// O - Width in columns
-pdfioImageGetWidth(pdfio_obj_t *obj)	// I - Image object
-{
-  if (obj)
-    return (pdfioDictGetNumber(obj->value.value.dict, "Width"));
-  else
-    return (0.0);
+    if (!pdfioStreamClose(st))
+      goto done;
+
+    // Write the widths of the characters that are used, with runs of
+    // consecutive characters sharing a sub-array...
+    if ((w_array = pdfioArrayCreate(pdf)) == NULL)
+      goto done;
+
+    for (ch = 0; ch <= max_ch; ch ++)
+    {
+      if (!(subset->cids[ch / 8] & (1 << (ch & 7))) || cmap[ch] <= 0)
+      {
+        temp_array = NULL;
+        continue;
+      }
+
+      if (!temp_array || pdfioArrayGetSize(temp_array) >= 8191)
+      {
+        if ((temp_array = pdfioArrayCreate(pdf)) == NULL)
+          goto done;
+
+        pdfioArrayAppendNumber(w_array, ch);
+        pdfioArrayAppendArray(w_array, temp_array);
+      }
+
+      pdfioArrayAppendNumber(temp_array, ttfGetWidth(font, ch));
+    }
+
+    temp_array = NULL;
+
+    pdfioDictSetArray(pdfioObjGetDict(subset->type2_obj), "W", w_array);
+
+    if (!pdfioObjClose(subset->type2_obj))
+      goto done;
+  }
+
+  ret = true;
+
+  done:
+
+  free(gids);
+  free(buffer);
+
+  return (ret);
 }
 
 
 //
-// 'pdfioPageDictAddColorSpace()' - Add a color space to the page dictionary.
-//
-// This function adds a named color space to the page dictionary.
+// 'pdfioFontCacheClear()' - Free unused fonts in the shared font cache.
 //
-// The names "DefaultCMYK", "DefaultGray", and "DefaultRGB" specify the default
-// device color space used for the page.
+// This function frees the fonts in the shared font cache that are not used by
+// any open PDF file.  See @link pdfioFileSetFontCache@ for details.
 //
-// The "data" array contains a calibrated, indexed, or ICC-based color space
-// array that was created using the
-// @link pdfioArrayCreateCalibratedColorFromMatrix@,
-// @link pdfioArrayCreateCalibratedColorFromPrimaries@,
-// @link pdfioArrayCreateICCBasedColor@, or
-// @link pdfioArrayCreateIndexedColor@ functions.
+// @since PDFio v1.7@
 //
 
-bool					// O - `true` on success, `false` on failure
-pdfioPageDictAddColorSpace(
-    pdfio_dict_t  *dict,		// I - Page dictionary
-    const char    *name,		// I - Color space name
-    pdfio_array_t *data)		// I - Color space array
+void
+pdfioFontCacheClear(void)
 {
-  pdfio_dict_t	*resources;		// Resource dictionary
-  pdfio_dict_t	*colorspace;		// ColorSpace dictionary
+  size_t	i, j;			// Looping vars
+  _pdfio_cfont_t *cfont;		// Current font
 
 
-  // Range check input...
-  if (!dict || !name || !data)
-    return (false);
+#ifdef HAVE_PTHREAD
+  pthread_mutex_lock(&font_cache_mutex);
+#endif // HAVE_PTHREAD
 
-  // Get the ColorSpace dictionary...
-  if ((resources = pdfioDictGetDict(dict, "Resources")) == NULL)
+  for (i = 0, j = 0; i < font_cache_num; i ++)
   {
-    if ((resources = pdfioDictCreate(dict->pdf)) == NULL)
-      return (false);
+    cfont = font_cache[i];
 
-    if (!pdfioDictSetDict(dict, "Resources", resources))
-      return (false);
+    if (cfont->refcount > 0)
+    {
+      // Keep fonts that are in use...
+      font_cache[j ++] = cfont;
+      continue;
+    }
+
+    ttfDelete(cfont->font);
+    free(cfont->filename);
+    free(cfont->data);
+    free(cfont->cid2gid);
+    free(cfont->widths);
+    free(cfont);
   }
 
-  if ((colorspace = pdfioDictGetDict(resources, "ColorSpace")) == NULL)
-  {
-    if ((colorspace = pdfioDictCreate(dict->pdf)) == NULL)
-      return (false);
+  font_cache_num = j;
 
-    if (!pdfioDictSetDict(resources, "ColorSpace", colorspace))
-      return (false);
+  if (font_cache_num == 0)
+  {
+    free(font_cache);
+    font_cache       = NULL;
+    font_cache_alloc = 0;
   }
 
-  // See if this name is already set...
-  if (_pdfioDictGetValue(colorspace, name))
-    return (false);			// Yes, return false
-
-  // Now set the color space reference and return...
-  return (pdfioDictSetArray(colorspace, name, data));
+#ifdef HAVE_PTHREAD
+  pthread_mutex_unlock(&font_cache_mutex);
+#endif // HAVE_PTHREAD
 }
 
 
 //
-// 'pdfioPageDictAddFont()' - Add a font object to the page dictionary.
+// 'pdfioFontMetricsCreate()' - Create a measurement context for a font.
+//
+// This function creates a context for measuring text with the given font
+// object, which must have been created using the
+// @link pdfioFileCreateFontObjFromBase@, @link pdfioFileCreateFontObjFromData@,
+// or @link pdfioFileCreateFontObjFromFile@ functions.  The widths of
+// characters are looked up once and cached in the context, making it much
+// faster than @link pdfioContentTextMeasure@ for measuring many strings.  The
+// widths are the same ones stored in the PDF font object.
+//
+// A context must not be used by more than one thread at a time.  Call the
+// @link pdfioFontMetricsDelete@ function to free the context when you are done
+// with it.
+//
+// @since PDFio v1.7@
 //
 
-bool					// O - `true` on success, `false` on failure
-pdfioPageDictAddFont(
-    pdfio_dict_t *dict,			// I - Page dictionary
-    const char   *name,			// I - Font name; must not contain spaces
-    pdfio_obj_t  *obj)			// I - Font object
+pdfio_fontmetrics_t *			// O - Measurement context or `NULL` on error
+pdfioFontMetricsCreate(
+    pdfio_obj_t *font)			// I - Font object
 {
-  pdfio_dict_t	*resources;		// Resource dictionary
-  pdfio_dict_t	*font;			// Font dictionary
+  pdfio_fontmetrics_t	*fm;		// Measurement context
+  ttf_t			*ttf;		// TrueType font, if any
+  const char		*basefont;	// Base font name
+  const short		*base_widths = NULL;
+					// Base font widths
 
 
   // Range check input...
-  if (!dict || !name || !obj)
-    return (false);
+  if (!font)
+    return (NULL);
 
-  // Get the Resources dictionary...
-  if ((resources = pdfioDictGetDict(dict, "Resources")) == NULL)
+  if ((ttf = (ttf_t *)_pdfioObjGetExtension(font)) == NULL)
   {
-    if ((resources = pdfioDictCreate(dict->pdf)) == NULL)
-      return (false);
-
-    if (!pdfioDictSetDict(dict, "Resources", resources))
-      return (false);
+    if ((basefont = pdfioDictGetName(pdfioObjGetDict(font), "BaseFont")) == NULL || (base_widths = get_base_widths(basefont)) == NULL)
+    {
+      _pdfioFileError(font->pdf, "Unable to measure text with this font.");
+      return (NULL);
+    }
   }
 
-  // Get the Font dictionary...
-  if ((font = pdfioDictGetDict(resources, "Font")) == NULL)
+  // Allocate the context...
+  if ((fm = (pdfio_fontmetrics_t *)calloc(1, sizeof(pdfio_fontmetrics_t))) == NULL)
   {
-    if ((font = pdfioDictCreate(dict->pdf)) == NULL)
-      return (false);
-
-    if (!pdfioDictSetDict(resources, "Font", font))
-      return (false);
+    _pdfioFileError(font->pdf, "Unable to allocate memory for font metrics.");
+    return (NULL);
   }
 
-  // Now set the image reference in the Font resource dictionary and return...
-  return (pdfioDictSetObj(font, name, obj));
+  fm->ttf         = ttf;
+  fm->base_widths = base_widths;
+
+  return (fm);
 }
 
 
 //
-// 'pdfioPageDictAddImage()' - Add an image object to the page dictionary.
+// 'pdfioFontMetricsDelete()' - Free a font measurement context.
+//
+// @since PDFio v1.7@
 //
 
-bool					// O - `true` on success, `false` on failure
-pdfioPageDictAddImage(
-    pdfio_dict_t *dict,			// I - Page dictionary
-    const char   *name,			// I - Image name
-    pdfio_obj_t  *obj)			// I - Image object
+void
+pdfioFontMetricsDelete(
+    pdfio_fontmetrics_t *fm)		// I - Measurement context
 {
-  pdfio_dict_t	*resources;		// Resource dictionary
-  pdfio_dict_t	*xobject;		// XObject dictionary
+  size_t	i;			// Looping var
+
+
+  if (!fm)
+    return;
+
+  for (i = 0; i < (sizeof(fm->widths) / sizeof(fm->widths[0])); i ++)
+    free(fm->widths[i]);
+
+  free(fm);
+}
+
+
+//
+// 'pdfioFontMetricsMeasure()' - Measure a text string using a font
+//                               measurement context.
+//
+// This function measures the given UTF-8 text string "s" and returns its width
+// based on "size".  Control characters (such as newlines) are ignored.
+//
+// If "advances" is not `NULL`, it must point to an array of `strlen(s) + 1`
+// values.  On return, "advances[i]" contains the width of the first "i" bytes
+// of the string, so the width of any substring starting and ending on
+// character boundaries (for example a word) is simply the difference between
+// two values:
+//
+// ```c
+// pdfio_fontmetrics_t *fm = pdfioFontMetricsCreate(font);
+// const char *s = "Hello, World!";
+// double advances[14];
+// double width = pdfioFontMetricsMeasure(fm, s, 12.0, advances);
+//
+// // Width of "World"...
+// double world = advances[12] - advances[7];
+// ```
+//
+// @since PDFio v1.7@
+//
+
+double					// O - Width
+pdfioFontMetricsMeasure(
+    pdfio_fontmetrics_t *fm,		// I - Measurement context
+    const char          *s,		// I - UTF-8 string
+    double              size,		// I - Font size/height
+    double              *advances)	// O - Cumulative widths for each byte or `NULL`
+{
+  const unsigned char	*sptr,		// Pointer into string
+			*start;		// Start of current character
+  int			ch,		// Unicode character
+			width = 0;	// Width in 1/1000ths of an em
+  double		scale;		// Scale for widths
 
 
   // Range check input...
-  if (!dict || !name || !obj)
-    return (false);
+  if (!fm || !s)
+    return (0.0);
 
-  // Get the Resources dictionary...
-  if ((resources = pdfioDictGetDict(dict, "Resources")) == NULL)
+  // Loop through the string...
+  scale = 0.001 * size;
+
+  for (sptr = (const unsigned char *)s; *sptr;)
   {
-    if ((resources = pdfioDictCreate(dict->pdf)) == NULL)
-      return (false);
+    // Get the next Unicode character...
+    start = sptr;
 
-    if (!pdfioDictSetDict(dict, "Resources", resources))
-      return (false);
-  }
+    if (*sptr < 0x80)
+    {
+      // ASCII
+      ch = *sptr++;
+    }
+    else if ((*sptr & 0xe0) == 0xc0 && (sptr[1] & 0xc0) == 0x80)
+    {
+      // Two-byte UTF-8
+      ch   = ((sptr[0] & 0x1f) << 6) | (sptr[1] & 0x3f);
+      sptr += 2;
+    }
+    else if ((*sptr & 0xf0) == 0xe0 && (sptr[1] & 0xc0) == 0x80 && (sptr[2] & 0xc0) == 0x80)
+    {
+      // Three-byte UTF-8
+      ch   = ((sptr[0] & 0x0f) << 12) | ((sptr[1] & 0x3f) << 6) | (sptr[2] & 0x3f);
+      sptr += 3;
+    }
+    else if ((*sptr & 0xf8) == 0xf0 && (sptr[1] & 0xc0) == 0x80 && (sptr[2] & 0xc0) == 0x80 && (sptr[3] & 0xc0) == 0x80)
+    {
+      // Four-byte UTF-8
+      ch   = ((sptr[0] & 0x07) << 18) | ((sptr[1] & 0x3f) << 12) | ((sptr[2] & 0x3f) << 6) | (sptr[3] & 0x3f);
+      sptr += 4;
+    }
+    else
+    {
+      // Invalid UTF-8 (treated as ISO-8859-1)...
+      ch = *sptr++;
+    }
 
-  // Get the XObject dictionary...
-  if ((xobject = pdfioDictGetDict(resources, "XObject")) == NULL)
-  {
-    if ((xobject = pdfioDictCreate(dict->pdf)) == NULL)
-      return (false);
+    // Record the width up to this character...
+    if (advances)
+    {
+      double advance = scale * width;	// Width before this character
 
-    if (!pdfioDictSetDict(resources, "XObject", xobject))
-      return (false);
+      while (start < sptr)
+        advances[(const char *)start++ - s] = advance;
+    }
+
+    // Add the width of this character...
+    if (ch < 0x10000 && fm->widths[ch >> 8])
+      width += fm->widths[ch >> 8][ch & 255];
+    else
+      width += get_advance(fm, ch);
   }
 
-  // Now set the image reference in the XObject resource dictionary and return...
-  return (pdfioDictSetObj(xobject, name, obj));
+  if (advances)
+    advances[(const char *)sptr - s] = scale * width;
+
+  return (scale * width);
 }
 
 
 //
-// 'copy_jpeg()' - Copy a JPEG image.
+// 'pdfioImageClose()' - Finish writing or reading an image object.
+//
+// This function finishes writing an image object started with the
+// @link pdfioFileCreateImage@ function, or reading an image object opened with
+// the @link pdfioImageOpen@ function, and frees the memory used by the image.
+// An error is reported if fewer lines were written than the height of the
+// image.
+//
+// @since PDFio v1.7@
 //
 
-static pdfio_obj_t *			// O - Object or `NULL` on error
-copy_jpeg(pdfio_dict_t *dict,		// I - Dictionary
-          int          fd)		// I - File descriptor
+pdfio_obj_t *				// O - Image object or `NULL` on error
+pdfioImageClose(pdfio_image_t *image)	// I - Image
 {
-  pdfio_obj_t	*obj = NULL;		// Object
-  pdfio_stream_t *st;			// Stream for JPEG data
-  ssize_t	bytes;			// Bytes read
-  unsigned char	buffer[16384],		// Read buffer
-		*bufptr,		// Pointer into buffer
-		*bufend;		// End of buffer
-  int		marker;			// JFIF marker byte
-  size_t	length;			// Length of chunk
-  unsigned	width = 0,		// Width in columns
-		height = 0,		// Height in lines
-		num_colors = 0;		// Number of colors
-  unsigned char	*icc_data = NULL;	// ICC profile data, if any
-  size_t	icc_datalen = 0;	// Length of ICC profile data
-  pdfio_obj_t	*icc_obj;		// ICC profile object
+  bool		ret = true;		// Return value
+  pdfio_obj_t	*obj;			// Image object
 
 
-  // Scan the file for APPn and SOFn markers to get the dimensions and color profile...
-  bytes = read(fd, buffer, sizeof(buffer));
+  // Range check input...
+  if (!image)
+    return (NULL);
 
-  for (bufptr = buffer + 2, bufend = buffer + bytes; bufptr < bufend;)
+  if (!image->reading && image->y < image->height)
   {
-    if ((bufptr + 16) >= bufend)
-    {
-      // Read more of the file...
-      if ((bytes = bufend - bufptr) > 0)
-	memmove(buffer, bufptr, (size_t)bytes);
-
-      bufptr = buffer;
-      bufend = buffer + bytes;
-
-      if ((bytes = read(fd, bufend, sizeof(buffer) - (size_t)bytes)) <= 0)
-      {
-	_pdfioFileError(dict->pdf, "Unable to read JPEG data - %s", strerror(errno));
-	goto finish;
-      }
+    _pdfioFileError(image->pdf, "Only %lu of %lu lines written to image object %u.", (unsigned long)image->y, (unsigned long)image->height, (unsigned)image->obj->number);
+    ret = false;
+  }
 
-      bufend += bytes;
-    }
+  // Close the stream(s), writing the staged mask image after the image...
+  if (!pdfioStreamClose(image->st))
+    ret = false;
 
-    if (*bufptr != _PDFIO_JPEG_MARKER)
-    {
-      _pdfioFileError(dict->pdf, "Invalid JPEG data: <%02X>", *bufptr);
-      goto finish;
-    }
+  if (image->mask_st && !pdfioStreamClose(image->mask_st))
+    ret = false;
 
-    // Start of a marker in the file...
-    bufptr ++;
+  obj = ret ? image->obj : NULL;
 
-    marker = *bufptr;
-    length = (size_t)((bufptr[1] << 8) | bufptr[2]);
-    bufptr += 3;
+  // Free memory and return...
+  free(image->lines);
+  free(image->mask_lines);
+  free(image->samples);
+  free(image->colors);
+  free(image->alphas);
+  free(image->palette);
+  free(image);
 
-    PDFIO_DEBUG("copy_jpeg: JPEG X'FF%02X' (length %u)\n", marker, (unsigned)length);
+  return (obj);
+}
 
-    if (marker == _PDFIO_JPEG_EOI || marker == _PDFIO_JPEG_SOS || length < 2)
-      break;
 
-    length -= 2;
+//
+// 'pdfioImageGetBytesPerLine()' - Get the number of bytes to read for each line.
+//
 
-    if ((marker >= _PDFIO_JPEG_SOF0 && marker <= _PDFIO_JPEG_SOF3) || (marker >= _PDFIO_JPEG_SOF5 && marker <= _PDFIO_JPEG_SOF7) || (marker >= _PDFIO_JPEG_SOF9 && marker <= _PDFIO_JPEG_SOF11) || (marker >= _PDFIO_JPEG_SOF13 && marker <= _PDFIO_JPEG_SOF15))
-    {
-      // SOFn marker, look for dimensions...
-      //
-      // Byte(s)  Description
-      // -------  -------------------
-      // 0        Bits per component
-      // 1-2      Height
-      // 3-4      Width
-      // 5        Number of colors
-      if (bufptr[0] != 8)
-      {
-	_pdfioFileError(dict->pdf, "Unable to load %d-bit JPEG image.", bufptr[0]);
-	goto finish;
-      }
-
-      width      = (unsigned)((bufptr[3] << 8) | bufptr[4]);
-      height     = (unsigned)((bufptr[1] << 8) | bufptr[2]);
-      num_colors = bufptr[5];
-    }
-    else if (marker == _PDFIO_JPEG_APP2 && length > 14 && memcmp(bufptr, "ICC_PROFILE", 12))
-    {
-      // Portion of ICC profile
-      int	n = bufptr[12],		// Chunk number in profile (1-based)
-	      count = bufptr[13];	// Number of chunks
-      unsigned char *icc_temp;	// New ICC buffer
-
-      // Discard "ICC_PROFILE\0" and chunk number/count...
-      bufptr += 14;
-      length -= 14;
+size_t					// O - Number of bytes per line or `0` on error
+pdfioImageGetBytesPerLine(
+    pdfio_obj_t *obj)			// I - Image object
+{
+  pdfio_dict_t	*params;		// DecodeParms value
+  int		width,			// Width of image
+		bpc,			// BitsPerComponent of image
+		colors;			// Number of colors in image
 
-      // Expand our ICC buffer...
-      if ((icc_temp = realloc(icc_data, icc_datalen + length)) == NULL)
-      {
-        free(icc_data);
-	return (NULL);
-      }
-      else
-      {
-	icc_data = icc_temp;
-      }
 
-      // Read the chunk into the ICC buffer...
-      do
-      {
-	if (bufptr >= bufend)
-	{
-	  // Read more of the marker...
-	  if ((bytes = read(fd, buffer, sizeof(buffer))) <= 0)
-	  {
-	    _pdfioFileError(dict->pdf, "Unable to read JPEG data - %s", strerror(errno));
-	    goto finish;
-	  }
+  if (!obj || obj->value.type != PDFIO_VALTYPE_DICT)
+    return (0);
 
-	  bufptr = buffer;
-	  bufend = buffer + bytes;
-	}
+  params = pdfioDictGetDict(obj->value.value.dict, "DecodeParms");
+  bpc    = (int)pdfioDictGetNumber(params, "BitsPerComponent");
+  colors = (int)pdfioDictGetNumber(params, "Colors");
+  width  = (int)pdfioDictGetNumber(params, "Columns");
 
-	// Copy from the file buffer to the ICC buffer
-	if ((bytes = bufend - bufptr) > (ssize_t)length)
-	  bytes = (ssize_t)length;
+  if (width == 0)
+    width = (int)pdfioDictGetNumber(obj->value.value.dict, "Width");
 
-	memcpy(icc_data + icc_datalen, bufptr, bytes);
-	icc_datalen += (size_t)bytes;
-	bufptr      += bytes;
-	length      -= (size_t)bytes;
-      }
-      while (length > 0);
+  if (bpc == 0)
+  {
+    if ((bpc = (int)pdfioDictGetNumber(obj->value.value.dict, "BitsPerComponent")) == 0)
+      bpc = 8;
+  }
 
-      if (n == count && width > 0 && height > 0 && num_colors > 0)
-      {
-	// Have everything we need...
-	break;
-      }
-      else
-      {
-	// Continue reading...
-	continue;
-      }
-    }
+  if (colors == 0)
+  {
+    const char	*cs_name;		// ColorSpace name
+    pdfio_array_t *cs_array;		// ColorSpace array
 
-    // Skip past this marker...
-    while (length > 0)
+    if ((cs_name = pdfioDictGetName(obj->value.value.dict, "ColorSpace")) == NULL)
     {
-      bytes = bufend - bufptr;
-
-      if (length > (size_t)bytes)
-      {
-	// Consume everything we have and grab more...
-	length -= (size_t)bytes;
-
-	if ((bytes = read(fd, buffer, sizeof(buffer))) <= 0)
-	{
-	  _pdfioFileError(dict->pdf, "Unable to read JPEG data - %s", strerror(errno));
-	  goto finish;
-	}
-
-	bufptr = buffer;
-	bufend = buffer + bytes;
-      }
-      else
-      {
-	// Enough at the end of the buffer...
-	bufptr += length;
-	length = 0;
-      }
+      if ((cs_array = pdfioDictGetArray(obj->value.value.dict, "ColorSpace")) != NULL)
+        cs_name = pdfioArrayGetName(cs_array, 0);
     }
+
+    if (!cs_name || strstr(cs_name, "RGB"))
+      colors = 3;
+    else if (strstr(cs_name, "CMYK"))
+      colors = 4;
+    else
+      colors = 1;
   }
 
-  if (width == 0 || height == 0 || (num_colors != 1 && num_colors != 3 && num_colors != 4))
+  if (width < 0)
   {
-    _pdfioFileError(dict->pdf, "Unable to find JPEG dimensions or image data.");
-    goto finish;
+    _pdfioFileError(obj->pdf, "Invalid image width %d.", width);
+    return (0);
   }
-
-  // Create the image object...
-  pdfioDictSetNumber(dict, "Width", width);
-  pdfioDictSetNumber(dict, "Height", height);
-  pdfioDictSetNumber(dict, "BitsPerComponent", 8);
-  pdfioDictSetName(dict, "Filter", "DCTDecode");
-  if (icc_datalen > 0)
+  else if (bpc != 1 && bpc != 2 && bpc != 4 && bpc != 8 && bpc != 16)
   {
-    icc_obj = pdfioFileCreateICCObjFromData(dict->pdf, icc_data, icc_datalen, num_colors);
-    pdfioDictSetArray(dict, "ColorSpace", pdfioArrayCreateColorFromICCObj(dict->pdf, icc_obj));
+    _pdfioFileError(obj->pdf, "Invalid image bits per component %d.", bpc);
+    return (0);
   }
-  else //if (pdfioDictGetArray(dict, "ColorSpace") == NULL)
+  else if (colors < 1 || colors > 4)
   {
-    // The default JPEG color space is sRGB or CGATS001 (CMYK)...
-    if (num_colors == 4)
-      pdfioDictSetArray(dict, "ColorSpace", pdfioArrayCreateColorFromStandard(dict->pdf, num_colors, PDFIO_CS_CGATS001));
-    else
-      pdfioDictSetArray(dict, "ColorSpace", pdfioArrayCreateColorFromStandard(dict->pdf, num_colors, PDFIO_CS_SRGB));
+    _pdfioFileError(obj->pdf, "Invalid image number of colors %d.", colors);
+    return (0);
+  }
+  else
+  {
+    return ((size_t)((width * colors * bpc + 7) / 8));
   }
+}
 
-  obj = pdfioFileCreateObj(dict->pdf, dict);
-  st  = pdfioObjCreateStream(obj, PDFIO_FILTER_NONE);
 
-  // Copy the file to a stream...
-  lseek(fd, 0, SEEK_SET);
+//
+// 'pdfioImageGetHeight()' - Get the height of an image object.
+//
 
-  while ((bytes = read(fd, buffer, sizeof(buffer))) > 0)
-  {
-    if (!pdfioStreamWrite(st, buffer, (size_t)bytes))
-    {
-      obj = NULL;
-      break;
-    }
-  }
+double					// O - Height in lines
+pdfioImageGetHeight(pdfio_obj_t *obj)	// I - Image object
+{
+  if (obj)
+    return (pdfioDictGetNumber(obj->value.value.dict, "Height"));
+  else
+    return (0.0);
+}
 
-  if (!pdfioStreamClose(st))
-    obj = NULL;
 
-  finish:
+//
+// 'pdfioImageGetObj()' - Get the object for an image that is being written.
+//
+// This function returns the image object for an image started with the
+// @link pdfioFileCreateImage@ function, for example to add the image to a
+// page dictionary before the image is finished.
+//
+// @since PDFio v1.7@
+//
 
-  free(icc_data);
+pdfio_obj_t *				// O - Image object
+pdfioImageGetObj(pdfio_image_t *image)	// I - Image
+{
+  return (image ? image->obj : NULL);
+}
 
-  return (obj);
+
+//
+// 'pdfioImageGetWidth()' - Get the width of an image object.
+//
+
+double					// O - Width in columns
+pdfioImageGetWidth(pdfio_obj_t *obj)	// I - Image object
+{
+  if (obj)
+    return (pdfioDictGetNumber(obj->value.value.dict, "Width"));
+  else
+    return (0.0);
 }
 
 
 //
-// 'copy_png()' - Copy a PNG image.
+// 'pdfioImageOpen()' - Open an image object for reading.
+//
+// This function opens an image object for reading 8-bit color values with the
+// @link pdfioImageReadRows@ function.  The "num_colors" parameter specifies
+// the number of colors to return (`1` for grayscale or `3` for RGB) and the
+// "alpha" parameter specifies whether each color tuple is followed by an alpha
+// value.
+//
+// The image data is unpacked and converted as needed - the "Decode" array is
+// applied, 1, 2, 4, and 16-bit values are converted to 8-bit values, indexed
+// colors are looked up in the palette, and CMYK colors are converted to RGB or
+// grayscale.  Alpha values are taken from the "SMask" image, stencil "Mask"
+// image, or color key "Mask" array, if any, and are `255` (opaque) otherwise.
+// Images using other color spaces or filters that PDFio cannot decode, such
+// as "DCTDecode" (JPEG), and images whose line or mask buffers would not fit
+// in memory cannot be opened.
+//
+// Call @link pdfioImageClose@ when done reading the image.
+//
+// @since PDFio v1.7@
 //
 
-static pdfio_obj_t *			// O - Object or `NULL` on error
-copy_png(pdfio_dict_t *dict,		// I - Dictionary
-         int          fd)		// I - File descriptor
+pdfio_image_t *				// O - Image or `NULL` on error
+pdfioImageOpen(pdfio_obj_t *obj,	// I - Image object
+               size_t      num_colors,	// I - Number of colors to return (`1` or `3`)
+               bool        alpha)	// I - Return alpha values?
 {
-  pdfio_obj_t	*obj = NULL;		// Object
-  double	gamma = 2.2,		// Gamma value
-		wx = 0.0, wy = 0.0,	// White point chromacity
-		rx = 0.0, ry = 0.0,	// Red chromacity
-		gx = 0.0, gy = 0.0,	// Green chromacity
-		bx = 0.0, by = 0.0;	// Blue chromacity
-#ifdef HAVE_LIBPNG
-  png_structp	pp = NULL;		// PNG read pointer
-  png_infop	info = NULL;		// PNG info pointers
-  png_bytep	*rows = NULL;		// PNG row pointers
-  unsigned char	*pixels = NULL;		// PNG image data
-  unsigned	i,			// Looping var
-		color_type,		// PNG color mode
-		width,			// Width in columns
-		height,			// Height in lines
-		depth,			// Bit depth
-		num_colors = 0,		// Number of colors
-		linesize;		// Bytes per line
-  bool		alpha;			// Alpha transparency?
-  int		srgb_intent;		// sRGB color?
-  png_color	*palette;		// Color palette information
-  int		num_palette;		// Number of colors
-  int		num_trans;		// Number of transparent colors
-  png_color_16	*trans;			// Transparent colors
-  png_charp	icc_name;		// ICC profile name
-  png_bytep	icc_data;		// ICC profile data
-  png_uint_32	icc_datalen;		// Length of ICC profile data
+  pdfio_image_t	*image,			// Image
+		*mask;			// Mask image
+  pdfio_dict_t	*dict;			// Image dictionary
+  const char	*subtype,		// Subtype value
+		*cs_name = NULL;	// ColorSpace name
+  pdfio_array_t	*cs_array,		// ColorSpace array
+		*decode,		// Decode array
+		*mask_array;		// Color key Mask array
+  pdfio_obj_t	*mask_obj = NULL,	// Mask image object
+		*lookup_obj;		// Indexed color lookup object
+  pdfio_stream_t *lookup_st;		// Indexed color lookup stream
+  const unsigned char *lookup;		// Indexed color lookup string
+  size_t	i, j,			// Looping vars
+		bits,			// Bits per decode table index
+		maxval,			// Maximum decode table index
+		hival = 0,		// Maximum palette index
+		lookup_len;		// Length of lookup string
+  double	dmin,			// Minimum decode value
+		dmax,			// Maximum decode value
+		width,			// Width from dictionary
+		height;			// Height from dictionary
+  long		val;			// Decoded value
+  bool		mask_invert = false;	// Invert mask values?
 
 
-  PDFIO_DEBUG("copy_png(dict=%p, fd=%d)\n", (void *)dict, fd);
+  // Range check input...
+  if (!obj || (num_colors != 1 && num_colors != 3))
+    return (NULL);
 
-  // Allocate memory for PNG reader structures...
-  if ((pp = png_create_read_struct(PNG_LIBPNG_VER_STRING, (png_voidp)dict->pdf, png_error_func, png_error_func)) == NULL)
+  if ((dict = pdfioObjGetDict(obj)) == NULL || (subtype = pdfioDictGetName(dict, "Subtype")) == NULL || strcmp(subtype, "Image"))
   {
-    _pdfioFileError(dict->pdf, "Unable to allocate memory for PNG file: %s", strerror(errno));
-    goto finish_png;
+    _pdfioFileError(obj->pdf, "Object %u is not an image.", (unsigned)obj->number);
+    return (NULL);
   }
 
-  if ((info = png_create_info_struct(pp)) == NULL)
+  // Make sure that the line and mask buffer sizes cannot overflow - lines use
+  // up to 64 bits (4 colors at 16 bits) per pixel and masks use 8 bits per
+  // pixel.  There is no fixed limit since pdfioFileCreateImage can write
+  // images of any size...
+  width  = pdfioDictGetNumber(dict, "Width");
+  height = pdfioDictGetNumber(dict, "Height");
+
+  if (width < 1.0 || width > (double)(SIZE_MAX / 64) || height < 1.0 || height > (double)(SIZE_MAX / 64) || (size_t)width > (SIZE_MAX / 64) / (size_t)height)
   {
-    _pdfioFileError(dict->pdf, "Unable to allocate memory for PNG file: %s", strerror(errno));
-    goto finish_png;
+    _pdfioFileError(obj->pdf, "Invalid image dimensions %gx%g.", width, height);
+    return (NULL);
   }
 
-  PDFIO_DEBUG("copy_png: pp=%p, info=%p\n", (void *)pp, (void *)info);
-
-  if (setjmp(png_jmpbuf(pp)))
+  // Allocate memory for the image...
+  if ((image = (pdfio_image_t *)calloc(1, sizeof(pdfio_image_t))) == NULL)
   {
-    // If we get here, PNG loading failed and any errors/warnings were logged
-    // via the corresponding callback functions...
-    fputs("copy_png: setjmp error handler called.\n", stderr);
-    goto finish_png;
+    _pdfioFileError(obj->pdf, "Unable to allocate memory for image.");
+    return (NULL);
   }
 
-  // Set max image size to 16384x16384...
-  png_set_user_limits(pp, 16384, 16384);
-
-  // Read from the file descriptor...
-  png_set_read_fn(pp, &fd, png_read_func);
-
-  // Don't throw errors with "invalid" sRGB profiles produced by Adobe apps.
-#  if defined(PNG_SKIP_sRGB_CHECK_PROFILE) && defined(PNG_SET_OPTION_SUPPORTED)
-  png_set_option(pp, PNG_SKIP_sRGB_CHECK_PROFILE, PNG_OPTION_ON);
-#  endif // PNG_SKIP_sRGB_CHECK_PROFILE && PNG_SET_OPTION_SUPPORTED
-
-  // Get the image dimensions and depth...
-  png_read_info(pp, info);
-
-  width      = png_get_image_width(pp, info);
-  height     = png_get_image_height(pp, info);
-  depth      = png_get_bit_depth(pp, info);
-  color_type = png_get_color_type(pp, info);
+  image->pdf        = obj->pdf;
+  image->obj        = obj;
+  image->reading    = true;
+  image->num_colors = num_colors;
+  image->alpha      = alpha;
+  image->width      = (size_t)width;
+  image->height     = (size_t)height;
 
-  if (dict->pdf->profile >= _PDFIO_PROFILE_PDFA_1A && dict->pdf->profile <= _PDFIO_PROFILE_PDFA_1B && (color_type & PNG_COLOR_MASK_ALPHA))
+  if (pdfioDictGetBoolean(dict, "ImageMask"))
   {
-    _pdfioFileError(dict->pdf, "PNG images with transparency (alpha channels) are not allowed in PDF/A-1 files.");
-    goto finish_png;
+    // Stencil masks are 1-bit grayscale...
+    image->depth       = 1;
+    image->src_colors  = 1;
+    image->base_colors = 1;
   }
-
-  if (color_type & PNG_COLOR_MASK_PALETTE)
-    num_colors = 1;
-  else if (color_type & PNG_COLOR_MASK_COLOR)
-    num_colors = 3;
   else
-    num_colors = 1;
+  {
+    if ((image->depth = (size_t)pdfioDictGetNumber(dict, "BitsPerComponent")) == 0)
+      image->depth = 8;
 
-  PDFIO_DEBUG("copy_png: width=%u, height=%u, depth=%u, color_type=%u, num_colors=%d\n", width, height, depth, color_type, num_colors);
+    if ((cs_name = pdfioDictGetName(dict, "ColorSpace")) != NULL)
+      cs_array = NULL;
+    else if ((cs_array = pdfioDictGetArray(dict, "ColorSpace")) != NULL)
+      cs_name = pdfioArrayGetName(cs_array, 0);
 
-  // Set decoding options...
-  alpha    = (color_type & PNG_COLOR_MASK_ALPHA) != 0;
-  linesize = (width * num_colors * depth + 7) / 8;
-  if (alpha)
-    linesize += width;
+    if (cs_name && !strcmp(cs_name, "Indexed"))
+    {
+      // Indexed color, load the palette...
+      image->src_colors  = 1;
+      image->base_colors = get_image_colors(pdfioArrayGetName(cs_array, 1), pdfioArrayGetArray(cs_array, 1));
 
-  PDFIO_DEBUG("copy_png: alpha=%s, linesize=%u\n", alpha ? "true" : "false", (unsigned)linesize);
+      if ((hival = (size_t)pdfioArrayGetNumber(cs_array, 2)) > 255)
+        hival = 255;
 
-  // Allocate memory for the image...
-  if ((pixels = (unsigned char *)calloc(height, linesize)) == NULL)
-  {
-    _pdfioFileError(dict->pdf, "Unable to allocate memory for PNG image: %s", strerror(errno));
-    goto finish_png;
-  }
+      if (image->base_colors && (image->palette = (unsigned char *)calloc(256, image->base_colors)) != NULL)
+      {
+        if ((lookup = pdfioArrayGetBinary(cs_array, 3, &lookup_len)) != NULL)
+        {
+          if (lookup_len > ((hival + 1) * image->base_colors))
+            lookup_len = (hival + 1) * image->base_colors;
 
-  if ((rows = (png_bytep *)calloc((size_t)height, sizeof(png_bytep))) == NULL)
-  {
-    _pdfioFileError(dict->pdf, "Unable to allocate memory for PNG image: %s", strerror(errno));
-    goto finish_png;
+          memcpy(image->palette, lookup, lookup_len);
+        }
+        else if ((lookup_obj = pdfioArrayGetObj(cs_array, 3)) != NULL && (lookup_st = pdfioObjOpenStream(lookup_obj, true)) != NULL)
+        {
+          pdfioStreamRead(lookup_st, image->palette, (hival + 1) * image->base_colors);
+          pdfioStreamClose(lookup_st);
+        }
+      }
+    }
+    else
+    {
+      image->src_colors = image->base_colors = get_image_colors(cs_name, cs_array);
+    }
   }
 
-  for (i = 0; i < height; i ++)
-    rows[i] = pixels + i * linesize;
-
-  // Read the image...
-  for (i = png_set_interlace_handling(pp); i > 0; i --)
-    png_read_rows(pp, rows, NULL, (png_uint_32)height);
-
-  // Add image dictionary information...
-  pdfioDictSetNumber(dict, "Width", width);
-  pdfioDictSetNumber(dict, "Height", height);
-  pdfioDictSetNumber(dict, "BitsPerComponent", depth);
+  PDFIO_DEBUG("pdfioImageOpen: width=%lu, height=%lu, depth=%lu, src_colors=%lu, base_colors=%lu, palette=%p\n", (unsigned long)image->width, (unsigned long)image->height, (unsigned long)image->depth, (unsigned long)image->src_colors, (unsigned long)image->base_colors, (void *)image->palette);
 
-  // Grab any color space/palette information...
-  if (png_get_PLTE(pp, info, &palette, &num_palette))
-  {
-    pdfioDictSetArray(dict, "ColorSpace", pdfioArrayCreateColorFromPalette(dict->pdf, num_palette, (unsigned char *)palette));
-  }
-  else if (png_get_iCCP(pp, info, &icc_name, /*compression_type*/NULL, &icc_data, &icc_datalen))
-  {
-    PDFIO_DEBUG("copy_png: ICC color profile '%s'\n", icc_name);
-    pdfio_obj_t	*icc_obj = pdfioFileCreateICCObjFromData(dict->pdf, icc_data, icc_datalen, num_colors);
-    pdfioDictSetArray(dict, "ColorSpace", pdfioArrayCreateColorFromICCObj(dict->pdf, icc_obj));
-  }
-  else if (png_get_sRGB(pp, info, &srgb_intent))
+  if (image->depth != 1 && image->depth != 2 && image->depth != 4 && image->depth != 8 && (image->depth != 16 || image->palette))
   {
-    PDFIO_DEBUG("copy_png: Explicit sRGB\n");
-    pdfioDictSetArray(dict, "ColorSpace", pdfioArrayCreateColorFromStandard(dict->pdf, num_colors, PDFIO_CS_SRGB));
+    _pdfioFileError(image->pdf, "Invalid image bits per component %lu.", (unsigned long)image->depth);
+    goto error;
   }
-  else if (png_get_cHRM(pp, info, &wx, &wy, &rx, &ry, &gx, &gy, &bx, &by) && png_get_gAMA(pp, info, &gamma))
+  else if (!image->base_colors)
   {
-    PDFIO_DEBUG("copy_png: Color primaries [%.6f %.6f %.6f %.6f %.6f %.6f %.6f %.6f], gamma %.6f\n", wx, wy, rx, ry, gx, gy, bx, by, gamma);
-    pdfioDictSetArray(dict, "ColorSpace", pdfioArrayCreateColorFromPrimaries(dict->pdf, num_colors, gamma, wx, wy, rx, ry, gx, gy, bx, by));
+    _pdfioFileError(image->pdf, "Unsupported image color space.");
+    goto error;
   }
-  else
+  else if (cs_name && !strcmp(cs_name, "Indexed") && !image->palette)
   {
-    // Default to sRGB...
-    pdfioDictSetArray(dict, "ColorSpace", pdfioArrayCreateColorFromStandard(dict->pdf, num_colors, PDFIO_CS_SRGB));
+    _pdfioFileError(image->pdf, "Unable to load image palette.");
+    goto error;
   }
 
-  if (png_get_tRNS(pp, info, /*trans_alpha*/NULL, &num_trans, &trans))
-  {
-    int			m;		// Looping var
-    pdfio_array_t	*mask;		// Mask array
-
-    mask = pdfioArrayCreate(dict->pdf);
+  // Build the decode lookup tables, mapping the top 8 bits of each sample to an
+  // 8-bit color value or palette index...
+  decode = pdfioDictGetArray(dict, "Decode");
+  bits   = image->depth > 8 ? 8 : image->depth;
+  maxval = (1U << bits) - 1;
 
-    if (color_type & PNG_COLOR_MASK_PALETTE)
+  for (i = 0; i < image->src_colors; i ++)
+  {
+    if (decode)
     {
-      // List color indices that are transparent...
-      for (m = 0; m < num_trans; m ++)
-      {
-	pdfioArrayAppendNumber(mask, trans[m].index);
-	pdfioArrayAppendNumber(mask, trans[m].index);
-      }
+      dmin = pdfioArrayGetNumber(decode, 2 * i);
+      dmax = pdfioArrayGetNumber(decode, 2 * i + 1);
     }
-    else if (num_colors == 1)
+    else
     {
-      // List grayscale values that are transparent...
-      for (m = 0; m < num_trans; m ++)
-      {
-	pdfioArrayAppendNumber(mask, trans[m].gray >> (16 - depth));
-	pdfioArrayAppendNumber(mask, trans[m].gray >> (16 - depth));
-      }
+      dmin = 0.0;
+      dmax = image->palette ? (double)maxval : 1.0;
     }
-    else
+
+    for (j = 0; j <= maxval; j ++)
     {
-      // List RGB color values that are transparent...
-      for (m = 0; m < num_trans; m ++)
+      if (image->palette)
       {
-	pdfioArrayAppendNumber(mask, trans[m].red >> (16 - depth));
-	pdfioArrayAppendNumber(mask, trans[m].green >> (16 - depth));
-	pdfioArrayAppendNumber(mask, trans[m].blue >> (16 - depth));
-	pdfioArrayAppendNumber(mask, trans[m].red >> (16 - depth));
-	pdfioArrayAppendNumber(mask, trans[m].green >> (16 - depth));
-	pdfioArrayAppendNumber(mask, trans[m].blue >> (16 - depth));
+        if ((val = lround(dmin + (double)j * (dmax - dmin) / (double)maxval)) > (long)hival)
+          val = (long)hival;
+      }
+      else if ((val = lround(255.0 * (dmin + (double)j * (dmax - dmin) / (double)maxval))) > 255)
+      {
+        val = 255;
       }
-    }
 
-    pdfioDictSetArray(dict, "Mask", mask);
+      image->decode[i][j] = (unsigned char)(val < 0 ? 0 : val);
+    }
   }
 
-  // Create the image object...
-  obj = create_image(dict, pixels, width, height, depth, num_colors, alpha);
-
-  finish_png:
-
-  if (pp && info)
+  // Load the mask image, if any.  Only one stream can be read at a time, so
+  // the mask is read into memory before opening the image stream...
+  if (alpha)
   {
-    png_destroy_read_struct(&pp, &info, NULL);
+    if ((mask_obj = pdfioDictGetObj(dict, "SMask")) == NULL && (mask_obj = pdfioDictGetObj(dict, "Mask")) != NULL)
+      mask_invert = true;		// Stencil mask, 1 = masked out
 
-    pp   = NULL;
-    info = NULL;
-  }
+    if (mask_obj)
+    {
+      if ((mask = pdfioImageOpen(mask_obj, 1, false)) == NULL)
+        goto error;
 
-  free(pixels);
-  pixels = NULL;
+      image->mask_width  = mask->width;
+      image->mask_height = mask->height;
 
-  free(rows);
-  rows = NULL;
+      if ((image->mask_lines = (unsigned char *)malloc(mask->width * mask->height)) == NULL)
+      {
+        _pdfioFileError(image->pdf, "Unable to allocate memory for image mask.");
+        pdfioImageClose(mask);
+        goto error;
+      }
 
-  return (obj);
+      if (!pdfioImageReadRows(mask, image->mask_lines, mask->height))
+      {
+        pdfioImageClose(mask);
+        goto error;
+      }
 
-#else
-  pdfio_dict_t	*decode = NULL;		// Parameters for PNG decode
-  pdfio_stream_t *st = NULL;		// Stream for PNG data
-  ssize_t	bytes;			// Bytes read
-  unsigned char	buffer[16384];		// Read buffer
-  unsigned	i,			// Looping var
-		length,			// Length
-		type,			// Chunk code
-		crc,			// CRC-32
-		temp,			// Temporary value
-		width = 0,		// Width
-		height = 0,		// Height
-		num_colors = 0;		// Number of colors
-  unsigned char	bit_depth = 0,		// Bit depth
-		color_type = 0,		// Color type
-		interlace = 0;		// Interlace type
-  pdfio_array_t	*mask = NULL;		// Color masking array
+      pdfioImageClose(mask);
 
+      if (mask_invert)
+      {
+        for (i = image->mask_width * image->mask_height; i > 0; i --)
+          image->mask_lines[i - 1] = 255 - image->mask_lines[i - 1];
+      }
+    }
+    else if ((mask_array = pdfioDictGetArray(dict, "Mask")) != NULL && pdfioArrayGetSize(mask_array) == 2 * image->src_colors)
+    {
+      // Color key mask...
+      image->num_color_key = 2 * image->src_colors;
 
-  // Read the file header...
-  if (read(fd, buffer, 8) != 8)
-    return (NULL);
+      for (i = 0; i < image->num_color_key; i ++)
+        image->color_key[i] = (unsigned)pdfioArrayGetNumber(mask_array, i);
+    }
+  }
 
-  // Then read chunks until we have the image data...
-  while (read(fd, buffer, 8) == 8)
+  // Allocate line buffers and open the image stream...
+  if ((image->lines = (unsigned char *)malloc((image->width * image->src_colors * image->depth + 7) / 8)) == NULL || (image->samples = (uint16_t *)malloc(image->width * image->src_colors * sizeof(uint16_t))) == NULL || (image->colors = (unsigned char *)malloc(image->width * image->base_colors)) == NULL || (image->alphas = (unsigned char *)malloc(image->width)) == NULL)
   {
-    // Get the chunk length and type values...
-    length = (unsigned)((buffer[0] << 24) | (buffer[1] << 16) | (buffer[2] << 8) | buffer[3]);
-    type   = (unsigned)((buffer[4] << 24) | (buffer[5] << 16) | (buffer[6] << 8) | buffer[7]);
-    crc    = update_png_crc(0xffffffff, buffer + 4, 4);
-
-    switch (type)
-    {
-      case _PDFIO_PNG_CHUNK_IDAT : // Image data
-          if (!width || !height)
-          {
-            _pdfioFileError(dict->pdf, "Image data seen in PNG file before header.");
-            return (NULL);
-	  }
+    _pdfioFileError(image->pdf, "Unable to allocate memory for image.");
+    goto error;
+  }
 
-          if (!st)
-          {
-	    PDFIO_DEBUG("copy_png: wx=%.6f, wy=%.6f, rx=%.6f, ry=%.6f, gx=%.6f, gy=%.6f, bx=%.6f, by=%.6f\n", wx, wy, rx, ry, gx, gy, bx, by);
-	    PDFIO_DEBUG("copy_png: gamma=%.6f\n", gamma);
+  if ((image->st = pdfioObjOpenStream(obj, true)) == NULL)
+    goto error;
 
-            if (!pdfioDictGetArray(dict, "ColorSpace"))
-            {
-              PDFIO_DEBUG("copy_png: Adding %s ColorSpace value.\n", color_type == _PDFIO_PNG_TYPE_GRAY ? "CalGray" : "CalRGB");
+  return (image);
 
-	      if (wx != 0.0)
-		pdfioDictSetArray(dict, "ColorSpace", pdfioArrayCreateColorFromPrimaries(dict->pdf, color_type == _PDFIO_PNG_TYPE_GRAY ? 1 : 3, gamma, wx, wy, rx, ry, gx, gy, bx, by));
-              else
-		pdfioDictSetArray(dict, "ColorSpace", pdfioArrayCreateColorFromStandard(dict->pdf, color_type == _PDFIO_PNG_TYPE_GRAY ? 1 : 3, PDFIO_CS_SRGB));
-            }
+  // If we get here there was an error...
+  error:
 
-	    obj = pdfioFileCreateObj(dict->pdf, dict);
+  pdfioImageClose(image);
 
-	    if ((st = pdfioObjCreateStream(obj, PDFIO_FILTER_NONE)) == NULL)
-	    {
-	      pdfioObjClose(obj);
-	      return (NULL);
-	    }
-          }
+  return (NULL);
+}
 
-          while (length > 0)
-          {
-            if (length > sizeof(buffer))
-              bytes = (ssize_t)sizeof(buffer);
-	    else
-	      bytes = (ssize_t)length;
 
-            if ((bytes = read(fd, buffer, (size_t)bytes)) <= 0)
-	    {
-	      pdfioStreamClose(st);
-	      _pdfioFileError(dict->pdf, "Early end-of-file in image file.");
-	      return (NULL);
-	    }
+//
+// 'pdfioImageReadRows()' - Read lines from an image object.
+//
+// This function reads one or more lines from an image object opened with the
+// @link pdfioImageOpen@ function.  The "data" parameter points to a buffer for
+// "num_rows" lines of 8-bit image data using the number of colors and alpha
+// channel specified when the image was opened.
+//
+// @since PDFio v1.7@
+//
 
-            crc = update_png_crc(crc, buffer, (size_t)bytes);
+bool					// O - `true` on success, `false` on error
+pdfioImageReadRows(
+    pdfio_image_t *image,		// I - Image
+    unsigned char *data,		// I - Buffer for image data
+    size_t        num_rows)		// I - Number of lines
+{
+  size_t	x,			// Looping var
+		i,			// Looping var
+		width,			// Width of image
+		linelen;		// Length of source line
+  const uint16_t *sptr;			// Pointer into samples
+  const unsigned char *cptr,		// Pointer into base colors
+		*aptr,			// Pointer into alpha values
+		*mptr;			// Pointer into mask image
+  unsigned char	*dptr;			// Pointer into base colors or data
+  unsigned	gray;			// Gray value for CMYK
+  bool		keyed;			// Color matches the color key?
 
-            if (!pdfioStreamWrite(st, buffer, (size_t)bytes))
-            {
-	      pdfioStreamClose(st);
-	      _pdfioFileError(dict->pdf, "Unable to copy image data.");
-	      return (NULL);
-            }
 
-            length -= bytes;
-          }
-          break;
+  // Range check input...
+  if (!image || !data || !image->reading)
+    return (false);
 
-      case _PDFIO_PNG_CHUNK_IEND : // Image end
-          if (st)
-          {
-            pdfioStreamClose(st);
-            return (obj);
-          }
-          break;
+  if (num_rows > (image->height - image->y))
+  {
+    _pdfioFileError(image->pdf, "Too many lines read from image object %u.", (unsigned)image->obj->number);
+    return (false);
+  }
 
-      case _PDFIO_PNG_CHUNK_IHDR : // Image header
-          if (st)
-          {
-	    pdfioStreamClose(st);
-	    _pdfioFileError(dict->pdf, "Unexpected image header.");
-	    return (NULL);
-          }
+  width   = image->width;
+  linelen = (width * image->src_colors * image->depth + 7) / 8;
 
-          if (length != 13)
+  for (; num_rows > 0; num_rows --, image->y ++)
+  {
+    // Read and unpack the next line...
+    if (pdfioStreamRead(image->st, image->lines, linelen) != (ssize_t)linelen)
+    {
+      _pdfioFileError(image->pdf, "Unable to read line %lu from image object %u.", (unsigned long)image->y, (unsigned)image->obj->number);
+      return (false);
+    }
+
+    unpack_samples(image->samples, image->lines, width * image->src_colors, image->depth);
+
+    // Decode the samples to base colors...
+    if (image->palette)
+    {
+      for (x = width, sptr = image->samples, dptr = image->colors; x > 0; x --, sptr ++)
+      {
+        cptr = image->palette + image->decode[0][*sptr] * image->base_colors;
+
+        for (i = image->base_colors; i > 0; i --)
+          *dptr++ = *cptr++;
+      }
+    }
+    else if (image->depth == 16)
+    {
+      for (x = width, sptr = image->samples, dptr = image->colors; x > 0; x --)
+      {
+        for (i = 0; i < image->src_colors; i ++)
+          *dptr++ = image->decode[i][*sptr++ >> 8];
+      }
+    }
+    else if (image->src_colors == 1)
+    {
+      for (x = width, sptr = image->samples, dptr = image->colors; x > 0; x --)
+        *dptr++ = image->decode[0][*sptr++];
+    }
+    else
+    {
+      for (x = width, sptr = image->samples, dptr = image->colors; x > 0; x --)
+      {
+        for (i = 0; i < image->src_colors; i ++)
+          *dptr++ = image->decode[i][*sptr++];
+      }
+    }
+
+    // Get the alpha values...
+    if (image->alpha)
+    {
+      if (image->mask_lines)
+      {
+        // Copy or scale the corresponding mask line...
+        mptr = image->mask_lines + image->y * image->mask_height / image->height * image->mask_width;
+
+        if (image->mask_width == width)
+        {
+          memcpy(image->alphas, mptr, width);
+        }
+        else
+        {
+          for (x = 0; x < width; x ++)
+            image->alphas[x] = mptr[x * image->mask_width / width];
+        }
+      }
+      else if (image->num_color_key)
+      {
+        for (x = 0, sptr = image->samples; x < width; x ++, sptr += image->src_colors)
+        {
+          for (i = 0, keyed = true; i < image->src_colors && keyed; i ++)
+            keyed = sptr[i] >= image->color_key[2 * i] && sptr[i] <= image->color_key[2 * i + 1];
+
+          image->alphas[x] = keyed ? 0 : 255;
+        }
+      }
+      else
+      {
+        memset(image->alphas, 255, width);
+      }
+    }
+
+    // Convert the base colors to the output colors...
+    cptr = image->colors;
+    aptr = image->alphas;
+
+    if (image->num_colors == 1)
+    {
+      switch (image->base_colors)
+      {
+        case 1 :
+            if (image->alpha)
+            {
+              for (x = width; x > 0; x --)
+              {
+                *data++ = *cptr++;
+                *data++ = *aptr++;
+              }
+            }
+            else
+            {
+              memcpy(data, cptr, width);
+              data += width;
+            }
+            break;
+
+        case 3 :
+            for (x = width; x > 0; x --, cptr += 3)
+            {
+              *data++ = (unsigned char)((cptr[0] * 77 + cptr[1] * 150 + cptr[2] * 29) >> 8);
+              if (image->alpha)
+                *data++ = *aptr++;
+            }
+            break;
+
+        case 4 :
+            for (x = width; x > 0; x --, cptr += 4)
+            {
+              if ((gray = ((cptr[0] * 77 + cptr[1] * 150 + cptr[2] * 29) >> 8) + cptr[3]) > 255)
+                gray = 255;
+
+              *data++ = (unsigned char)(255 - gray);
+              if (image->alpha)
+                *data++ = *aptr++;
+            }
+            break;
+      }
+    }
+    else
+    {
+      switch (image->base_colors)
+      {
+        case 1 :
+            for (x = width; x > 0; x --, cptr ++)
+            {
+              *data++ = *cptr;
+              *data++ = *cptr;
+              *data++ = *cptr;
+              if (image->alpha)
+                *data++ = *aptr++;
+            }
+            break;
+
+        case 3 :
+            if (image->alpha)
+            {
+              for (x = width; x > 0; x --)
+              {
+                *data++ = *cptr++;
+                *data++ = *cptr++;
+                *data++ = *cptr++;
+                *data++ = *aptr++;
+              }
+            }
+            else
+            {
+              memcpy(data, cptr, 3 * width);
+              data += 3 * width;
+            }
+            break;
+
+        case 4 :
+            for (x = width; x > 0; x --, cptr += 4)
+            {
+              *data++ = (unsigned char)(cptr[0] + cptr[3] > 255 ? 0 : 255 - cptr[0] - cptr[3]);
+              *data++ = (unsigned char)(cptr[1] + cptr[3] > 255 ? 0 : 255 - cptr[1] - cptr[3]);
+              *data++ = (unsigned char)(cptr[2] + cptr[3] > 255 ? 0 : 255 - cptr[2] - cptr[3]);
+              if (image->alpha)
+                *data++ = *aptr++;
+            }
+            break;
+      }
+    }
+  }
+
+  return (true);
+}
+
+
+//
+// 'pdfioImageWriteRows()' - Write lines to an image object.
+//
+// This function writes one or more lines to an image object started with the
+// @link pdfioFileCreateImage@ function.  The "data" parameter points to
+// "num_rows" lines of image data using the bit depth, number of colors, and
+// alpha channel specified when the image was started.
+//
+// @since PDFio v1.7@
+//
+
+bool					// O - `true` on success, `false` on failure
+pdfioImageWriteRows(
+    pdfio_image_t       *image,		// I - Image
+    const unsigned char *data,		// I - Image data
+    size_t              num_rows)	// I - Number of lines
+{
+  size_t	bpc,			// Bytes per component
+		bpp,			// Bytes per pixel (less alpha)
+		linelen,		// Line length (less alpha)
+		count;			// Number of lines to split
+
+
+  // Range check input...
+  if (!image || !data || image->reading)
+    return (false);
+
+  if (num_rows > (image->height - image->y))
+  {
+    _pdfioFileError(image->pdf, "Too many lines written to image object %u.", (unsigned)image->obj->number);
+    return (false);
+  }
+
+  linelen = (image->width * image->num_colors * image->depth + 7) / 8;
+
+  if (!image->alpha)
+  {
+    // No alpha channel, write the lines as-is...
+    if (!pdfioStreamWrite(image->st, data, num_rows * linelen))
+      return (false);
+
+    image->y += num_rows;
+
+    return (true);
+  }
+
+  // Split the color and alpha values for a batch of lines at a time...
+  bpc = image->depth / 8;
+  bpp = image->num_colors * bpc;
+
+  while (num_rows > 0)
+  {
+    if ((count = num_rows) > image->max_lines)
+      count = image->max_lines;
+
+    split_alpha(image->lines, image->mask_lines, data, count * image->width, image->num_colors, bpc);
+
+    if (!pdfioStreamWrite(image->st, image->lines, count * linelen) || !pdfioStreamWrite(image->mask_st, image->mask_lines, count * image->width * bpc))
+      return (false);
+
+    data     += count * image->width * (bpp + bpc);
+    num_rows -= count;
+    image->y += count;
+  }
+
+  return (true);
+}
+
+
+//
+// 'pdfioPageDictAddColorSpace()' - Add a color space to the page dictionary.
+//
+// This function adds a named color space to the page dictionary.
+//
+// The names "DefaultCMYK", "DefaultGray", and "DefaultRGB" specify the default
+// device color space used for the page.
+//
+// The "data" array contains a calibrated, indexed, or ICC-based color space
+// array that was created using the
+// @link pdfioArrayCreateCalibratedColorFromMatrix@,
+// @link pdfioArrayCreateCalibratedColorFromPrimaries@,
+// @link pdfioArrayCreateICCBasedColor@, or
+// @link pdfioArrayCreateIndexedColor@ functions.
+//
+
+bool					// O - `true` on success, `false` on failure
+pdfioPageDictAddColorSpace(
+    pdfio_dict_t  *dict,		// I - Page dictionary
+    const char    *name,		// I - Color space name
+    pdfio_array_t *data)		// I - Color space array
+{
+  pdfio_dict_t	*resources;		// Resource dictionary
+  pdfio_dict_t	*colorspace;		// ColorSpace dictionary
+
+
+  // Range check input...
+  if (!dict || !name || !data)
+    return (false);
+
+  // Get the ColorSpace dictionary...
+  if ((resources = pdfioDictGetDict(dict, "Resources")) == NULL)
+  {
+    if ((resources = pdfioDictCreate(dict->pdf)) == NULL)
+      return (false);
+
+    if (!pdfioDictSetDict(dict, "Resources", resources))
+      return (false);
+  }
+
+  if ((colorspace = pdfioDictGetDict(resources, "ColorSpace")) == NULL)
+  {
+    if ((colorspace = pdfioDictCreate(dict->pdf)) == NULL)
+      return (false);
+
+    if (!pdfioDictSetDict(resources, "ColorSpace", colorspace))
+      return (false);
+  }
+
+  // See if this name is already set...
+  if (_pdfioDictGetValue(colorspace, name))
+    return (false);			// Yes, return false
+
+  // Now set the color space reference and return...
+  return (pdfioDictSetArray(colorspace, name, data));
+}
+
+
+//
+// 'pdfioPageDictAddFont()' - Add a font object to the page dictionary.
+//
+
+bool					// O - `true` on success, `false` on failure
+pdfioPageDictAddFont(
+    pdfio_dict_t *dict,			// I - Page dictionary
+    const char   *name,			// I - Font name; must not contain spaces
+    pdfio_obj_t  *obj)			// I - Font object
+{
+  pdfio_dict_t	*resources;		// Resource dictionary
+  pdfio_dict_t	*font;			// Font dictionary
+
+
+  // Range check input...
+  if (!dict || !name || !obj)
+    return (false);
+
+  // Get the Resources dictionary...
+  if ((resources = pdfioDictGetDict(dict, "Resources")) == NULL)
+  {
+    if ((resources = pdfioDictCreate(dict->pdf)) == NULL)
+      return (false);
+
+    if (!pdfioDictSetDict(dict, "Resources", resources))
+      return (false);
+  }
+
+  // Get the Font dictionary...
+  if ((font = pdfioDictGetDict(resources, "Font")) == NULL)
+  {
+    if ((font = pdfioDictCreate(dict->pdf)) == NULL)
+      return (false);
+
+    if (!pdfioDictSetDict(resources, "Font", font))
+      return (false);
+  }
+
+  // Now set the image reference in the Font resource dictionary and return...
+  return (pdfioDictSetObj(font, name, obj));
+}
+
+
+//
+// 'pdfioPageDictAddImage()' - Add an image object to the page dictionary.
+//
+
+bool					// O - `true` on success, `false` on failure
+pdfioPageDictAddImage(
+    pdfio_dict_t *dict,			// I - Page dictionary
+    const char   *name,			// I - Image name
+    pdfio_obj_t  *obj)			// I - Image object
+{
+  pdfio_dict_t	*resources;		// Resource dictionary
+  pdfio_dict_t	*xobject;		// XObject dictionary
+
+
+  // Range check input...
+  if (!dict || !name || !obj)
+    return (false);
+
+  // Get the Resources dictionary...
+  if ((resources = pdfioDictGetDict(dict, "Resources")) == NULL)
+  {
+    if ((resources = pdfioDictCreate(dict->pdf)) == NULL)
+      return (false);
+
+    if (!pdfioDictSetDict(dict, "Resources", resources))
+      return (false);
+  }
+
+  // Get the XObject dictionary...
+  if ((xobject = pdfioDictGetDict(resources, "XObject")) == NULL)
+  {
+    if ((xobject = pdfioDictCreate(dict->pdf)) == NULL)
+      return (false);
+
+    if (!pdfioDictSetDict(resources, "XObject", xobject))
+      return (false);
+  }
+
+  // Now set the image reference in the XObject resource dictionary and return...
+  return (pdfioDictSetObj(xobject, name, obj));
+}
+
+
+//
+// 'cached_font_error_cb()' - Relay a message from the TTF functions for a
+//                            cached font.
+//
+// Cached fonts outlive the PDF file that loaded them, so messages are only
+// relayed while the font is being loaded.
+//
+
+static void
+cached_font_error_cb(
+    _pdfio_cfont_t *cfont,		// I - Cached font
+    const char     *message)		// I - Error message
+{
+  if (cfont->pdf)
+    ttf_error_cb(cfont->pdf, message);
+}
+
+
+//
+// 'copy_image()' - Copy a JPEG or PNG image.
+//
+
+static pdfio_obj_t *			// O - Object or `NULL` on error
+copy_image(pdfio_file_t    *pdf,	// I - PDF file
+           _pdfio_imgsrc_t *src,	// I - Image source
+           const char      *filename,	// I - Filename or `NULL` for memory
+           bool            interpolate)	// I - Interpolate image data?
+{
+  pdfio_dict_t	*dict;			// Image dictionary
+  pdfio_obj_t	*obj;			// Image object
+  unsigned char	buffer[32];		// Read buffer
+  _pdfio_image_func_t copy_func = NULL;	// Image copy function
+  uint8_t	digest[32];		// Resource digest
+  bool		cached;			// Use the resource cache?
+
+
+  // Read the header to determine the file format...
+  if (read_image(src, buffer, sizeof(buffer)) < (ssize_t)sizeof(buffer))
+  {
+    if (filename)
+      _pdfioFileError(pdf, "Unable to read header from image file '%s'.", filename);
+    else
+      _pdfioFileError(pdf, "Unable to read header from image data.");
+    return (NULL);
+  }
+
+  rewind_image(src);
+
+  PDFIO_DEBUG("copy_image: buffer=<%02X%02X%02X%02X%02X%02X%02X%02X%02X%02X%02X%02X%02X%02X%02X%02X%02X%02X%02X%02X%02X%02X%02X%02X%02X%02X%02X%02X%02X%02X%02X%02X>\n", buffer[0], buffer[1], buffer[2], buffer[3], buffer[4], buffer[5], buffer[6], buffer[7], buffer[8], buffer[9], buffer[10], buffer[11], buffer[12], buffer[13], buffer[14], buffer[15], buffer[16], buffer[17], buffer[18], buffer[19], buffer[20], buffer[21], buffer[22], buffer[23], buffer[24], buffer[25], buffer[26], buffer[27], buffer[28], buffer[29], buffer[30], buffer[31]);
+
+  if (!memcmp(buffer, "\211PNG\015\012\032\012\000\000\000\015IHDR", 16))
+  {
+    // PNG image...
+    copy_func = copy_png;
+  }
+  else if (!memcmp(buffer, "\377\330\377", 3))
+  {
+   // JPEG image...
+    copy_func = copy_jpeg;
+  }
+  else
+  {
+    // Something else that isn't supported...
+    if (filename)
+      _pdfioFileError(pdf, "Unsupported image file '%s'.", filename);
+    else
+      _pdfioFileError(pdf, "Unsupported image data.");
+    return (NULL);
+  }
+
+  // Reuse an identical image as needed...
+  if ((cached = get_resource_digest(pdf, digest, interpolate ? "image/file 1" : "image/file 0", NULL, src->data, src->data ? (size_t)(src->dataend - src->data) : 0, src->fd)) && (obj = _pdfioFileFindDigest(pdf, digest)) != NULL)
+    return (obj);
+
+  // Create the base image dictionary the copy the image into an object...
+  if ((dict = pdfioDictCreate(pdf)) == NULL)
+    return (NULL);
+
+  pdfioDictSetName(dict, "Type", "XObject");
+  pdfioDictSetName(dict, "Subtype", "Image");
+  pdfioDictSetBoolean(dict, "Interpolate", interpolate);
+
+  if ((obj = (copy_func)(dict, src)) != NULL && cached)
+    obj = _pdfioFileAddDigest(pdf, digest, obj);
+
+  return (obj);
+}
+
+
+//
+// 'copy_jpeg()' - Copy a JPEG image.
+//
+
+static pdfio_obj_t *			// O - Object or `NULL` on error
+copy_jpeg(pdfio_dict_t    *dict,	// I - Dictionary
+          _pdfio_imgsrc_t *src)		// I - Image source
+{
+  pdfio_obj_t	*obj = NULL;		// Object
+  pdfio_stream_t *st;			// Stream for JPEG data
+  ssize_t	bytes;			// Bytes read
+  unsigned char	buffer[16384],		// Read buffer
+		*bufptr,		// Pointer into buffer
+		*bufend;		// End of buffer
+  int		marker;			// JFIF marker byte
+  size_t	length;			// Length of chunk
+  unsigned	width = 0,		// Width in columns
+		height = 0,		// Height in lines
+		num_colors = 0;		// Number of colors
+  unsigned char	*icc_data = NULL;	// ICC profile data, if any
+  size_t	icc_datalen = 0;	// Length of ICC profile data
+  pdfio_obj_t	*icc_obj;		// ICC profile object
+
+
+  // Scan the file for APPn and SOFn markers to get the dimensions and color profile...
+  bytes = read_image(src, buffer, sizeof(buffer));
+
+  for (bufptr = buffer + 2, bufend = buffer + bytes; bufptr < bufend;)
+  {
+    if ((bufptr + 16) >= bufend)
+    {
+      // Read more of the file...
+      if ((bytes = bufend - bufptr) > 0)
+	memmove(buffer, bufptr, (size_t)bytes);
+
+      bufptr = buffer;
+      bufend = buffer + bytes;
+
+      if ((bytes = read_image(src, bufend, sizeof(buffer) - (size_t)bytes)) <= 0)
+      {
+	_pdfioFileError(dict->pdf, "Unable to read JPEG data - %s", strerror(errno));
+	goto finish;
+      }
+
+      bufend += bytes;
+    }
+
+    if (*bufptr != _PDFIO_JPEG_MARKER)
+    {
+      _pdfioFileError(dict->pdf, "Invalid JPEG data: <%02X>", *bufptr);
+      goto finish;
+    }
+
+    // Start of a marker in the file...
+    bufptr ++;
+
+    marker = *bufptr;
+    length = (size_t)((bufptr[1] << 8) | bufptr[2]);
+    bufptr += 3;
+
+    PDFIO_DEBUG("copy_jpeg: JPEG X'FF%02X' (length %u)\n", marker, (unsigned)length);
+
+    if (marker == _PDFIO_JPEG_EOI || marker == _PDFIO_JPEG_SOS || length < 2)
+      break;
+
+    length -= 2;
+
+    if ((marker >= _PDFIO_JPEG_SOF0 && marker <= _PDFIO_JPEG_SOF3) || (marker >= _PDFIO_JPEG_SOF5 && marker <= _PDFIO_JPEG_SOF7) || (marker >= _PDFIO_JPEG_SOF9 && marker <= _PDFIO_JPEG_SOF11) || (marker >= _PDFIO_JPEG_SOF13 && marker <= _PDFIO_JPEG_SOF15))
+    {
+      // SOFn marker, look for dimensions...
+      //
+      // Byte(s)  Description
+      // -------  -------------------
+      // 0        Bits per component
+      // 1-2      Height
+      // 3-4      Width
+      // 5        Number of colors
+      if (bufptr[0] != 8)
+      {
+	_pdfioFileError(dict->pdf, "Unable to load %d-bit JPEG image.", bufptr[0]);
+	goto finish;
+      }
+
+      width      = (unsigned)((bufptr[3] << 8) | bufptr[4]);
+      height     = (unsigned)((bufptr[1] << 8) | bufptr[2]);
+      num_colors = bufptr[5];
+    }
+    else if (marker == _PDFIO_JPEG_APP2 && length > 14 && memcmp(bufptr, "ICC_PROFILE", 12))
+    {
+      // Portion of ICC profile
+      int	n = bufptr[12],		// Chunk number in profile (1-based)
+	      count = bufptr[13];	// Number of chunks
+      unsigned char *icc_temp;	// New ICC buffer
+
+      // Discard "ICC_PROFILE\0" and chunk number/count...
+      bufptr += 14;
+      length -= 14;
+
+      // Expand our ICC buffer...
+      if ((icc_temp = realloc(icc_data, icc_datalen + length)) == NULL)
+      {
+        free(icc_data);
+	return (NULL);
+      }
+      else
+      {
+	icc_data = icc_temp;
+      }
+
+      // Read the chunk into the ICC buffer...
+      do
+      {
+	if (bufptr >= bufend)
+	{
+	  // Read more of the marker...
+	  if ((bytes = read_image(src, buffer, sizeof(buffer))) <= 0)
+	  {
+	    _pdfioFileError(dict->pdf, "Unable to read JPEG data - %s", strerror(errno));
+	    goto finish;
+	  }
+
+	  bufptr = buffer;
+	  bufend = buffer + bytes;
+	}
+
+	// Copy from the file buffer to the ICC buffer
+	if ((bytes = bufend - bufptr) > (ssize_t)length)
+	  bytes = (ssize_t)length;
+
+	memcpy(icc_data + icc_datalen, bufptr, bytes);
+	icc_datalen += (size_t)bytes;
+	bufptr      += bytes;
+	length      -= (size_t)bytes;
+      }
+      while (length > 0);
+
+      if (n == count && width > 0 && height > 0 && num_colors > 0)
+      {
+	// Have everything we need...
+	break;
+      }
+      else
+      {
+	// Continue reading...
+	continue;
+      }
+    }
+
+    // Skip past this marker...
+    while (length > 0)
+    {
+      bytes = bufend - bufptr;
+
+      if (length > (size_t)bytes)
+      {
+	// Consume everything we have and grab more...
+	length -= (size_t)bytes;
+
+	if ((bytes = read_image(src, buffer, sizeof(buffer))) <= 0)
+	{
+	  _pdfioFileError(dict->pdf, "Unable to read JPEG data - %s", strerror(errno));
+	  goto finish;
+	}
+
+	bufptr = buffer;
+	bufend = buffer + bytes;
+      }
+      else
+      {
+	// Enough at the end of the buffer...
+	bufptr += length;
+	length = 0;
+      }
+    }
+  }
+
+  if (width == 0 || height == 0 || (num_colors != 1 && num_colors != 3 && num_colors != 4))
+  {
+    _pdfioFileError(dict->pdf, "Unable to find JPEG dimensions or image data.");
+    goto finish;
+  }
+
+  // Create the image object...
+  pdfioDictSetNumber(dict, "Width", width);
+  pdfioDictSetNumber(dict, "Height", height);
+  pdfioDictSetNumber(dict, "BitsPerComponent", 8);
+  pdfioDictSetName(dict, "Filter", "DCTDecode");
+  if (icc_datalen > 0)
+  {
+    icc_obj = pdfioFileCreateICCObjFromData(dict->pdf, icc_data, icc_datalen, num_colors);
+    pdfioDictSetArray(dict, "ColorSpace", pdfioArrayCreateColorFromICCObj(dict->pdf, icc_obj));
+  }
+  else //if (pdfioDictGetArray(dict, "ColorSpace") == NULL)
+  {
+    // The default JPEG color space is sRGB or CGATS001 (CMYK)...
+    if (num_colors == 4)
+      pdfioDictSetArray(dict, "ColorSpace", pdfioArrayCreateColorFromStandard(dict->pdf, num_colors, PDFIO_CS_CGATS001));
+    else
+      pdfioDictSetArray(dict, "ColorSpace", pdfioArrayCreateColorFromStandard(dict->pdf, num_colors, PDFIO_CS_SRGB));
+  }
+
+  obj = pdfioFileCreateObj(dict->pdf, dict);
+  st  = pdfioObjCreateStream(obj, PDFIO_FILTER_NONE);
+
+  // Copy the image data to a stream...
+  if (src->data)
+  {
+    if (!pdfioStreamWrite(st, src->data, (size_t)(src->dataend - src->data)))
+      obj = NULL;
+  }
+  else
+  {
+    rewind_image(src);
+
+    while ((bytes = read_image(src, buffer, sizeof(buffer))) > 0)
+    {
+      if (!pdfioStreamWrite(st, buffer, (size_t)bytes))
+      {
+	obj = NULL;
+	break;
+      }
+    }
+  }
+
+  if (!pdfioStreamClose(st))
+    obj = NULL;
+
+  finish:
+
+  free(icc_data);
+
+  return (obj);
+}
+
+
+//
+// 'copy_png()' - Copy a PNG image.
+//
+// Interlaced images and images with an alpha channel are decoded using libpng,
+// when available.  All other images are copied using `copy_png_chunks`.
+//
+
+static pdfio_obj_t *			// O - Object or `NULL` on error
+copy_png(pdfio_dict_t    *dict,	// I - Dictionary
+         _pdfio_imgsrc_t *src)		// I - Image source
+{
+#ifdef HAVE_LIBPNG
+  pdfio_obj_t	*obj = NULL;		// Object
+  double	gamma = 2.2,		// Gamma value
+		wx = 0.0, wy = 0.0,	// White point chromacity
+		rx = 0.0, ry = 0.0,	// Red chromacity
+		gx = 0.0, gy = 0.0,	// Green chromacity
+		bx = 0.0, by = 0.0;	// Blue chromacity
+  png_structp	pp = NULL;		// PNG read pointer
+  png_infop	info = NULL;		// PNG info pointers
+  png_bytep	*rows = NULL;		// PNG row pointers
+  unsigned char	*pixels = NULL;		// PNG image data
+  unsigned	i,			// Looping var
+		color_type,		// PNG color mode
+		width,			// Width in columns
+		height,			// Height in lines
+		depth,			// Bit depth
+		num_colors = 0,		// Number of colors
+		linesize;		// Bytes per line
+  bool		alpha;			// Alpha transparency?
+  int		srgb_intent;		// sRGB color?
+  png_color	*palette;		// Color palette information
+  int		num_palette;		// Number of colors
+  int		num_trans;		// Number of transparent colors
+  png_color_16	*trans;			// Transparent colors
+  png_charp	icc_name;		// ICC profile name
+  png_bytep	icc_data;		// ICC profile data
+  png_uint_32	icc_datalen;		// Length of ICC profile data
+  unsigned char	header[29];		// PNG file header and IHDR chunk
+
+
+  PDFIO_DEBUG("copy_png(dict=%p, src=%p)\n", (void *)dict, (void *)src);
+
+  // Copy the compressed image data as-is when the image is not interlaced and
+  // has no alpha channel...
+  if (read_image(src, header, sizeof(header)) == (ssize_t)sizeof(header) && (header[25] == _PDFIO_PNG_TYPE_GRAY || header[25] == _PDFIO_PNG_TYPE_RGB || header[25] == _PDFIO_PNG_TYPE_INDEXED) && header[28] == _PDFIO_PNG_INTERLACE_NONE)
+  {
+    PDFIO_DEBUG("copy_png: Copying compressed image data.\n");
+    rewind_image(src);
+    return (copy_png_chunks(dict, src));
+  }
+
+  rewind_image(src);
+
+  // Allocate memory for PNG reader structures...
+  if ((pp = png_create_read_struct(PNG_LIBPNG_VER_STRING, (png_voidp)dict->pdf, png_error_func, png_error_func)) == NULL)
+  {
+    _pdfioFileError(dict->pdf, "Unable to allocate memory for PNG file: %s", strerror(errno));
+    goto finish_png;
+  }
+
+  if ((info = png_create_info_struct(pp)) == NULL)
+  {
+    _pdfioFileError(dict->pdf, "Unable to allocate memory for PNG file: %s", strerror(errno));
+    goto finish_png;
+  }
+
+  PDFIO_DEBUG("copy_png: pp=%p, info=%p\n", (void *)pp, (void *)info);
+
+  if (setjmp(png_jmpbuf(pp)))
+  {
+    // If we get here, PNG loading failed and any errors/warnings were logged
+    // via the corresponding callback functions...
+    fputs("copy_png: setjmp error handler called.\n", stderr);
+    goto finish_png;
+  }
+
+  // Set max image size to 16384x16384...
+  png_set_user_limits(pp, 16384, 16384);
+
+  // Read from the file descriptor...
+  png_set_read_fn(pp, src, png_read_func);
+
+  // Don't throw errors with "invalid" sRGB profiles produced by Adobe apps.
+#  if defined(PNG_SKIP_sRGB_CHECK_PROFILE) && defined(PNG_SET_OPTION_SUPPORTED)
+  png_set_option(pp, PNG_SKIP_sRGB_CHECK_PROFILE, PNG_OPTION_ON);
+#  endif // PNG_SKIP_sRGB_CHECK_PROFILE && PNG_SET_OPTION_SUPPORTED
+
+  // Get the image dimensions and depth...
+  png_read_info(pp, info);
+
+  width      = png_get_image_width(pp, info);
+  height     = png_get_image_height(pp, info);
+  depth      = png_get_bit_depth(pp, info);
+  color_type = png_get_color_type(pp, info);
+
+  if (dict->pdf->profile >= _PDFIO_PROFILE_PDFA_1A && dict->pdf->profile <= _PDFIO_PROFILE_PDFA_1B && (color_type & PNG_COLOR_MASK_ALPHA))
+  {
+    _pdfioFileError(dict->pdf, "PNG images with transparency (alpha channels) are not allowed in PDF/A-1 files.");
+    goto finish_png;
+  }
+
+  if (color_type & PNG_COLOR_MASK_PALETTE)
+    num_colors = 1;
+  else if (color_type & PNG_COLOR_MASK_COLOR)
+    num_colors = 3;
+  else
+    num_colors = 1;
+
+  PDFIO_DEBUG("copy_png: width=%u, height=%u, depth=%u, color_type=%u, num_colors=%d\n", width, height, depth, color_type, num_colors);
+
+  // Set decoding options...
+  alpha    = (color_type & PNG_COLOR_MASK_ALPHA) != 0;
+  linesize = (width * num_colors * depth + 7) / 8;
+  if (alpha)
+    linesize += width * depth / 8;
+
+  PDFIO_DEBUG("copy_png: alpha=%s, linesize=%u\n", alpha ? "true" : "false", (unsigned)linesize);
+
+  // Allocate memory for the image...
+  if ((pixels = (unsigned char *)calloc(height, linesize)) == NULL)
+  {
+    _pdfioFileError(dict->pdf, "Unable to allocate memory for PNG image: %s", strerror(errno));
+    goto finish_png;
+  }
+
+  if ((rows = (png_bytep *)calloc((size_t)height, sizeof(png_bytep))) == NULL)
+  {
+    _pdfioFileError(dict->pdf, "Unable to allocate memory for PNG image: %s", strerror(errno));
+    goto finish_png;
+  }
+
+  for (i = 0; i < height; i ++)
+    rows[i] = pixels + i * linesize;
+
+  // Read the image...
+  for (i = png_set_interlace_handling(pp); i > 0; i --)
+    png_read_rows(pp, rows, NULL, (png_uint_32)height);
+
+  // Add image dictionary information...
+  pdfioDictSetNumber(dict, "Width", width);
+  pdfioDictSetNumber(dict, "Height", height);
+  pdfioDictSetNumber(dict, "BitsPerComponent", depth);
+
+  // Grab any color space/palette information...
+  if (png_get_PLTE(pp, info, &palette, &num_palette))
+  {
+    pdfioDictSetArray(dict, "ColorSpace", pdfioArrayCreateColorFromPalette(dict->pdf, num_palette, (unsigned char *)palette));
+  }
+  else if (png_get_iCCP(pp, info, &icc_name, /*compression_type*/NULL, &icc_data, &icc_datalen))
+  {
+    PDFIO_DEBUG("copy_png: ICC color profile '%s'\n", icc_name);
+    pdfio_obj_t	*icc_obj = pdfioFileCreateICCObjFromData(dict->pdf, icc_data, icc_datalen, num_colors);
+    pdfioDictSetArray(dict, "ColorSpace", pdfioArrayCreateColorFromICCObj(dict->pdf, icc_obj));
+  }
+  else if (png_get_sRGB(pp, info, &srgb_intent))
+  {
+    PDFIO_DEBUG("copy_png: Explicit sRGB\n");
+    pdfioDictSetArray(dict, "ColorSpace", pdfioArrayCreateColorFromStandard(dict->pdf, num_colors, PDFIO_CS_SRGB));
+  }
+  else if (png_get_cHRM(pp, info, &wx, &wy, &rx, &ry, &gx, &gy, &bx, &by) && png_get_gAMA(pp, info, &gamma))
+  {
+    PDFIO_DEBUG("copy_png: Color primaries [%.6f %.6f %.6f %.6f %.6f %.6f %.6f %.6f], gamma %.6f\n", wx, wy, rx, ry, gx, gy, bx, by, gamma);
+    pdfioDictSetArray(dict, "ColorSpace", pdfioArrayCreateColorFromPrimaries(dict->pdf, num_colors, gamma, wx, wy, rx, ry, gx, gy, bx, by));
+  }
+  else
+  {
+    // Default to sRGB...
+    pdfioDictSetArray(dict, "ColorSpace", pdfioArrayCreateColorFromStandard(dict->pdf, num_colors, PDFIO_CS_SRGB));
+  }
+
+  if (png_get_tRNS(pp, info, /*trans_alpha*/NULL, &num_trans, &trans))
+  {
+    int			m;		// Looping var
+    pdfio_array_t	*mask;		// Mask array
+
+    mask = pdfioArrayCreate(dict->pdf);
+
+    if (color_type & PNG_COLOR_MASK_PALETTE)
+    {
+      // List color indices that are transparent...
+      for (m = 0; m < num_trans; m ++)
+      {
+	pdfioArrayAppendNumber(mask, trans[m].index);
+	pdfioArrayAppendNumber(mask, trans[m].index);
+      }
+    }
+    else if (num_colors == 1)
+    {
+      // List grayscale values that are transparent...
+      for (m = 0; m < num_trans; m ++)
+      {
+	pdfioArrayAppendNumber(mask, trans[m].gray >> (16 - depth));
+	pdfioArrayAppendNumber(mask, trans[m].gray >> (16 - depth));
+      }
+    }
+    else
+    {
+      // List RGB color values that are transparent...
+      for (m = 0; m < num_trans; m ++)
+      {
+	pdfioArrayAppendNumber(mask, trans[m].red >> (16 - depth));
+	pdfioArrayAppendNumber(mask, trans[m].green >> (16 - depth));
+	pdfioArrayAppendNumber(mask, trans[m].blue >> (16 - depth));
+	pdfioArrayAppendNumber(mask, trans[m].red >> (16 - depth));
+	pdfioArrayAppendNumber(mask, trans[m].green >> (16 - depth));
+	pdfioArrayAppendNumber(mask, trans[m].blue >> (16 - depth));
+      }
+    }
+
+    pdfioDictSetArray(dict, "Mask", mask);
+  }
+
+  // Create the image object...
+  obj = create_image(dict, pixels, width, height, depth, num_colors, alpha);
+
+  finish_png:
+
+  if (pp && info)
+  {
+    png_destroy_read_struct(&pp, &info, NULL);
+
+    pp   = NULL;
+    info = NULL;
+  }
+
+  free(pixels);
+  pixels = NULL;
+
+  free(rows);
+  rows = NULL;
+
+  return (obj);
+
+#else
+  return (copy_png_chunks(dict, src));
+#endif // HAVE_LIBPNG
+}
+
+
+//
+// 'copy_png_chunks()' - Copy the compressed image data from a PNG image.
+//
+// This function copies the IDAT chunks from non-interlaced PNG images without
+// an alpha channel to a FlateDecode stream using the PNG predictors.
+//
+
+static pdfio_obj_t *			// O - Object or `NULL` on error
+copy_png_chunks(pdfio_dict_t    *dict,	// I - Dictionary
+                _pdfio_imgsrc_t *src)	// I - Image source
+{
+  pdfio_obj_t	*obj = NULL;		// Object
+  double	gamma = 2.2,		// Gamma value
+		wx = 0.0, wy = 0.0,	// White point chromacity
+		rx = 0.0, ry = 0.0,	// Red chromacity
+		gx = 0.0, gy = 0.0,	// Green chromacity
+		bx = 0.0, by = 0.0;	// Blue chromacity
+  bool		srgb = false;		// Explicit sRGB color space?
+  pdfio_dict_t	*decode = NULL;		// Parameters for PNG decode
+  pdfio_stream_t *st = NULL;		// Stream for PNG data
+  ssize_t	bytes;			// Bytes read
+  unsigned char	buffer[16384];		// Read buffer
+  unsigned	i,			// Looping var
+		length,			// Length
+		type,			// Chunk code
+		crc,			// CRC-32
+		temp,			// Temporary value
+		width = 0,		// Width
+		height = 0,		// Height
+		num_colors = 0;		// Number of colors
+  unsigned char	bit_depth = 0,		// Bit depth
+		color_type = 0,		// Color type
+		interlace = 0;		// Interlace type
+  pdfio_array_t	*mask = NULL;		// Color masking array
+  unsigned char	*iccp,			// ICC profile chunk
+		*iccptr,		// Pointer into ICC profile chunk
+		*icc = NULL,		// ICC profile data
+		*newicc;		// New ICC profile data
+  size_t	iccsize = 0,		// Allocated size of ICC profile data
+		newsize;		// New size of ICC profile data
+  z_stream	z;			// Decompression stream
+  int		zstatus;		// Decompression status
+  pdfio_obj_t	*icc_obj;		// ICC profile object
+
+
+  // Read the file header...
+  if (read_image(src, buffer, 8) != 8)
+    return (NULL);
+
+  // Then read chunks until we have the image data...
+  while (read_image(src, buffer, 8) == 8)
+  {
+    // Get the chunk length and type values...
+    length = (unsigned)((buffer[0] << 24) | (buffer[1] << 16) | (buffer[2] << 8) | buffer[3]);
+    type   = (unsigned)((buffer[4] << 24) | (buffer[5] << 16) | (buffer[6] << 8) | buffer[7]);
+    crc    = update_png_crc(0xffffffff, buffer + 4, 4);
+
+    switch (type)
+    {
+      case _PDFIO_PNG_CHUNK_IDAT : // Image data
+          if (!width || !height)
+          {
+            _pdfioFileError(dict->pdf, "Image data seen in PNG file before header.");
+            return (NULL);
+	  }
+
+          if (!st)
+          {
+	    PDFIO_DEBUG("copy_png_chunks: wx=%.6f, wy=%.6f, rx=%.6f, ry=%.6f, gx=%.6f, gy=%.6f, bx=%.6f, by=%.6f\n", wx, wy, rx, ry, gx, gy, bx, by);
+	    PDFIO_DEBUG("copy_png_chunks: gamma=%.6f\n", gamma);
+
+            if (!pdfioDictGetArray(dict, "ColorSpace"))
+            {
+              PDFIO_DEBUG("copy_png_chunks: Adding %s ColorSpace value.\n", color_type == _PDFIO_PNG_TYPE_GRAY ? "CalGray" : "CalRGB");
+
+	      if (wx != 0.0 && !srgb)
+		pdfioDictSetArray(dict, "ColorSpace", pdfioArrayCreateColorFromPrimaries(dict->pdf, color_type == _PDFIO_PNG_TYPE_GRAY ? 1 : 3, gamma, wx, wy, rx, ry, gx, gy, bx, by));
+              else
+		pdfioDictSetArray(dict, "ColorSpace", pdfioArrayCreateColorFromStandard(dict->pdf, color_type == _PDFIO_PNG_TYPE_GRAY ? 1 : 3, PDFIO_CS_SRGB));
+            }
+
+	    obj = pdfioFileCreateObj(dict->pdf, dict);
+
+	    if ((st = pdfioObjCreateStream(obj, PDFIO_FILTER_NONE)) == NULL)
+	    {
+	      pdfioObjClose(obj);
+	      return (NULL);
+	    }
+          }
+
+          while (length > 0)
+          {
+            if (length > sizeof(buffer))
+              bytes = (ssize_t)sizeof(buffer);
+	    else
+	      bytes = (ssize_t)length;
+
+            if ((bytes = read_image(src, buffer, (size_t)bytes)) <= 0)
+	    {
+	      pdfioStreamClose(st);
+	      _pdfioFileError(dict->pdf, "Early end-of-file in image file.");
+	      return (NULL);
+	    }
+
+            crc = update_png_crc(crc, buffer, (size_t)bytes);
+
+            if (!pdfioStreamWrite(st, buffer, (size_t)bytes))
+            {
+	      pdfioStreamClose(st);
+	      _pdfioFileError(dict->pdf, "Unable to copy image data.");
+	      return (NULL);
+            }
+
+            length -= bytes;
+          }
+          break;
+
+      case _PDFIO_PNG_CHUNK_IEND : // Image end
+          if (st)
+          {
+            pdfioStreamClose(st);
+            return (obj);
+          }
+          break;
+
+      case _PDFIO_PNG_CHUNK_IHDR : // Image header
+          if (st)
+          {
+	    pdfioStreamClose(st);
+	    _pdfioFileError(dict->pdf, "Unexpected image header.");
+	    return (NULL);
+          }
+
+          if (length != 13)
+          {
+	    _pdfioFileError(dict->pdf, "Early end-of-file in image file.");
+	    return (NULL);
+          }
+
+          if (read_image(src, buffer, length) != length)
+          {
+	    _pdfioFileError(dict->pdf, "Early end-of-file in image file.");
+	    return (NULL);
+          }
+
+	  crc    = update_png_crc(crc, buffer, length);
+	  width  = (unsigned)((buffer[0] << 24) | (buffer[1] << 16) | (buffer[2] << 8) | buffer[3]);
+	  height = (unsigned)((buffer[4] << 24) | (buffer[5] << 16) | (buffer[6] << 8) | buffer[7]);
+
+	  if (width == 0 || height == 0)
+	  {
+	    _pdfioFileError(dict->pdf, "Unsupported PNG dimensions %ux%u.", (unsigned)width, (unsigned)height);
+	    return (NULL);
+	  }
+
+	  bit_depth = buffer[8];
+	  color_type = buffer[9];
+
+	  if (color_type != _PDFIO_PNG_TYPE_GRAY && color_type != _PDFIO_PNG_TYPE_RGB && color_type != _PDFIO_PNG_TYPE_INDEXED)
+	  {
+	    _pdfioFileError(dict->pdf, "Unsupported PNG color type %u.", color_type);
+	    return (NULL);
+	  }
+
+	  if ((color_type == _PDFIO_PNG_TYPE_GRAY && bit_depth != 1 && bit_depth != 2 && bit_depth != 4 && bit_depth != 8 && bit_depth != 16) ||
+	      (color_type == _PDFIO_PNG_TYPE_RGB && bit_depth != 8 && bit_depth != 16) ||
+	      (color_type == _PDFIO_PNG_TYPE_INDEXED && bit_depth != 1 && bit_depth != 2 && bit_depth != 4 && bit_depth != 8))
+	  {
+	    _pdfioFileError(dict->pdf, "Unsupported PNG bit depth %u for color type %u.", bit_depth, color_type);
+	    return (NULL);
+	  }
+
+	  if (buffer[10] != _PDFIO_PNG_COMPRESSION_FLATE)
+	  {
+	    _pdfioFileError(dict->pdf, "Unsupported PNG compression %u.", buffer[10]);
+	    return (NULL);
+	  }
+
+	  if (buffer[11] != _PDFIO_PNG_FILTER_ADAPTIVE)
+	  {
+	    _pdfioFileError(dict->pdf, "Unsupported PNG filtering %u.", buffer[11]);
+	    return (NULL);
+	  }
+
+          interlace = buffer[12];
+
+	  if (interlace != _PDFIO_PNG_INTERLACE_NONE)
+	  {
+	    _pdfioFileError(dict->pdf, "Unsupported PNG interlacing %u.", interlace);
+	    return (NULL);
+	  }
+
+          num_colors = color_type == _PDFIO_PNG_TYPE_RGB ? 3 : 1;
+
+	  pdfioDictSetNumber(dict, "Width", width);
+	  pdfioDictSetNumber(dict, "Height", height);
+	  pdfioDictSetNumber(dict, "BitsPerComponent", bit_depth);
+	  pdfioDictSetName(dict, "Filter", "FlateDecode");
+
+	  if ((decode = pdfioDictCreate(dict->pdf)) == NULL)
+	    return (NULL);
+
+	  pdfioDictSetNumber(decode, "BitsPerComponent", bit_depth);
+	  pdfioDictSetNumber(decode, "Colors", num_colors);
+	  pdfioDictSetNumber(decode, "Columns", width);
+	  pdfioDictSetNumber(decode, "Predictor", _PDFIO_PREDICTOR_PNG_AUTO);
+	  pdfioDictSetDict(dict, "DecodeParms", decode);
+          break;
+
+      case _PDFIO_PNG_CHUNK_PLTE : // Palette
+          if (length == 0 || (length % 3) != 0 || length > 768)
+          {
+	    pdfioStreamClose(st);
+	    _pdfioFileError(dict->pdf, "Invalid color palette.");
+	    return (NULL);
+          }
+
+          if (read_image(src, buffer, length) != length)
+          {
+	    _pdfioFileError(dict->pdf, "Early end-of-file in image file.");
+	    return (NULL);
+          }
+
+	  crc = update_png_crc(crc, buffer, length);
+
+          PDFIO_DEBUG("copy_png_chunks: Adding Indexed ColorSpace value.\n");
+
+          pdfioDictSetArray(dict, "ColorSpace", pdfioArrayCreateColorFromPalette(dict->pdf, length / 3, buffer));
+          break;
+
+      case _PDFIO_PNG_CHUNK_cHRM : // Cromacities and white point
+          if (length != 32)
+          {
+	    _pdfioFileError(dict->pdf, "Early end-of-file in image file.");
+	    return (NULL);
+          }
+
+          if (read_image(src, buffer, length) != length)
+          {
+	    _pdfioFileError(dict->pdf, "Early end-of-file in image file.");
+	    return (NULL);
+          }
+
+	  crc = update_png_crc(crc, buffer, length);
+
+          wx = 0.00001 * ((buffer[0] << 24) | (buffer[1] << 16) | (buffer[2] << 8) | buffer[3]);
+          wy = 0.00001 * ((buffer[4] << 24) | (buffer[5] << 16) | (buffer[6] << 8) | buffer[7]);
+          rx = 0.00001 * ((buffer[8] << 24) | (buffer[9] << 16) | (buffer[10] << 8) | buffer[11]);
+          ry = 0.00001 * ((buffer[12] << 24) | (buffer[13] << 16) | (buffer[14] << 8) | buffer[15]);
+          gx = 0.00001 * ((buffer[16] << 24) | (buffer[17] << 16) | (buffer[18] << 8) | buffer[19]);
+          gy = 0.00001 * ((buffer[20] << 24) | (buffer[21] << 16) | (buffer[22] << 8) | buffer[23]);
+          bx = 0.00001 * ((buffer[24] << 24) | (buffer[25] << 16) | (buffer[26] << 8) | buffer[27]);
+          by = 0.00001 * ((buffer[28] << 24) | (buffer[29] << 16) | (buffer[30] << 8) | buffer[31]);
+          break;
+
+      case _PDFIO_PNG_CHUNK_gAMA : // Gamma correction
+          if (length != 4)
+          {
+	    _pdfioFileError(dict->pdf, "Early end-of-file in image file.");
+	    return (NULL);
+          }
+
+          if (read_image(src, buffer, length) != length)
+          {
+	    _pdfioFileError(dict->pdf, "Early end-of-file in image file.");
+	    return (NULL);
+          }
+
+	  crc = update_png_crc(crc, buffer, length);
+
+          gamma = 10000.0 / ((buffer[0] << 24) | (buffer[1] << 16) | (buffer[2] << 8) | buffer[3]);
+          break;
+
+      case _PDFIO_PNG_CHUNK_iCCP : // ICC color profile
+          if (!num_colors || length < 3 || length > 16777216)
+          {
+	    _pdfioFileError(dict->pdf, "Bad ICC profile chunk in image file.");
+	    return (NULL);
+          }
+
+          if ((iccp = (unsigned char *)malloc(length)) == NULL)
+          {
+	    _pdfioFileError(dict->pdf, "Unable to allocate memory for ICC profile: %s", strerror(errno));
+	    return (NULL);
+          }
+
+          if (read_image(src, iccp, length) != length)
+          {
+            free(iccp);
+	    _pdfioFileError(dict->pdf, "Early end-of-file in image file.");
+	    return (NULL);
+          }
+
+	  crc = update_png_crc(crc, iccp, length);
+
+          // Skip the profile name and compression method, then decompress the
+          // profile...
+          if ((iccptr = memchr(iccp, 0, length - 1)) == NULL || iccptr[1] != _PDFIO_PNG_COMPRESSION_FLATE)
+          {
+            free(iccp);
+	    _pdfioFileError(dict->pdf, "Bad ICC profile chunk in image file.");
+	    return (NULL);
+          }
+
+          memset(&z, 0, sizeof(z));
+          z.next_in  = iccptr + 2;
+          z.avail_in = (uInt)(length - (size_t)(iccptr + 2 - iccp));
+
+          if ((zstatus = inflateInit(&z)) == Z_OK)
+          {
+	    while (zstatus == Z_OK)
+	    {
+	      if (z.avail_out == 0)
+	      {
+	        // Grow the profile buffer as needed...
+	        newsize = iccsize ? 2 * iccsize : 65536;
+
+	        if (newsize > 16777216 || (newicc = (unsigned char *)realloc(icc, newsize)) == NULL)
+	        {
+	          zstatus = Z_MEM_ERROR;
+	          break;
+	        }
+
+	        icc         = newicc;
+	        iccsize     = newsize;
+	        z.next_out  = icc + z.total_out;
+	        z.avail_out = (uInt)(iccsize - z.total_out);
+	      }
+
+	      zstatus = inflate(&z, Z_NO_FLUSH);
+	    }
+
+	    inflateEnd(&z);
+	  }
+
+          free(iccp);
+
+          if (zstatus == Z_STREAM_END && (icc_obj = pdfioFileCreateICCObjFromData(dict->pdf, icc, z.total_out, num_colors)) != NULL)
+          {
+	    PDFIO_DEBUG("copy_png_chunks: Adding ICCBased ColorSpace value.\n");
+
+	    pdfioDictSetArray(dict, "ColorSpace", pdfioArrayCreateColorFromICCObj(dict->pdf, icc_obj));
+	  }
+	  else
+	  {
+	    PDFIO_DEBUG("copy_png_chunks: Ignoring bad ICC profile, zstatus=%d.\n", zstatus);
+	  }
+
+          free(icc);
+          icc     = NULL;
+          iccsize = 0;
+          break;
+
+      case _PDFIO_PNG_CHUNK_sRGB : // Standard RGB color space
+          if (length != 1)
+          {
+	    _pdfioFileError(dict->pdf, "Bad sRGB chunk in image file.");
+	    return (NULL);
+          }
+
+          if (read_image(src, buffer, length) != length)
           {
 	    _pdfioFileError(dict->pdf, "Early end-of-file in image file.");
 	    return (NULL);
           }
 
-          if (read(fd, buffer, length) != length)
+	  crc  = update_png_crc(crc, buffer, length);
+	  srgb = true;
+          break;
+
+      case _PDFIO_PNG_CHUNK_tRNS : // Transparency information
+          switch (color_type)
+          {
+            case _PDFIO_PNG_TYPE_INDEXED :
+		if (length > 256)
+		{
+		  _pdfioFileError(dict->pdf, "Bad transparency chunk in image file.");
+		  return (NULL);
+		}
+
+		if (read_image(src, buffer, length) != length)
+		{
+		  _pdfioFileError(dict->pdf, "Early end-of-file in image file.");
+		  return (NULL);
+		}
+
+                for (i = 0; i < length; i ++)
+                {
+                  if (!buffer[i])
+                    break;
+                }
+
+                if (i < length)
+                {
+                  if ((mask = pdfioArrayCreate(dict->pdf)) == NULL)
+                    return (NULL);
+
+                  pdfioArrayAppendNumber(mask, i);
+
+		  for (i ++; i < length; i ++)
+		  {
+		    if (buffer[i])
+		      break;
+		  }
+
+		  pdfioArrayAppendNumber(mask, i - 1);
+		}
+		break;
+
+	    case _PDFIO_PNG_TYPE_GRAY :
+		if (length != 2)
+		{
+		  _pdfioFileError(dict->pdf, "Bad transparency chunk in image file.");
+		  return (NULL);
+		}
+
+		if (read_image(src, buffer, length) != length)
+		{
+		  _pdfioFileError(dict->pdf, "Early end-of-file in image file.");
+		  return (NULL);
+		}
+
+		if ((mask = pdfioArrayCreate(dict->pdf)) == NULL)
+		  return (NULL);
+
+		pdfioArrayAppendNumber(mask, (buffer[0] << 8) | buffer[1]);
+		pdfioArrayAppendNumber(mask, (buffer[0] << 8) | buffer[1]);
+	        break;
+	    case _PDFIO_PNG_TYPE_RGB :
+		if (length != 6)
+		{
+		  _pdfioFileError(dict->pdf, "Bad transparency chunk in image file.");
+		  return (NULL);
+		}
+
+		if (read_image(src, buffer, length) != length)
+		{
+		  _pdfioFileError(dict->pdf, "Early end-of-file in image file.");
+		  return (NULL);
+		}
+
+		if ((mask = pdfioArrayCreate(dict->pdf)) == NULL)
+		  return (NULL);
+
+		pdfioArrayAppendNumber(mask, (buffer[0] << 8) | buffer[1]);
+		pdfioArrayAppendNumber(mask, (buffer[2] << 8) | buffer[3]);
+		pdfioArrayAppendNumber(mask, (buffer[4] << 8) | buffer[5]);
+		pdfioArrayAppendNumber(mask, (buffer[0] << 8) | buffer[1]);
+		pdfioArrayAppendNumber(mask, (buffer[2] << 8) | buffer[3]);
+		pdfioArrayAppendNumber(mask, (buffer[4] << 8) | buffer[5]);
+	        break;
+	  }
+
+	  crc = update_png_crc(crc, buffer, length);
+
+          if (mask)
+            pdfioDictSetArray(dict, "Mask", mask);
+          break;
+
+      default : // Something else
+          while (length > 0)
           {
-	    _pdfioFileError(dict->pdf, "Early end-of-file in image file.");
-	    return (NULL);
+            if (length > sizeof(buffer))
+              bytes = (ssize_t)sizeof(buffer);
+	    else
+	      bytes = (ssize_t)length;
+
+            if ((bytes = read_image(src, buffer, (size_t)bytes)) <= 0)
+	    {
+	      pdfioStreamClose(st);
+	      _pdfioFileError(dict->pdf, "Early end-of-file in image file.");
+	      return (NULL);
+	    }
+
+            crc    = update_png_crc(crc, buffer, (size_t)bytes);
+            length -= bytes;
           }
+          break;
+    }
+
+    // Verify the CRC...
+    crc ^= 0xffffffff;
+
+    if (read_image(src, buffer, 4) != 4)
+    {
+      pdfioStreamClose(st);
+      _pdfioFileError(dict->pdf, "Unable to read CRC.");
+      return (NULL);
+    }
+
+    temp = (unsigned)((buffer[0] << 24) | (buffer[1] << 16) | (buffer[2] << 8) | buffer[3]);
+    if (temp != crc)
+    {
+      pdfioStreamClose(st);
+      _pdfioFileError(dict->pdf, "Bad CRC (0x%08x != 0x%08x).", temp, crc);
+      return (NULL);
+    }
+  }
+
+  return (NULL);
+}
+
+
+//
+// 'clear_gstate()' - Forget the current value of a graphics state item.
+//
+
+static void
+clear_gstate(pdfio_stream_t *st,	// I - Stream
+             _pdfio_gitem_t item)	// I - Graphics state item
+{
+  if (st && st->gstates)
+    st->gstates[st->num_gstates - 1].valid &= ~(1U << item);
+}
+
+
+//
+// 'create_cp1252()' - Create the CP1252 font encoding object.
+//
+
+static bool				// O - `true` on success, `false` on failure
+create_cp1252(pdfio_file_t *pdf)	// I - PDF file
+{
+  pdfio_dict_t	*cp1252_dict;		// Encoding dictionary
+  pdfio_obj_t	*cp1252_obj;		// Encoding object
+
+
+  _pdfioFileLock(pdf);
+
+  // Another thread may have created the encoding already...
+  if (pdf->cp1252_obj)
+  {
+    _pdfioFileUnlock(pdf);
+    return (true);
+  }
+
+  if ((cp1252_dict = pdfioDictCreate(pdf)) == NULL)
+  {
+    _pdfioFileUnlock(pdf);
+    return (false);
+  }
+
+  pdfioDictSetName(cp1252_dict, "Type", "Encoding");
+  pdfioDictSetName(cp1252_dict, "BaseEncoding", "WinAnsiEncoding");
+
+  if ((cp1252_obj = pdfioFileCreateObj(pdf, cp1252_dict)) != NULL)
+  {
+    pdfioObjClose(cp1252_obj);
+    pdf->cp1252_obj = cp1252_obj;
+  }
+
+  _pdfioFileUnlock(pdf);
+
+  return (cp1252_obj != NULL);
+}
+
+
+//
+// 'create_font()' - Create the object for a TrueType font.
+//
+
+static pdfio_obj_t *			// O - Font object
+create_font(pdfio_obj_t *file_obj,	// I - Font file object
+            ttf_t       *font,		// I - TrueType font
+            bool        unicode,	// I - Force Unicode
+            _pdfio_subset_t *subset,	// I - Font subset or `NULL` for none
+            _pdfio_cfont_t  *cfont)	// I - Cached font or `NULL` for none
+{
+  ttf_rect_t	bounds;			// Font bounds
+  pdfio_dict_t	*dict,			// Font dictionary
+		*desc;			// Font descriptor
+  pdfio_obj_t	*obj = NULL,		// Font object
+		*desc_obj;		// Font descriptor object
+  const char	*basefont;		// Base font name
+  pdfio_array_t	*bbox;			// Font bounding box array
+  pdfio_stream_t *st;			// Font stream
+
+
+  // Create the font descriptor dictionary and object...
+  if ((bbox = pdfioArrayCreate(file_obj->pdf)) == NULL)
+    goto done;
+
+  ttfGetBounds(font, &bounds);
+
+  pdfioArrayAppendNumber(bbox, bounds.left);
+  pdfioArrayAppendNumber(bbox, bounds.bottom);
+  pdfioArrayAppendNumber(bbox, bounds.right);
+  pdfioArrayAppendNumber(bbox, bounds.top);
+
+  if ((desc = pdfioDictCreate(file_obj->pdf)) == NULL)
+    goto done;
+
+  if (subset)
+  {
+    // Subset fonts get a unique six letter tag based on the object number...
+    char	tag[7],			// Subset tag
+		*tagptr;		// Pointer into tag
+    size_t	number;			// Object number
+
+    for (tagptr = tag + 5, number = file_obj->number; tagptr >= tag; tagptr --, number /= 26)
+      *tagptr = (char)('A' + number % 26);
+    tag[6] = '\0';
+
+    basefont = pdfioStringCreatef(file_obj->pdf, "%s+%s", tag, ttfGetPostScriptName(font));
+  }
+  else
+  {
+    basefont = pdfioStringCreate(file_obj->pdf, ttfGetPostScriptName(font));
+  }
+
+  if (!basefont)
+    goto done;
+
+  pdfioDictSetName(desc, "Type", "FontDescriptor");
+  pdfioDictSetName(desc, "FontName", basefont);
+  pdfioDictSetObj(desc, "FontFile2", file_obj);
+  pdfioDictSetNumber(desc, "Flags", ttfIsFixedPitch(font) ? 0x21 : 0x20);
+  pdfioDictSetArray(desc, "FontBBox", bbox);
+  pdfioDictSetNumber(desc, "ItalicAngle", ttfGetItalicAngle(font));
+  pdfioDictSetNumber(desc, "Ascent", ttfGetAscent(font));
+  pdfioDictSetNumber(desc, "Descent", ttfGetDescent(font));
+  pdfioDictSetNumber(desc, "CapHeight", ttfGetCapHeight(font));
+  pdfioDictSetNumber(desc, "XHeight", ttfGetXHeight(font));
+  // Note: No TrueType value exists for this but PDF requires it, so we
+  // calculate a generic value from 50 to 250 based on the weight...
+  pdfioDictSetNumber(desc, "StemV", ttfGetWeight(font) / 4 + 25);
+
+  if ((desc_obj = pdfioFileCreateObj(file_obj->pdf, desc)) == NULL)
+    goto done;
+
+  pdfioObjClose(desc_obj);
+
+  if (unicode)
+  {
+    // Unicode (CID) font...
+    pdfio_dict_t	*cid2gid,	// CIDToGIDMap dictionary
+			*to_unicode;	// ToUnicode dictionary
+    pdfio_obj_t		*cid2gid_obj,	// CIDToGIDMap object
+			*to_unicode_obj;// ToUnicode object
+    size_t		i,		// Looping var
+			num_cmap;	// Number of CMap entries
+    const int		*cmap;		// CMap entries
+    int			min_glyph,	// First glyph
+			max_glyph;	// Last glyph
+    unsigned short	glyphs[65536];	// Glyph to Unicode mapping
+    unsigned char	buffer[16384],	// Read buffer
+			*bufptr,	// Pointer into buffer
+			*bufend;	// End of buffer
+    pdfio_dict_t	*type2;		// CIDFontType2 font dictionary
+    pdfio_obj_t		*type2_obj;	// CIDFontType2 font object
+    pdfio_array_t	*descendants;	// Decendant font list
+    pdfio_dict_t	*sidict;	// CIDSystemInfo dictionary
+    pdfio_array_t	*w_array = NULL;// Width array
+
+    // Create a CIDSystemInfo mapping to Adobe UCS2 v0 (Unicode)
+    if ((sidict = pdfioDictCreate(file_obj->pdf)) == NULL)
+      goto done;
+
+    pdfioDictSetString(sidict, "Registry", "Adobe");
+    pdfioDictSetString(sidict, "Ordering", "Identity");
+    pdfioDictSetNumber(sidict, "Supplement", 0);
+
+    // Create a CIDToGIDMap object for the Unicode font...
+    if ((cid2gid = pdfioDictCreate(file_obj->pdf)) == NULL)
+      goto done;
+
+#ifndef DEBUG
+    pdfioDictSetName(cid2gid, "Filter", "FlateDecode");
+#endif // !DEBUG
+
+    if ((cid2gid_obj = pdfioFileCreateObj(file_obj->pdf, cid2gid)) == NULL)
+      goto done;
+
+    if (cfont)
+    {
+      // Copy the cached map...
+      pdfioDictSetName(cid2gid, "Filter", "FlateDecode");
+
+      if ((st = pdfioObjCreateStream(cid2gid_obj, PDFIO_FILTER_NONE)) == NULL)
+        goto done;
+
+      if (!pdfioStreamWrite(st, cfont->cid2gid, cfont->cid2gidlen))
+      {
+	pdfioStreamClose(st);
+	goto done;
+      }
+
+      pdfioStreamClose(st);
+    }
+    else if (!subset)
+    {
+      // Map all of the characters in the font...
+#ifdef DEBUG
+      if ((st = pdfioObjCreateStream(cid2gid_obj, PDFIO_FILTER_NONE)) == NULL)
+#else
+      if ((st = pdfioObjCreateStream(cid2gid_obj, PDFIO_FILTER_FLATE)) == NULL)
+#endif // DEBUG
+	goto done;
+
+      cmap      = ttfGetCMap(font, &num_cmap);
+      min_glyph = 65536;
+      max_glyph = 0;
+      memset(glyphs, 0, sizeof(glyphs));
 
-	  crc    = update_png_crc(crc, buffer, length);
-	  width  = (unsigned)((buffer[0] << 24) | (buffer[1] << 16) | (buffer[2] << 8) | buffer[3]);
-	  height = (unsigned)((buffer[4] << 24) | (buffer[5] << 16) | (buffer[6] << 8) | buffer[7]);
+      PDFIO_DEBUG("create_font: num_cmap=%u\n", (unsigned)num_cmap);
 
-	  if (width == 0 || height == 0)
+      for (i = 0, bufptr = buffer, bufend = buffer + sizeof(buffer); i < num_cmap; i ++)
+      {
+	PDFIO_DEBUG("create_font: cmap[%u]=%d\n", (unsigned)i, cmap[i]);
+	if (cmap[i] < 0 || cmap[i] >= (int)(sizeof(glyphs) / sizeof(glyphs[0])))
+	{
+	  // Map undefined glyph to .notdef...
+	  *bufptr++ = 0;
+	  *bufptr++ = 0;
+	}
+	else
+	{
+	  // Map to specified glyph...
+	  *bufptr++ = (unsigned char)(cmap[i] >> 8);
+	  *bufptr++ = (unsigned char)(cmap[i] & 255);
+
+	  glyphs[cmap[i]] = (unsigned short)i;
+	  if (cmap[i] < min_glyph)
+	    min_glyph = cmap[i];
+	  if (cmap[i] > max_glyph)
+	    max_glyph = cmap[i];
+	}
+
+	if (bufptr >= bufend)
+	{
+	  // Flush buffer...
+	  if (!pdfioStreamWrite(st, buffer, (size_t)(bufptr - buffer)))
 	  {
-	    _pdfioFileError(dict->pdf, "Unsupported PNG dimensions %ux%u.", (unsigned)width, (unsigned)height);
-	    return (NULL);
+	    pdfioStreamClose(st);
+	    goto done;
 	  }
 
-	  bit_depth = buffer[8];
-	  color_type = buffer[9];
+	  bufptr = buffer;
+	}
+      }
 
-	  if (color_type != _PDFIO_PNG_TYPE_GRAY && color_type != _PDFIO_PNG_TYPE_RGB && color_type != _PDFIO_PNG_TYPE_INDEXED)
-	  {
-	    _pdfioFileError(dict->pdf, "Unsupported PNG color type %u.", color_type);
-	    return (NULL);
-	  }
+      if (bufptr > buffer)
+      {
+	// Flush buffer...
+	if (!pdfioStreamWrite(st, buffer, (size_t)(bufptr - buffer)))
+	{
+	  pdfioStreamClose(st);
+	  goto done;
+	}
+      }
 
-	  if ((color_type == _PDFIO_PNG_TYPE_GRAY && bit_depth != 1 && bit_depth != 2 && bit_depth != 4 && bit_depth != 8 && bit_depth != 16) ||
-	      (color_type == _PDFIO_PNG_TYPE_RGB && bit_depth != 8 && bit_depth != 16) ||
-	      (color_type == _PDFIO_PNG_TYPE_INDEXED && bit_depth != 1 && bit_depth != 2 && bit_depth != 4 && bit_depth != 8))
-	  {
-	    _pdfioFileError(dict->pdf, "Unsupported PNG bit depth %u for color type %u.", bit_depth, color_type);
-	    return (NULL);
-	  }
+      pdfioStreamClose(st);
+    }
 
-	  if (buffer[10] != _PDFIO_PNG_COMPRESSION_FLATE)
-	  {
-	    _pdfioFileError(dict->pdf, "Unsupported PNG compression %u.", buffer[10]);
-	    return (NULL);
-	  }
+    // ToUnicode mapping object
+    to_unicode = pdfioDictCreate(file_obj->pdf);
+    pdfioDictSetName(to_unicode, "Type", "CMap");
+    pdfioDictSetName(to_unicode, "CMapName", "Adobe-Identity-UCS2");
+    pdfioDictSetDict(to_unicode, "CIDSystemInfo", sidict);
 
-	  if (buffer[11] != _PDFIO_PNG_FILTER_ADAPTIVE)
-	  {
-	    _pdfioFileError(dict->pdf, "Unsupported PNG filtering %u.", buffer[11]);
-	    return (NULL);
-	  }
+#ifndef DEBUG
+    pdfioDictSetName(to_unicode, "Filter", "FlateDecode");
+#endif // !DEBUG
 
-          interlace = buffer[12];
+    if ((to_unicode_obj = pdfioFileCreateObj(file_obj->pdf, to_unicode)) == NULL)
+      goto done;
 
-	  if (interlace != _PDFIO_PNG_INTERLACE_NONE)
-	  {
-	    _pdfioFileError(dict->pdf, "Unsupported PNG interlacing %u.", interlace);
-	    return (NULL);
-	  }
+#ifdef DEBUG
+    if ((st = pdfioObjCreateStream(to_unicode_obj, PDFIO_FILTER_NONE)) == NULL)
+#else
+    if ((st = pdfioObjCreateStream(to_unicode_obj, PDFIO_FILTER_FLATE)) == NULL)
+#endif // DEBUG
+      goto done;
+
+    pdfioStreamPuts(st,
+		    "stream\n"
+		    "/CIDInit /ProcSet findresource begin\n"
+		    "12 dict begin\n"
+		    "begincmap\n"
+		    "/CIDSystemInfo<<\n"
+		    "/Registry (Adobe)\n"
+		    "/Ordering (UCS2)\n"
+		    "/Supplement 0\n"
+		    ">> def\n"
+		    "/CMapName /Adobe-Identity-UCS2 def\n"
+		    "/CMapType 2 def\n"
+		    "1 begincodespacerange\n"
+		    "<0000> <FFFF>\n"
+		    "endcodespacerange\n"
+                    "endcmap\n"
+                    "CMapName currentdict /CMap defineresource pop\n"
+                    "end\n"
+                    "end\n");
+
+    pdfioStreamClose(st);
+
+    // Create a CIDFontType2 dictionary for the Unicode font...
+    if ((type2 = pdfioDictCreate(file_obj->pdf)) == NULL)
+      goto done;
+
+    // Width array (the subset widths are written when the file is closed)
+    if (cfont)
+    {
+      if ((w_array = create_widths(file_obj->pdf, cfont->widths, cfont->num_widths)) == NULL)
+        goto done;
+    }
+    else if (!subset)
+    {
+      int	*widths;		// Encoded widths
+      size_t	num_widths;		// Number of encoded widths
+
+      if ((widths = get_widths(font, &num_widths)) == NULL)
+        goto done;
+
+      w_array = create_widths(file_obj->pdf, widths, num_widths);
+      free(widths);
+
+      if (!w_array)
+        goto done;
+    }
+
+    // Then the dictionary for the CID base font...
+    pdfioDictSetName(type2, "Type", "Font");
+    pdfioDictSetName(type2, "Subtype", "CIDFontType2");
+    pdfioDictSetName(type2, "BaseFont", basefont);
+    pdfioDictSetDict(type2, "CIDSystemInfo", sidict);
+    pdfioDictSetObj(type2, "CIDToGIDMap", cid2gid_obj);
+    pdfioDictSetObj(type2, "FontDescriptor", desc_obj);
+    if (!subset)
+      pdfioDictSetArray(type2, "W", w_array);
+
+    if ((type2_obj = pdfioFileCreateObj(file_obj->pdf, type2)) == NULL)
+      goto done;
+
+    if (!subset)
+      pdfioObjClose(type2_obj);
+
+    // Create a Type 0 font object...
+    if ((descendants = pdfioArrayCreate(file_obj->pdf)) == NULL)
+      goto done;
+
+    pdfioArrayAppendObj(descendants, type2_obj);
+
+    if ((dict = pdfioDictCreate(file_obj->pdf)) == NULL)
+      goto done;
+
+    pdfioDictSetName(dict, "Type", "Font");
+    pdfioDictSetName(dict, "Subtype", "Type0");
+    pdfioDictSetName(dict, "BaseFont", basefont);
+    pdfioDictSetArray(dict, "DescendantFonts", descendants);
+    pdfioDictSetName(dict, "Encoding", "Identity-H");
+    pdfioDictSetObj(dict, "ToUnicode", to_unicode_obj);
+
+    if ((obj = pdfioFileCreateObj(file_obj->pdf, dict)) == NULL)
+      goto done;
+
+    pdfioObjClose(obj);
+
+    if (subset)
+    {
+      // Save the subset for writing when the PDF file is closed...
+      pdfio_file_t	*pdf = file_obj->pdf;
+					// PDF file
+
+      subset->font_obj    = obj;
+      subset->file_obj    = file_obj;
+      subset->cid2gid_obj = cid2gid_obj;
+      subset->type2_obj   = type2_obj;
+
+      _pdfioFileLock(pdf);
+
+      if (pdf->num_subsets >= pdf->alloc_subsets)
+      {
+	_pdfio_subset_t	**temp;		// New subsets array
+
+	if ((temp = (_pdfio_subset_t **)realloc(pdf->subsets, (pdf->alloc_subsets + 4) * sizeof(_pdfio_subset_t *))) == NULL)
+	{
+	  _pdfioFileUnlock(pdf);
+	  _pdfioFileError(pdf, "Unable to allocate memory for font subset.");
+	  obj = NULL;
+	  goto done;
+	}
+
+	pdf->subsets       = temp;
+	pdf->alloc_subsets += 4;
+      }
+
+      pdf->subsets[pdf->num_subsets ++] = subset;
+
+      _pdfioFileUnlock(pdf);
+    }
+  }
+  else
+  {
+    // Simple (CP1282 or custom encoding) 8-bit font...
+    int			ch;		// Character
+    pdfio_array_t	*w_array;	// Widths array
+
+    if (ttfGetMaxChar(font) >= 255 && !file_obj->pdf->cp1252_obj && !create_cp1252(file_obj->pdf))
+      goto done;
+
+    // Create a TrueType font object...
+    if ((dict = pdfioDictCreate(file_obj->pdf)) == NULL)
+      goto done;
+
+    pdfioDictSetName(dict, "Type", "Font");
+    pdfioDictSetName(dict, "Subtype", "TrueType");
+    pdfioDictSetName(dict, "BaseFont", basefont);
+    pdfioDictSetNumber(dict, "FirstChar", 32);
+    if (ttfGetMaxChar(font) >= 255)
+    {
+      pdfioDictSetObj(dict, "Encoding", file_obj->pdf->cp1252_obj);
+      pdfioDictSetNumber(dict, "LastChar", 255);
+    }
+    else
+    {
+      pdfioDictSetNumber(dict, "LastChar", ttfGetMaxChar(font));
+    }
+
+    // Build a Widths array for CP1252/WinAnsiEncoding
+    if ((w_array = pdfioArrayCreate(file_obj->pdf)) == NULL)
+      goto done;
+
+    for (ch = 32; ch < 256 && ch < ttfGetMaxChar(font); ch ++)
+    {
+      if (ch >= 0x80 && ch < 0xa0)
+	pdfioArrayAppendNumber(w_array, ttfGetWidth(font, _pdfio_cp1252[ch - 0x80]));
+      else
+	pdfioArrayAppendNumber(w_array, ttfGetWidth(font, ch));
+    }
+
+    pdfioDictSetArray(dict, "Widths", w_array);
+
+    pdfioDictSetObj(dict, "FontDescriptor", desc_obj);
+
+    if ((obj = pdfioFileCreateObj(file_obj->pdf, dict)) != NULL)
+      pdfioObjClose(obj);
+  }
+
+  done:
+
+  if (obj)
+    _pdfioObjSetExtension(obj, font, cfont ? (_pdfio_extfree_t)release_font : (_pdfio_extfree_t)ttfDelete);
+
+  return (obj);
+}
+
+
+//
+// 'create_image()' - Create an image object from some data.
+//
+
+static pdfio_obj_t *			// O - PDF object or `NULL` on error
+create_image(
+    pdfio_dict_t        *dict,		// I - Image dictionary
+    const unsigned char *data,		// I - Image data
+    size_t              width,		// I - Width in columns
+    size_t              height,		// I - Height in lines
+    size_t              depth,		// I - Bit depth
+    size_t              num_colors,	// I - Number of colors
+    bool                alpha)		// I - `true` if there is transparency
+{
+  pdfio_image_t	*image;			// Image
+
+
+  if ((image = start_image(dict, width, height, depth, num_colors, alpha)) == NULL)
+    return (NULL);
+
+  if (!pdfioImageWriteRows(image, data, height))
+  {
+    pdfioImageClose(image);
+    return (NULL);
+  }
+
+  return (pdfioImageClose(image));
+}
+
+
+//
+// 'create_widths()' - Create a W array from encoded widths.
+//
+
+static pdfio_array_t *			// O - Width array or `NULL` on error
+create_widths(pdfio_file_t *pdf,	// I - PDF file
+              const int    *widths,	// I - Encoded widths
+              size_t       num_widths)	// I - Number of encoded widths
+{
+  pdfio_array_t	*w_array,		// Width array
+		*temp_array;		// Temporary width sub-array
+  const int	*wptr,			// Pointer into widths
+		*wend;			// End of widths
+  int		first,			// First CID
+		count;			// Number of widths or -length of run
+
+
+  if ((w_array = pdfioArrayCreate(pdf)) == NULL)
+    return (NULL);
+
+  for (wptr = widths, wend = widths + num_widths; (wptr + 2) < wend;)
+  {
+    first = *wptr++;
+    count = *wptr++;
+
+    if (count < 0)
+    {
+      // Repeating sequence...
+      pdfioArrayAppendNumber(w_array, first);
+      pdfioArrayAppendNumber(w_array, first - count - 1);
+      pdfioArrayAppendNumber(w_array, *wptr++);
+    }
+    else
+    {
+      // Non-repeating sequence...
+      pdfioArrayAppendNumber(w_array, first);
+
+      if ((temp_array = pdfioArrayCreate(pdf)) == NULL)
+        return (NULL);
+
+      for (; count > 0 && wptr < wend; count --)
+        pdfioArrayAppendNumber(temp_array, *wptr++);
+
+      pdfioArrayAppendArray(w_array, temp_array);
+    }
+  }
 
-          num_colors = color_type == _PDFIO_PNG_TYPE_RGB ? 3 : 1;
+  return (w_array);
+}
 
-	  pdfioDictSetNumber(dict, "Width", width);
-	  pdfioDictSetNumber(dict, "Height", height);
-	  pdfioDictSetNumber(dict, "BitsPerComponent", bit_depth);
-	  pdfioDictSetName(dict, "Filter", "FlateDecode");
 
-	  if ((decode = pdfioDictCreate(dict->pdf)) == NULL)
-	    return (NULL);
+//
+// 'get_advance()' - Get the advance width of a character.
+//
+// The widths for a block of 256 characters in the Basic Multilingual Plane are
+// looked up and cached the first time one of them is measured.
+//
 
-	  pdfioDictSetNumber(decode, "BitsPerComponent", bit_depth);
-	  pdfioDictSetNumber(decode, "Colors", num_colors);
-	  pdfioDictSetNumber(decode, "Columns", width);
-	  pdfioDictSetNumber(decode, "Predictor", _PDFIO_PREDICTOR_PNG_AUTO);
-	  pdfioDictSetDict(dict, "DecodeParms", decode);
-          break;
+static int				// O - Advance width in 1/1000ths of an em
+get_advance(pdfio_fontmetrics_t *fm,	// I - Measurement context
+            int                 ch)	// I - Unicode character
+{
+  int	*widths,			// Widths for block
+	base,				// First character in block
+	i;				// Looping var
 
-      case _PDFIO_PNG_CHUNK_PLTE : // Palette
-          if (length == 0 || (length % 3) != 0 || length > 768)
-          {
-	    pdfioStreamClose(st);
-	    _pdfioFileError(dict->pdf, "Invalid color palette.");
-	    return (NULL);
-          }
 
-          if (read(fd, buffer, length) != length)
-          {
-	    _pdfioFileError(dict->pdf, "Early end-of-file in image file.");
-	    return (NULL);
-          }
+  if (ch < 0x10000 && (widths = (int *)calloc(256, sizeof(int))) != NULL)
+  {
+    // Cache the widths for this block of characters...
+    base = ch & ~255;
 
-	  crc = update_png_crc(crc, buffer, length);
+    for (i = 0; i < 256; i ++)
+    {
+      if ((base + i) < ' ' || (base + i) == 0x7f)
+        widths[i] = 0;			// Control characters are ignored
+      else if (fm->ttf)
+        widths[i] = ttfGetWidth(fm->ttf, base + i);
+      else if (base)
+        widths[i] = fm->base_widths[map_cp1252(base + i)];
+      else
+        widths[i] = fm->base_widths[i];
+    }
 
-          PDFIO_DEBUG("copy_png: Adding Indexed ColorSpace value.\n");
+    fm->widths[ch >> 8] = widths;
 
-          pdfioDictSetArray(dict, "ColorSpace", pdfioArrayCreateColorFromPalette(dict->pdf, length / 3, buffer));
-          break;
+    return (widths[ch & 255]);
+  }
 
-      case _PDFIO_PNG_CHUNK_cHRM : // Cromacities and white point
-          if (length != 32)
-          {
-	    _pdfioFileError(dict->pdf, "Early end-of-file in image file.");
-	    return (NULL);
-          }
+  // Look up the width of characters outside the BMP directly (the TrueType
+  // library only supports characters up to U+3FFFF)...
+  if (!fm->ttf)
+    return (fm->base_widths['?']);
+  else if (ch < 0x40000)
+    return (ttfGetWidth(fm->ttf, ch));
+  else
+    return (0);
+}
 
-          if (read(fd, buffer, length) != length)
-          {
-	    _pdfioFileError(dict->pdf, "Early end-of-file in image file.");
-	    return (NULL);
-          }
 
-	  crc = update_png_crc(crc, buffer, length);
+//
+// 'get_base_widths()' - Get the widths table for a base font.
+//
 
-          wx = 0.00001 * ((buffer[0] << 24) | (buffer[1] << 16) | (buffer[2] << 8) | buffer[3]);
-          wy = 0.00001 * ((buffer[4] << 24) | (buffer[5] << 16) | (buffer[6] << 8) | buffer[7]);
-          rx = 0.00001 * ((buffer[8] << 24) | (buffer[9] << 16) | (buffer[10] << 8) | buffer[11]);
-          ry = 0.00001 * ((buffer[12] << 24) | (buffer[13] << 16) | (buffer[14] << 8) | buffer[15]);
-          gx = 0.00001 * ((buffer[16] << 24) | (buffer[17] << 16) | (buffer[18] << 8) | buffer[19]);
-          gy = 0.00001 * ((buffer[20] << 24) | (buffer[21] << 16) | (buffer[22] << 8) | buffer[23]);
-          bx = 0.00001 * ((buffer[24] << 24) | (buffer[25] << 16) | (buffer[26] << 8) | buffer[27]);
-          by = 0.00001 * ((buffer[28] << 24) | (buffer[29] << 16) | (buffer[30] << 8) | buffer[31]);
-          break;
+static const short *			// O - Widths or `NULL` if not a base font
+get_base_widths(const char *basefont)	// I - Base font name
+{
+  if (!strcmp(basefont, "Courier"))
+    return (courier_widths);
+  else if (!strcmp(basefont, "Courier-Bold"))
+    return (courier_bold_widths);
+  else if (!strcmp(basefont, "Courier-BoldOblique"))
+    return (courier_boldoblique_widths);
+  else if (!strcmp(basefont, "Courier-Oblique"))
+    return (courier_oblique_widths);
+  else if (!strcmp(basefont, "Helvetica"))
+    return (helvetica_widths);
+  else if (!strcmp(basefont, "Helvetica-Bold"))
+    return (helvetica_bold_widths);
+  else if (!strcmp(basefont, "Helvetica-BoldOblique"))
+    return (helvetica_boldoblique_widths);
+  else if (!strcmp(basefont, "Helvetica-Oblique"))
+    return (helvetica_oblique_widths);
+  else if (!strcmp(basefont, "Symbol"))
+    return (symbol_widths);
+  else if (!strcmp(basefont, "Times-Bold"))
+    return (times_bold_widths);
+  else if (!strcmp(basefont, "Times-BoldItalic"))
+    return (times_bolditalic_widths);
+  else if (!strcmp(basefont, "Times-Italic"))
+    return (times_italic_widths);
+  else if (!strcmp(basefont, "Times-Roman"))
+    return (times_roman_widths);
+  else if (!strcmp(basefont, "ZapfDingbats"))
+    return (zapfdingbats_widths);
+  else
+    return (NULL);
+}
 
-      case _PDFIO_PNG_CHUNK_gAMA : // Gamma correction
-          if (length != 4)
-          {
-	    _pdfioFileError(dict->pdf, "Early end-of-file in image file.");
-	    return (NULL);
-          }
 
-          if (read(fd, buffer, length) != length)
-          {
-	    _pdfioFileError(dict->pdf, "Early end-of-file in image file.");
-	    return (NULL);
-          }
+//
+// 'get_cached_font()' - Get a font from the shared font cache.
+//
+// The font file is loaded, compressed, and added to the cache the first time
+// it is used.  The CIDToGIDMap and widths for Unicode fonts are likewise
+// computed the first time a Unicode font object is created.
+//
 
-	  crc = update_png_crc(crc, buffer, length);
+static _pdfio_cfont_t *			// O - Cached font or `NULL` on error
+get_cached_font(pdfio_file_t *pdf,	// I - PDF file
+                const char   *filename,	// I - Font filename
+                int          fd,	// I - Font file descriptor
+                bool         unicode)	// I - Unicode font?
+{
+  struct stat	fileinfo;		// Font file information
+  size_t	i,			// Looping var
+		num_cmap;		// Number of CMap entries
+  _pdfio_cfont_t *cfont = NULL,		// Cached font
+		**temp;			// New font cache array
+  const int	*cmap;			// CMap entries
+  unsigned char	*data = NULL,		// Uncompressed data
+		*dataptr;		// Pointer into data
+  size_t	datasize;		// Size of uncompressed data
+  uLongf	datalen;		// Length of compressed data
+  ssize_t	bytes;			// Bytes read
 
-          gamma = 10000.0 / ((buffer[0] << 24) | (buffer[1] << 16) | (buffer[2] << 8) | buffer[3]);
-          break;
 
-      case _PDFIO_PNG_CHUNK_tRNS : // Transparency information
-          switch (color_type)
-          {
-            case _PDFIO_PNG_TYPE_INDEXED :
-		if (length > 256)
-		{
-		  _pdfioFileError(dict->pdf, "Bad transparency chunk in image file.");
-		  return (NULL);
-		}
+  if (fstat(fd, &fileinfo))
+  {
+    _pdfioFileError(pdf, "Unable to get information for font file '%s': %s", filename, strerror(errno));
+    return (NULL);
+  }
 
-		if (read(fd, buffer, length) != length)
-		{
-		  _pdfioFileError(dict->pdf, "Early end-of-file in image file.");
-		  return (NULL);
-		}
+#ifdef HAVE_PTHREAD
+  pthread_mutex_lock(&font_cache_mutex);
+#endif // HAVE_PTHREAD
 
-                for (i = 0; i < length; i ++)
-                {
-                  if (!buffer[i])
-                    break;
-                }
+  // Look for the font in the cache, using the size and modification time to
+  // catch font files that are updated...
+  for (i = 0; i < font_cache_num; i ++)
+  {
+    if (!strcmp(font_cache[i]->filename, filename) && font_cache[i]->size == fileinfo.st_size && font_cache[i]->mtime == fileinfo.st_mtime)
+    {
+      cfont = font_cache[i];
+      break;
+    }
+  }
 
-                if (i < length)
-                {
-                  if ((mask = pdfioArrayCreate(dict->pdf)) == NULL)
-                    return (NULL);
+  if (!cfont)
+  {
+    // Load the font and compress the font file...
+    if (font_cache_num >= font_cache_alloc)
+    {
+      if ((temp = (_pdfio_cfont_t **)realloc(font_cache, (font_cache_alloc + 8) * sizeof(_pdfio_cfont_t *))) == NULL)
+      {
+        _pdfioFileError(pdf, "Unable to allocate memory for font cache.");
+        goto error;
+      }
 
-                  pdfioArrayAppendNumber(mask, i);
+      font_cache       = temp;
+      font_cache_alloc += 8;
+    }
 
-		  for (i ++; i < length; i ++)
-		  {
-		    if (buffer[i])
-		      break;
-		  }
+    if ((cfont = (_pdfio_cfont_t *)calloc(1, sizeof(_pdfio_cfont_t))) == NULL || (cfont->filename = strdup(filename)) == NULL)
+    {
+      _pdfioFileError(pdf, "Unable to allocate memory for font cache.");
+      goto error;
+    }
 
-		  pdfioArrayAppendNumber(mask, i - 1);
-		}
-		break;
+    cfont->size  = fileinfo.st_size;
+    cfont->mtime = fileinfo.st_mtime;
 
-	    case _PDFIO_PNG_TYPE_GRAY :
-		if (length != 2)
-		{
-		  _pdfioFileError(dict->pdf, "Bad transparency chunk in image file.");
-		  return (NULL);
-		}
+    // Note: Errors are only reported to the PDF file while loading the font...
+    cfont->pdf = pdf;
 
-		if (read(fd, buffer, length) != length)
-		{
-		  _pdfioFileError(dict->pdf, "Early end-of-file in image file.");
-		  return (NULL);
-		}
+    if ((cfont->font = ttfCreate(filename, 0, (ttf_err_cb_t)cached_font_error_cb, cfont)) == NULL)
+      goto error;
 
-		if ((mask = pdfioArrayCreate(dict->pdf)) == NULL)
-		  return (NULL);
+    cfont->pdf = NULL;
 
-		pdfioArrayAppendNumber(mask, buffer[1]);
-		pdfioArrayAppendNumber(mask, buffer[1]);
-	        break;
-	    case _PDFIO_PNG_TYPE_RGB :
-		if (length != 6)
-		{
-		  _pdfioFileError(dict->pdf, "Bad transparency chunk in image file.");
-		  return (NULL);
-		}
+    datasize = (size_t)fileinfo.st_size;
 
-		if (read(fd, buffer, length) != length)
-		{
-		  _pdfioFileError(dict->pdf, "Early end-of-file in image file.");
-		  return (NULL);
-		}
+    if ((data = (unsigned char *)malloc(datasize)) == NULL)
+    {
+      _pdfioFileError(pdf, "Unable to allocate memory for font file '%s'.", filename);
+      goto error;
+    }
 
-		if ((mask = pdfioArrayCreate(dict->pdf)) == NULL)
-		  return (NULL);
+    for (dataptr = data; dataptr < (data + datasize); dataptr += bytes)
+    {
+      if ((bytes = read(fd, dataptr, datasize - (size_t)(dataptr - data))) <= 0)
+      {
+        _pdfioFileError(pdf, "Unable to read font file '%s'.", filename);
+        goto error;
+      }
+    }
 
-		pdfioArrayAppendNumber(mask, buffer[1]);
-		pdfioArrayAppendNumber(mask, buffer[3]);
-		pdfioArrayAppendNumber(mask, buffer[5]);
-		pdfioArrayAppendNumber(mask, buffer[1]);
-		pdfioArrayAppendNumber(mask, buffer[3]);
-		pdfioArrayAppendNumber(mask, buffer[5]);
-	        break;
-	  }
+    // The font is only compressed once, so use the best compression...
+    datalen = compressBound((uLong)datasize);
 
-	  crc = update_png_crc(crc, buffer, length);
+    if ((cfont->data = (unsigned char *)malloc(datalen)) == NULL || compress2(cfont->data, &datalen, data, (uLong)datasize, Z_BEST_COMPRESSION) != Z_OK)
+    {
+      _pdfioFileError(pdf, "Unable to compress font file '%s'.", filename);
+      goto error;
+    }
 
-          if (mask)
-            pdfioDictSetArray(dict, "Mask", mask);
-          break;
+    cfont->datalen = (size_t)datalen;
 
-      default : // Something else
-          while (length > 0)
-          {
-            if (length > sizeof(buffer))
-              bytes = (ssize_t)sizeof(buffer);
-	    else
-	      bytes = (ssize_t)length;
+    free(data);
+    data = NULL;
 
-            if ((bytes = read(fd, buffer, (size_t)bytes)) <= 0)
-	    {
-	      pdfioStreamClose(st);
-	      _pdfioFileError(dict->pdf, "Early end-of-file in image file.");
-	      return (NULL);
-	    }
+    font_cache[font_cache_num ++] = cfont;
+  }
 
-            crc    = update_png_crc(crc, buffer, (size_t)bytes);
-            length -= bytes;
-          }
-          break;
+  if (unicode && !cfont->widths)
+  {
+    // Compute the CIDToGIDMap and widths for Unicode fonts...
+    cmap     = ttfGetCMap(cfont->font, &num_cmap);
+    datasize = 2 * num_cmap;
+
+    if ((data = (unsigned char *)calloc(1, datasize + 1)) == NULL)
+    {
+      _pdfioFileError(pdf, "Unable to allocate memory for font file '%s'.", filename);
+      goto unlock_error;
     }
 
-    // Verify the CRC...
-    crc ^= 0xffffffff;
+    for (i = 0, dataptr = data; i < num_cmap; i ++, dataptr += 2)
+    {
+      // Map undefined glyphs to .notdef...
+      if (cmap[i] > 0 && cmap[i] < 65536)
+      {
+        dataptr[0] = (unsigned char)(cmap[i] >> 8);
+        dataptr[1] = (unsigned char)(cmap[i] & 255);
+      }
+    }
+
+    datalen = compressBound((uLong)datasize);
 
-    if (read(fd, buffer, 4) != 4)
+    if ((cfont->cid2gid = (unsigned char *)malloc(datalen)) == NULL || compress2(cfont->cid2gid, &datalen, data, (uLong)datasize, Z_BEST_COMPRESSION) != Z_OK)
     {
-      pdfioStreamClose(st);
-      _pdfioFileError(dict->pdf, "Unable to read CRC.");
-      return (NULL);
+      _pdfioFileError(pdf, "Unable to compress CIDToGIDMap for font file '%s'.", filename);
+      free(cfont->cid2gid);
+      cfont->cid2gid = NULL;
+      goto unlock_error;
     }
 
-    temp = (unsigned)((buffer[0] << 24) | (buffer[1] << 16) | (buffer[2] << 8) | buffer[3]);
-    if (temp != crc)
+    cfont->cid2gidlen = (size_t)datalen;
+
+    free(data);
+    data = NULL;
+
+    if ((cfont->widths = get_widths(cfont->font, &cfont->num_widths)) == NULL)
     {
-      pdfioStreamClose(st);
-      _pdfioFileError(dict->pdf, "Bad CRC (0x%08x != 0x%08x).", temp, crc);
-      return (NULL);
+      _pdfioFileError(pdf, "Unable to allocate memory for font widths.");
+      free(cfont->cid2gid);
+      cfont->cid2gid = NULL;
+      goto unlock_error;
     }
   }
 
+  cfont->refcount ++;
+
+#ifdef HAVE_PTHREAD
+  pthread_mutex_unlock(&font_cache_mutex);
+#endif // HAVE_PTHREAD
+
+  return (cfont);
+
+  // If we get here something went wrong loading a new font...
+  error:
+
+  if (cfont)
+  {
+    ttfDelete(cfont->font);
+    free(cfont->filename);
+    free(cfont->data);
+    free(cfont);
+  }
+
+  // If we get here something went wrong with a cached font...
+  unlock_error:
+
+  free(data);
+
+#ifdef HAVE_PTHREAD
+  pthread_mutex_unlock(&font_cache_mutex);
+#endif // HAVE_PTHREAD
+
   return (NULL);
-#endif // HAVE_LIBPNG
 }
 
 
 //
-// 'create_cp1252()' - Create the CP1252 font encoding object.
+// 'get_image_colors()' - Get the number of colors for an image color space.
 //
 
-static bool				// O - `true` on success, `false` on failure
-create_cp1252(pdfio_file_t *pdf)	// I - PDF file
+static size_t				// O - Number of colors or `0` if unsupported
+get_image_colors(
+    const char    *cs_name,		// I - ColorSpace name
+    pdfio_array_t *cs_array)		// I - ColorSpace array, if any
 {
-  pdfio_dict_t	*cp1252_dict;		// Encoding dictionary
+  if (!cs_name && cs_array)
+    cs_name = pdfioArrayGetName(cs_array, 0);
 
+  if (!cs_name)
+    return (0);
+  else if (!strcmp(cs_name, "DeviceGray") || !strcmp(cs_name, "CalGray") || !strcmp(cs_name, "G"))
+    return (1);
+  else if (!strcmp(cs_name, "DeviceRGB") || !strcmp(cs_name, "CalRGB") || !strcmp(cs_name, "RGB"))
+    return (3);
+  else if (!strcmp(cs_name, "DeviceCMYK") || !strcmp(cs_name, "CMYK"))
+    return (4);
+  else if (!strcmp(cs_name, "ICCBased"))
+  {
+    size_t num_colors = (size_t)pdfioDictGetNumber(pdfioObjGetDict(pdfioArrayGetObj(cs_array, 1)), "N");
+					// Number of colors
 
-  if ((cp1252_dict = pdfioDictCreate(pdf)) == NULL)
-    return (false);
+    return (num_colors == 1 || num_colors == 3 || num_colors == 4 ? num_colors : 0);
+  }
+  else
+    return (0);
+}
 
-  pdfioDictSetName(cp1252_dict, "Type", "Encoding");
-  pdfioDictSetName(cp1252_dict, "BaseEncoding", "WinAnsiEncoding");
 
-  if ((pdf->cp1252_obj = pdfioFileCreateObj(pdf, cp1252_dict)) == NULL)
+//
+// 'get_resource_digest()' - Compute the digest of a resource for the cache.
+//
+// The digest covers the resource type and options, any color space array,
+// and the resource data or file.  `false` is returned if the resource cache
+// is disabled or the file cannot be read.
+//
+
+static bool				// O - `true` on success, `false` otherwise
+get_resource_digest(
+    pdfio_file_t  *pdf,			// I - PDF file
+    uint8_t       *digest,		// O - SHA-256 digest
+    const char    *params,		// I - Resource type and options
+    pdfio_array_t *colors,		// I - Color space array or `NULL` for none
+    const void    *data,		// I - Resource data or `NULL` to read the file
+    size_t        datalen,		// I - Length of resource data
+    int           fd)			// I - Resource file
+{
+  _pdfio_sha256_t sha256;		// SHA-256 context
+  _pdfio_value_t colorv;		// Color space value
+  uint8_t	buffer[16384];		// Read buffer
+  ssize_t	bytes;			// Bytes read
+
+
+  if (!pdf->resource_cache)
     return (false);
 
-  pdfioObjClose(pdf->cp1252_obj);
+  _pdfioCryptoSHA256Init(&sha256);
+  _pdfioCryptoSHA256Append(&sha256, (const uint8_t *)params, strlen(params) + 1);
+
+  if (colors)
+  {
+    colorv.type        = PDFIO_VALTYPE_ARRAY;
+    colorv.value.array = colors;
+
+    _pdfioValueHash(&colorv, &sha256);
+  }
+
+  if (data)
+  {
+    _pdfioCryptoSHA256Append(&sha256, (const uint8_t *)data, datalen);
+  }
+  else
+  {
+    // Read the whole file and then rewind it...
+    while ((bytes = read(fd, buffer, sizeof(buffer))) > 0)
+      _pdfioCryptoSHA256Append(&sha256, buffer, (size_t)bytes);
+
+    if (lseek(fd, 0, SEEK_SET) != 0 || bytes < 0)
+      return (false);
+  }
+
+  _pdfioCryptoSHA256Finish(&sha256, digest);
 
   return (true);
 }
 
 
 //
-// 'create_font()' - Create the object for a TrueType font.
+// 'get_widths()' - Get the encoded widths for a Unicode font.
+//
+// Widths are encoded as "first -length width" for runs of four or more
+// characters with the same width and "first count width ... width" for other
+// characters, matching the structure of the W array.
 //
 
-static pdfio_obj_t *			// O - Font object
-create_font(pdfio_obj_t *file_obj,	// I - Font file object
-            ttf_t       *font,		// I - TrueType font
-            bool        unicode)	// I - Force Unicode
+static int *				// O - Encoded widths or `NULL` on error
+get_widths(ttf_t  *font,		// I - TrueType font
+           size_t *num_widths)		// O - Number of encoded widths
 {
-  ttf_rect_t	bounds;			// Font bounds
-  pdfio_dict_t	*dict,			// Font dictionary
-		*desc;			// Font descriptor
-  pdfio_obj_t	*obj = NULL,		// Font object
-		*desc_obj;		// Font descriptor object
-  const char	*basefont;		// Base font name
-  pdfio_array_t	*bbox;			// Font bounding box array
-  pdfio_stream_t *st;			// Font stream
+  int		*widths,		// Encoded widths
+		*wptr,			// Pointer into widths
+		*count;			// Number of widths in sequence
+  int		i, j,			// Looping vars
+		w0, w1;			// Widths
 
 
-  // Create the font descriptor dictionary and object...
-  if ((bbox = pdfioArrayCreate(file_obj->pdf)) == NULL)
-    goto done;
+  // Each character needs at most 3 values...
+  if ((widths = (int *)malloc(3 * 65536 * sizeof(int))) == NULL)
+  {
+    *num_widths = 0;
+    return (NULL);
+  }
 
-  ttfGetBounds(font, &bounds);
+  for (i = 0, wptr = widths, w0 = ttfGetWidth(font, 0), w1 = 0; i < 65536; w0 = w1)
+  {
+    for (j = 1; (i + j) < 65536; j ++)
+    {
+      if ((w1 = ttfGetWidth(font, i + j)) != w0)
+        break;
+    }
 
-  pdfioArrayAppendNumber(bbox, bounds.left);
-  pdfioArrayAppendNumber(bbox, bounds.bottom);
-  pdfioArrayAppendNumber(bbox, bounds.right);
-  pdfioArrayAppendNumber(bbox, bounds.top);
+    if (j >= 4)
+    {
+      // Encode a repeating sequence...
+      *wptr++ = i;
+      *wptr++ = -j;
+      *wptr++ = w0;
 
-  if ((desc = pdfioDictCreate(file_obj->pdf)) == NULL)
-    goto done;
+      i += j;
+    }
+    else
+    {
+      // Encode a non-repeating sequence...
+      *wptr++ = i;
+      count   = wptr++;
+      *count  = 1;
+      *wptr++ = w0;
 
-  if ((basefont = pdfioStringCreate(file_obj->pdf, ttfGetPostScriptName(font))) == NULL)
-    goto done;
+      for (i ++; i < 65536 && *count < 8191; i ++, w0 = w1)
+      {
+        if ((w1 = ttfGetWidth(font, i)) == w0 && i < 65530)
+        {
+          for (j = 1; j < 4; j ++)
+          {
+            if (ttfGetWidth(font, i + j) != w0)
+              break;
+          }
 
-  pdfioDictSetName(desc, "Type", "FontDescriptor");
-  pdfioDictSetName(desc, "FontName", basefont);
-  pdfioDictSetObj(desc, "FontFile2", file_obj);
-  pdfioDictSetNumber(desc, "Flags", ttfIsFixedPitch(font) ? 0x21 : 0x20);
-  pdfioDictSetArray(desc, "FontBBox", bbox);
-  pdfioDictSetNumber(desc, "ItalicAngle", ttfGetItalicAngle(font));
-  pdfioDictSetNumber(desc, "Ascent", ttfGetAscent(font));
-  pdfioDictSetNumber(desc, "Descent", ttfGetDescent(font));
-  pdfioDictSetNumber(desc, "CapHeight", ttfGetCapHeight(font));
-  pdfioDictSetNumber(desc, "XHeight", ttfGetXHeight(font));
-  // Note: No TrueType value exists for this but PDF requires it, so we
-  // calculate a generic value from 50 to 250 based on the weight...
-  pdfioDictSetNumber(desc, "StemV", ttfGetWeight(font) / 4 + 25);
+          if (j >= 4)
+            break;
+        }
 
-  if ((desc_obj = pdfioFileCreateObj(file_obj->pdf, desc)) == NULL)
-    goto done;
+        *wptr++ = w1;
+        (*count) ++;
+      }
+    }
+  }
 
-  pdfioObjClose(desc_obj);
+  *num_widths = (size_t)(wptr - widths);
 
-  if (unicode)
-  {
-    // Unicode (CID) font...
-    pdfio_dict_t	*cid2gid,	// CIDToGIDMap dictionary
-			*to_unicode;	// ToUnicode dictionary
-    pdfio_obj_t		*cid2gid_obj,	// CIDToGIDMap object
-			*to_unicode_obj;// ToUnicode object
-    size_t		i, j,		// Looping vars
-			num_cmap;	// Number of CMap entries
-    const int		*cmap;		// CMap entries
-    int			min_glyph,	// First glyph
-			max_glyph;	// Last glyph
-    unsigned short	glyphs[65536];	// Glyph to Unicode mapping
-    unsigned char	buffer[16384],	// Read buffer
-			*bufptr,	// Pointer into buffer
-			*bufend;	// End of buffer
-    pdfio_dict_t	*type2;		// CIDFontType2 font dictionary
-    pdfio_obj_t		*type2_obj;	// CIDFontType2 font object
-    pdfio_array_t	*descendants;	// Decendant font list
-    pdfio_dict_t	*sidict;	// CIDSystemInfo dictionary
-    pdfio_array_t	*w_array,	// Width array
-			*temp_array;	// Temporary width sub-array
-    int			w0, w1;		// Widths
+  // Free the unused memory...
+  if ((wptr = (int *)realloc(widths, *num_widths * sizeof(int))) != NULL)
+    widths = wptr;
 
-    // Create a CIDSystemInfo mapping to Adobe UCS2 v0 (Unicode)
-    if ((sidict = pdfioDictCreate(file_obj->pdf)) == NULL)
-      goto done;
+  return (widths);
+}
 
-    pdfioDictSetString(sidict, "Registry", "Adobe");
-    pdfioDictSetString(sidict, "Ordering", "Identity");
-    pdfioDictSetNumber(sidict, "Supplement", 0);
 
-    // Create a CIDToGIDMap object for the Unicode font...
-    if ((cid2gid = pdfioDictCreate(file_obj->pdf)) == NULL)
-      goto done;
+//
+// 'map_cp1252()' - Map a Unicode character above U+00FF to CP1252.
+//
+// The `_pdfio_cp1252_rev` table gives each Unicode character in the
+// `_pdfio_cp1252` table a unique slot, so the lookup is a single table access
+// that is then checked against `_pdfio_cp1252`.
+//
 
-#ifndef DEBUG
-    pdfioDictSetName(cid2gid, "Filter", "FlateDecode");
-#endif // !DEBUG
+static int				// O - CP1252 character or '?' if not supported
+map_cp1252(int ch)			// I - Unicode character
+{
+  int	cp;				// CP1252 character
 
-    if ((cid2gid_obj = pdfioFileCreateObj(file_obj->pdf, cid2gid)) == NULL)
-      goto done;
 
-#ifdef DEBUG
-    if ((st = pdfioObjCreateStream(cid2gid_obj, PDFIO_FILTER_NONE)) == NULL)
-#else
-    if ((st = pdfioObjCreateStream(cid2gid_obj, PDFIO_FILTER_FLATE)) == NULL)
-#endif // DEBUG
-      goto done;
+  if (ch > 0 && (cp = _pdfio_cp1252_rev[(ch ^ (ch >> 8)) & 127]) != 0 && _pdfio_cp1252[cp - 0x80] == ch)
+    return (cp);
+  else
+    return ('?');
+}
 
-    cmap      = ttfGetCMap(font, &num_cmap);
-    min_glyph = 65536;
-    max_glyph = 0;
-    memset(glyphs, 0, sizeof(glyphs));
 
-    PDFIO_DEBUG("create_font: num_cmap=%u\n", (unsigned)num_cmap);
+#ifdef HAVE_LIBPNG
+//
+// 'png_error_func()' - PNG error message function.
+//
 
-    for (i = 0, bufptr = buffer, bufend = buffer + sizeof(buffer); i < num_cmap; i ++)
-    {
-      PDFIO_DEBUG("create_font: cmap[%u]=%d\n", (unsigned)i, cmap[i]);
-      if (cmap[i] < 0 || cmap[i] >= (int)(sizeof(glyphs) / sizeof(glyphs[0])))
-      {
-        // Map undefined glyph to .notdef...
-        *bufptr++ = 0;
-        *bufptr++ = 0;
-      }
-      else
-      {
-        // Map to specified glyph...
-        *bufptr++ = (unsigned char)(cmap[i] >> 8);
-        *bufptr++ = (unsigned char)(cmap[i] & 255);
-
-        glyphs[cmap[i]] = (unsigned short)i;
-        if (cmap[i] < min_glyph)
-          min_glyph = cmap[i];
-        if (cmap[i] > max_glyph)
-          max_glyph = cmap[i];
-      }
+static void
+png_error_func(
+    png_structp     pp,			// I - PNG pointer
+    png_const_charp message)		// I - Error message
+{
+  pdfio_file_t	*pdf = (pdfio_file_t *)png_get_error_ptr(pp);
+					// PDF file
 
-      if (bufptr >= bufend)
-      {
-        // Flush buffer...
-        if (!pdfioStreamWrite(st, buffer, (size_t)(bufptr - buffer)))
-        {
-	  pdfioStreamClose(st);
-	  goto done;
-        }
 
-        bufptr = buffer;
-      }
-    }
+  _pdfioFileError(pdf, "Unable to create image object from PNG file: %s", message);
+}
 
-    if (bufptr > buffer)
-    {
-      // Flush buffer...
-      if (!pdfioStreamWrite(st, buffer, (size_t)(bufptr - buffer)))
-      {
-	pdfioStreamClose(st);
-	goto done;
-      }
-    }
 
-    pdfioStreamClose(st);
+//
+// 'png_read_func()' - Read from a PNG file.
+//
 
-    // ToUnicode mapping object
-    to_unicode = pdfioDictCreate(file_obj->pdf);
-    pdfioDictSetName(to_unicode, "Type", "CMap");
-    pdfioDictSetName(to_unicode, "CMapName", "Adobe-Identity-UCS2");
-    pdfioDictSetDict(to_unicode, "CIDSystemInfo", sidict);
+static void
+png_read_func(png_structp pp,		// I - PNG pointer
+              png_bytep   data,		// I - Read buffer
+              size_t      length)	// I - Number of bytes to read
+{
+  _pdfio_imgsrc_t *src = (_pdfio_imgsrc_t *)png_get_io_ptr(pp);
+					// Image source
+  ssize_t	bytes;			// Bytes read
 
-#ifndef DEBUG
-    pdfioDictSetName(to_unicode, "Filter", "FlateDecode");
-#endif // !DEBUG
 
-    if ((to_unicode_obj = pdfioFileCreateObj(file_obj->pdf, to_unicode)) == NULL)
-      goto done;
+  PDFIO_DEBUG("png_read_func(pp=%p, data=%p, length=%lu)\n", (void *)pp, (void *)data, (unsigned long)length);
 
-#ifdef DEBUG
-    if ((st = pdfioObjCreateStream(to_unicode_obj, PDFIO_FILTER_NONE)) == NULL)
-#else
-    if ((st = pdfioObjCreateStream(to_unicode_obj, PDFIO_FILTER_FLATE)) == NULL)
-#endif // DEBUG
-      goto done;
+  if ((bytes = read_image(src, data, length)) < (ssize_t)length)
+    png_error(pp, "Unable to read from PNG file.");
+}
+#endif // HAVE_LIBPNG
 
-    pdfioStreamPuts(st,
-		    "stream\n"
-		    "/CIDInit /ProcSet findresource begin\n"
-		    "12 dict begin\n"
-		    "begincmap\n"
-		    "/CIDSystemInfo<<\n"
-		    "/Registry (Adobe)\n"
-		    "/Ordering (UCS2)\n"
-		    "/Supplement 0\n"
-		    ">> def\n"
-		    "/CMapName /Adobe-Identity-UCS2 def\n"
-		    "/CMapType 2 def\n"
-		    "1 begincodespacerange\n"
-		    "<0000> <FFFF>\n"
-		    "endcodespacerange\n"
-                    "endcmap\n"
-                    "CMapName currentdict /CMap defineresource pop\n"
-                    "end\n"
-                    "end\n");
 
-    pdfioStreamClose(st);
+//
+// 'read_image()' - Read from an image file or memory.
+//
 
-    // Create a CIDFontType2 dictionary for the Unicode font...
-    if ((type2 = pdfioDictCreate(file_obj->pdf)) == NULL)
-      goto done;
+static ssize_t				// O - Number of bytes read or `-1` on error
+read_image(_pdfio_imgsrc_t *src,	// I - Image source
+           void            *buffer,	// I - Read buffer
+           size_t          bytes)	// I - Number of bytes to read
+{
+  if (!src->data)
+    return (read(src->fd, buffer, bytes));
 
-    // Width array
-    if ((w_array = pdfioArrayCreate(file_obj->pdf)) == NULL)
-      goto done;
+  if (bytes > (size_t)(src->dataend - src->dataptr))
+    bytes = (size_t)(src->dataend - src->dataptr);
 
-    for (i = 0, w0 = ttfGetWidth(font, 0), w1 = 0; i < 65536; w0 = w1)
-    {
-      for (j = 1; (i + j) < 65536; j ++)
-      {
-        if ((w1 = ttfGetWidth(font, (int)(i + j))) != w0)
-          break;
-      }
+  memcpy(buffer, src->dataptr, bytes);
+  src->dataptr += bytes;
 
-      if (j >= 4)
-      {
-        // Encode a long sequence of zeros...
-	// Encode a repeating sequence...
-	pdfioArrayAppendNumber(w_array, (double)i);
-	pdfioArrayAppendNumber(w_array, (double)(i + j - 1));
-	pdfioArrayAppendNumber(w_array, w0);
+  return ((ssize_t)bytes);
+}
 
-	i += j;
-      }
-      else
-      {
-        // Encode a non-repeating sequence...
-        pdfioArrayAppendNumber(w_array, (double)i);
 
-        if ((temp_array = pdfioArrayCreate(file_obj->pdf)) == NULL)
-	  goto done;
+//
+// 'release_font()' - Release a font from the shared font cache.
+//
 
-        pdfioArrayAppendNumber(temp_array, w0);
-        for (i ++; i < 65536 && pdfioArrayGetSize(temp_array) < 8191; i ++, w0 = w1)
-        {
-          if ((w1 = ttfGetWidth(font, (int)i)) == w0 && i < 65530)
-          {
-            for (j = 1; j < 4; j ++)
-            {
-              if (ttfGetWidth(font, (int)(i + j)) != w0)
-                break;
-            }
+static void
+release_font(ttf_t *font)		// I - TrueType font
+{
+  size_t	i;			// Looping var
 
-            if (j >= 4)
-	      break;
-	  }
 
-	  pdfioArrayAppendNumber(temp_array, w1);
-        }
+#ifdef HAVE_PTHREAD
+  pthread_mutex_lock(&font_cache_mutex);
+#endif // HAVE_PTHREAD
 
-        pdfioArrayAppendArray(w_array, temp_array);
-      }
+  for (i = 0; i < font_cache_num; i ++)
+  {
+    if (font_cache[i]->font == font)
+    {
+      if (font_cache[i]->refcount > 0)
+        font_cache[i]->refcount --;
+      break;
     }
+  }
 
-    // Then the dictionary for the CID base font...
-    pdfioDictSetName(type2, "Type", "Font");
-    pdfioDictSetName(type2, "Subtype", "CIDFontType2");
-    pdfioDictSetName(type2, "BaseFont", basefont);
-    pdfioDictSetDict(type2, "CIDSystemInfo", sidict);
-    pdfioDictSetObj(type2, "CIDToGIDMap", cid2gid_obj);
-    pdfioDictSetObj(type2, "FontDescriptor", desc_obj);
-    pdfioDictSetArray(type2, "W", w_array);
+#ifdef HAVE_PTHREAD
+  pthread_mutex_unlock(&font_cache_mutex);
+#endif // HAVE_PTHREAD
+}
 
-    if ((type2_obj = pdfioFileCreateObj(file_obj->pdf, type2)) == NULL)
-      goto done;
 
-    pdfioObjClose(type2_obj);
+//
+// 'rewind_image()' - Rewind an image file or memory to the beginning.
+//
 
-    // Create a Type 0 font object...
-    if ((descendants = pdfioArrayCreate(file_obj->pdf)) == NULL)
-      goto done;
+static bool				// O - `true` on success, `false` on error
+rewind_image(_pdfio_imgsrc_t *src)	// I - Image source
+{
+  if (!src->data)
+    return (lseek(src->fd, 0, SEEK_SET) == 0);
 
-    pdfioArrayAppendObj(descendants, type2_obj);
+  src->dataptr = src->data;
 
-    if ((dict = pdfioDictCreate(file_obj->pdf)) == NULL)
-      goto done;
+  return (true);
+}
 
-    pdfioDictSetName(dict, "Type", "Font");
-    pdfioDictSetName(dict, "Subtype", "Type0");
-    pdfioDictSetName(dict, "BaseFont", basefont);
-    pdfioDictSetArray(dict, "DescendantFonts", descendants);
-    pdfioDictSetName(dict, "Encoding", "Identity-H");
-    pdfioDictSetObj(dict, "ToUnicode", to_unicode_obj);
 
-    if ((obj = pdfioFileCreateObj(file_obj->pdf, dict)) != NULL)
-      pdfioObjClose(obj);
-  }
-  else
+//
+// 'scale_image()' - Downsample image data using area averaging.
+//
+// Each source pixel covers "out_width" by "out_height" units while each output
+// pixel covers "width" by "height" units, so a source pixel contributes to at
+// most two output pixels in each direction.  Rows are averaged horizontally
+// into "hrow" and then accumulated into the current and next output rows,
+// which are written as soon as they are complete.
+//
+
+static bool				// O - `true` on success, `false` on error
+scale_image(
+    pdfio_image_t       *image,		// I - Image
+    const unsigned char *data,		// I - Source image data
+    size_t              width,		// I - Source width
+    size_t              height,		// I - Source height
+    size_t              bpp)		// I - Bytes per pixel
+{
+  bool		ret = false;		// Return value
+  size_t	out_width = image->width,// Output width
+		out_height = image->height,
+					// Output height
+		out_linelen = out_width * bpp,
+					// Length of output line
+		x, y,			// Looping vars
+		i,			// Looping var
+		oy,			// Output row
+		start;			// Start of source pixel in output units
+  size_t	*xout = NULL;		// First output column for each source column
+  uint32_t	*xweight = NULL,	// Weight of first output column
+		*hrow = NULL,		// Horizontally averaged row
+		*hptr,			// Pointer into horizontal row
+		w0, w1;			// Weights
+  uint64_t	*acc = NULL,		// Current output row accumulator
+		*next = NULL,		// Next output row accumulator
+		*temp,			// Temporary pointer
+		total = (uint64_t)width * (uint64_t)height,
+					// Total weight of an output pixel
+		half = total / 2;	// Rounding offset
+  unsigned char	*outrow = NULL;		// Output row
+  const unsigned char *src;		// Pointer into source data
+
+
+  // Allocate memory...
+  if ((xout = (size_t *)malloc(width * sizeof(size_t))) == NULL || (xweight = (uint32_t *)malloc(width * sizeof(uint32_t))) == NULL || (hrow = (uint32_t *)malloc((out_linelen + bpp) * sizeof(uint32_t))) == NULL || (acc = (uint64_t *)calloc(out_linelen, sizeof(uint64_t))) == NULL || (next = (uint64_t *)calloc(out_linelen, sizeof(uint64_t))) == NULL || (outrow = (unsigned char *)malloc(out_linelen)) == NULL)
   {
-    // Simple (CP1282 or custom encoding) 8-bit font...
-    int			ch;		// Character
-    pdfio_array_t	*w_array;	// Widths array
+    _pdfioFileError(image->pdf, "Unable to allocate memory for scaled image.");
+    goto done;
+  }
 
-    if (ttfGetMaxChar(font) >= 255 && !file_obj->pdf->cp1252_obj && !create_cp1252(file_obj->pdf))
-      goto done;
+  // Compute the horizontal weights...
+  for (x = 0; x < width; x ++)
+  {
+    start      = x * out_width;
+    xout[x]    = start / width;
+    xweight[x] = (uint32_t)((start + out_width < (xout[x] + 1) * width ? start + out_width : (xout[x] + 1) * width) - start);
+  }
 
-    // Create a TrueType font object...
-    if ((dict = pdfioDictCreate(file_obj->pdf)) == NULL)
-      goto done;
+  // Scale the image...
+  for (y = 0, oy = 0, src = data; y < height; y ++)
+  {
+    // Average the source row horizontally...
+    memset(hrow, 0, (out_linelen + bpp) * sizeof(uint32_t));
 
-    pdfioDictSetName(dict, "Type", "Font");
-    pdfioDictSetName(dict, "Subtype", "TrueType");
-    pdfioDictSetName(dict, "BaseFont", basefont);
-    pdfioDictSetNumber(dict, "FirstChar", 32);
-    if (ttfGetMaxChar(font) >= 255)
-    {
-      pdfioDictSetObj(dict, "Encoding", file_obj->pdf->cp1252_obj);
-      pdfioDictSetNumber(dict, "LastChar", 255);
-    }
-    else
+    for (x = 0; x < width; x ++, src += bpp)
     {
-      pdfioDictSetNumber(dict, "LastChar", ttfGetMaxChar(font));
+      hptr = hrow + xout[x] * bpp;
+      w0   = xweight[x];
+      w1   = (uint32_t)out_width - w0;
+
+      for (i = 0; i < bpp; i ++)
+      {
+        hptr[i]       += w0 * src[i];
+        hptr[bpp + i] += w1 * src[i];
+      }
     }
 
-    // Build a Widths array for CP1252/WinAnsiEncoding
-    if ((w_array = pdfioArrayCreate(file_obj->pdf)) == NULL)
-      goto done;
+    // Then accumulate it into the current and next output rows...
+    start = y * out_height;
+    w0    = (uint32_t)((start + out_height < (oy + 1) * height ? start + out_height : (oy + 1) * height) - start);
+    w1    = (uint32_t)out_height - w0;
 
-    for (ch = 32; ch < 256 && ch < ttfGetMaxChar(font); ch ++)
+    for (i = 0; i < out_linelen; i ++)
     {
-      if (ch >= 0x80 && ch < 0xa0)
-	pdfioArrayAppendNumber(w_array, ttfGetWidth(font, _pdfio_cp1252[ch - 0x80]));
-      else
-	pdfioArrayAppendNumber(w_array, ttfGetWidth(font, ch));
+      acc[i]  += (uint64_t)w0 * hrow[i];
+      next[i] += (uint64_t)w1 * hrow[i];
     }
 
-    pdfioDictSetArray(dict, "Widths", w_array);
+    if (start + out_height >= (oy + 1) * height)
+    {
+      // Output row is complete, write it...
+      for (i = 0; i < out_linelen; i ++)
+        outrow[i] = (unsigned char)((acc[i] + half) / total);
 
-    pdfioDictSetObj(dict, "FontDescriptor", desc_obj);
+      if (!pdfioImageWriteRows(image, outrow, 1))
+        goto done;
 
-    if ((obj = pdfioFileCreateObj(file_obj->pdf, dict)) != NULL)
-      pdfioObjClose(obj);
+      temp = acc;
+      acc  = next;
+      next = temp;
+
+      memset(next, 0, out_linelen * sizeof(uint64_t));
+      oy ++;
+    }
   }
 
+  ret = true;
+
+  // Free memory and return...
   done:
 
-  if (obj)
-    _pdfioObjSetExtension(obj, font, (_pdfio_extfree_t)ttfDelete);
+  free(xout);
+  free(xweight);
+  free(hrow);
+  free(acc);
+  free(next);
+  free(outrow);
 
-  return (obj);
+  return (ret);
 }
 
 
 //
-// 'create_image()' - Create an image object from some data.
+// 'split_alpha()' - Split color and alpha values.
+//
+// The common pixel formats use dedicated loops with fixed-size copies instead
+// of a memcpy call per pixel.  Splitting is much faster than the Flate
+// compression that follows (see "benchpdfio -i"), so portable byte loops are
+// used rather than SIMD code.
 //
 
-static pdfio_obj_t *			// O - PDF object or `NULL` on error
-create_image(
-    pdfio_dict_t        *dict,		// I - Image dictionary
-    const unsigned char *data,		// I - Image data
-    size_t              width,		// I - Width in columns
-    size_t              height,		// I - Height in lines
-    size_t              depth,		// I - Bit depth
+static void
+split_alpha(
+    unsigned char       *colors,	// O - Color values
+    unsigned char       *alpha,		// O - Alpha values
+    const unsigned char *data,		// I - Color and alpha values
+    size_t              num_pixels,	// I - Number of pixels
     size_t              num_colors,	// I - Number of colors
-    bool                alpha)		// I - `true` if there is transparency
+    size_t              bpc)		// I - Bytes per component
 {
-  pdfio_file_t		*pdf = dict->pdf;
-					// PDF file
-  pdfio_dict_t		*mask_dict,	// Mask image dictionary
-			*decode;	// DecodeParms dictionary
-  pdfio_obj_t		*obj,		// Image object
-			*mask_obj = NULL;
-					// Mask image object, if any
-  pdfio_stream_t	*st;		// Image stream
-  size_t		x, y,		// X and Y position in image
-			bpc = depth / 8,// Bytes per component
-			bpp = num_colors * bpc,
-					// Bytes per pixel (less alpha)
-			linelen;	// Line length
-  const unsigned char	*dataptr;	// Pointer into image data
-  unsigned char		*line = NULL,	// Current line
-			*lineptr;	// Pointer into line
-
-
-  // Allocate memory for one line of data...
-  linelen = (width * num_colors * depth + 7) / 8;
-
-  if ((line = malloc(linelen)) == NULL)
+  size_t	bpp = num_colors * bpc;	// Bytes per pixel (less alpha)
+
+
+  if (bpc == 1)
+  {
+    switch (num_colors)
+    {
+      case 1 : // Gray + alpha
+          for (; num_pixels > 0; num_pixels --, data += 2)
+          {
+            *colors++ = data[0];
+            *alpha++  = data[1];
+          }
+          return;
+
+      case 3 : // RGB + alpha
+          for (; num_pixels > 0; num_pixels --, data += 4, colors += 3)
+          {
+            colors[0] = data[0];
+            colors[1] = data[1];
+            colors[2] = data[2];
+            *alpha++  = data[3];
+          }
+          return;
+
+      case 4 : // CMYK + alpha
+          for (; num_pixels > 0; num_pixels --, data += 5, colors += 4)
+          {
+            colors[0] = data[0];
+            colors[1] = data[1];
+            colors[2] = data[2];
+            colors[3] = data[3];
+            *alpha++  = data[4];
+          }
+          return;
+    }
+  }
+  else if (bpc == 2)
+  {
+    switch (num_colors)
+    {
+      case 1 : // 16-bit gray + alpha
+          for (; num_pixels > 0; num_pixels --, data += 4, colors += 2, alpha += 2)
+          {
+            colors[0] = data[0];
+            colors[1] = data[1];
+            alpha[0]  = data[2];
+            alpha[1]  = data[3];
+          }
+          return;
+
+      case 3 : // 16-bit RGB + alpha
+          for (; num_pixels > 0; num_pixels --, data += 8, colors += 6, alpha += 2)
+          {
+            colors[0] = data[0];
+            colors[1] = data[1];
+            colors[2] = data[2];
+            colors[3] = data[3];
+            colors[4] = data[4];
+            colors[5] = data[5];
+            alpha[0]  = data[6];
+            alpha[1]  = data[7];
+          }
+          return;
+    }
+  }
+
+  // Other formats...
+  for (; num_pixels > 0; num_pixels --, data += bpp + bpc, colors += bpp, alpha += bpc)
+  {
+    memcpy(colors, data, bpp);
+    memcpy(alpha, data + bpp, bpc);
+  }
+}
+
+
+//
+// 'start_image()' - Start writing an image object.
+//
+// The image data is written using Flate compression and the automatic PNG
+// predictor.  When the image has an alpha channel, the alpha values are
+// written to a separate "soft mask" image whose stream is staged in memory.
+//
+
+static pdfio_image_t *			// O - Image or `NULL` on error
+start_image(
+    pdfio_dict_t *dict,			// I - Image dictionary
+    size_t       width,			// I - Width in columns
+    size_t       height,		// I - Height in lines
+    size_t       depth,			// I - Bit depth
+    size_t       num_colors,		// I - Number of colors
+    bool         alpha)			// I - `true` if there is transparency
+{
+  pdfio_file_t	*pdf = dict->pdf;	// PDF file
+  pdfio_image_t	*image;			// Image
+  pdfio_dict_t	*mask_dict,		// Mask image dictionary
+		*decode;		// DecodeParms dictionary
+
+
+  // Allocate memory for the image...
+  if ((image = (pdfio_image_t *)calloc(1, sizeof(pdfio_image_t))) == NULL)
+  {
+    _pdfioFileError(pdf, "Unable to allocate memory for image: %s", strerror(errno));
     return (NULL);
+  }
+
+  image->pdf        = pdf;
+  image->width      = width;
+  image->height     = height;
+  image->depth      = depth;
+  image->num_colors = num_colors;
+  image->alpha      = alpha;
+
+  if (alpha)
+  {
+    // Allocate buffers for splitting about 64k of image data at a time...
+    if ((image->max_lines = 65536 / (width * num_colors * depth / 8)) < 1)
+      image->max_lines = 1;
+    else if (image->max_lines > height)
+      image->max_lines = height;
+
+    if ((image->lines = malloc(image->max_lines * width * num_colors * depth / 8)) == NULL || (image->mask_lines = malloc(image->max_lines * width * depth / 8)) == NULL)
+    {
+      _pdfioFileError(pdf, "Unable to allocate memory for image: %s", strerror(errno));
+      goto error;
+    }
+  }
 
   // Use Flate compression...
   pdfioDictSetName(dict, "Filter", "FlateDecode");
@@ -3700,20 +6620,14 @@ create_image(
   {
     // Create the image mask dictionary...
     if ((mask_dict = pdfioDictCopy(pdf, dict)) == NULL)
-    {
-      free(line);
-      return (NULL);
-    }
+      goto error;
 
     // Transparency masks are always grayscale...
     pdfioDictSetName(mask_dict, "ColorSpace", "DeviceGray");
 
     // Set the automatic PNG predictor to optimize compression...
     if ((decode = pdfioDictCreate(pdf)) == NULL)
-    {
-      free(line);
-      return (NULL);
-    }
+      goto error;
 
     pdfioDictSetNumber(decode, "BitsPerComponent", (double)depth);
     pdfioDictSetNumber(decode, "Colors", 1);
@@ -3721,51 +6635,18 @@ create_image(
     pdfioDictSetNumber(decode, "Predictor", _PDFIO_PREDICTOR_PNG_AUTO);
     pdfioDictSetDict(mask_dict, "DecodeParms", decode);
 
-    // Create the mask object and write the mask image...
-    if ((mask_obj = pdfioFileCreateObj(pdf, mask_dict)) == NULL)
-    {
-      free(line);
-      return (NULL);
-    }
-
-    if ((st = pdfioObjCreateStream(mask_obj, PDFIO_FILTER_FLATE)) == NULL)
-    {
-      free(line);
-      pdfioObjClose(mask_obj);
-      return (NULL);
-    }
-
-    for (y = height, dataptr = data + bpp; y > 0; y --)
-    {
-      if (bpc == 1)
-      {
-	for (x = width, lineptr = line; x > 0; x --, dataptr += bpp)
-	  *lineptr++ = *dataptr++;
-      }
-      else
-      {
-	for (x = width, lineptr = line; x > 0; x --, dataptr += bpp)
-	{
-	  *lineptr++ = *dataptr++;
-	  *lineptr++ = *dataptr++;
-	}
-      }
-
-      pdfioStreamWrite(st, line, width * bpc);
-    }
-
-    pdfioStreamClose(st);
+    // Create the mask object...
+    if ((image->mask_obj = pdfioFileCreateObj(pdf, mask_dict)) == NULL)
+      goto error;
 
     // Use the transparency mask...
-    pdfioDictSetObj(dict, "SMask", mask_obj);
+    pdfioDictSetObj(dict, "SMask", image->mask_obj);
   }
 
-  // Set the automatic PNG predictor to optimize compression...
+  // Set the automatic PNG predictor to optimize compression (this also selects
+  // the filtered Flate strategy unless the file specifies another one)...
   if ((decode = pdfioDictCreate(pdf)) == NULL)
-  {
-    free(line);
-    return (NULL);
-  }
+    goto error;
 
   pdfioDictSetNumber(decode, "BitsPerComponent", (double)depth);
   pdfioDictSetNumber(decode, "Colors", (double)num_colors);
@@ -3773,104 +6654,191 @@ create_image(
   pdfioDictSetNumber(decode, "Predictor", _PDFIO_PREDICTOR_PNG_AUTO);
   pdfioDictSetDict(dict, "DecodeParms", decode);
 
-  // Now create the image...
-  if ((obj = pdfioFileCreateObj(pdf, dict)) == NULL)
-  {
-    free(line);
-    return (NULL);
-  }
+  // Now create the image object and stream(s)...
+  if ((image->obj = pdfioFileCreateObj(pdf, dict)) == NULL)
+    goto error;
 
-  if ((st = pdfioObjCreateStream(obj, PDFIO_FILTER_FLATE)) == NULL)
-  {
-    free(line);
-    pdfioObjClose(obj);
-    return (NULL);
-  }
+  if ((image->st = pdfioObjCreateStream(image->obj, PDFIO_FILTER_FLATE)) == NULL)
+    goto error;
 
-  for (y = height, dataptr = data; y > 0; y --)
-  {
-    if (alpha)
-    {
-      if (bpp == 1)
-      {
-	for (x = width, lineptr = line; x > 0; x --, dataptr += bpc)
-	  *lineptr++ = *dataptr++;
-      }
-      else
-      {
-	for (x = width, lineptr = line; x > 0; x --, dataptr += bpp + bpc, lineptr += bpp)
-	  memcpy(lineptr, dataptr, bpp);
-      }
+  if (alpha && (image->mask_st = _pdfioObjCreateStagedStream(image->mask_obj, PDFIO_FILTER_FLATE)) == NULL)
+    goto error;
 
-      pdfioStreamWrite(st, line, linelen);
-    }
-    else
-    {
-      pdfioStreamWrite(st, dataptr, linelen);
-      dataptr += linelen;
-    }
-  }
+  return (image);
 
-  free(line);
-  pdfioStreamClose(st);
+  // If we get here something went wrong...
+  error:
 
-  return (obj);
+  if (image->st)
+    pdfioStreamClose(image->st);
+
+  free(image->lines);
+  free(image->mask_lines);
+  free(image);
+
+  return (NULL);
 }
 
 
-#ifdef HAVE_LIBPNG
 //
-// 'png_error_func()' - PNG error message function.
+// 'ttf_error_cb()' - Relay a message from the TTF functions.
 //
 
 static void
-png_error_func(
-    png_structp     pp,			// I - PNG pointer
-    png_const_charp message)		// I - Error message
+ttf_error_cb(pdfio_file_t *pdf,		// I - PDF file
+             const char   *message)	// I - Error message
 {
-  pdfio_file_t	*pdf = (pdfio_file_t *)png_get_error_ptr(pp);
-					// PDF file
-
-
-  _pdfioFileError(pdf, "Unable to create image object from PNG file: %s", message);
+  (pdf->error_cb)(pdf, message, pdf->error_data);
 }
 
 
 //
-// 'png_read_func()' - Read from a PNG file.
+// 'unpack_samples()' - Unpack a line of image samples.
+//
+// Samples of 1, 2, and 4 bits are unpacked a byte at a time.
 //
 
 static void
-png_read_func(png_structp pp,		// I - PNG pointer
-              png_bytep   data,		// I - Read buffer
-              size_t      length)	// I - Number of bytes to read
+unpack_samples(
+    uint16_t            *samples,	// O - Samples
+    const unsigned char *line,		// I - Line data
+    size_t              count,		// I - Number of samples
+    size_t              depth)		// I - Bits per sample
 {
-  int		*fd = (int *)png_get_io_ptr(pp);
-					// Pointer to file descriptor
-  ssize_t	bytes;			// Bytes read
+  unsigned	byte;			// Current byte
+  int		bit;			// Current bit
 
 
-  PDFIO_DEBUG("png_read_func(pp=%p, data=%p, length=%lu)\n", (void *)pp, (void *)data, (unsigned long)length);
+  switch (depth)
+  {
+    case 1 :
+        for (; count >= 8; count -= 8, samples += 8)
+        {
+          byte       = *line++;
+          samples[0] = (uint16_t)(byte >> 7);
+          samples[1] = (uint16_t)((byte >> 6) & 1);
+          samples[2] = (uint16_t)((byte >> 5) & 1);
+          samples[3] = (uint16_t)((byte >> 4) & 1);
+          samples[4] = (uint16_t)((byte >> 3) & 1);
+          samples[5] = (uint16_t)((byte >> 2) & 1);
+          samples[6] = (uint16_t)((byte >> 1) & 1);
+          samples[7] = (uint16_t)(byte & 1);
+        }
 
-  if ((bytes = read(*fd, data, length)) < (ssize_t)length)
-    png_error(pp, "Unable to read from PNG file.");
+        for (bit = 7; count > 0; count --, bit --)
+          *samples++ = (uint16_t)((*line >> bit) & 1);
+        break;
+
+    case 2 :
+        for (; count >= 4; count -= 4, samples += 4)
+        {
+          byte       = *line++;
+          samples[0] = (uint16_t)(byte >> 6);
+          samples[1] = (uint16_t)((byte >> 4) & 3);
+          samples[2] = (uint16_t)((byte >> 2) & 3);
+          samples[3] = (uint16_t)(byte & 3);
+        }
+
+        for (bit = 6; count > 0; count --, bit -= 2)
+          *samples++ = (uint16_t)((*line >> bit) & 3);
+        break;
+
+    case 4 :
+        for (; count >= 2; count -= 2, samples += 2)
+        {
+          byte       = *line++;
+          samples[0] = (uint16_t)(byte >> 4);
+          samples[1] = (uint16_t)(byte & 15);
+        }
+
+        if (count > 0)
+          *samples = (uint16_t)(*line >> 4);
+        break;
+
+    case 8 :
+        for (; count > 0; count --)
+          *samples++ = *line++;
+        break;
+
+    case 16 :
+        for (; count > 0; count --, line += 2)
+          *samples++ = (uint16_t)((line[0] << 8) | line[1]);
+        break;
+  }
 }
-#endif // HAVE_LIBPNG
 
 
 //
-// 'ttf_error_cb()' - Relay a message from the TTF functions.
+// 'update_gstate()' - Update a graphics state item.
+//
+// This function compares the operator, values, and font name (if any) with
+// the current graphics state and records them.  `false` is returned if state
+// tracking is enabled and the item already has the same value so that the
+// caller can skip writing the operator.
 //
 
-static void
-ttf_error_cb(pdfio_file_t *pdf,		// I - PDF file
-             const char   *message)	// I - Error message
+static bool				// O - `true` if the operator must be written, `false` if unchanged
+update_gstate(
+    pdfio_stream_t *st,			// I - Stream
+    _pdfio_gitem_t item,		// I - Graphics state item
+    const char     *op,			// I - Operator
+    const char     *name,		// I - Font name or `NULL` for none
+    size_t         num_values,		// I - Number of values (up to 6)
+    ...)				// I - Values
 {
-  (pdf->error_cb)(pdf, message, pdf->error_data);
+  _pdfio_gstate_t *gs;			// Current graphics state
+  double	values[6];		// Values
+  size_t	i;			// Looping var
+  bool		same;			// Same as current state?
+  va_list	ap;			// Argument pointer
+
+
+  // Range check input...
+  if (!st || !st->gstates)
+    return (true);
+
+  gs = st->gstates + st->num_gstates - 1;
+
+  if (name && strlen(name) >= sizeof(gs->font))
+  {
+    // Don't track long font names...
+    gs->valid &= ~(1U << item);
+    return (true);
+  }
+
+  // Get the values...
+  va_start(ap, num_values);
+
+  for (i = 0; i < num_values && i < 6; i ++)
+    values[i] = va_arg(ap, double);
+
+  va_end(ap);
+
+  for (; i < 6; i ++)
+    values[i] = 0.0;
+
+  // Compare against the current state...
+  same = (gs->valid & (1U << item)) != 0 && !strcmp(gs->ops[item], op) && (!name || !strcmp(gs->font, name));
+
+  for (i = 0; i < 6 && same; i ++)
+    same = gs->values[item][i] == values[i];
+
+  if (same)
+    return (false);
+
+  // Save the new state...
+  gs->valid |= 1U << item;
+
+  _pdfio_strlcpy(gs->ops[item], op, sizeof(gs->ops[item]));
+  memcpy(gs->values[item], values, sizeof(values));
+
+  if (name)
+    _pdfio_strlcpy(gs->font, name, sizeof(gs->font));
+
+  return (true);
 }
 
 
-#ifndef HAVE_LIBPNG
 //
 // 'update_png_crc()' - Update the CRC-32 value for a PNG chunk.
 //
@@ -3890,7 +6858,6 @@ update_png_crc(
 
   return (crc);
 }
-#endif // !HAVE_LIBPNG
 
 
 //
@@ -4001,6 +6968,14 @@ write_string(pdfio_stream_t *st,	// I - Stream
 
     if (unicode)
     {
+      // Mark the character as used for subset fonts...
+      if (st->subset && ch < 0x10000)
+      {
+        _pdfioFileLock(st->pdf);
+        st->subset->cids[ch / 8] |= 1 << (ch & 7);
+        _pdfioFileUnlock(st->pdf);
+      }
+
       // Write UTF-16 in hex...
       if (ch < 0x100000)
       {
@@ -4033,22 +7008,7 @@ write_string(pdfio_stream_t *st,	// I - Stream
       {
         // Non-escaped character...
         if (ch > 255)
-	{
-	  // Try mapping from Unicode to CP1252...
-	  int i;				// Looping var
-
-	  for (i = 0; i < (int)(sizeof(_pdfio_cp1252) / sizeof(_pdfio_cp1252[0])); i ++)
-	  {
-	    if (ch == _pdfio_cp1252[i])
-	    {
-	      ch = i + 128;
-	      break;
-	    }
-	  }
-
-	  if (ch > 255)
-	    ch = '?';				// Unsupported chars map to ?
-	}
+	  ch = map_cp1252(ch);		// Try mapping from Unicode to CP1252
 
         // Write the character...
         pdfioStreamPutChar(st, ch);
@@ -27,6 +27,12 @@ typedef enum pdfio_cs_e			// Standard color spaces
   PDFIO_CS_CGATS001			// CGATS001 (CMYK)
 } pdfio_cs_t;
 
+typedef struct _pdfio_fontmetrics_s pdfio_fontmetrics_t;
+					// Font measurement context
+
+typedef struct _pdfio_image_s pdfio_image_t;
+					// Image being written
+
 typedef enum pdfio_linecap_e		// Line capping modes
 {
   PDFIO_LINECAP_BUTT,			// Butt ends
@@ -86,6 +92,8 @@ extern bool		pdfioContentPathCurve23(pdfio_stream_t *st, double x2, double y2, d
 extern bool		pdfioContentPathEnd(pdfio_stream_t *st) _PDFIO_PUBLIC;
 extern bool		pdfioContentPathLineTo(pdfio_stream_t *st, double x, double y) _PDFIO_PUBLIC;
 extern bool		pdfioContentPathMoveTo(pdfio_stream_t *st, double x, double y) _PDFIO_PUBLIC;
+extern bool		pdfioContentPathPolygon(pdfio_stream_t *st, size_t num_points, const double *points) _PDFIO_PUBLIC;
+extern bool		pdfioContentPathPolyline(pdfio_stream_t *st, size_t num_points, const double *points) _PDFIO_PUBLIC;
 extern bool		pdfioContentPathRect(pdfio_stream_t *st, double x, double y, double width, double height) _PDFIO_PUBLIC;
 extern bool		pdfioContentRestore(pdfio_stream_t *st) _PDFIO_PUBLIC;
 extern bool		pdfioContentSave(pdfio_stream_t *st) _PDFIO_PUBLIC;
@@ -101,6 +109,7 @@ extern bool		pdfioContentSetLineCap(pdfio_stream_t *st, pdfio_linecap_t lc) _PDF
 extern bool		pdfioContentSetLineJoin(pdfio_stream_t *st, pdfio_linejoin_t lj) _PDFIO_PUBLIC;
 extern bool		pdfioContentSetLineWidth(pdfio_stream_t *st, double width) _PDFIO_PUBLIC;
 extern bool		pdfioContentSetMiterLimit(pdfio_stream_t *st, double limit) _PDFIO_PUBLIC;
+extern bool		pdfioContentSetStateTracking(pdfio_stream_t *st, bool value) _PDFIO_PUBLIC;
 extern bool		pdfioContentSetStrokeColorDeviceCMYK(pdfio_stream_t *st, double c, double m, double y, double k) _PDFIO_PUBLIC;
 extern bool		pdfioContentSetStrokeColorDeviceGray(pdfio_stream_t *st, double g) _PDFIO_PUBLIC;
 extern bool		pdfioContentSetStrokeColorDeviceRGB(pdfio_stream_t *st, double r, double g, double b) _PDFIO_PUBLIC;
@@ -136,13 +145,27 @@ extern pdfio_obj_t	*pdfioFileCreateFontObjFromData(pdfio_file_t *pdf, const void
 extern pdfio_obj_t	*pdfioFileCreateFontObjFromFile(pdfio_file_t *pdf, const char *filename, bool unicode) _PDFIO_PUBLIC;
 extern pdfio_obj_t	*pdfioFileCreateICCObjFromData(pdfio_file_t *pdf, const unsigned char *data, size_t datalen, size_t num_colors) _PDFIO_PUBLIC;
 extern pdfio_obj_t	*pdfioFileCreateICCObjFromFile(pdfio_file_t *pdf, const char *filename, size_t num_colors) _PDFIO_PUBLIC;
+extern pdfio_image_t	*pdfioFileCreateImage(pdfio_file_t *pdf, size_t width, size_t height, size_t depth, size_t num_colors, pdfio_array_t *color_data, bool alpha, bool interpolate) _PDFIO_PUBLIC;
 extern pdfio_obj_t	*pdfioFileCreateImageObjFromData(pdfio_file_t *pdf, const unsigned char *data, size_t width, size_t height, size_t num_colors, pdfio_array_t *color_data, bool alpha, bool interpolate) _PDFIO_PUBLIC;
+extern pdfio_obj_t	*pdfioFileCreateImageObjFromEncodedData(pdfio_file_t *pdf, const unsigned char *data, size_t datalen, bool interpolate) _PDFIO_PUBLIC;
 extern pdfio_obj_t	*pdfioFileCreateImageObjFromFile(pdfio_file_t *pdf, const char *filename, bool interpolate) _PDFIO_PUBLIC;
+extern pdfio_obj_t	*pdfioFileCreateScaledImageObjFromData(pdfio_file_t *pdf, const unsigned char *data, size_t width, size_t height, size_t num_colors, pdfio_array_t *color_data, bool alpha, bool interpolate, double box_width, double box_height, double resolution) _PDFIO_PUBLIC;
+extern void		pdfioFontCacheClear(void) _PDFIO_PUBLIC;
+
+// Font measurement helpers...
+extern pdfio_fontmetrics_t *pdfioFontMetricsCreate(pdfio_obj_t *font) _PDFIO_PUBLIC;
+extern void		pdfioFontMetricsDelete(pdfio_fontmetrics_t *fm) _PDFIO_PUBLIC;
+extern double		pdfioFontMetricsMeasure(pdfio_fontmetrics_t *fm, const char *s, double size, double *advances) _PDFIO_PUBLIC;
 
 // Image object helpers...
+extern pdfio_obj_t	*pdfioImageClose(pdfio_image_t *image) _PDFIO_PUBLIC;
 extern size_t		pdfioImageGetBytesPerLine(pdfio_obj_t *obj) _PDFIO_PUBLIC;
 extern double		pdfioImageGetHeight(pdfio_obj_t *obj) _PDFIO_PUBLIC;
+extern pdfio_obj_t	*pdfioImageGetObj(pdfio_image_t *image) _PDFIO_PUBLIC;
 extern double		pdfioImageGetWidth(pdfio_obj_t *obj) _PDFIO_PUBLIC;
+extern pdfio_image_t	*pdfioImageOpen(pdfio_obj_t *obj, size_t num_colors, bool alpha) _PDFIO_PUBLIC;
+extern bool		pdfioImageReadRows(pdfio_image_t *image, unsigned char *data, size_t num_rows) _PDFIO_PUBLIC;
+extern bool		pdfioImageWriteRows(pdfio_image_t *image, const unsigned char *data, size_t num_rows) _PDFIO_PUBLIC;
 
 // Page dictionary helpers...
 extern bool		pdfioPageDictAddColorSpace(pdfio_dict_t *dict, const char *name, pdfio_array_t *data) _PDFIO_PUBLIC;
@@ -147,12 +147,15 @@ pdfioDictCreate(pdfio_file_t *pdf)	// I - PDF file
 
   dict->pdf = pdf;
 
+  _pdfioFileLock(pdf);
+
   if (pdf->num_dicts >= pdf->alloc_dicts)
   {
     pdfio_dict_t **temp = (pdfio_dict_t **)realloc(pdf->dicts, (pdf->alloc_dicts + 16) * sizeof(pdfio_dict_t *));
 
     if (!temp)
     {
+      _pdfioFileUnlock(pdf);
       free(dict);
       return (NULL);
     }
@@ -163,6 +166,8 @@ pdfioDictCreate(pdfio_file_t *pdf)	// I - PDF file
 
   pdf->dicts[pdf->num_dicts ++] = dict;
 
+  _pdfioFileUnlock(pdf);
+
   return (dict);
 }
 
@@ -14,28 +14,253 @@
 #endif // !O_BINARY
 
 
+//
+// Local constants...
+//
+
+#define _PDFIO_OBJSTM_MAX	100	// Objects per compressed object stream
+#define _PDFIO_PAGES_MAX	32	// Kids per page tree node
+#define _PDFIO_SHARED_OBJ	((size_t)-1)
+					// Object used by more than one page
+
+
+//
+// Local types...
+//
+
+typedef struct _pdfio_linear_s		// Linearization data
+{
+  int		fd;			// Original PDF file
+  size_t	num_objs,		// Number of objects
+		num_pages,		// Number of pages
+		*usage,			// Page using each object
+		*marks,			// Traversal mark for each object
+		*stack,			// Traversal stack
+		num_stack,		// Number of objects on the stack
+		*order,			// Objects in output order
+		*page_start,		// Start of each page's objects in order
+		*page_refs,		// Number of shared object references for each page
+		*refs,			// Shared object references
+		num_refs,		// Number of shared object references
+		alloc_refs,		// Allocated shared object references
+		num_first,		// Number of objects in the first page section
+		num_main,		// Number of objects in the main section
+		shared_start,		// Start of shared objects in order
+		other_start;		// Start of other objects in order
+  off_t		*offsets,		// Offsets of objects in order
+		lin_offset,		// Offset of linearization dictionary
+		xref_offset,		// Offset of first page cross-reference table
+		hint_offset,		// Offset of hint stream
+		hint_length,		// Length of hint stream object
+		main_offset,		// Offset of main cross-reference table
+		main_entry,		// Offset of white space before first main entry
+		file_length;		// Length of file
+} _pdfio_linear_t;
+
+
 //
 // Local functions...
 //
 
 static pdfio_obj_t	*add_obj(pdfio_file_t *pdf, size_t number, unsigned short generation, off_t offset);
-static int		compare_objmaps(_pdfio_objmap_t *a, _pdfio_objmap_t *b);
+static ssize_t		append_objstm(_pdfio_objstm_t *objstm, const void *data, size_t datalen);
 static pdfio_file_t	*create_common(const char *filename, int fd, pdfio_output_cb_t output_cb, void *output_cbdata, const char *version, pdfio_rect_t *media_box, pdfio_rect_t *crop_box, pdfio_error_cb_t error_cb, void *error_cbdata);
+static size_t		find_objmap(_pdfio_objmap_t *maps, size_t mask, const unsigned char *src_id, size_t src_number);
 static const char	*get_info_string(pdfio_file_t *pdf, const char *key);
 static char		*get_iso_date(time_t t, char *buffer, size_t bufsize);
 static struct lconv	*get_lconv(void);
+static int		get_num_bits(size_t value);
+static pdfio_obj_t	*get_page_node(pdfio_file_t *pdf);
 static bool		load_obj_stream(pdfio_obj_t *obj);
 static bool		load_pages(pdfio_file_t *pdf, pdfio_obj_t *obj, size_t depth);
 static bool		load_xref(pdfio_file_t *pdf, off_t xref_offset, pdfio_password_cb_t password_cb, void *password_data);
+static pdfio_file_t	*open_merge_file(pdfio_file_t *pdf, const char *filename, pdfio_password_cb_t password_cb, void *password_cbdata);
+static void		put_hint(unsigned char *data, size_t *bitpos, size_t value, int nbits);
 static bool		repair_xref(pdfio_file_t *pdf, pdfio_password_cb_t password_cb, void *password_data);
+static void		scan_refs(pdfio_file_t *pdf, _pdfio_linear_t *lin, _pdfio_value_t *v, size_t mark);
+static bool		write_linear_header(pdfio_file_t *pdf, _pdfio_linear_t *lin);
+static bool		write_linear_obj(pdfio_file_t *pdf, _pdfio_linear_t *lin, pdfio_obj_t *obj);
+static bool		write_linearized(pdfio_file_t *pdf);
 static bool		write_metadata(pdfio_file_t *pdf);
+static bool		write_objstm(pdfio_file_t *pdf);
 static bool		write_pages(pdfio_file_t *pdf);
 static bool		write_trailer(pdfio_file_t *pdf);
 
 
+//
+// '_pdfioFileAddCompressedObj()' - Add an object to a compressed object stream.
+//
+
+bool					// O - `true` on success, `false` on failure
+_pdfioFileAddCompressedObj(
+    pdfio_file_t *pdf,			// I - PDF file
+    pdfio_obj_t  *obj)			// I - Object
+{
+  _pdfio_objstm_t	*objstm = pdf->objstm;
+					// Compressed object stream
+  bool			ret;		// Return value
+  pdfio_output_cb_t	output_cb;	// Saved output callback
+  void			*output_ctx;	// Saved output callback context
+  off_t			bufpos;		// Saved file position
+
+
+  PDFIO_DEBUG("_pdfioFileAddCompressedObj(pdf=%p, obj=%p(%lu))\n", (void *)pdf, (void *)obj, (unsigned long)obj->number);
+
+  // Create the object stream object as needed...
+  if (!objstm->obj)
+  {
+    pdfio_dict_t	*dict;		// Object stream dictionary
+
+    if ((dict = pdfioDictCreate(pdf)) == NULL)
+      return (false);
+
+    pdfioDictSetName(dict, "Type", "ObjStm");
+    pdfioDictSetName(dict, "Filter", "FlateDecode");
+
+    if ((objstm->obj = pdfioFileCreateObj(pdf, dict)) == NULL)
+      return (false);
+  }
+
+  // Allocate memory as needed...
+  if (objstm->num_objs >= objstm->alloc_objs)
+  {
+    pdfio_obj_t	**temp;			// New objects array
+    size_t	*tempoffsets;		// New offsets array
+
+    if ((temp = realloc(objstm->objs, (objstm->alloc_objs + 32) * sizeof(pdfio_obj_t *))) == NULL)
+    {
+      _pdfioFileError(pdf, "Unable to allocate memory for compressed object.");
+      return (false);
+    }
+
+    objstm->objs = temp;
+
+    if ((tempoffsets = realloc(objstm->offsets, (objstm->alloc_objs + 32) * sizeof(size_t))) == NULL)
+    {
+      _pdfioFileError(pdf, "Unable to allocate memory for compressed object.");
+      return (false);
+    }
+
+    objstm->offsets    = tempoffsets;
+    objstm->alloc_objs += 32;
+  }
+
+  // Write the object value to the object stream data by temporarily
+  // redirecting output...
+  if (!_pdfioFileFlush(pdf))
+    return (false);
+
+  output_cb       = pdf->output_cb;
+  output_ctx      = pdf->output_ctx;
+  bufpos          = pdf->bufpos;
+  pdf->output_cb  = (pdfio_output_cb_t)append_objstm;
+  pdf->output_ctx = objstm;
+
+  objstm->offsets[objstm->num_objs] = objstm->datalen;
+
+  ret = _pdfioValueWrite(pdf, NULL, &obj->value, NULL) && _pdfioFilePuts(pdf, "\n") && _pdfioFileFlush(pdf);
+
+  pdf->output_cb  = output_cb;
+  pdf->output_ctx = output_ctx;
+  pdf->bufpos     = bufpos;
+
+  if (!ret)
+    return (false);
+
+  obj->objstm       = objstm->obj;
+  obj->objstm_index = objstm->num_objs;
+
+  objstm->objs[objstm->num_objs ++] = obj;
+
+  // Write the object stream once it is full, unless another stream is being
+  // written...
+  if (objstm->num_objs >= _PDFIO_OBJSTM_MAX && !pdf->current_obj)
+    return (write_objstm(pdf));
+
+  return (true);
+}
+
+
+//
+// '_pdfioFileAddDigest()' - Add a stream digest.
+//
+// When another thread has already added an object for the same digest, that
+// object is returned instead so that all references use the same copy.  If
+// memory for the digest cannot be allocated, the object is returned without
+// caching the digest.
+//
+
+pdfio_obj_t *				// O - Object for digest
+_pdfioFileAddDigest(
+    pdfio_file_t  *pdf,			// I - Destination PDF file
+    const uint8_t *digest,		// I - SHA-256 digest
+    pdfio_obj_t   *obj)			// I - Destination object
+{
+  _pdfio_digest_t	*dig;		// Stream digest
+  size_t		left,		// Left digest
+			right,		// Right digest
+			current;	// Current digest
+
+
+  _pdfioFileLock(pdf);
+
+  // Find the insertion point to keep the digests sorted...
+  for (left = 0, right = pdf->num_digests; left < right;)
+  {
+    current = (left + right) / 2;
+
+    if (memcmp(pdf->digests[current].digest, digest, sizeof(pdf->digests[current].digest)) < 0)
+      left = current + 1;
+    else
+      right = current;
+  }
+
+  if (left < pdf->num_digests && !memcmp(pdf->digests[left].digest, digest, sizeof(pdf->digests[left].digest)))
+  {
+    // Another thread got here first, use its object...
+    obj = pdf->digests[left].obj;
+
+    _pdfioFileUnlock(pdf);
+
+    return (obj);
+  }
+
+  // Allocate memory as needed...
+  if (pdf->num_digests >= pdf->alloc_digests)
+  {
+    if ((dig = realloc(pdf->digests, (pdf->alloc_digests + 32) * sizeof(_pdfio_digest_t))) == NULL)
+    {
+      // The object is still usable, so just skip caching its digest...
+      _pdfioFileUnlock(pdf);
+      return (obj);
+    }
+
+    pdf->alloc_digests += 32;
+    pdf->digests       = dig;
+  }
+
+  dig = pdf->digests + left;
+
+  if (left < pdf->num_digests)
+    memmove(dig + 1, dig, (pdf->num_digests - left) * sizeof(_pdfio_digest_t));
+
+  pdf->num_digests ++;
+
+  memcpy(dig->digest, digest, sizeof(dig->digest));
+  dig->obj = obj;
+
+  _pdfioFileUnlock(pdf);
+
+  return (obj);
+}
+
+
 //
 // '_pdfioFileAddMappedObj()' - Add a mapped object.
 //
+// Object maps are stored in a hash table using open addressing.  The table
+// is doubled in size whenever it becomes half full.
+//
 
 bool					// O - `true` on success, `false` on failure
 _pdfioFileAddMappedObj(
@@ -43,24 +268,51 @@ _pdfioFileAddMappedObj(
     pdfio_obj_t  *dst_obj,		// I - Destination object
     pdfio_obj_t  *src_obj)		// I - Source object
 {
-  _pdfio_objmap_t	*map;		// Object map
+  _pdfio_objmap_t	*map,		// Object map
+			*maps;		// New object maps
+  size_t		i,		// Looping var
+			alloc_maps,	// Size of new object maps
+			mask;		// Mask for hash values
 
 
-  // Allocate memory as needed...
-  if (pdf->num_objmaps >= pdf->alloc_objmaps)
+  // Update an existing mapping in place...
+  if (pdf->num_objmaps > 0)
+  {
+    map = pdf->objmaps + find_objmap(pdf->objmaps, pdf->alloc_objmaps - 1, src_obj->pdf->file_id, src_obj->number);
+
+    if (map->obj)
+    {
+      map->obj = dst_obj;
+      return (true);
+    }
+  }
+
+  // Grow the hash table as needed...
+  if (pdf->num_objmaps >= pdf->alloc_objmaps / 2)
   {
-    if ((map = realloc(pdf->objmaps, (pdf->alloc_objmaps + 16) * sizeof(_pdfio_objmap_t))) == NULL)
+    alloc_maps = pdf->alloc_objmaps ? 2 * pdf->alloc_objmaps : 64;
+    mask       = alloc_maps - 1;
+
+    if ((maps = calloc(alloc_maps, sizeof(_pdfio_objmap_t))) == NULL)
     {
       _pdfioFileError(pdf, "Unable to allocate memory for object map.");
       return (false);
     }
 
-    pdf->alloc_objmaps += 16;
-    pdf->objmaps       = map;
+    for (i = pdf->alloc_objmaps, map = pdf->objmaps; i > 0; i --, map ++)
+    {
+      if (map->obj)
+        maps[find_objmap(maps, mask, map->src_id, map->src_number)] = *map;
+    }
+
+    free(pdf->objmaps);
+
+    pdf->alloc_objmaps = alloc_maps;
+    pdf->objmaps       = maps;
   }
 
-  // Add an object to the end...
-  map = pdf->objmaps + pdf->num_objmaps;
+  // Add the object to the first free slot...
+  map = pdf->objmaps + find_objmap(pdf->objmaps, pdf->alloc_objmaps - 1, src_obj->pdf->file_id, src_obj->number);
   pdf->num_objmaps ++;
 
   map->obj        = dst_obj;
@@ -68,10 +320,6 @@ _pdfioFileAddMappedObj(
 
   memcpy(map->src_id, src_obj->pdf->file_id, sizeof(map->src_id));
 
-  // Sort as needed...
-  if (pdf->num_objmaps > 1 && compare_objmaps(map, pdf->objmaps + pdf->num_objmaps - 2) < 0)
-    qsort(pdf->objmaps, pdf->num_objmaps, sizeof(_pdfio_objmap_t), (int (*)(const void *, const void *))compare_objmaps);
-
   return (true);
 }
 
@@ -84,6 +332,15 @@ bool					// O - `true` on success and `false` on failure
 _pdfioFileAddPage(pdfio_file_t *pdf,	// I - PDF file
                   pdfio_obj_t  *obj)	// I - Page object
 {
+  _pdfioFileLock(pdf);
+
+  // Make sure there is a page tree node for the page...
+  if (pdf->mode == _PDFIO_MODE_WRITE && !get_page_node(pdf))
+  {
+    _pdfioFileUnlock(pdf);
+    return (false);
+  }
+
   // Add the page to the array of pages...
   if (pdf->num_pages >= pdf->alloc_pages)
   {
@@ -91,6 +348,7 @@ _pdfioFileAddPage(pdfio_file_t *pdf,	// I - PDF file
 
     if (!temp)
     {
+      _pdfioFileUnlock(pdf);
       _pdfioFileError(pdf, "Unable to allocate memory for pages.");
       return (false);
     }
@@ -101,6 +359,8 @@ _pdfioFileAddPage(pdfio_file_t *pdf,	// I - PDF file
 
   pdf->pages[pdf->num_pages ++] = obj;
 
+  _pdfioFileUnlock(pdf);
+
   return (true);
 }
 
@@ -127,17 +387,43 @@ pdfioFileClose(pdfio_file_t *pdf)	// I - PDF file
   {
     ret = false;
 
-    // Add default OutputIntent for PDF/A CMYK printing...
-    pdfioFileAddOutputIntent(pdf, /*subtype*/"GTS_PDFA1", /*condition*/"CMYK", /*cond_id*/"CGATS001", /*reg_name*/NULL, /*info*/"CMYK Printing", /*profile*/NULL);
+    // Finish any staged streams that are still open and write any updated
+    // objects...
+    for (i = 0; i < pdf->num_objs; i ++)
+    {
+      if (pdf->objs[i]->stream)
+      {
+        pdfioStreamClose(pdf->objs[i]->stream);
+        pdf->objs[i]->stream = NULL;
+      }
+
+      if (pdf->objs[i]->modified)
+        pdfioObjClose(pdf->objs[i]);
+    }
+
+    if (pdf->update_pdf)
+    {
+      // Append the cross-reference section for the updated objects...
+      if (_pdfioFileWriteSubsets(pdf) && write_objstm(pdf) && write_trailer(pdf))
+        ret = _pdfioFileFlush(pdf);
+    }
+    else
+    {
+      // Add default OutputIntent for PDF/A CMYK printing...
+      pdfioFileAddOutputIntent(pdf, /*subtype*/"GTS_PDFA1", /*condition*/"CMYK", /*cond_id*/"CGATS001", /*reg_name*/NULL, /*info*/"CMYK Printing", /*profile*/NULL);
 
-    // Close and write out the last bits...
-    if (write_metadata(pdf) && pdfioObjClose(pdf->info_obj) && write_pages(pdf) && pdfioObjClose(pdf->root_obj) && write_trailer(pdf))
-      ret = _pdfioFileFlush(pdf);
+      // Close and write out the last bits...
+      if (_pdfioFileWriteSubsets(pdf) && write_metadata(pdf) && pdfioObjClose(pdf->info_obj) && write_pages(pdf) && pdfioObjClose(pdf->root_obj) && write_objstm(pdf) && (pdf->linearized ? write_linearized(pdf) : write_trailer(pdf)))
+	ret = _pdfioFileFlush(pdf);
+    }
   }
 
   if (pdf->fd >= 0 && close(pdf->fd) < 0)
     ret = false;
 
+  if (pdf->update_pdf)
+    pdfioFileClose(pdf->update_pdf);
+
   // Free all data...
   free(pdf->filename);
   free(pdf->version);
@@ -155,8 +441,30 @@ pdfioFileClose(pdfio_file_t *pdf)	// I - PDF file
   free(pdf->objs);
 
   free(pdf->objmaps);
+  free(pdf->digests);
+
+  for (i = 0; i < pdf->num_subsets; i ++)
+  {
+    free(pdf->subsets[i]->data);
+    free(pdf->subsets[i]);
+  }
+  free(pdf->subsets);
 
   free(pdf->pages);
+  free(pdf->page_nodes);
+
+#ifdef HAVE_PTHREAD
+  if (pdf->threaded)
+    pthread_mutex_destroy(&pdf->mutex);
+#endif // HAVE_PTHREAD
+
+  if (pdf->objstm)
+  {
+    free(pdf->objstm->objs);
+    free(pdf->objstm->offsets);
+    free(pdf->objstm->data);
+    free(pdf->objstm);
+  }
 
   for (i = 0; i < pdf->num_strings; i ++)
     free(pdf->strings[i]);
@@ -399,12 +707,15 @@ _pdfioFileCreateObj(
   }
 
   // Expand the objects array as needed
+  _pdfioFileLock(pdf);
+
   if (pdf->num_objs >= pdf->alloc_objs)
   {
     pdfio_obj_t **temp = (pdfio_obj_t **)realloc(pdf->objs, (pdf->alloc_objs + 32) * sizeof(pdfio_obj_t *));
 
     if (!temp)
     {
+      _pdfioFileUnlock(pdf);
       _pdfioFileError(pdf, "Unable to allocate memory for object - %s", strerror(errno));
       free(obj);
       return (NULL);
@@ -414,11 +725,13 @@ _pdfioFileCreateObj(
     pdf->alloc_objs += 32;
   }
 
+  // Initialize the object, numbering it after the last object in the file...
+  obj->pdf    = pdf;
+  obj->number = pdf->num_objs > 0 ? pdf->objs[pdf->num_objs - 1]->number + 1 : 1;
+
   pdf->objs[pdf->num_objs ++] = obj;
 
-  // Initialize the object...
-  obj->pdf    = pdf;
-  obj->number = pdf->num_objs;
+  _pdfioFileUnlock(pdf);
 
   if (value)
     _pdfioValueCopy(pdf, &obj->value, srcpdf, value);
@@ -515,14 +828,23 @@ pdfioFileCreatePage(pdfio_file_t *pdf,	// I - PDF file
                     pdfio_dict_t *dict)	// I - Page dictionary
 {
   pdfio_obj_t	*page,			// Page object
+		*parent,		// Parent page tree node
 		*contents;		// Contents object
   pdfio_dict_t	*contents_dict;		// Dictionary for Contents object
+  pdfio_stream_t *st;			// Contents stream
+  bool		subsetting;		// Subsetting fonts?
 
 
   // Range check input...
   if (!pdf)
     return (NULL);
 
+  if (pdf->update_pdf)
+  {
+    _pdfioFileError(pdf, "Unable to add pages to a PDF file opened for update.");
+    return (NULL);
+  }
+
   // Copy the page dictionary...
   if (dict)
     dict = pdfioDictCopy(pdf, dict);
@@ -539,8 +861,6 @@ pdfioFileCreatePage(pdfio_file_t *pdf,	// I - PDF file
   if (!_pdfioDictGetValue(dict, "MediaBox"))
     pdfioDictSetRect(dict, "MediaBox", &pdf->media_box);
 
-  pdfioDictSetObj(dict, "Parent", pdf->pages_obj);
-
   pdfioPageDictAddColorSpace(dict, "DefaultGray", pdfioArrayCreateColorFromStandard(pdf, 1, PDFIO_CS_SRGB));
   pdfioPageDictAddColorSpace(dict, "DefaultRGB", pdfioArrayCreateColorFromStandard(pdf, 3, PDFIO_CS_SRGB));
   pdfioPageDictAddColorSpace(dict, "DefaultCMYK", pdfioArrayCreateColorFromStandard(pdf, 4, PDFIO_CS_CGATS001));
@@ -548,10 +868,6 @@ pdfioFileCreatePage(pdfio_file_t *pdf,	// I - PDF file
   if (!_pdfioDictGetValue(dict, "Type"))
     pdfioDictSetName(dict, "Type", "Page");
 
-  // Create the page object...
-  if ((page = pdfioFileCreateObj(pdf, dict)) == NULL)
-    return (NULL);
-
   // Create a contents object to hold the contents of the page...
   if ((contents_dict = pdfioDictCreate(pdf)) == NULL)
     return (NULL);
@@ -560,23 +876,52 @@ pdfioFileCreatePage(pdfio_file_t *pdf,	// I - PDF file
   pdfioDictSetName(contents_dict, "Filter", "FlateDecode");
 #endif // !DEBUG
 
+  // Create and write the page object, keeping the file locked so that the
+  // page gets the right parent node...
+  _pdfioFileLock(pdf);
+
+  if ((parent = get_page_node(pdf)) == NULL)
+    goto error;
+
+  pdfioDictSetObj(dict, "Parent", parent);
+
+  if ((page = pdfioFileCreateObj(pdf, dict)) == NULL)
+    goto error;
+
   if ((contents = pdfioFileCreateObj(pdf, contents_dict)) == NULL)
-    return (NULL);
+    goto error;
 
   // Add the contents stream to the pages object and write it...
   pdfioDictSetObj(dict, "Contents", contents);
   if (!pdfioObjClose(page))
-    return (NULL);
+    goto error;
 
   if (!_pdfioFileAddPage(pdf, page))
-    return (NULL);
+    goto error;
+
+  subsetting = pdf->num_subsets > 0;
+
+  _pdfioFileUnlock(pdf);
 
   // Create the contents stream...
 #ifdef DEBUG
-  return (pdfioObjCreateStream(contents, PDFIO_FILTER_NONE));
+  st = pdfioObjCreateStream(contents, PDFIO_FILTER_NONE);
 #else
-  return (pdfioObjCreateStream(contents, PDFIO_FILTER_FLATE));
+  st = pdfioObjCreateStream(contents, PDFIO_FILTER_FLATE);
 #endif // DEBUG
+
+  // Track the fonts used on the page when subsetting...
+  if (st && subsetting)
+    st->fonts = pdfioDictGetDict(pdfioDictGetDict(dict, "Resources"), "Font");
+
+  return (st);
+
+  // If we get here something went wrong...
+  error:
+
+  _pdfioFileUnlock(pdf);
+
+  return (NULL);
 }
 
 
@@ -732,6 +1077,49 @@ pdfioFileCreateTemporary(
 }
 
 
+//
+// '_pdfioFileFindDigest()' - Find the object for a stream digest.
+//
+
+pdfio_obj_t *				// O - Matching object or `NULL` if none
+_pdfioFileFindDigest(
+    pdfio_file_t  *pdf,			// I - Destination PDF file
+    const uint8_t *digest)		// I - SHA-256 digest
+{
+  pdfio_obj_t	*obj = NULL;		// Matching object
+  size_t	left,			// Left digest
+		right,			// Right digest
+		current;		// Current digest
+  int		result;			// Result of comparison
+
+
+  _pdfioFileLock(pdf);
+
+  for (left = 0, right = pdf->num_digests; left < right;)
+  {
+    current = (left + right) / 2;
+
+    if ((result = memcmp(pdf->digests[current].digest, digest, sizeof(pdf->digests[current].digest))) == 0)
+    {
+      obj = pdf->digests[current].obj;
+      break;
+    }
+    else if (result < 0)
+    {
+      left = current + 1;
+    }
+    else
+    {
+      right = current;
+    }
+  }
+
+  _pdfioFileUnlock(pdf);
+
+  return (obj);
+}
+
+
 //
 // '_pdfioFileFindMappedObj()' - Find a mapped object.
 //
@@ -742,22 +1130,13 @@ _pdfioFileFindMappedObj(
     pdfio_file_t *src_pdf,		// I - Source PDF file
     size_t       src_number)		// I - Source object number
 {
-  _pdfio_objmap_t	key,		// Search key
-			*match;		// Matching object map
-
-
   // If we have no mapped objects, return NULL immediately...
   if (pdf->num_objmaps == 0)
     return (NULL);
 
-  // Otherwise search for a match...
-  memcpy(key.src_id, src_pdf->file_id, sizeof(key.src_id));
-  key.src_number = src_number;
-
-  if ((match = (_pdfio_objmap_t *)bsearch(&key, pdf->objmaps, pdf->num_objmaps, sizeof(_pdfio_objmap_t), (int (*)(const void *, const void *))compare_objmaps)) != NULL)
-    return (match->obj);
-  else
-    return (NULL);
+  // Otherwise look up the slot for the source object, which is either the
+  // match or the first free slot...
+  return (pdf->objmaps[find_objmap(pdf->objmaps, pdf->alloc_objmaps - 1, src_pdf->file_id, src_number)].obj);
 }
 
 
@@ -776,14 +1155,21 @@ pdfioFileFindObj(
   size_t	left,			// Left object
 		right,			// Right object
 		current;		// Current object
+  pdfio_obj_t	*obj = NULL;		// Matching object
 
 
   PDFIO_DEBUG("pdfioFileFindObj(pdf=%p, number=%lu) alloc_objs=%lu, num_objs=%lu, objs=%p\n", (void *)pdf, (unsigned long)number, (unsigned long)(pdf ? pdf->alloc_objs : 0), (unsigned long)(pdf ? pdf->num_objs : 0), (void *)(pdf ? pdf->objs : NULL));
 
   // Range check input...
-  if (!pdf || pdf->num_objs == 0 || number < 1)
+  if (!pdf || number < 1)
     return (NULL);
 
+  // Lock the object array so another thread cannot grow it while we search...
+  _pdfioFileLock(pdf);
+
+  if (pdf->num_objs == 0)
+    goto done;
+
   // Do a binary search for the object...
   if ((current = number - 1) >= pdf->num_objs)
     current = pdf->num_objs / 2;
@@ -793,8 +1179,8 @@ pdfioFileFindObj(
   if (number == pdf->objs[current]->number)
   {
     // Fast match...
-    PDFIO_DEBUG("pdfioFileFindObj: Returning %lu (%p)\n", (unsigned long)current, (void *)pdf->objs[current]);
-    return (pdf->objs[current]);
+    obj = pdf->objs[current];
+    goto done;
   }
   else if (number < pdf->objs[current]->number)
   {
@@ -812,7 +1198,10 @@ pdfioFileFindObj(
     current = (left + right) / 2;
 
     if (number == pdf->objs[current]->number)
-      return (pdf->objs[current]);
+    {
+      obj = pdf->objs[current];
+      goto done;
+    }
     else if (number < pdf->objs[current]->number)
       right = current;
     else
@@ -820,20 +1209,17 @@ pdfioFileFindObj(
   }
 
   if (number == pdf->objs[left]->number)
-  {
-    PDFIO_DEBUG("pdfioFileFindObj: Returning %lu (%p)\n", (unsigned long)left, (void *)pdf->objs[left]);
-    return (pdf->objs[left]);
-  }
+    obj = pdf->objs[left];
   else if (number == pdf->objs[right]->number)
-  {
-    PDFIO_DEBUG("pdfioFileFindObj: Returning %lu (%p)\n", (unsigned long)right, (void *)pdf->objs[right]);
-    return (pdf->objs[right]);
-  }
-  else
-  {
-    PDFIO_DEBUG("pdfioFileFindObj: Returning NULL\n");
-    return (NULL);
-  }
+    obj = pdf->objs[right];
+
+  done:
+
+  _pdfioFileUnlock(pdf);
+
+  PDFIO_DEBUG("pdfioFileFindObj: Returning %p\n", (void *)obj);
+
+  return (obj);
 }
 
 
@@ -861,6 +1247,25 @@ pdfioFileGetCatalog(pdfio_file_t *pdf)	// I - PDF file
 }
 
 
+//
+// 'pdfioFileGetCompression()' - Get the default Flate compression level and
+//                               strategy for a PDF file.
+//
+// @since PDFio v1.7@
+//
+
+int					// O - Compression level (`0` to `9`)
+pdfioFileGetCompression(
+    pdfio_file_t      *pdf,		// I - PDF file
+    pdfio_zstrategy_t *strategy)	// O - Compression strategy or `NULL` to ignore
+{
+  if (strategy)
+    *strategy = pdf ? pdf->zstrategy : PDFIO_ZSTRATEGY_AUTO;
+
+  return (pdf ? pdf->zlevel : 9);
+}
+
+
 //
 // 'pdfioFileGetCreationDate()' - Get the creation date for a PDF file.
 //
@@ -1075,40 +1480,127 @@ pdfioFileGetVersion(
 
 
 //
-// 'pdfioFileOpen()' - Open a PDF file for reading.
-//
-// This function opens an existing PDF file.  The "filename" argument specifies
-// the name of the PDF file to create.
-//
-// The "password_cb" and "password_cbdata" arguments specify a password callback
-// and its data pointer for PDF files that use one of the standard Adobe
-// "security" handlers.  The callback returns a password string or `NULL` to
-// cancel the open.  If `NULL` is specified for the callback function and the
-// PDF file requires a password, the open will always fail.
-//
-// The "error_cb" and "error_cbdata" arguments specify an error handler callback
-// and its data pointer - if `NULL` then the default error handler is used that
-// writes error and warning messages to `stderr`.  The error handler callback
-// should return `true` to continue reading the PDF file or `false` to stop.
-// For example:
+// 'pdfioFileMergeFiles()' - Copy all of the pages from one or more PDF files.
 //
-// ```
-// bool
-// my_error_cb(pdfio_file_t *pdf, const char *message, void *data)
-// {
-//   (void)data; /* Not using data pointer in this callback */
+// This function copies all of the pages from the named PDF files to the end
+// of the PDF file.  Streams such as fonts, images, and ICC profiles that are
+// identical in more than one source file are only written once.  Each source
+// file is opened, and the operating system asked to start reading it, while
+// the pages from the previous file are being copied.
 //
-//   fprintf(stderr, "%s: %s\n", pdfioFileGetName(pdf), message);
+// The "password_cb" and "password_cbdata" arguments specify a password
+// callback and its data pointer for encrypted source files.  Errors in the
+// source files are reported using the PDF file's error callback.
 //
-//   /* Return true to continue on warning messages, false otherwise... */
-//   return (!strncmp(message, "WARNING:", 8));
-// }
-// ```
+// @since PDFio v1.7@
 //
-// > Note: Error messages starting with "WARNING:" are actually warning
-// > messages - the callback should normally return `true` to allow PDFio to
-// > try to resolve the issue.  In addition, some errors are unrecoverable and
-// > ignore the return value of the error callback.
+
+bool					// O - `true` on success, `false` on failure
+pdfioFileMergeFiles(
+    pdfio_file_t        *pdf,		// I - PDF file
+    size_t              num_files,	// I - Number of files to merge
+    const char * const  *filenames,	// I - Names of PDF files to merge
+    pdfio_password_cb_t password_cb,	// I - Password callback or `NULL` for none
+    void                *password_cbdata)
+					// I - Password callback data, if any
+{
+  bool		ret = false;		// Return value
+  size_t	i,			// Looping var
+		page,			// Current page
+		num_pages;		// Number of pages
+  pdfio_file_t	*src,			// Current source PDF file
+		*next;			// Next source PDF file
+
+
+  // Range check input...
+  if (!pdf || pdf->mode != _PDFIO_MODE_WRITE || (num_files > 0 && !filenames))
+    return (false);
+
+  if (pdf->update_pdf)
+  {
+    _pdfioFileError(pdf, "Unable to add pages to a PDF file opened for update.");
+    return (false);
+  }
+
+  if (num_files == 0)
+    return (true);
+
+  // Open the first file and then copy the pages from each file...
+  if ((src = open_merge_file(pdf, filenames[0], password_cb, password_cbdata)) == NULL)
+    return (false);
+
+  pdf->merging = true;
+
+  for (i = 0; i < num_files; i ++, src = next)
+  {
+    // Open the next file before copying from the current one...
+    if (i + 1 >= num_files)
+      next = NULL;
+    else if ((next = open_merge_file(pdf, filenames[i + 1], password_cb, password_cbdata)) == NULL)
+    {
+      pdfioFileClose(src);
+      goto done;
+    }
+
+    for (page = 0, num_pages = pdfioFileGetNumPages(src); page < num_pages; page ++)
+    {
+      if (!pdfioPageCopy(pdf, pdfioFileGetPage(src, page)))
+      {
+        pdfioFileClose(src);
+        if (next)
+          pdfioFileClose(next);
+        goto done;
+      }
+    }
+
+    pdfioFileClose(src);
+  }
+
+  ret = true;
+
+  done:
+
+  pdf->merging = false;
+
+  return (ret);
+}
+
+
+//
+// 'pdfioFileOpen()' - Open a PDF file for reading.
+//
+// This function opens an existing PDF file.  The "filename" argument specifies
+// the name of the PDF file to create.
+//
+// The "password_cb" and "password_cbdata" arguments specify a password callback
+// and its data pointer for PDF files that use one of the standard Adobe
+// "security" handlers.  The callback returns a password string or `NULL` to
+// cancel the open.  If `NULL` is specified for the callback function and the
+// PDF file requires a password, the open will always fail.
+//
+// The "error_cb" and "error_cbdata" arguments specify an error handler callback
+// and its data pointer - if `NULL` then the default error handler is used that
+// writes error and warning messages to `stderr`.  The error handler callback
+// should return `true` to continue reading the PDF file or `false` to stop.
+// For example:
+//
+// ```
+// bool
+// my_error_cb(pdfio_file_t *pdf, const char *message, void *data)
+// {
+//   (void)data; /* Not using data pointer in this callback */
+//
+//   fprintf(stderr, "%s: %s\n", pdfioFileGetName(pdf), message);
+//
+//   /* Return true to continue on warning messages, false otherwise... */
+//   return (!strncmp(message, "WARNING:", 8));
+// }
+// ```
+//
+// > Note: Error messages starting with "WARNING:" are actually warning
+// > messages - the callback should normally return `true` to allow PDFio to
+// > try to resolve the issue.  In addition, some errors are unrecoverable and
+// > ignore the return value of the error callback.
 //
 
 pdfio_file_t *				// O - PDF file
@@ -1123,7 +1615,7 @@ pdfioFileOpen(
   pdfio_file_t	*pdf;			// PDF file
   char		line[1025],		// Line from file
 		*ptr,			// Pointer into line
-		*end;			// End of line
+		*end;			// End of "startxref" in line
   ssize_t	bytes;			// Bytes read
   off_t		xref_offset;		// Offset to xref table
   time_t	curtime;		// Creation date/time
@@ -1203,15 +1695,19 @@ pdfioFileOpen(
   PDFIO_DEBUG("pdfioOpen: Read %d bytes at end of file.\n", (int)bytes);
 
   line[bytes] = '\0';
-  end = line + bytes - 9;
 
-  for (ptr = line; ptr < end; ptr ++)
+  // Use the last "startxref" since incremental updates add new ones after
+  // the old ones and binary stream data may contain nul characters...
+  for (ptr = NULL, end = line + bytes; end >= (line + 9); end --)
   {
-    if (!strncmp(ptr, "startxref", 9) && !strstr(ptr + 9, "startxref") && strtol(ptr + 9, NULL, 10) > 0)
+    if (!strncmp(end - 9, "startxref", 9) && strtol(end, NULL, 10) > 0)
+    {
+      ptr = end - 9;
       break;
+    }
   }
 
-  if (ptr >= end)
+  if (!ptr)
   {
     if (!_pdfioFileError(pdf, "WARNING: Unable to find start of cross-reference table, will attempt to rebuild."))
       goto error;
@@ -1223,7 +1719,8 @@ pdfioFileOpen(
   {
     PDFIO_DEBUG("pdfioFileOpen: line=%p,ptr=%p(\"%s\")\n", (void *)line, (void *)ptr, ptr);
 
-    xref_offset = (off_t)strtol(ptr + 9, NULL, 10);
+    xref_offset      = (off_t)strtol(ptr + 9, NULL, 10);
+    pdf->xref_offset = xref_offset;
 
     PDFIO_DEBUG("pdfioFileOpen: xref_offset=%lu\n", (unsigned long)xref_offset);
 
@@ -1255,6 +1752,126 @@ pdfioFileOpen(
 }
 
 
+//
+// 'pdfioFileOpenUpdate()' - Open a PDF file for incremental updates.
+//
+// This function opens an existing PDF file so that objects can be updated and
+// added without rewriting the whole file.  The updated and new objects are
+// appended to the end of the file along with a new cross-reference section
+// when the file is closed, leaving the original contents of the file
+// untouched.
+//
+// Use the @link pdfioObjUpdate@ function to mark existing objects as updated
+// and the `pdfioFileCreate...Obj` functions to add new objects.  Pages cannot
+// be added to a PDF file opened for update - the @link pdfioFileCreatePage@
+// function reports an error and returns `NULL`.  Encrypted and damaged PDF
+// files cannot be updated.
+//
+// The "error_cb" and "error_cbdata" arguments specify an error handler callback
+// and its data pointer - if `NULL` then the default error handler is used that
+// writes error and warning messages to `stderr`.
+//
+// @since PDFio v1.7@
+//
+
+pdfio_file_t *				// O - PDF file or `NULL` on error
+pdfioFileOpenUpdate(
+    const char       *filename,		// I - Filename
+    pdfio_error_cb_t error_cb,		// I - Error callback or `NULL` for default
+    void             *error_cbdata)	// I - Error callback data, if any
+{
+  pdfio_file_t	*pdf,			// PDF file
+		*update_pdf;		// Original PDF file
+  pdfio_dict_t	*dict;			// Information dictionary
+
+
+  PDFIO_DEBUG("pdfioFileOpenUpdate(filename=\"%s\", error_cb=%p, error_cbdata=%p)\n", filename, (void *)error_cb, (void *)error_cbdata);
+
+  // Load the original PDF file...
+  if ((pdf = pdfioFileOpen(filename, /*password_cb*/NULL, /*password_cbdata*/NULL, error_cb, error_cbdata)) == NULL)
+    return (NULL);
+
+  if (pdf->encrypt_obj)
+  {
+    _pdfioFileError(pdf, "Unable to update an encrypted PDF file.");
+    goto error;
+  }
+  else if (!pdf->xref_offset || pdf->num_objs == 0)
+  {
+    _pdfioFileError(pdf, "Unable to update a damaged PDF file.");
+    goto error;
+  }
+
+  // Move the original file descriptor to a separate read-only file so that
+  // existing objects and streams can still be loaded...
+  if ((update_pdf = (pdfio_file_t *)calloc(1, sizeof(pdfio_file_t))) == NULL)
+  {
+    _pdfioFileError(pdf, "Unable to allocate memory for PDF file - %s", strerror(errno));
+    goto error;
+  }
+
+  pdf->update_pdf = update_pdf;
+
+  update_pdf->loc         = pdf->loc;
+  update_pdf->filename    = strdup(pdf->filename);
+  update_pdf->mode        = _PDFIO_MODE_READ;
+  update_pdf->error_cb    = pdf->error_cb;
+  update_pdf->error_data  = pdf->error_data;
+  update_pdf->permissions = PDFIO_PERMISSION_ALL;
+  update_pdf->fd          = pdf->fd;
+
+  // Then open the file again for appending the updates...
+  if ((pdf->fd = open(filename, O_WRONLY | O_BINARY)) < 0)
+  {
+    _pdfioFileError(pdf, "Unable to open file for writing - %s", strerror(errno));
+    goto error;
+  }
+
+  if ((pdf->update_offset = lseek(pdf->fd, 0, SEEK_END)) < 0)
+  {
+    _pdfioFileError(pdf, "Unable to seek to end of file - %s", strerror(errno));
+    goto error;
+  }
+
+  pdf->update_number = pdf->objs[pdf->num_objs - 1]->number;
+  pdf->mode          = _PDFIO_MODE_WRITE;
+  pdf->zlevel        = 9;
+  pdf->zstrategy     = PDFIO_ZSTRATEGY_AUTO;
+  pdf->zthreads      = 1;
+  pdf->precision     = 6;
+  pdf->bufpos        = pdf->update_offset;
+  pdf->bufptr        = pdf->buffer;
+  pdf->bufend        = pdf->buffer + sizeof(pdf->buffer);
+
+  // Update the modification date in the information dictionary...
+  if (!pdf->info_obj)
+  {
+    if ((dict = pdfioDictCreate(pdf)) == NULL || (pdf->info_obj = pdfioFileCreateObj(pdf, dict)) == NULL)
+      goto error;
+  }
+
+  if (!pdfioObjUpdate(pdf->info_obj) || pdf->info_obj->value.type != PDFIO_VALTYPE_DICT)
+  {
+    _pdfioFileError(pdf, "Unable to update the information dictionary.");
+    goto error;
+  }
+
+  pdfioFileSetModificationDate(pdf, time(NULL));
+
+  return (pdf);
+
+
+  // If we get here we had a fatal error, close without writing anything...
+  error:
+
+  pdf->mode = _PDFIO_MODE_READ;
+
+  pdfioFileClose(pdf);
+
+  return (NULL);
+}
+
+
 //
 // 'pdfioFileSetAuthor()' - Set the author for a PDF file.
 //
@@ -1268,6 +1885,104 @@ pdfioFileSetAuthor(pdfio_file_t *pdf,	// I - PDF file
 }
 
 
+//
+// 'pdfioFileSetCompression()' - Set the default Flate compression level and
+//                               strategy for a PDF file.
+//
+// This function sets the default compression level and strategy used for
+// Flate-compressed streams created in a PDF file.  The "level" argument
+// specifies a compression level from `0` (no compression) to `9` (best
+// compression) - the default is `9`.  Lower levels are faster and usually
+// produce only slightly larger files, for example level `6` is a good
+// general-purpose compromise.
+//
+// The "strategy" argument specifies the compression strategy to use:
+//
+// - `PDFIO_ZSTRATEGY_AUTO`: Use `PDFIO_ZSTRATEGY_FILTERED` for image data that
+//   uses a PNG predictor and `PDFIO_ZSTRATEGY_DEFAULT` for everything else
+//   (default)
+// - `PDFIO_ZSTRATEGY_DEFAULT`: Use the default strategy for all streams
+// - `PDFIO_ZSTRATEGY_FILTERED`: Use the strategy for filtered data
+// - `PDFIO_ZSTRATEGY_HUFFMAN_ONLY`: Use Huffman coding only, which is fast but
+//   offers limited compression
+// - `PDFIO_ZSTRATEGY_RLE`: Use run-length encoding, which is fast and works
+//   well for images with large areas of a single color
+//
+// The level and strategy can be overridden for individual streams using the
+// @link pdfioObjCreateFlateStream@ function.
+//
+// @since PDFio v1.7@
+//
+
+bool					// O - `true` on success, `false` otherwise
+pdfioFileSetCompression(
+    pdfio_file_t      *pdf,		// I - PDF file
+    int               level,		// I - Compression level (`0` to `9`)
+    pdfio_zstrategy_t strategy)		// I - Compression strategy
+{
+  if (!pdf)
+    return (false);
+
+  if (level < 0 || level > 9)
+  {
+    _pdfioFileError(pdf, "Unsupported compression level %d.", level);
+    return (false);
+  }
+
+  if (strategy < PDFIO_ZSTRATEGY_AUTO || strategy > PDFIO_ZSTRATEGY_RLE)
+  {
+    _pdfioFileError(pdf, "Unsupported compression strategy %d.", (int)strategy);
+    return (false);
+  }
+
+  pdf->zlevel    = level;
+  pdf->zstrategy = strategy;
+
+  return (true);
+}
+
+
+//
+// 'pdfioFileSetCompressionThreads()' - Set the number of threads used to
+//                                      compress large streams.
+//
+// This function sets the number of threads used to Flate compress large
+// streams in a PDF file, for example the page images in a PCLm file.  The
+// default is `1` thread which compresses all data as it is written.
+//
+// When more than one thread is used, data written to a Flate-compressed stream
+// is buffered in 128k blocks, and streams larger than "num_threads" blocks are
+// compressed in parallel, one block per thread.  Each block uses the previous
+// 32k of data as its dictionary so the compression ratio is close to that of a
+// single thread.  Smaller streams are compressed normally when they are
+// closed.
+//
+// > *Note*: If PDFio was built without threading support, the blocks are
+// > compressed sequentially.
+//
+// @since PDFio v1.7@
+//
+
+bool					// O - `true` on success, `false` otherwise
+pdfioFileSetCompressionThreads(
+    pdfio_file_t *pdf,			// I - PDF file
+    size_t       num_threads)		// I - Number of threads (`1` to `64`)
+{
+  if (!pdf)
+    return (false);
+
+  if (num_threads < 1 || num_threads > PDFIO_MAX_THREADS)
+  {
+    _pdfioFileError(pdf, "Unsupported number of compression threads %lu.", (unsigned long)num_threads);
+    return (false);
+  }
+
+  pdf->zthreads = num_threads;
+
+  return (true);
+}
+
+
 //
 // 'pdfioFileSetCreationDate()' - Set the creation date for a PDF file.
 //
@@ -1295,6 +2010,70 @@ pdfioFileSetCreator(pdfio_file_t *pdf,	// I - PDF file
 }
 
 
+//
+// 'pdfioFileSetFontCache()' - Set whether to use the shared font cache.
+//
+// This function controls whether fonts created with the
+// @link pdfioFileCreateFontObjFromFile@ function use a cache that is shared by
+// all PDF files in the current process.  The first time a font file is used,
+// it is loaded and compressed and the character to glyph map and widths are
+// computed - later uses, from this or any other PDF file, copy the cached data
+// without reading the font file again.  The font file is reloaded if its size
+// or modification time changes.
+//
+// Cached fonts remain in memory until the @link pdfioFontCacheClear@ function
+// is called.  Font subsetting, when enabled, takes precedence over the cache.
+// The default is `false`.
+//
+// @since PDFio v1.7@
+//
+
+bool					// O - `true` on success, `false` otherwise
+pdfioFileSetFontCache(
+    pdfio_file_t *pdf,			// I - PDF file
+    bool         value)			// I - `true` to use the shared font cache, `false` otherwise
+{
+  // Range check input...
+  if (!pdf || pdf->mode != _PDFIO_MODE_WRITE)
+    return (false);
+
+  pdf->font_cache = value;
+
+  return (true);
+}
+
+
+//
+// 'pdfioFileSetFontSubsetting()' - Set whether to subset embedded fonts.
+//
+// This function controls whether Unicode TrueType fonts created with the
+// @link pdfioFileCreateFontObjFromData@ and
+// @link pdfioFileCreateFontObjFromFile@ functions are embedded as subsets
+// containing only the glyphs that are used.  Glyph usage is tracked for text
+// shown with the `pdfioContentTextShow` functions in page content streams
+// created with @link pdfioFileCreatePage@ and in form or appearance streams
+// whose dictionary lists the font in its resources, and the subset fonts are
+// written when the PDF file is closed.  Fonts using PostScript (CFF) outlines are
+// always embedded in full.  The default is `false`.
+//
+// @since PDFio v1.7@
+//
+
+bool					// O - `true` on success, `false` otherwise
+pdfioFileSetFontSubsetting(
+    pdfio_file_t *pdf,			// I - PDF file
+    bool         value)			// I - `true` to subset fonts, `false` otherwise
+{
+  // Range check input...
+  if (!pdf || pdf->mode != _PDFIO_MODE_WRITE)
+    return (false);
+
+  pdf->subset_fonts = value;
+
+  return (true);
+}
+
+
 //
 // 'pdfioFileSetKeywords()' - Set the keywords string for a PDF file.
 //
@@ -1330,51 +2109,204 @@ pdfioFileSetLanguage(
 
 
 //
-// 'pdfioFileSetModificationDate()' - Set the modification date for a PDF file.
-//
-
-void
-pdfioFileSetModificationDate(
-    pdfio_file_t *pdf,			// I - PDF file
-    time_t       value)			// I - Value
-{
-  if (pdf && pdf->info_obj)
-    pdfioDictSetDate(pdf->info_obj->value.value.dict, "ModDate", value);
-}
-
-
+// 'pdfioFileSetLinearized()' - Set whether to write a linearized PDF file.
 //
-// 'pdfioFileSetPermissions()' - Set the PDF permissions, encryption mode, and passwords.
+// This function controls whether the PDF file is "linearized" for fast web
+// viewing.  A linearized PDF file starts with the objects for the first page
+// along with "hint" tables that allow a viewer to show the first page, and to
+// locate the other pages, before the rest of the file has been downloaded.
+// The PDF file is rewritten in this order when @link pdfioFileClose@ is
+// called.
 //
-// This function sets the PDF usage permissions, encryption mode, and
-// passwords.
+// Linearized PDF files cannot be written using an output callback and cannot
+// use compressed object streams or encryption.  The default is `false`.
 //
-// > *Note*: This function must be called before creating or copying any
-// > objects.  Due to fundamental limitations in the PDF format, PDF encryption
-// > offers little protection from disclosure.  Permissions are not enforced in
-// > any meaningful way.
+// @since PDFio v1.7@
 //
 
 bool					// O - `true` on success, `false` otherwise
-pdfioFileSetPermissions(
-    pdfio_file_t       *pdf,		// I - PDF file
-    pdfio_permission_t permissions,	// I - Use permissions
-    pdfio_encryption_t encryption,	// I - Type of encryption to use
-    const char         *owner_password,	// I - Owner password, if any
-    const char         *user_password)	// I - User password, if any
+pdfioFileSetLinearized(
+    pdfio_file_t *pdf,			// I - PDF file
+    bool         value)			// I - `true` to linearize the PDF file, `false` otherwise
 {
-  if (!pdf)
-    return (false);
+  size_t	i;			// Looping var
 
-  if (pdf->profile >= _PDFIO_PROFILE_PDFA_1A && pdf->profile <= _PDFIO_PROFILE_PDFA_4 && encryption != PDFIO_ENCRYPTION_NONE)
-  {
-    _pdfioFileError(pdf, "Encryption is not allowed for PDF/A files.");
+
+  // Range check input...
+  if (!pdf || pdf->mode != _PDFIO_MODE_WRITE)
     return (false);
-  }
 
-  if (encryption == PDFIO_ENCRYPTION_NONE)
+  if (value)
+  {
+    // Objects already written to a compressed object stream cannot be moved,
+    // even if object streams have since been turned off...
+    for (i = 0; i < pdf->num_objs; i ++)
+    {
+      if (pdf->objs[i]->objstm)
+        break;
+    }
+
+    if (pdf->output_cb)
+    {
+      _pdfioFileError(pdf, "Linearized PDF files cannot be written using an output callback.");
+      return (false);
+    }
+    else if (pdf->update_pdf)
+    {
+      _pdfioFileError(pdf, "Unable to linearize a PDF file opened for update.");
+      return (false);
+    }
+    else if (pdf->profile == _PDFIO_PROFILE_PCLM)
+    {
+      _pdfioFileError(pdf, "PCLm files cannot be linearized.");
+      return (false);
+    }
+    else if (pdf->objstm || i < pdf->num_objs)
+    {
+      _pdfioFileError(pdf, "Linearized PDF files cannot use compressed object streams.");
+      return (false);
+    }
+    else if (pdf->encryption != PDFIO_ENCRYPTION_NONE)
+    {
+      _pdfioFileError(pdf, "Linearized PDF files cannot be encrypted.");
+      return (false);
+    }
+  }
+
+  pdf->linearized = value;
+
+  return (true);
+}
+
+
+//
+// 'pdfioFileSetModificationDate()' - Set the modification date for a PDF file.
+//
+
+void
+pdfioFileSetModificationDate(
+    pdfio_file_t *pdf,			// I - PDF file
+    time_t       value)			// I - Value
+{
+  if (pdf && pdf->info_obj)
+    pdfioDictSetDate(pdf->info_obj->value.value.dict, "ModDate", value);
+}
+
+
+//
+// 'pdfioFileSetObjectStreams()' - Set whether to use compressed object streams.
+//
+// This function controls whether non-stream objects such as pages, fonts, and
+// annotations are written to compressed object streams, which can make PDF
+// files with many objects considerably smaller.  Compressed object streams
+// require PDF 1.5 or later and cannot be used with encryption or output
+// callbacks.  The default is `false`.
+//
+// @since PDFio v1.7@
+//
+
+bool					// O - `true` on success, `false` otherwise
+pdfioFileSetObjectStreams(
+    pdfio_file_t *pdf,			// I - PDF file
+    bool         value)			// I - `true` to use compressed object streams, `false` otherwise
+{
+  // Range check input...
+  if (!pdf || pdf->mode != _PDFIO_MODE_WRITE)
+    return (false);
+
+  if (!value)
+  {
+    // Write any pending objects and stop using object streams...
+    if (pdf->objstm)
+    {
+      if (!write_objstm(pdf))
+        return (false);
+
+      free(pdf->objstm->objs);
+      free(pdf->objstm->offsets);
+      free(pdf->objstm->data);
+      free(pdf->objstm);
+
+      pdf->objstm = NULL;
+    }
+
+    return (true);
+  }
+
+  if (strcmp(pdf->version, "1.5") < 0)
+  {
+    _pdfioFileError(pdf, "Compressed object streams require PDF 1.5 or later.");
+    return (false);
+  }
+  else if (pdf->output_cb)
+  {
+    _pdfioFileError(pdf, "Compressed object streams cannot be used with an output callback.");
+    return (false);
+  }
+  else if (pdf->encryption != PDFIO_ENCRYPTION_NONE)
+  {
+    _pdfioFileError(pdf, "Compressed object streams cannot be used with encryption.");
+    return (false);
+  }
+  else if (pdf->update_pdf && !pdf->xref_stream)
+  {
+    _pdfioFileError(pdf, "Compressed object streams cannot be used to update a PDF file without a cross-reference stream.");
+    return (false);
+  }
+  else if (pdf->linearized)
+  {
+    _pdfioFileError(pdf, "Compressed object streams cannot be used with linearized PDF files.");
+    return (false);
+  }
+
+  if (!pdf->objstm && (pdf->objstm = (_pdfio_objstm_t *)calloc(1, sizeof(_pdfio_objstm_t))) == NULL)
+  {
+    _pdfioFileError(pdf, "Unable to allocate memory for compressed object stream.");
+    return (false);
+  }
+
+  return (true);
+}
+
+
+//
+// 'pdfioFileSetPermissions()' - Set the PDF permissions, encryption mode, and passwords.
+//
+// This function sets the PDF usage permissions, encryption mode, and
+// passwords.
+//
+// > *Note*: This function must be called before creating or copying any
+// > objects.  Due to fundamental limitations in the PDF format, PDF encryption
+// > offers little protection from disclosure.  Permissions are not enforced in
+// > any meaningful way.
+//
+
+bool					// O - `true` on success, `false` otherwise
+pdfioFileSetPermissions(
+    pdfio_file_t       *pdf,		// I - PDF file
+    pdfio_permission_t permissions,	// I - Use permissions
+    pdfio_encryption_t encryption,	// I - Type of encryption to use
+    const char         *owner_password,	// I - Owner password, if any
+    const char         *user_password)	// I - User password, if any
+{
+  if (!pdf)
+    return (false);
+
+  if (pdf->profile >= _PDFIO_PROFILE_PDFA_1A && pdf->profile <= _PDFIO_PROFILE_PDFA_4 && encryption != PDFIO_ENCRYPTION_NONE)
+  {
+    _pdfioFileError(pdf, "Encryption is not allowed for PDF/A files.");
+    return (false);
+  }
+
+  if (encryption == PDFIO_ENCRYPTION_NONE)
     return (true);
 
+  if (pdf->linearized)
+  {
+    _pdfioFileError(pdf, "Linearized PDF files cannot be encrypted.");
+    return (false);
+  }
+
   if (pdf->num_objs > 3)		// First three objects are pages, info, and root
   {
     _pdfioFileError(pdf, "You must call pdfioFileSetPermissions before adding any objects.");
@@ -1386,6 +2318,114 @@ pdfioFileSetPermissions(
   return (_pdfioCryptoLock(pdf, permissions, encryption, owner_password, user_password));
 }
 
+
+//
+// 'pdfioFileSetPrecision()' - Set the number of decimal places used for
+//                             coordinates in page content.
+//
+// This function sets the number of decimal places from `0` to `6` that are
+// used for coordinates written by the path and text positioning functions,
+// for example @link pdfioContentPathLineTo@ and @link pdfioContentTextMoveTo@.
+// The default is `6` which writes coordinates exactly as in prior releases.
+// Smaller values produce smaller content streams - `2` decimal places are
+// precise to 1/7200th of an inch.  When fewer than `6` decimal places are used,
+// coordinates between -1 and 1 are also written without the leading zero.
+//
+// Colors, line widths, and transformation matrices always use `6` decimal
+// places.
+//
+// @since PDFio v1.7@
+//
+
+bool					// O - `true` on success, `false` otherwise
+pdfioFileSetPrecision(
+    pdfio_file_t *pdf,			// I - PDF file
+    int          digits)		// I - Number of decimal places (`0` to `6`)
+{
+  // Range check input...
+  if (!pdf || pdf->mode != _PDFIO_MODE_WRITE)
+    return (false);
+
+  if (digits < 0 || digits > 6)
+  {
+    _pdfioFileError(pdf, "Unsupported precision %d.", digits);
+    return (false);
+  }
+
+  pdf->precision = digits;
+
+  return (true);
+}
+
+
+//
+// 'pdfioFileSetResourceCache()' - Set whether to reuse identical resources.
+//
+// This function controls whether fonts, ICC profiles, and images created
+// from the same data or file (and with the same options) are written to the
+// PDF file once, with later calls to the `pdfioFileCreate...Obj...` functions
+// returning the existing object.  Resources are identified using a SHA-256
+// digest of their data and options, so files are read one extra time to
+// compute the digest.  The default is `false`.
+//
+// @since PDFio v1.7@
+//
+
+bool					// O - `true` on success, `false` otherwise
+pdfioFileSetResourceCache(
+    pdfio_file_t *pdf,			// I - PDF file
+    bool         value)			// I - `true` to reuse identical resources, `false` otherwise
+{
+  // Range check input...
+  if (!pdf || pdf->mode != _PDFIO_MODE_WRITE)
+    return (false);
+
+  pdf->resource_cache = value;
+
+  return (true);
+}
+
+
+//
+// 'pdfioFileSetStagedStreams()' - Set whether to stage streams in memory.
+//
+// This function controls whether new streams are written directly to the PDF
+// file or staged in memory.  When streams are staged, the data for each stream
+// is compressed (and encrypted) into its own memory buffer and the object is
+// written to the file when the stream is closed.  This allows any number of
+// streams to be open at the same time, for example to write the contents of
+// several pages along with the images they use.  The default is `false`.
+//
+// @since PDFio v1.7@
+//
+
+bool					// O - `true` on success, `false` otherwise
+pdfioFileSetStagedStreams(
+    pdfio_file_t *pdf,			// I - PDF file
+    bool         value)			// I - `true` to stage streams in memory, `false` otherwise
+{
+  // Range check input...
+  if (!pdf || pdf->mode != _PDFIO_MODE_WRITE)
+    return (false);
+
+  if (pdf->current_obj)
+  {
+    _pdfioFileError(pdf, "Another object (%u) is already open.", (unsigned)pdf->current_obj->number);
+    return (false);
+  }
+
+  if (!value && pdf->threaded)
+  {
+    _pdfioFileError(pdf, "Streams must be staged when the file is shared between threads.");
+    return (false);
+  }
+
+  pdf->staged = value;
+
+  return (true);
+}
+
+
 //
 // 'pdfioFileSetSubject()' - Set the subject for a PDF file.
 //
@@ -1400,6 +2440,72 @@ pdfioFileSetSubject(
 }
 
 
+//
+// 'pdfioFileSetThreadSafe()' - Set whether a PDF file is shared between threads.
+//
+// This function controls whether a PDF file being written can be used from
+// multiple threads at the same time.  When enabled, object creation and all
+// writes to the PDF file are serialized and streams are staged in memory (see
+// @link pdfioFileSetStagedStreams@) so that each thread can create its own
+// pages, images, and other objects.  Pages are added to the document in the
+// order in which they are created.
+//
+// Each stream and dictionary must only be used by one thread at a time, and
+// this function must not be called while other threads are using the PDF file.
+//
+// > *Note*: Thread-safe access is not available if PDFio was built without
+// > threading support.
+//
+// @since PDFio v1.7@
+//
+
+bool					// O - `true` on success, `false` otherwise
+pdfioFileSetThreadSafe(
+    pdfio_file_t *pdf,			// I - PDF file
+    bool         value)			// I - `true` to allow access from multiple threads, `false` otherwise
+{
+  // Range check input...
+  if (!pdf || pdf->mode != _PDFIO_MODE_WRITE)
+    return (false);
+
+#ifdef HAVE_PTHREAD
+  if (value && !pdf->threaded)
+  {
+    pthread_mutexattr_t	attr;		// Mutex attributes
+
+    // Stage streams so that each thread writes to its own buffers...
+    if (!pdfioFileSetStagedStreams(pdf, true))
+      return (false);
+
+    // Create a recursive mutex for the file...
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init(&pdf->mutex, &attr);
+    pthread_mutexattr_destroy(&attr);
+
+    pdf->threaded = true;
+  }
+  else if (!value && pdf->threaded)
+  {
+    pdf->threaded = false;
+
+    pthread_mutex_destroy(&pdf->mutex);
+  }
+
+  return (true);
+
+#else
+  if (value)
+  {
+    _pdfioFileError(pdf, "Multi-threaded access is not supported.");
+    return (false);
+  }
+
+  return (true);
+#endif // HAVE_PTHREAD
+}
+
+
 //
 // 'pdfioFileSetTitle()' - Set the title for a PDF file.
 //
@@ -1515,24 +2621,37 @@ add_obj(pdfio_file_t   *pdf,		// I - PDF file
 
 
 //
-// 'compare_objmaps()' - Compare two object maps...
+// 'append_objstm()' - Append data to a compressed object stream.
 //
 
-static int				// O - Result of comparison
-compare_objmaps(_pdfio_objmap_t *a,	// I - First object map
-                _pdfio_objmap_t *b)	// I - Second object map
+static ssize_t				// O - Number of bytes appended or `-1` on error
+append_objstm(_pdfio_objstm_t *objstm,	// I - Compressed object stream
+              const void      *data,	// I - Data
+              size_t          datalen)	// I - Length of data
 {
-  int	ret = memcmp(a->src_id, b->src_id, sizeof(a->src_id));
-					// Result of comparison
+  // Expand the data buffer as needed...
+  if ((objstm->datalen + datalen) > objstm->datasize)
+  {
+    char	*temp;			// New data buffer
+    size_t	tempsize;		// New size of data buffer
 
-  if (ret)
-    return (ret);
-  else if (a->src_number < b->src_number)
-    return (-1);
-  else if (a->src_number > b->src_number)
-    return (1);
-  else
-    return (0);
+    if ((tempsize = 2 * objstm->datasize) < 4096)
+      tempsize = 4096;
+    if (tempsize < (objstm->datalen + datalen))
+      tempsize = objstm->datalen + datalen;
+
+    if ((temp = realloc(objstm->data, tempsize)) == NULL)
+      return (-1);
+
+    objstm->data     = temp;
+    objstm->datasize = tempsize;
+  }
+
+  // Append the data...
+  memcpy(objstm->data + objstm->datalen, data, datalen);
+  objstm->datalen += datalen;
+
+  return ((ssize_t)datalen);
 }
 
 
@@ -1591,6 +2710,10 @@ create_common(
   pdf->output_cb   = output_cb;
   pdf->output_ctx  = output_cbdata;
   pdf->filename    = strdup(filename);
+  pdf->zlevel      = 9;
+  pdf->zstrategy   = PDFIO_ZSTRATEGY_AUTO;
+  pdf->zthreads    = 1;
+  pdf->precision   = 6;
 
   if (!version)
     version = "2.0";
@@ -1742,6 +2865,39 @@ create_common(
 }
 
 
+//
+// 'find_objmap()' - Find the hash table slot for a source object.
+//
+// The returned slot contains the matching object map or is the first free
+// slot for the source object.
+//
+
+static size_t				// O - Slot in hash table
+find_objmap(
+    _pdfio_objmap_t     *maps,		// I - Object maps
+    size_t              mask,		// I - Mask for hash values
+    const unsigned char *src_id,	// I - Source PDF file identifier
+    size_t              src_number)	// I - Source object number
+{
+  size_t	i,			// Looping var
+		hash;			// FNV-1a hash of source file and object
+
+
+  for (i = 0, hash = 2166136261U; i < sizeof(maps->src_id); i ++)
+    hash = (hash ^ src_id[i]) * 16777619U;
+
+  hash = (hash ^ src_number) * 16777619U;
+
+  for (i = hash & mask; maps[i].obj; i = (i + 1) & mask)
+  {
+    if (maps[i].src_number == src_number && !memcmp(maps[i].src_id, src_id, sizeof(maps[i].src_id)))
+      break;
+  }
+
+  return (i);
+}
+
+
 //
 // 'get_info_string()' - Get a string value from the Info dictionary.
 //
@@ -1813,29 +2969,102 @@ get_lconv(void)
 
 
 //
-// 'load_obj_stream()' - Load an object stream.
-//
-// Object streams are Adobe's complicated solution for saving a few
-// kilobytes in an average PDF file at the expense of massively more
-// complicated reader applications.
-//
-// Each object stream starts with pairs of object numbers and offsets,
-// followed by the object values (typically dictionaries).  For
-// simplicity pdfio loads all of these values into memory so that we
-// don't later have to randomly access compressed stream data to get
-// a dictionary.
+// 'get_num_bits()' - Get the number of bits needed to represent a value.
 //
 
-static bool				// O - `true` on success, `false` on error
-load_obj_stream(pdfio_obj_t *obj)	// I - Object to load
+static int				// O - Number of bits
+get_num_bits(size_t value)		// I - Value
 {
-  pdfio_stream_t	*st;		// Stream
-  _pdfio_token_t	tb;		// Token buffer/stack
+  int	bits;				// Number of bits
+
+
+  for (bits = 0; value > 0; bits ++)
+    value >>= 1;
+
+  return (bits);
+}
+
+
+//
+// 'get_page_node()' - Get the leaf page tree node for the next page.
+//
+// Pages are grouped into leaf nodes of up to `_PDFIO_PAGES_MAX` pages, with
+// the first leaf node being the "pages_obj" object that is created with the
+// file.  The upper levels of the page tree are created by `write_pages`.
+//
+
+static pdfio_obj_t *			// O - Page tree node or `NULL` on error
+get_page_node(pdfio_file_t *pdf)	// I - PDF file
+{
+  size_t	node = pdf->num_pages / _PDFIO_PAGES_MAX;
+					// Node index
+
+
+  if (node < pdf->num_page_nodes)
+    return (pdf->page_nodes[node]);
+
+  // Allocate memory as needed...
+  if (pdf->num_page_nodes >= pdf->alloc_page_nodes)
+  {
+    pdfio_obj_t **temp = (pdfio_obj_t **)realloc(pdf->page_nodes, (pdf->alloc_page_nodes + 16) * sizeof(pdfio_obj_t *));
+
+    if (!temp)
+    {
+      _pdfioFileError(pdf, "Unable to allocate memory for pages.");
+      return (NULL);
+    }
+
+    pdf->alloc_page_nodes += 16;
+    pdf->page_nodes       = temp;
+  }
+
+  // Add a new node...
+  if (pdf->num_page_nodes == 0)
+  {
+    pdf->page_nodes[0] = pdf->pages_obj;
+  }
+  else
+  {
+    pdfio_dict_t *dict;			// Page tree node dictionary
+
+    if ((dict = pdfioDictCreate(pdf)) == NULL)
+      return (NULL);
+
+    pdfioDictSetName(dict, "Type", "Pages");
+
+    if ((pdf->page_nodes[pdf->num_page_nodes] = pdfioFileCreateObj(pdf, dict)) == NULL)
+      return (NULL);
+  }
+
+  return (pdf->page_nodes[pdf->num_page_nodes ++]);
+}
+
+
+//
+// 'load_obj_stream()' - Load an object stream.
+//
+// Object streams are Adobe's complicated solution for saving a few
+// kilobytes in an average PDF file at the expense of massively more
+// complicated reader applications.
+//
+// Each object stream starts with pairs of object numbers and offsets,
+// followed by the object values (typically dictionaries).  For
+// simplicity pdfio loads all of these values into memory so that we
+// don't later have to randomly access compressed stream data to get
+// a dictionary.
+//
+
+static bool				// O - `true` on success, `false` on error
+load_obj_stream(pdfio_obj_t *obj)	// I - Object to load
+{
+  pdfio_stream_t	*st;		// Stream
+  _pdfio_token_t	tb;		// Token buffer/stack
   char			buffer[32];	// Token
   size_t		number,		// Object number
 			cur_obj,	// Current object
 			num_objs = 0;	// Number of objects
   pdfio_obj_t		*objs[16384];	// Objects
+  _pdfio_value_t	value;		// Discarded object value
   int			count;		// Count of objects
 
 
@@ -1891,7 +3120,9 @@ load_obj_stream(pdfio_obj_t *obj)	// I - Object to load
   // Read the objects themselves...
   for (cur_obj = 0; cur_obj < num_objs; cur_obj ++)
   {
-    if (!_pdfioValueRead(obj->pdf, obj, &tb, &(objs[cur_obj]->value), 0))
+    // Objects that were already loaded from a newer object stream are read
+    // and discarded...
+    if (!_pdfioValueRead(obj->pdf, obj, &tb, objs[cur_obj]->value.type == PDFIO_VALTYPE_NONE ? &(objs[cur_obj]->value) : &value, 0))
     {
       _pdfioFileError(obj->pdf, "Unable to read compressed object.");
       pdfioStreamClose(st);
@@ -2048,7 +3279,6 @@ load_xref(
       unsigned char	buffer[32];	// Read buffer
       size_t		num_sobjs = 0,	// Number of object streams
 			sobjs[16384];	// Object streams to load
-      pdfio_obj_t	*current;	// Current object
 
       if ((number = strtoimax(line, &ptr, 10)) < 1)
       {
@@ -2221,22 +3451,11 @@ load_xref(
 	  }
 
 	  // Create a placeholder for the object in memory...
-	  if ((current = pdfioFileFindObj(pdf, (size_t)number)) != NULL)
+	  if (pdfioFileFindObj(pdf, (size_t)number))
 	  {
-	    PDFIO_DEBUG("load_xref: existing object, prev offset=%u\n", (unsigned)current->offset);
-
-            if (w[0] == 0 || buffer[0] == 1)
-            {
-              // Location of object...
-	      current->offset = (off_t)offset;
-	    }
-	    else if (number != offset)
-	    {
-	      // Object is part of a stream, offset is the object number...
-	      current->offset = 0;
-	    }
-
-	    PDFIO_DEBUG("load_xref: new offset=%u\n", (unsigned)current->offset);
+	    // Don't replace newer object...
+	    number ++;
+	    continue;
 	  }
 
 	  if (w[0] > 0 && buffer[0] == 2)
@@ -2263,7 +3482,7 @@ load_xref(
 	      }
 	    }
 	  }
-	  else if (!current)
+	  else
 	  {
 	    // Add this object...
 	    if (!add_obj(pdf, (size_t)number, (unsigned short)generation, (off_t)offset))
@@ -2283,6 +3502,7 @@ load_xref(
       {
 	// Save the trailer dictionary and grab the root (catalog) and info
 	// objects...
+	pdf->xref_stream  = true;
 	pdf->trailer_dict = trailer.value.dict;
 	pdf->encrypt_obj  = pdfioDictGetObj(pdf->trailer_dict, "Encrypt");
 	pdf->id_array     = pdfioDictGetArray(pdf->trailer_dict, "ID");
@@ -2502,6 +3722,54 @@ load_xref(
 }
 
 
+//
+// 'open_merge_file()' - Open a PDF file to be merged.
+//
+
+static pdfio_file_t *			// O - Source PDF file or `NULL` on error
+open_merge_file(
+    pdfio_file_t        *pdf,		// I - Destination PDF file
+    const char          *filename,	// I - Filename
+    pdfio_password_cb_t password_cb,	// I - Password callback or `NULL` for none
+    void                *password_cbdata)
+					// I - Password callback data, if any
+{
+  pdfio_file_t	*src;			// Source PDF file
+
+
+  if ((src = pdfioFileOpen(filename, password_cb, password_cbdata, pdf->error_cb, pdf->error_data)) == NULL)
+    return (NULL);
+
+#ifdef HAVE_POSIX_FADVISE
+  // Let the operating system read the rest of the file in the background...
+  posix_fadvise(src->fd, 0, 0, POSIX_FADV_WILLNEED);
+#endif // HAVE_POSIX_FADVISE
+
+  return (src);
+}
+
+
+//
+// 'put_hint()' - Put a value in a hint table.
+//
+// Hint table values are packed most significant bit first.  The data buffer
+// must be initialized to zeros.
+//
+
+static void
+put_hint(unsigned char *data,		// I - Hint table data
+         size_t        *bitpos,		// IO - Bit position in data
+         size_t        value,		// I - Value
+         int           nbits)		// I - Number of bits
+{
+  for (nbits --; nbits >= 0; nbits --, (*bitpos) ++)
+  {
+    if ((value >> nbits) & 1)
+      data[*bitpos / 8] |= (unsigned char)(0x80 >> (*bitpos & 7));
+  }
+}
+
+
 //
 // 'repair_xref()' - Try to "repair" a PDF file and its cross-references...
 //
@@ -2525,6 +3793,8 @@ repair_xref(
 
 
   // Clear trailer data...
+  pdf->xref_offset  = 0;
+  pdf->xref_stream  = false;
   pdf->trailer_dict = NULL;
   pdf->root_obj     = NULL;
   pdf->info_obj     = NULL;
@@ -2618,100 +3888,732 @@ repair_xref(
 	        if (!backup_trailer)
 	          backup_trailer = pdfioDictCreate(pdf);
 
-	        pdfioDictSetObj(backup_trailer, "Root", obj);
-	      }
-	    }
-	  }
-	}
-      }
-    }
-    else if (!strncmp(line, "trailer", 7) && (!line[7] || isspace(line[7] & 255) || line[7] == '<'))
-    {
-      // Trailer dictionary
-      _pdfio_token_t tb;		// Token buffer/stack
-      _pdfio_value_t trailer;		// Trailer
+	        pdfioDictSetObj(backup_trailer, "Root", obj);
+	      }
+	    }
+	  }
+	}
+      }
+    }
+    else if (!strncmp(line, "trailer", 7) && (!line[7] || isspace(line[7] & 255) || line[7] == '<'))
+    {
+      // Trailer dictionary
+      _pdfio_token_t tb;		// Token buffer/stack
+      _pdfio_value_t trailer;		// Trailer
+
+      PDFIO_DEBUG("repair_xref: line=\"%s\"\n", line);
+
+      if (line[7])
+      {
+	// Probably the start of the trailer dictionary, rewind the file so
+	// we can read it...
+	_pdfioFileSeek(pdf, line_offset + 7, SEEK_SET);
+      }
+
+      PDFIO_DEBUG("repair_xref: TRAILER at offset %ld\n", (long)line_offset);
+
+      _pdfioTokenInit(&tb, pdf, (_pdfio_tconsume_cb_t)_pdfioFileConsume, (_pdfio_tpeek_cb_t)_pdfioFilePeek, pdf);
+      if (!_pdfioValueRead(pdf, NULL, &tb, &trailer, 0))
+      {
+	_pdfioFileError(pdf, "Unable to read cross-reference stream dictionary.");
+	return (false);
+      }
+      else if (trailer.type != PDFIO_VALTYPE_DICT)
+      {
+	_pdfioFileError(pdf, "Trailer is not a dictionary.");
+	return (false);
+      }
+
+      _pdfioTokenFlush(&tb);
+
+      if (_pdfioDictGetValue(trailer.value.dict, "Root"))
+      {
+	// Save the trailer dictionary and grab the root (catalog) and info
+	// objects...
+	PDFIO_DEBUG("repair_xref: Using this trailer dictionary.\n");
+
+	pdf->trailer_dict = trailer.value.dict;
+	pdf->encrypt_obj  = pdfioDictGetObj(pdf->trailer_dict, "Encrypt");
+	pdf->id_array     = pdfioDictGetArray(pdf->trailer_dict, "ID");
+      }
+    }
+
+    // Get the offset for the next line...
+    line_offset = _pdfioFileTell(pdf);
+  }
+
+  PDFIO_DEBUG("repair_xref: Stopped at line_offset=%lu\n", (unsigned long)line_offset);
+
+  if (!pdf->trailer_dict && backup_trailer)
+    pdf->trailer_dict = backup_trailer;
+
+  // If the trailer contains an Encrypt key, try unlocking the file...
+  if (pdf->encrypt_obj && !_pdfioCryptoUnlock(pdf, password_cb, password_data))
+    return (false);
+
+  // Load any stream objects...
+  PDFIO_DEBUG("repair_xref: Found %lu stream objects.\n", (unsigned long)num_sobjs);
+
+  for (i = 0; i < num_sobjs; i ++)
+  {
+    if (!load_obj_stream(sobjs[i]))
+      return (false);
+  }
+
+  // Once we have all of the xref tables loaded, get the important objects and
+  // build the pages array...
+  pdf->info_obj = pdfioDictGetObj(pdf->trailer_dict, "Info");
+
+  if ((pdf->root_obj = pdfioDictGetObj(pdf->trailer_dict, "Root")) == NULL)
+  {
+    _pdfioFileError(pdf, "Missing Root object.");
+    return (false);
+  }
+
+  PDFIO_DEBUG("repair_xref: Root=%p(%lu)\n", (void *)pdf->root_obj, (unsigned long)pdf->root_obj->number);
+
+  if ((pages_obj = pdfioDictGetObj(pdfioObjGetDict(pdf->root_obj), "Pages")) == NULL)
+  {
+    _pdfioFileError(pdf, "Missing Pages object.");
+    return (false);
+  }
+
+  PDFIO_DEBUG("repair_xref: Pages=%p(%lu)\n", (void *)pages_obj, (unsigned long)pages_obj->number);
+
+  // Load pages...
+  return (load_pages(pdf, pages_obj, 0));
+}
+
+
+//
+// 'scan_refs()' - Scan a value for objects used by a page.
+//
+// Objects that are found for the first time with the current mark are pushed
+// on the traversal stack.  References to the catalog, the information
+// dictionary, and other page tree nodes are not followed.
+//
+
+static void
+scan_refs(pdfio_file_t    *pdf,		// I - PDF file
+          _pdfio_linear_t *lin,		// I - Linearization data
+          _pdfio_value_t  *v,		// I - Value
+          size_t          mark)		// I - Traversal mark
+{
+  size_t	i;			// Looping var
+  pdfio_obj_t	*obj;			// Referenced object
+  const char	*type;			// Object type
+
+
+  switch (v->type)
+  {
+    case PDFIO_VALTYPE_ARRAY :
+        for (i = 0; i < v->value.array->num_values; i ++)
+          scan_refs(pdf, lin, v->value.array->values + i, mark);
+        break;
+
+    case PDFIO_VALTYPE_DICT :
+        for (i = 0; i < v->value.dict->num_pairs; i ++)
+        {
+          // Don't follow links back up the page tree...
+          if (strcmp(v->value.dict->pairs[i].key, "Parent"))
+            scan_refs(pdf, lin, &v->value.dict->pairs[i].value, mark);
+        }
+        break;
+
+    case PDFIO_VALTYPE_INDIRECT :
+        if (v->value.indirect.number < 1 || v->value.indirect.number > lin->num_objs || lin->marks[v->value.indirect.number - 1] == mark)
+          break;
+
+        obj = pdf->objs[v->value.indirect.number - 1];
+
+        if (obj == pdf->root_obj || obj == pdf->info_obj)
+          break;
+
+        if (obj->value.type == PDFIO_VALTYPE_DICT && (type = pdfioDictGetName(obj->value.value.dict, "Type")) != NULL && (!strcmp(type, "Page") || !strcmp(type, "Pages")))
+          break;
+
+        lin->marks[v->value.indirect.number - 1] = mark;
+        lin->stack[lin->num_stack ++]            = v->value.indirect.number - 1;
+        break;
+
+    default :
+        break;
+  }
+}
+
+
+//
+// 'write_linear_header()' - Write the linearization dictionary and first page cross-reference table.
+//
+// This function is called twice, once to reserve space for the header and
+// then again once all of the offsets are known.  All of the values that are
+// not known the first time are written using a fixed width.
+//
+
+static bool				// O - `true` on success, `false` on failure
+write_linear_header(
+    pdfio_file_t    *pdf,		// I - PDF file
+    _pdfio_linear_t *lin)		// I - Linearization data
+{
+  size_t	i;			// Looping var
+  pdfio_obj_t	*obj;			// Current object
+
+
+  // Linearization parameter dictionary...
+  if (!_pdfioFilePrintf(pdf, "%lu 0 obj\n<</Linearized 1/L %-10lu/H[%-10lu %-10lu]/O %lu/E %-10lu/N %lu/T %-10lu>>\nendobj\n", (unsigned long)(lin->num_main + 1), (unsigned long)lin->file_length, (unsigned long)lin->hint_offset, (unsigned long)lin->hint_length, (unsigned long)pdf->renumber[pdf->pages[0]->number], (unsigned long)lin->offsets[lin->num_first], (unsigned long)lin->num_pages, (unsigned long)lin->main_entry))
+    return (false);
+
+  // First page cross-reference table for the linearization dictionary, hint
+  // stream, catalog, and first page objects...
+  lin->xref_offset = _pdfioFileTell(pdf);
+
+  if (!_pdfioFilePrintf(pdf, "xref\n%lu %lu \n%010lu 00000 n \n%010lu 00000 n \n", (unsigned long)(lin->num_main + 1), (unsigned long)(lin->num_first + 2), (unsigned long)lin->lin_offset, (unsigned long)lin->hint_offset))
+    return (false);
+
+  for (i = 0; i < lin->num_first; i ++)
+  {
+    obj = pdf->objs[lin->order[i]];
+
+    if (!_pdfioFilePrintf(pdf, "%010lu %05u n \n", (unsigned long)obj->offset, obj->generation))
+      return (false);
+  }
+
+  // First page trailer, which points to the main cross-reference table...
+  if (!_pdfioFilePrintf(pdf, "trailer\n<</Size %lu/Root %lu 0 R", (unsigned long)(lin->num_objs + 3), (unsigned long)pdf->renumber[pdf->root_obj->number]))
+    return (false);
+
+  if (pdf->info_obj && !_pdfioFilePrintf(pdf, "/Info %lu 0 R", (unsigned long)pdf->renumber[pdf->info_obj->number]))
+    return (false);
+
+  if (pdf->id_array && (!_pdfioFilePuts(pdf, "/ID") || !_pdfioArrayWrite(pdf->id_array, NULL)))
+    return (false);
+
+  return (_pdfioFilePrintf(pdf, "/Prev %-10lu>>\nstartxref\n0\n%%%%EOF\n", (unsigned long)lin->main_offset));
+}
+
+
+//
+// 'write_linear_obj()' - Copy an object to the linearized PDF file.
+//
+
+static bool				// O - `true` on success, `false` on failure
+write_linear_obj(
+    pdfio_file_t    *pdf,		// I - PDF file
+    _pdfio_linear_t *lin,		// I - Linearization data
+    pdfio_obj_t     *obj)		// I - Object
+{
+  off_t		stream_offset = obj->stream_offset;
+					// Offset of stream data in original file
+  _pdfio_value_t *length;		// Length value
+  size_t	remaining;		// Remaining stream data
+  ssize_t	bytes;			// Bytes read
+  char		buffer[16384];		// Copy buffer
+
+
+  obj->offset = _pdfioFileTell(pdf);
+
+  if (!_pdfioFilePrintf(pdf, "%lu %u obj\n", (unsigned long)pdf->renumber[obj->number], obj->generation))
+    return (false);
+
+  // Replace any placeholder stream length with the real one...
+  if (stream_offset > 0 && obj->value.type == PDFIO_VALTYPE_DICT && (length = _pdfioDictGetValue(obj->value.value.dict, "Length")) != NULL && length->type == PDFIO_VALTYPE_NUMBER)
+    length->value.number = (double)obj->stream_length;
+
+  if (!_pdfioValueWrite(pdf, obj, &obj->value, NULL))
+    return (false);
+
+  if (stream_offset <= 0)
+    return (_pdfioFilePuts(pdf, "\nendobj\n"));
+
+  // Copy the (already encoded) stream data...
+  if (!_pdfioFilePuts(pdf, "\nstream\n"))
+    return (false);
+
+  obj->stream_offset = _pdfioFileTell(pdf);
+
+  if (lseek(lin->fd, stream_offset, SEEK_SET) < 0)
+  {
+    _pdfioFileError(pdf, "Unable to seek within file - %s", strerror(errno));
+    return (false);
+  }
+
+  for (remaining = obj->stream_length; remaining > 0; remaining -= (size_t)bytes)
+  {
+    if ((bytes = read(lin->fd, buffer, remaining < sizeof(buffer) ? remaining : sizeof(buffer))) < 0 && (errno == EINTR || errno == EAGAIN))
+    {
+      bytes = 0;
+      continue;
+    }
+    else if (bytes <= 0)
+    {
+      _pdfioFileError(pdf, "Unable to read stream data for object %lu.", (unsigned long)obj->number);
+      return (false);
+    }
+
+    if (!_pdfioFileWrite(pdf, buffer, (size_t)bytes))
+      return (false);
+  }
+
+  return (_pdfioFilePuts(pdf, "\nendstream\nendobj\n"));
+}
+
+
+//
+// 'write_linearized()' - Rewrite the PDF file with the first page first.
+//
+// All of the objects have already been written to the PDF file once.  This
+// function writes a new file containing the linearization dictionary, the
+// first page cross-reference table, the catalog, the hint stream, and the
+// objects used by the first page, followed by the remaining pages and their
+// objects, the objects shared between pages, all other objects, and the main
+// cross-reference table.  Objects are renumbered so that the first page
+// objects come last, and the new file replaces the original.
+//
+
+static bool				// O - `true` on success, `false` on failure
+write_linearized(pdfio_file_t *pdf)	// I - PDF file
+{
+  bool		ret = false;		// Return value
+  _pdfio_linear_t lin;			// Linearization data
+  size_t	i,			// Looping var
+		j,			// Looping var
+		p,			// Current page
+		*temp,			// Temporary references
+		count,			// Number of objects
+		min_objs,		// Least number of objects in a page
+		max_objs,		// Greatest number of objects in a page
+		max_refs,		// Greatest number of shared references in a page
+		num_entries,		// Number of shared object hint entries
+		hint_psize,		// Size of page offset hint table
+		hint_size,		// Size of hint stream data
+		bitpos;			// Bit position in hint stream data
+  int		bits_objs,		// Bits for number of objects in a page
+		bits_refs,		// Bits for number of shared references
+		bits_ids;		// Bits for shared object identifiers
+  off_t		hint_data,		// Offset of hint stream data
+		length,			// Length of page or object
+		min_length;		// Least length of page or object
+  unsigned char	*hint = NULL;		// Hint stream data
+  int		fd;			// New PDF file
+  char		tempfile[1024];		// New PDF filename
+
+
+  // pdfioFileSetLinearized and pdfioFileSetObjectStreams prevent this, but
+  // don't quietly write a non-linearized file if it happens anyways...
+  for (i = 0; i < pdf->num_objs; i ++)
+  {
+    if (pdf->objs[i]->objstm)
+    {
+      _pdfioFileError(pdf, "Linearized PDF files cannot use compressed object streams.");
+      return (false);
+    }
+  }
+
+  // Write a normal PDF file if there are no pages or the object numbers
+  // don't match their positions...
+  if (pdf->num_pages == 0)
+    return (write_trailer(pdf));
+
+  for (i = 0; i < pdf->num_objs; i ++)
+  {
+    if (pdf->objs[i]->number != (i + 1))
+      return (write_trailer(pdf));
+  }
+
+  // Allocate memory...
+  memset(&lin, 0, sizeof(lin));
+
+  lin.fd        = -1;
+  lin.num_objs  = pdf->num_objs;
+  lin.num_pages = pdf->num_pages;
+  tempfile[0]   = '\0';
+
+  if ((lin.usage = (size_t *)calloc(lin.num_objs, sizeof(size_t))) == NULL || (lin.marks = (size_t *)calloc(lin.num_objs, sizeof(size_t))) == NULL || (lin.stack = (size_t *)calloc(lin.num_objs, sizeof(size_t))) == NULL || (lin.order = (size_t *)calloc(lin.num_objs, sizeof(size_t))) == NULL || (lin.page_start = (size_t *)calloc(lin.num_pages + 1, sizeof(size_t))) == NULL || (lin.page_refs = (size_t *)calloc(lin.num_pages, sizeof(size_t))) == NULL || (lin.offsets = (off_t *)calloc(lin.num_objs + 1, sizeof(off_t))) == NULL || (pdf->renumber = (size_t *)calloc(lin.num_objs + 1, sizeof(size_t))) == NULL)
+  {
+    _pdfioFileError(pdf, "Unable to allocate memory for linearization.");
+    goto done;
+  }
+
+  // Find the objects used by each page, starting with the first page.  The
+  // usage value is the page number (starting at 1) for objects used by a
+  // single page, and objects used by the first page stay with it...
+  for (p = 0; p < lin.num_pages; p ++)
+  {
+    i             = pdf->pages[p]->number - 1;
+    lin.marks[i]  = p + 1;
+    lin.stack[0]  = i;
+    lin.num_stack = 1;
+
+    while (lin.num_stack > 0)
+    {
+      i = lin.stack[-- lin.num_stack];
+
+      if (!lin.usage[i])
+        lin.usage[i] = p + 1;
+      else if (lin.usage[i] != 1 && lin.usage[i] != (p + 1))
+        lin.usage[i] = _PDFIO_SHARED_OBJ;
+
+      scan_refs(pdf, &lin, &pdf->objs[i]->value, p + 1);
+    }
+  }
+
+  // Put the objects in order: the catalog, the first page objects, the
+  // objects for each of the remaining pages starting with the page object,
+  // the shared objects, and then everything else...
+  count = 0;
+  lin.order[count ++] = pdf->root_obj->number - 1;
+  lin.order[count ++] = pdf->pages[0]->number - 1;
+
+  for (i = 0; i < lin.num_objs; i ++)
+  {
+    if (lin.usage[i] == 1 && pdf->objs[i] != pdf->pages[0])
+      lin.order[count ++] = i;
+    else if (lin.usage[i] > 1 && lin.usage[i] != _PDFIO_SHARED_OBJ)
+      lin.page_start[lin.usage[i] - 1] ++;
+  }
+
+  lin.num_first     = count;
+  lin.page_start[0] = 1;
+
+  for (p = 1; p < lin.num_pages; p ++)
+  {
+    // Convert the object count to a starting position, using the reference
+    // count as the next position until the references are counted below...
+    j                 = lin.page_start[p];
+    lin.page_start[p] = count;
+    lin.order[count]  = pdf->pages[p]->number - 1;
+    lin.page_refs[p]  = count + 1;
+    count             += j;
+  }
+
+  lin.page_start[lin.num_pages] = lin.shared_start = count;
+
+  for (i = 0; i < lin.num_objs; i ++)
+  {
+    if (lin.usage[i] > 1 && lin.usage[i] != _PDFIO_SHARED_OBJ && pdf->objs[i] != pdf->pages[lin.usage[i] - 1])
+      lin.order[lin.page_refs[lin.usage[i] - 1] ++] = i;
+  }
+
+  for (i = 0; i < lin.num_objs; i ++)
+  {
+    if (lin.usage[i] == _PDFIO_SHARED_OBJ)
+      lin.order[count ++] = i;
+  }
+
+  lin.other_start = count;
+
+  for (i = 0; i < lin.num_objs; i ++)
+  {
+    if (!lin.usage[i] && pdf->objs[i] != pdf->root_obj)
+      lin.order[count ++] = i;
+  }
+
+  // Number the objects in the main section starting at 1, followed by the
+  // linearization dictionary, hint stream, catalog, and first page objects...
+  lin.num_main = lin.num_objs - lin.num_first;
+
+  for (j = 0; j < lin.num_objs; j ++)
+  {
+    if (j < lin.num_first)
+      pdf->renumber[lin.order[j] + 1] = lin.num_main + 3 + j;
+    else
+      pdf->renumber[lin.order[j] + 1] = j - lin.num_first + 1;
+  }
+
+  // Find the shared objects used by the remaining pages.  Each object in the
+  // first page section and shared object section is identified by its
+  // position in those sections...
+  for (p = 1; p < lin.num_pages; p ++)
+  {
+    i                = pdf->pages[p]->number - 1;
+    lin.marks[i]     = lin.num_pages + p + 1;
+    lin.stack[0]     = i;
+    lin.num_stack    = 1;
+    lin.page_refs[p] = 0;
+
+    while (lin.num_stack > 0)
+    {
+      i = lin.stack[-- lin.num_stack];
+
+      if (lin.usage[i] == 1 || lin.usage[i] == _PDFIO_SHARED_OBJ)
+      {
+        if (lin.num_refs >= lin.alloc_refs)
+        {
+          if ((temp = (size_t *)realloc(lin.refs, (lin.alloc_refs + 1024) * sizeof(size_t))) == NULL)
+          {
+	    _pdfioFileError(pdf, "Unable to allocate memory for linearization.");
+	    goto done;
+          }
+
+          lin.refs       = temp;
+          lin.alloc_refs += 1024;
+        }
+
+        if (lin.usage[i] == 1)
+          lin.refs[lin.num_refs ++] = pdf->renumber[i + 1] - lin.num_main - 4;
+        else
+          lin.refs[lin.num_refs ++] = lin.num_first - 1 + pdf->renumber[i + 1] - 1 + lin.num_first - lin.shared_start;
+
+        lin.page_refs[p] ++;
+      }
+
+      scan_refs(pdf, &lin, &pdf->objs[i]->value, lin.num_pages + p + 1);
+    }
+  }
+
+  // Figure out the size of the hint tables...
+  min_objs = max_objs = lin.num_first - 1;
+  max_refs = 0;
+
+  for (p = 1; p < lin.num_pages; p ++)
+  {
+    count = lin.page_start[p + 1] - lin.page_start[p];
+
+    if (count < min_objs)
+      min_objs = count;
+    if (count > max_objs)
+      max_objs = count;
+    if (lin.page_refs[p] > max_refs)
+      max_refs = lin.page_refs[p];
+  }
+
+  num_entries = lin.num_first - 1 + lin.other_start - lin.shared_start;
+  bits_objs   = get_num_bits(max_objs - min_objs);
+  bits_refs   = get_num_bits(max_refs);
+  bits_ids    = get_num_bits(num_entries - 1);
+  hint_psize  = 36 + (lin.num_pages * (size_t)bits_objs + 7) / 8 + 8 * lin.num_pages + (lin.num_pages * (size_t)bits_refs + 7) / 8 + (lin.num_refs * (size_t)bits_ids + 7) / 8;
+  hint_size   = hint_psize + 24 + 4 * num_entries + (num_entries + 7) / 8;
+
+  if ((hint = (unsigned char *)calloc(1, hint_size)) == NULL)
+  {
+    _pdfioFileError(pdf, "Unable to allocate memory for linearization.");
+    goto done;
+  }
+
+  // Create the new PDF file and open the original file for reading...
+  if (snprintf(tempfile, sizeof(tempfile), "%s.tmp", pdf->filename) >= (int)sizeof(tempfile))
+  {
+    _pdfioFileError(pdf, "Filename is too long to linearize.");
+    tempfile[0] = '\0';
+    goto done;
+  }
+
+  if (!_pdfioFileFlush(pdf))
+  {
+    tempfile[0] = '\0';
+    goto done;
+  }
+
+  if ((lin.fd = open(pdf->filename, O_RDONLY | O_BINARY)) < 0)
+  {
+    _pdfioFileError(pdf, "Unable to open '%s' for linearization: %s", pdf->filename, strerror(errno));
+    tempfile[0] = '\0';
+    goto done;
+  }
+
+  if ((fd = open(tempfile, O_WRONLY | O_BINARY | O_CREAT | O_TRUNC, 0666)) < 0)
+  {
+    _pdfioFileError(pdf, "Unable to create '%s': %s", tempfile, strerror(errno));
+    tempfile[0] = '\0';
+    goto done;
+  }
+
+  close(pdf->fd);
+
+  pdf->fd     = fd;
+  pdf->bufpos = 0;
+  pdf->bufptr = pdf->buffer;
+
+  // Write the header, linearization dictionary, first page cross-reference
+  // table, catalog, and an empty hint stream...
+  if (!_pdfioFilePrintf(pdf, "%%PDF-%s\n%%\342\343\317\323\n", pdf->version))
+    goto done;
+
+  lin.lin_offset = _pdfioFileTell(pdf);
+
+  if (!write_linear_header(pdf, &lin) || !write_linear_obj(pdf, &lin, pdf->root_obj))
+    goto done;
 
-      PDFIO_DEBUG("repair_xref: line=\"%s\"\n", line);
+  lin.offsets[0]  = pdf->root_obj->offset;
+  lin.hint_offset = _pdfioFileTell(pdf);
 
-      if (line[7])
-      {
-	// Probably the start of the trailer dictionary, rewind the file so
-	// we can read it...
-	_pdfioFileSeek(pdf, line_offset + 7, SEEK_SET);
-      }
+  if (!_pdfioFilePrintf(pdf, "%lu 0 obj\n<</Length %lu/S %lu>>\nstream\n", (unsigned long)(lin.num_main + 2), (unsigned long)hint_size, (unsigned long)hint_psize))
+    goto done;
 
-      PDFIO_DEBUG("repair_xref: TRAILER at offset %ld\n", (long)line_offset);
+  hint_data = _pdfioFileTell(pdf);
 
-      _pdfioTokenInit(&tb, pdf, (_pdfio_tconsume_cb_t)_pdfioFileConsume, (_pdfio_tpeek_cb_t)_pdfioFilePeek, pdf);
-      if (!_pdfioValueRead(pdf, NULL, &tb, &trailer, 0))
-      {
-	_pdfioFileError(pdf, "Unable to read cross-reference stream dictionary.");
-	return (false);
-      }
-      else if (trailer.type != PDFIO_VALTYPE_DICT)
-      {
-	_pdfioFileError(pdf, "Trailer is not a dictionary.");
-	return (false);
-      }
+  if (!_pdfioFileWrite(pdf, hint, hint_size) || !_pdfioFilePuts(pdf, "\nendstream\nendobj\n"))
+    goto done;
 
-      _pdfioTokenFlush(&tb);
+  lin.hint_length = _pdfioFileTell(pdf) - lin.hint_offset;
 
-      if (_pdfioDictGetValue(trailer.value.dict, "Root"))
-      {
-	// Save the trailer dictionary and grab the root (catalog) and info
-	// objects...
-	PDFIO_DEBUG("repair_xref: Using this trailer dictionary.\n");
+  // Then the rest of the objects...
+  for (j = 1; j < lin.num_objs; j ++)
+  {
+    if (!write_linear_obj(pdf, &lin, pdf->objs[lin.order[j]]))
+      goto done;
 
-	pdf->trailer_dict = trailer.value.dict;
-	pdf->encrypt_obj  = pdfioDictGetObj(pdf->trailer_dict, "Encrypt");
-	pdf->id_array     = pdfioDictGetArray(pdf->trailer_dict, "ID");
-      }
-    }
+    lin.offsets[j] = pdf->objs[lin.order[j]]->offset;
+  }
 
-    // Get the offset for the next line...
-    line_offset = _pdfioFileTell(pdf);
+  // Write the main cross-reference table and trailer...
+  lin.main_offset = lin.offsets[lin.num_objs] = _pdfioFileTell(pdf);
+
+  if (!_pdfioFilePrintf(pdf, "xref\n0 %lu \n", (unsigned long)(lin.num_main + 1)))
+    goto done;
+
+  lin.main_entry = _pdfioFileTell(pdf) - 1;
+
+  if (!_pdfioFilePuts(pdf, "0000000000 65535 f \n"))
+    goto done;
+
+  for (j = lin.num_first; j < lin.num_objs; j ++)
+  {
+    if (!_pdfioFilePrintf(pdf, "%010lu %05u n \n", (unsigned long)lin.offsets[j], pdf->objs[lin.order[j]]->generation))
+      goto done;
   }
 
-  PDFIO_DEBUG("repair_xref: Stopped at line_offset=%lu\n", (unsigned long)line_offset);
+  if (!_pdfioFilePrintf(pdf, "trailer\n<</Size %lu>>\nstartxref\n%lu\n%%%%EOF\n", (unsigned long)(lin.num_objs + 3), (unsigned long)lin.xref_offset))
+    goto done;
 
-  if (!pdf->trailer_dict && backup_trailer)
-    pdf->trailer_dict = backup_trailer;
+  lin.file_length = _pdfioFileTell(pdf);
 
-  // If the trailer contains an Encrypt key, try unlocking the file...
-  if (pdf->encrypt_obj && !_pdfioCryptoUnlock(pdf, password_cb, password_data))
-    return (false);
+  // Fill in the page offset hint table.  Offsets in the hint tables do not
+  // include the hint stream, and the content stream offsets and lengths
+  // are the same as the page offsets and lengths...
+  for (p = 0, min_length = 0; p < lin.num_pages; p ++)
+  {
+    length = lin.offsets[lin.page_start[p + 1]] - lin.offsets[lin.page_start[p]];
 
-  // Load any stream objects...
-  PDFIO_DEBUG("repair_xref: Found %lu stream objects.\n", (unsigned long)num_sobjs);
+    if (p == 0 || length < min_length)
+      min_length = length;
+  }
 
-  for (i = 0; i < num_sobjs; i ++)
+  bitpos = 0;
+
+  put_hint(hint, &bitpos, min_objs, 32);
+  put_hint(hint, &bitpos, (size_t)(lin.offsets[1] - lin.hint_length), 32);
+  put_hint(hint, &bitpos, (size_t)bits_objs, 16);
+  put_hint(hint, &bitpos, (size_t)min_length, 32);
+  put_hint(hint, &bitpos, 32, 16);
+  put_hint(hint, &bitpos, 0, 32);
+  put_hint(hint, &bitpos, 0, 16);
+  put_hint(hint, &bitpos, (size_t)min_length, 32);
+  put_hint(hint, &bitpos, 32, 16);
+  put_hint(hint, &bitpos, (size_t)bits_refs, 16);
+  put_hint(hint, &bitpos, (size_t)bits_ids, 16);
+  put_hint(hint, &bitpos, 0, 16);
+  put_hint(hint, &bitpos, 1, 16);
+
+  for (p = 0; p < lin.num_pages; p ++)
+    put_hint(hint, &bitpos, lin.page_start[p + 1] - lin.page_start[p] - min_objs, bits_objs);
+
+  bitpos = (bitpos + 7) & ~(size_t)7;
+
+  for (p = 0; p < lin.num_pages; p ++)
+    put_hint(hint, &bitpos, (size_t)(lin.offsets[lin.page_start[p + 1]] - lin.offsets[lin.page_start[p]] - min_length), 32);
+
+  for (p = 0; p < lin.num_pages; p ++)
+    put_hint(hint, &bitpos, lin.page_refs[p], bits_refs);
+
+  bitpos = (bitpos + 7) & ~(size_t)7;
+
+  for (i = 0; i < lin.num_refs; i ++)
+    put_hint(hint, &bitpos, lin.refs[i], bits_ids);
+
+  bitpos = (bitpos + 7) & ~(size_t)7;
+
+  for (p = 0; p < lin.num_pages; p ++)
+    put_hint(hint, &bitpos, (size_t)(lin.offsets[lin.page_start[p + 1]] - lin.offsets[lin.page_start[p]] - min_length), 32);
+
+  // Then the shared object hint table, using one object per group...
+  for (j = 1, min_length = 0; j < lin.other_start; j ++)
   {
-    if (!load_obj_stream(sobjs[i]))
-      return (false);
+    if (j == lin.num_first)
+      j = lin.shared_start;
+
+    if (j >= lin.other_start)
+      break;
+
+    length = lin.offsets[j + 1] - lin.offsets[j];
+
+    if (j == 1 || length < min_length)
+      min_length = length;
   }
 
-  // Once we have all of the xref tables loaded, get the important objects and
-  // build the pages array...
-  pdf->info_obj = pdfioDictGetObj(pdf->trailer_dict, "Info");
+  put_hint(hint, &bitpos, lin.other_start > lin.shared_start ? pdf->renumber[lin.order[lin.shared_start] + 1] : 0, 32);
+  put_hint(hint, &bitpos, lin.other_start > lin.shared_start ? (size_t)(lin.offsets[lin.shared_start] - lin.hint_length) : 0, 32);
+  put_hint(hint, &bitpos, lin.num_first - 1, 32);
+  put_hint(hint, &bitpos, num_entries, 32);
+  put_hint(hint, &bitpos, 0, 16);
+  put_hint(hint, &bitpos, (size_t)min_length, 32);
+  put_hint(hint, &bitpos, 32, 16);
 
-  if ((pdf->root_obj = pdfioDictGetObj(pdf->trailer_dict, "Root")) == NULL)
+  for (j = 1; j < lin.other_start; j ++)
   {
-    _pdfioFileError(pdf, "Missing Root object.");
-    return (false);
+    if (j == lin.num_first)
+      j = lin.shared_start;
+
+    if (j >= lin.other_start)
+      break;
+
+    put_hint(hint, &bitpos, (size_t)(lin.offsets[j + 1] - lin.offsets[j] - min_length), 32);
   }
 
-  PDFIO_DEBUG("repair_xref: Root=%p(%lu)\n", (void *)pdf->root_obj, (unsigned long)pdf->root_obj->number);
+  // (No MD5 signatures, and the number of objects in each group is 1 so
+  // those values use 0 bits...)
+  bitpos += num_entries;
 
-  if ((pages_obj = pdfioDictGetObj(pdfioObjGetDict(pdf->root_obj), "Pages")) == NULL)
+  PDFIO_DEBUG("write_linearized: hint_size=%lu, bitpos=%lu\n", (unsigned long)hint_size, (unsigned long)bitpos);
+
+  // Write the hint stream data and the final linearization dictionary and
+  // first page cross-reference table...
+  if (_pdfioFileSeek(pdf, hint_data, SEEK_SET) < 0 || !_pdfioFileWrite(pdf, hint, hint_size) || _pdfioFileSeek(pdf, lin.lin_offset, SEEK_SET) < 0 || !write_linear_header(pdf, &lin) || !_pdfioFileFlush(pdf))
+    goto done;
+
+  // Close the files and replace the original file with the new one...
+  close(lin.fd);
+  lin.fd = -1;
+
+  close(pdf->fd);
+  pdf->fd = -1;
+
+#ifdef _WIN32
+  // Windows does not replace existing files...
+  remove(pdf->filename);
+#endif // _WIN32
+
+  if (rename(tempfile, pdf->filename))
   {
-    _pdfioFileError(pdf, "Missing Pages object.");
-    return (false);
+    _pdfioFileError(pdf, "Unable to replace '%s': %s", pdf->filename, strerror(errno));
+    goto done;
   }
 
-  PDFIO_DEBUG("repair_xref: Pages=%p(%lu)\n", (void *)pages_obj, (unsigned long)pages_obj->number);
+  ret = true;
 
-  // Load pages...
-  return (load_pages(pdf, pages_obj, 0));
+  // Free memory and return...
+  done:
+
+  if (lin.fd >= 0)
+    close(lin.fd);
+
+  if (!ret && tempfile[0])
+    remove(tempfile);
+
+  free(lin.usage);
+  free(lin.marks);
+  free(lin.stack);
+  free(lin.order);
+  free(lin.page_start);
+  free(lin.page_refs);
+  free(lin.refs);
+  free(lin.offsets);
+  free(hint);
+
+  free(pdf->renumber);
+  pdf->renumber = NULL;
+
+  return (ret);
 }
 
 
@@ -2828,6 +4730,66 @@ write_metadata(pdfio_file_t *pdf)	// I - PDF file
 }
 
 
+//
+// 'write_objstm()' - Write the current compressed object stream, if any.
+//
+
+static bool				// O - `true` on success, `false` on failure
+write_objstm(pdfio_file_t *pdf)		// I - PDF file
+{
+  _pdfio_objstm_t	*objstm = pdf->objstm;
+					// Compressed object stream
+  size_t		i,		// Looping var
+			first;		// Offset of first object
+  char			pair[64];	// Object number/offset pair
+  pdfio_stream_t	*st;		// Stream
+
+
+  // Don't write anything if there are no objects...
+  if (!objstm || !objstm->num_objs)
+    return (true);
+
+  PDFIO_DEBUG("write_objstm(pdf=%p), num_objs=%lu, datalen=%lu\n", (void *)pdf, (unsigned long)objstm->num_objs, (unsigned long)objstm->datalen);
+
+  // Figure out where the first object starts after the object number/offset
+  // pairs...
+  for (i = 0, first = 0; i < objstm->num_objs; i ++)
+    first += (size_t)snprintf(pair, sizeof(pair), "%lu %lu\n", (unsigned long)objstm->objs[i]->number, (unsigned long)objstm->offsets[i]);
+
+  // Write the object stream...
+  pdfioDictSetNumber(objstm->obj->value.value.dict, "N", (double)objstm->num_objs);
+  pdfioDictSetNumber(objstm->obj->value.value.dict, "First", (double)first);
+
+  if ((st = pdfioObjCreateStream(objstm->obj, PDFIO_FILTER_FLATE)) == NULL)
+    return (false);
+
+  for (i = 0; i < objstm->num_objs; i ++)
+  {
+    if (!pdfioStreamPrintf(st, "%lu %lu\n", (unsigned long)objstm->objs[i]->number, (unsigned long)objstm->offsets[i]))
+    {
+      pdfioStreamClose(st);
+      return (false);
+    }
+  }
+
+  if (!pdfioStreamWrite(st, objstm->data, objstm->datalen))
+  {
+    pdfioStreamClose(st);
+    return (false);
+  }
+
+  if (!pdfioStreamClose(st))
+    return (false);
+
+  // Start a new object stream as needed...
+  objstm->obj      = NULL;
+  objstm->num_objs = 0;
+  objstm->datalen  = 0;
+
+  return (true);
+}
+
+
 //
 // 'write_pages()' - Write the PDF pages objects.
 //
@@ -2836,21 +4798,101 @@ static bool				// O - `true` on success, `false` on failure
 write_pages(pdfio_file_t *pdf)		// I - PDF file
 {
   pdfio_array_t	*kids;			// Pages array
-  size_t	i;			// Looping var
+  size_t	i,			// Looping var
+		j,			// Looping var
+		count,			// Number of pages in node
+		num_nodes,		// Number of nodes in current level
+		num_parents;		// Number of nodes in parent level
+  pdfio_obj_t	**nodes,		// Nodes in current level
+		*parent;		// Parent node
+  pdfio_dict_t	*dict;			// Parent node dictionary
+
+
+  // Simple case: all of the pages fit in the Pages object...
+  if (pdf->num_page_nodes <= 1)
+  {
+    // Build the "Kids" array pointing to each page...
+    if ((kids = pdfioArrayCreate(pdf)) == NULL)
+      return (false);
+
+    for (i = 0; i < pdf->num_pages; i ++)
+      pdfioArrayAppendObj(kids, pdf->pages[i]);
+
+    pdfioDictSetNumber(pdf->pages_obj->value.value.dict, "Count", (double)pdf->num_pages);
+    pdfioDictSetArray(pdf->pages_obj->value.value.dict, "Kids", kids);
+
+    // Write the Pages object...
+    return (pdfioObjClose(pdf->pages_obj));
+  }
+
+  // Otherwise fill in the leaf nodes...
+  for (i = 0; i < pdf->num_page_nodes; i ++)
+  {
+    if ((kids = pdfioArrayCreate(pdf)) == NULL)
+      return (false);
+
+    for (j = i * _PDFIO_PAGES_MAX, count = 0; j < pdf->num_pages && count < _PDFIO_PAGES_MAX; j ++, count ++)
+      pdfioArrayAppendObj(kids, pdf->pages[j]);
 
+    pdfioDictSetNumber(pdf->page_nodes[i]->value.value.dict, "Count", (double)count);
+    pdfioDictSetArray(pdf->page_nodes[i]->value.value.dict, "Kids", kids);
+  }
 
-  // Build the "Kids" array pointing to each page...
-  if ((kids = pdfioArrayCreate(pdf)) == NULL)
+  // Then build the upper levels of the tree until there is a single root
+  // node...
+  if ((nodes = (pdfio_obj_t **)malloc(pdf->num_page_nodes * sizeof(pdfio_obj_t *))) == NULL)
+  {
+    _pdfioFileError(pdf, "Unable to allocate memory for pages.");
     return (false);
+  }
+
+  memcpy(nodes, pdf->page_nodes, pdf->num_page_nodes * sizeof(pdfio_obj_t *));
+
+  for (num_nodes = pdf->num_page_nodes; num_nodes > 1; num_nodes = num_parents)
+  {
+    for (i = 0, num_parents = 0; i < num_nodes; i += _PDFIO_PAGES_MAX, num_parents ++)
+    {
+      if ((dict = pdfioDictCreate(pdf)) == NULL || (kids = pdfioArrayCreate(pdf)) == NULL)
+        goto error;
+
+      pdfioDictSetName(dict, "Type", "Pages");
+
+      if ((parent = pdfioFileCreateObj(pdf, dict)) == NULL)
+        goto error;
+
+      for (j = i, count = 0; j < num_nodes && j < (i + _PDFIO_PAGES_MAX); j ++)
+      {
+        pdfioArrayAppendObj(kids, nodes[j]);
+        pdfioDictSetObj(nodes[j]->value.value.dict, "Parent", parent);
+        count += (size_t)pdfioDictGetNumber(nodes[j]->value.value.dict, "Count");
+
+        if (!pdfioObjClose(nodes[j]))
+          goto error;
+      }
+
+      pdfioDictSetNumber(dict, "Count", (double)count);
+      pdfioDictSetArray(dict, "Kids", kids);
+
+      nodes[num_parents] = parent;
+    }
+  }
+
+  // Point the catalog at the root node and write it...
+  pdfioDictSetObj(pdf->root_obj->value.value.dict, "Pages", nodes[0]);
+
+  if (!pdfioObjClose(nodes[0]))
+    goto error;
+
+  free(nodes);
+
+  return (true);
 
-  for (i = 0; i < pdf->num_pages; i ++)
-    pdfioArrayAppendObj(kids, pdf->pages[i]);
+  // If we get here something went wrong...
+  error:
 
-  pdfioDictSetNumber(pdf->pages_obj->value.value.dict, "Count", (double)pdf->num_pages);
-  pdfioDictSetArray(pdf->pages_obj->value.value.dict, "Kids", kids);
+  free(nodes);
 
-  // Write the Pages object...
-  return (pdfioObjClose(pdf->pages_obj));
+  return (false);
 }
 
 
@@ -2863,42 +4905,69 @@ write_trailer(pdfio_file_t *pdf)	// I - PDF file
 {
   bool		ret = true;		// Return value
   off_t		xref_offset;		// Offset to xref table
-  size_t	i;			// Looping var
+  size_t	i,			// Looping var
+		j,			// Looping var
+		size;			// Number of object entries
   pdfio_obj_t	*obj;			// Current object
+  bool		use_stream;		// Write a cross-reference stream?
 
 
   // Write the xref table...
   xref_offset = _pdfioFileTell(pdf);
+  size        = pdf->objs[pdf->num_objs - 1]->number + 1;
+
+  if (pdf->update_pdf)
+    use_stream = pdf->xref_stream;	// Match the original file
+  else
+    use_stream = strcmp(pdf->version, "1.5") >= 0 && !pdf->output_cb;
 
-  if (strcmp(pdf->version, "1.5") >= 0 && !pdf->output_cb)
+  if (use_stream)
   {
     // Write a cross-reference stream...
     pdfio_dict_t	*xref_dict;	// Object dictionary
-    pdfio_array_t	*w_array;	// W array
+    pdfio_array_t	*w_array,	// W array
+			*index_array;	// Index array
     pdfio_obj_t		*xref_obj;	// Object
     pdfio_stream_t	*xref_st;	// Stream
-    int			offsize;	// Size of object offsets
-    unsigned char	buffer[10];	// Buffer entry
+    int			offsize,	// Size of object offsets
+			gensize;	// Size of generation numbers/indices
+    off_t		maxoffset,	// Maximum offset/object number
+			offset;		// Offset/object number
+    size_t		field;		// Generation number/index
+    unsigned char	buffer[11];	// Buffer entry
     pdfio_encryption_t	encryption;	// PDF encryption mode
 
     // Disable encryption while we write the xref stream...
     encryption      = pdf->encryption;
     pdf->encryption = PDFIO_ENCRYPTION_NONE;
 
-    // Figure out how many bytes are needed for the object numbers
-    if (xref_offset < 0xff)
+    // Figure out how many bytes are needed for the object offsets and numbers
+    // and the indices of compressed objects...
+    maxoffset = xref_offset;
+    gensize   = 1;
+
+    if (maxoffset < (off_t)size + 1)
+      maxoffset = (off_t)size + 1;
+
+    for (i = 0; i < pdf->num_objs; i ++)
+    {
+      if ((pdf->objs[i]->objstm && pdf->objs[i]->objstm_index > 255) || pdf->objs[i]->generation > 255)
+        gensize = 2;
+    }
+
+    if (maxoffset < 0xff)
       offsize = 1;
-    else if (xref_offset < 0xffff)
+    else if (maxoffset < 0xffff)
       offsize = 2;
-    else if (xref_offset < 0xffffff)
+    else if (maxoffset < 0xffffff)
       offsize = 3;
-    else if (xref_offset < 0xffffffff)
+    else if (maxoffset < 0xffffffff)
       offsize = 4;
-    else if (xref_offset < 0xffffffffff)
+    else if (maxoffset < 0xffffffffff)
       offsize = 5;
-    else if (xref_offset < 0xffffffffffff)
+    else if (maxoffset < 0xffffffffffff)
       offsize = 6;
-    else if (xref_offset < 0xffffffffffffff)
+    else if (maxoffset < 0xffffffffffffff)
       offsize = 7;
     else
       offsize = 8;
@@ -2913,7 +4982,7 @@ write_trailer(pdfio_file_t *pdf)	// I - PDF file
 
     pdfioArrayAppendNumber(w_array, 1);
     pdfioArrayAppendNumber(w_array, offsize);
-    pdfioArrayAppendNumber(w_array, 1);
+    pdfioArrayAppendNumber(w_array, gensize);
 
     if ((xref_dict = pdfioDictCreate(pdf)) == NULL)
     {
@@ -2923,7 +4992,7 @@ write_trailer(pdfio_file_t *pdf)	// I - PDF file
     }
 
     pdfioDictSetName(xref_dict, "Type", "XRef");
-    pdfioDictSetNumber(xref_dict, "Size", (double)(pdf->num_objs + 2));
+    pdfioDictSetNumber(xref_dict, "Size", (double)(size + 1));
     pdfioDictSetArray(xref_dict, "W", w_array);
     pdfioDictSetName(xref_dict, "Filter", "FlateDecode");
     pdfioDictSetObj(xref_dict, "Info", pdf->info_obj);
@@ -2942,6 +5011,42 @@ write_trailer(pdfio_file_t *pdf)	// I - PDF file
       goto done;
     }
 
+    if (pdf->update_pdf)
+    {
+      // Only list the updated objects, including the cross-reference stream
+      // itself, and point back to the original cross-reference...
+      if ((index_array = pdfioArrayCreate(pdf)) == NULL)
+      {
+	_pdfioFileError(pdf, "Unable to write cross-reference table.");
+	ret = false;
+	goto done;
+      }
+
+      for (i = 0; i < pdf->num_objs; i = j)
+      {
+        for (j = i; j < pdf->num_objs; j ++)
+        {
+          obj = pdf->objs[j];
+
+          if ((obj->offset < pdf->update_offset && !obj->objstm && obj != xref_obj) || (j > i && obj->number != pdf->objs[j - 1]->number + 1))
+            break;
+        }
+
+        if (j > i)
+        {
+          pdfioArrayAppendNumber(index_array, (double)pdf->objs[i]->number);
+          pdfioArrayAppendNumber(index_array, (double)(j - i));
+        }
+        else
+        {
+          j ++;
+        }
+      }
+
+      pdfioDictSetArray(xref_dict, "Index", index_array);
+      pdfioDictSetNumber(xref_dict, "Prev", (double)pdf->xref_offset);
+    }
+
     if ((xref_st = pdfioObjCreateStream(xref_obj, PDFIO_FILTER_FLATE)) == NULL)
     {
       _pdfioFileError(pdf, "Unable to write cross-reference table.");
@@ -2949,79 +5054,108 @@ write_trailer(pdfio_file_t *pdf)	// I - PDF file
       goto done;
     }
 
-    // Write the "free" 0 object...
-    memset(buffer, 0, sizeof(buffer));
-    pdfioStreamWrite(xref_st, buffer, (size_t)offsize + 2);
+    if (!pdf->update_pdf)
+    {
+      // Write the "free" 0 object...
+      memset(buffer, 0, sizeof(buffer));
+      pdfioStreamWrite(xref_st, buffer, (size_t)(offsize + gensize + 1));
+    }
 
     // Then write the "allocated" objects...
-    buffer[0] = 1;
-
     for (i = 0; i < pdf->num_objs; i ++)
     {
       obj = pdf->objs[i];		// Current object
 
+      if (pdf->update_pdf && obj->offset < pdf->update_offset && !obj->objstm)
+        continue;			// Skip original objects
+
+      if (obj->objstm)
+      {
+        // Compressed object: object stream number and index...
+        buffer[0] = 2;
+        offset    = (off_t)obj->objstm->number;
+        field     = obj->objstm_index;
+      }
+      else
+      {
+        // Regular object: offset and generation...
+        buffer[0] = 1;
+        offset    = obj->offset;
+        field     = obj->generation;
+      }
+
+      if (gensize == 2)
+      {
+        buffer[offsize + 1] = (field >> 8) & 255;
+        buffer[offsize + 2] = field & 255;
+      }
+      else
+      {
+        buffer[offsize + 1] = field & 255;
+      }
+
       switch (offsize)
       {
         case 1 :
-            buffer[1] = obj->offset & 255;
+            buffer[1] = offset & 255;
             break;
         case 2 :
-            buffer[1] = (obj->offset >> 8) & 255;
-            buffer[2] = obj->offset & 255;
+            buffer[1] = (offset >> 8) & 255;
+            buffer[2] = offset & 255;
             break;
         case 3 :
-            buffer[1] = (obj->offset >> 16) & 255;
-            buffer[2] = (obj->offset >> 8) & 255;
-            buffer[3] = obj->offset & 255;
+            buffer[1] = (offset >> 16) & 255;
+            buffer[2] = (offset >> 8) & 255;
+            buffer[3] = offset & 255;
             break;
 #ifdef _WIN32
 	default :
 #endif // _WIN32
         case 4 :
-            buffer[1] = (obj->offset >> 24) & 255;
-            buffer[2] = (obj->offset >> 16) & 255;
-            buffer[3] = (obj->offset >> 8) & 255;
-            buffer[4] = obj->offset & 255;
+            buffer[1] = (offset >> 24) & 255;
+            buffer[2] = (offset >> 16) & 255;
+            buffer[3] = (offset >> 8) & 255;
+            buffer[4] = offset & 255;
             break;
 #ifndef _WIN32 // Windows off_t is 32-bits?!?
         case 5 :
-            buffer[1] = (obj->offset >> 32) & 255;
-            buffer[2] = (obj->offset >> 24) & 255;
-            buffer[3] = (obj->offset >> 16) & 255;
-            buffer[4] = (obj->offset >> 8) & 255;
-            buffer[5] = obj->offset & 255;
+            buffer[1] = (offset >> 32) & 255;
+            buffer[2] = (offset >> 24) & 255;
+            buffer[3] = (offset >> 16) & 255;
+            buffer[4] = (offset >> 8) & 255;
+            buffer[5] = offset & 255;
             break;
         case 6 :
-            buffer[1] = (obj->offset >> 40) & 255;
-            buffer[2] = (obj->offset >> 32) & 255;
-            buffer[3] = (obj->offset >> 24) & 255;
-            buffer[4] = (obj->offset >> 16) & 255;
-            buffer[5] = (obj->offset >> 8) & 255;
-            buffer[6] = obj->offset & 255;
+            buffer[1] = (offset >> 40) & 255;
+            buffer[2] = (offset >> 32) & 255;
+            buffer[3] = (offset >> 24) & 255;
+            buffer[4] = (offset >> 16) & 255;
+            buffer[5] = (offset >> 8) & 255;
+            buffer[6] = offset & 255;
             break;
         case 7 :
-            buffer[1] = (obj->offset >> 48) & 255;
-            buffer[2] = (obj->offset >> 40) & 255;
-            buffer[3] = (obj->offset >> 32) & 255;
-            buffer[4] = (obj->offset >> 24) & 255;
-            buffer[5] = (obj->offset >> 16) & 255;
-            buffer[6] = (obj->offset >> 8) & 255;
-            buffer[7] = obj->offset & 255;
+            buffer[1] = (offset >> 48) & 255;
+            buffer[2] = (offset >> 40) & 255;
+            buffer[3] = (offset >> 32) & 255;
+            buffer[4] = (offset >> 24) & 255;
+            buffer[5] = (offset >> 16) & 255;
+            buffer[6] = (offset >> 8) & 255;
+            buffer[7] = offset & 255;
             break;
         default :
-            buffer[1] = (obj->offset >> 56) & 255;
-            buffer[2] = (obj->offset >> 48) & 255;
-            buffer[3] = (obj->offset >> 40) & 255;
-            buffer[4] = (obj->offset >> 32) & 255;
-            buffer[5] = (obj->offset >> 24) & 255;
-            buffer[6] = (obj->offset >> 16) & 255;
-            buffer[7] = (obj->offset >> 8) & 255;
-            buffer[8] = obj->offset & 255;
+            buffer[1] = (offset >> 56) & 255;
+            buffer[2] = (offset >> 48) & 255;
+            buffer[3] = (offset >> 40) & 255;
+            buffer[4] = (offset >> 32) & 255;
+            buffer[5] = (offset >> 24) & 255;
+            buffer[6] = (offset >> 16) & 255;
+            buffer[7] = (offset >> 8) & 255;
+            buffer[8] = offset & 255;
             break;
 #endif // !_WIN32
       }
 
-      if (!pdfioStreamWrite(xref_st, buffer, (size_t)offsize + 2))
+      if (!pdfioStreamWrite(xref_st, buffer, (size_t)(offsize + gensize + 1)))
       {
 	_pdfioFileError(pdf, "Unable to write cross-reference table.");
 	ret = false;
@@ -3036,23 +5170,70 @@ write_trailer(pdfio_file_t *pdf)	// I - PDF file
   else
   {
     // Write a cross-reference table...
-    if (!_pdfioFilePrintf(pdf, "xref\n0 %lu \n0000000000 65535 f \n", (unsigned long)pdf->num_objs + 1))
+    if (pdf->update_pdf)
     {
-      _pdfioFileError(pdf, "Unable to write cross-reference table.");
-      ret = false;
-      goto done;
-    }
+      // Only list the updated objects...
+      if (!_pdfioFilePuts(pdf, "xref\n"))
+      {
+	_pdfioFileError(pdf, "Unable to write cross-reference table.");
+	ret = false;
+	goto done;
+      }
 
-    for (i = 0; i < pdf->num_objs; i ++)
-    {
-      obj = pdf->objs[i];		// Current object
+      for (i = 0; i < pdf->num_objs; i = j)
+      {
+        for (j = i; j < pdf->num_objs; j ++)
+        {
+          if (pdf->objs[j]->offset < pdf->update_offset || (j > i && pdf->objs[j]->number != pdf->objs[j - 1]->number + 1))
+            break;
+        }
+
+        if (j == i)
+        {
+          j ++;
+          continue;
+        }
+
+        if (!_pdfioFilePrintf(pdf, "%lu %lu \n", (unsigned long)pdf->objs[i]->number, (unsigned long)(j - i)))
+        {
+	  _pdfioFileError(pdf, "Unable to write cross-reference table.");
+	  ret = false;
+	  goto done;
+        }
+
+        for (; i < j; i ++)
+        {
+	  obj = pdf->objs[i];		// Current object
 
-      if (!_pdfioFilePrintf(pdf, "%010lu %05u n \n", (unsigned long)obj->offset, obj->generation))
+	  if (!_pdfioFilePrintf(pdf, "%010lu %05u n \n", (unsigned long)obj->offset, obj->generation))
+	  {
+	    _pdfioFileError(pdf, "Unable to write cross-reference table.");
+	    ret = false;
+	    goto done;
+	  }
+        }
+      }
+    }
+    else
+    {
+      if (!_pdfioFilePrintf(pdf, "xref\n0 %lu \n0000000000 65535 f \n", (unsigned long)size))
       {
 	_pdfioFileError(pdf, "Unable to write cross-reference table.");
 	ret = false;
 	goto done;
       }
+
+      for (i = 0; i < pdf->num_objs; i ++)
+      {
+	obj = pdf->objs[i];		// Current object
+
+	if (!_pdfioFilePrintf(pdf, "%010lu %05u n \n", (unsigned long)obj->offset, obj->generation))
+	{
+	  _pdfioFileError(pdf, "Unable to write cross-reference table.");
+	  ret = false;
+	  goto done;
+	}
+      }
     }
 
     // Write the trailer...
@@ -3076,7 +5257,10 @@ write_trailer(pdfio_file_t *pdf)	// I - PDF file
       pdfioDictSetArray(pdf->trailer_dict, "ID", pdf->id_array);
     pdfioDictSetObj(pdf->trailer_dict, "Info", pdf->info_obj);
     pdfioDictSetObj(pdf->trailer_dict, "Root", pdf->root_obj);
-    pdfioDictSetNumber(pdf->trailer_dict, "Size", (double)(pdf->num_objs + 1));
+    pdfioDictSetNumber(pdf->trailer_dict, "Size", (double)size);
+
+    if (pdf->update_pdf)
+      pdfioDictSetNumber(pdf->trailer_dict, "Prev", (double)pdf->xref_offset);
 
     if (!_pdfioDictWrite(pdf->trailer_dict, NULL, NULL))
     {
@@ -10,6 +10,24 @@
 #include "pdfio-private.h"
 
 
+//
+// Local constants...
+//
+
+#define _PDFIO_MERGE_HASH_MAX	1000	// Maximum objects hashed per merged stream
+
+
+//
+// Local functions...
+//
+
+static pdfio_obj_t	*copy_merged_stream(pdfio_file_t *pdf, pdfio_obj_t *srcobj);
+static bool		copy_stream(pdfio_obj_t *dstobj, pdfio_obj_t *srcobj);
+static pdfio_stream_t	*create_stream(pdfio_obj_t *obj, pdfio_filter_t filter, int level, pdfio_zstrategy_t strategy, bool staged);
+static bool		hash_merged_obj(pdfio_obj_t *srcobj, _pdfio_sha256_t *sha256, size_t depth, size_t *count);
+static bool		hash_merged_value(pdfio_file_t *srcpdf, _pdfio_value_t *v, const char *skip, _pdfio_sha256_t *sha256, size_t depth, size_t *count);
+
+
 //
 // 'pdfioObjClose()' - Close an object, writing any data as needed to the PDF
 //                     file.
@@ -18,39 +36,52 @@
 bool					// O - `true` on success, `false` on failure
 pdfioObjClose(pdfio_obj_t *obj)		// I - Object
 {
+  bool	ret;				// Return value
+
+
   // Range check input
   if (!obj)
     return (false);
 
-  // Clear the current object pointer...
-  obj->pdf->current_obj = NULL;
-
   if (obj->pdf->mode != _PDFIO_MODE_WRITE)
   {
     // Nothing to do when reading
+    obj->pdf->current_obj = NULL;
     return (true);
   }
 
-  // Write what remains for the object...
-  if (!obj->offset)
+  if (obj->stream)
   {
-    // Write the object value
-    if (!_pdfioObjWriteHeader(obj))
-      return (false);
+    // Close the staged stream...
+    return (pdfioStreamClose(obj->stream));
+  }
 
-    // Write the "endobj" line...
-    return (_pdfioFilePuts(obj->pdf, "endobj\n"));
+  _pdfioFileLock(obj->pdf);
+
+  if (!obj->modified && (obj->offset || obj->objstm || (obj->pdf->update_pdf && obj->number <= obj->pdf->update_number)))
+  {
+    // Already closed
+    obj->pdf->current_obj = NULL;
+    ret                   = true;
   }
-  else if (obj->stream)
+  else if (obj->pdf->objstm && obj->generation == 0 && obj != obj->pdf->encrypt_obj && obj->pdf->encryption == PDFIO_ENCRYPTION_NONE)
   {
-    // Close the stream...
-    return (pdfioStreamClose(obj->stream));
+    // Add the object to the current compressed object stream...
+    obj->modified = false;
+    ret           = _pdfioFileAddCompressedObj(obj->pdf, obj);
   }
   else
   {
-    // Already closed
-    return (true);
+    // Write the object value and "endobj" line...
+    obj->pdf->current_obj = NULL;
+    obj->modified         = false;
+    obj->objstm           = NULL;
+    ret                   = _pdfioObjWriteHeader(obj) && _pdfioFilePuts(obj->pdf, "endobj\n");
   }
+
+  _pdfioFileUnlock(obj->pdf);
+
+  return (ret);
 }
 
 
@@ -63,10 +94,6 @@ pdfioObjCopy(pdfio_file_t *pdf,		// I - PDF file
              pdfio_obj_t  *srcobj)	// I - Object to copy
 {
   pdfio_obj_t	*dstobj;		// Destination object
-  pdfio_stream_t *srcst,		// Source stream
-		*dstst;			// Destination stream
-  char		buffer[32768];		// Copy buffer
-  ssize_t	bytes;			// Bytes read
 
 
   PDFIO_DEBUG("pdfioObjCopy(pdf=%p, srcobj=%p(%p))\n", (void *)pdf, (void *)srcobj, srcobj ? (void *)srcobj->pdf : NULL);
@@ -83,6 +110,10 @@ pdfioObjCopy(pdfio_file_t *pdf,		// I - PDF file
   if ((dstobj = _pdfioFileFindMappedObj(pdf, srcobj->pdf, srcobj->number)) != NULL)
     return (dstobj);			// Yes, return that one...
 
+  // Streams are shared between source files when merging...
+  if (pdf->merging && srcobj->stream_offset && srcobj->value.type == PDFIO_VALTYPE_DICT && pdf->merge_depth < PDFIO_MAX_DEPTH)
+    return (copy_merged_stream(pdf, srcobj));
+
   // Create the new object...
   if ((dstobj = _pdfioFileCreateObj(pdf, srcobj->pdf, NULL)) == NULL)
     return (NULL);
@@ -101,32 +132,7 @@ pdfioObjCopy(pdfio_file_t *pdf,		// I - PDF file
   if (srcobj->stream_offset)
   {
     // Copy stream data...
-    if ((srcst = pdfioObjOpenStream(srcobj, false)) == NULL)
-    {
-      pdfioObjClose(dstobj);
-      return (NULL);
-    }
-
-    if ((dstst = pdfioObjCreateStream(dstobj, PDFIO_FILTER_NONE)) == NULL)
-    {
-      pdfioStreamClose(srcst);
-      pdfioObjClose(dstobj);
-      return (NULL);
-    }
-
-    while ((bytes = pdfioStreamRead(srcst, buffer, sizeof(buffer))) > 0)
-    {
-      if (!pdfioStreamWrite(dstst, buffer, (size_t)bytes))
-      {
-        bytes = -1;
-        break;
-      }
-    }
-
-    pdfioStreamClose(srcst);
-    pdfioStreamClose(dstst);
-
-    if (bytes < 0)
+    if (!copy_stream(dstobj, srcobj))
       return (NULL);
   }
   else
@@ -137,75 +143,74 @@ pdfioObjCopy(pdfio_file_t *pdf,		// I - PDF file
 
 
 //
-// 'pdfioObjCreateStream()' - Create an object (data) stream for writing.
+// 'pdfioObjCreateFlateStream()' - Create a Flate-compressed object (data) stream
+//                                 using the specified compression level and
+//                                 strategy.
+//
+// This function creates a Flate-compressed stream like
+// @link pdfioObjCreateStream@ but allows the compression level and strategy
+// to be specified for the stream.  The "level" argument specifies a
+// compression level from `0` (no compression) to `9` (best compression), or
+// `-1` to use the file's default level.  The "strategy" argument specifies the
+// compression strategy to use, or `PDFIO_ZSTRATEGY_AUTO` to use the file's
+// default strategy.
+//
+// @since PDFio v1.7@
 //
 
 pdfio_stream_t *			// O - Stream or `NULL` on error
-pdfioObjCreateStream(
-    pdfio_obj_t    *obj,		// I - Object
-    pdfio_filter_t filter)		// I - Type of compression to apply
+pdfioObjCreateFlateStream(
+    pdfio_obj_t       *obj,		// I - Object
+    int               level,		// I - Compression level (`0` to `9`) or `-1` for default
+    pdfio_zstrategy_t strategy)		// I - Compression strategy
 {
-  pdfio_stream_t *st;			// Stream
-  pdfio_obj_t	*length_obj = NULL;	// Length object, if any
-
-
-  // Range check input
-  if (!obj || obj->pdf->mode != _PDFIO_MODE_WRITE || obj->value.type != PDFIO_VALTYPE_DICT)
-    return (NULL);
-
-  if (obj->offset)
+  if (obj && (level < -1 || level > 9))
   {
-    _pdfioFileError(obj->pdf, "Object has already been written.");
+    _pdfioFileError(obj->pdf, "Unsupported compression level %d.", level);
     return (NULL);
   }
 
-  if (filter != PDFIO_FILTER_NONE && filter != PDFIO_FILTER_FLATE)
+  if (obj && (strategy < PDFIO_ZSTRATEGY_AUTO || strategy > PDFIO_ZSTRATEGY_RLE))
   {
-    _pdfioFileError(obj->pdf, "Unsupported filter value for PDFioObjCreateStream.");
+    _pdfioFileError(obj->pdf, "Unsupported compression strategy %d.", (int)strategy);
     return (NULL);
   }
 
-  if (obj->pdf->current_obj)
-  {
-    _pdfioFileError(obj->pdf, "Another object (%u) is already open.", (unsigned)obj->pdf->current_obj->number);
-    return (NULL);
-  }
-
-  // Write the header...
-  if (!_pdfioDictGetValue(obj->value.value.dict, "Length"))
-  {
-    if (obj->pdf->output_cb)
-    {
-      // Streaming via an output callback, so add a placeholder length object
-      _pdfio_value_t	length_value;	// Length value
+  return (create_stream(obj, PDFIO_FILTER_FLATE, level, strategy, false));
+}
 
-      length_value.type         = PDFIO_VALTYPE_NUMBER;
-      length_value.value.number = 0.0f;
 
-      length_obj = _pdfioFileCreateObj(obj->pdf, obj->pdf, &length_value);
-      pdfioDictSetObj(obj->value.value.dict, "Length", length_obj);
-    }
-    else
-    {
-      // Need a Length key for the stream, add a placeholder that we can fill in
-      // later...
-      pdfioDictSetNumber(obj->value.value.dict, "Length", 0.0);
-    }
-  }
-
-  if (!_pdfioObjWriteHeader(obj))
-    return (NULL);
+//
+// '_pdfioObjCreateStagedStream()' - Create an object (data) stream that is
+//                                   staged in memory.
+//
+// This function creates a stream like @link pdfioObjCreateStream@ but always
+// stages the stream data in memory, allowing the stream to be written while
+// another object is open.
+//
 
-  if (!_pdfioFilePuts(obj->pdf, "stream\n"))
-    return (NULL);
+pdfio_stream_t *			// O - Stream or `NULL` on error
+_pdfioObjCreateStagedStream(
+    pdfio_obj_t    *obj,		// I - Object
+    pdfio_filter_t filter)		// I - Type of compression to apply
+{
+  return (create_stream(obj, filter, -1, PDFIO_ZSTRATEGY_AUTO, true));
+}
 
-  obj->stream_offset = _pdfioFileTell(obj->pdf);
 
-  // Return the new stream...
-  if ((st = _pdfioStreamCreate(obj, length_obj, 0, filter)) != NULL)
-    obj->pdf->current_obj = obj;
+//
+// 'pdfioObjCreateStream()' - Create an object (data) stream for writing.
+//
+// Flate-compressed streams use the default compression level and strategy set
+// using the @link pdfioFileSetCompression@ function.
+//
 
-  return (st);
+pdfio_stream_t *			// O - Stream or `NULL` on error
+pdfioObjCreateStream(
+    pdfio_obj_t    *obj,		// I - Object
+    pdfio_filter_t filter)		// I - Type of compression to apply
+{
+  return (create_stream(obj, filter, -1, PDFIO_ZSTRATEGY_AUTO, false));
 }
 
 
@@ -367,6 +372,22 @@ pdfioObjGetNumber(pdfio_obj_t *obj)	// I - Object
 }
 
 
+//
+// '_pdfioObjGetReadFile()' - Get the file used to read an object.
+//
+// Objects in a PDF file opened for update are read from the original file.
+//
+
+pdfio_file_t *				// O - PDF file
+_pdfioObjGetReadFile(pdfio_obj_t *obj)	// I - Object
+{
+  if (obj->pdf->update_pdf && obj->offset < obj->pdf->update_offset)
+    return (obj->pdf->update_pdf);
+  else
+    return (obj->pdf);
+}
+
+
 //
 // 'pdfioObjGetSubtype()' - Get an object's subtype.
 //
@@ -434,6 +455,8 @@ pdfioObjGetType(pdfio_obj_t *obj)	// I - Object
 bool					// O - `true` on success, `false` otherwise
 _pdfioObjLoad(pdfio_obj_t *obj)		// I - Object
 {
+  pdfio_file_t		*pdf = _pdfioObjGetReadFile(obj);
+					// File to read from
   char			line[64],	// Line from file
 			*ptr;		// Pointer into line
   ssize_t		bytes;		// Bytes read
@@ -443,13 +466,13 @@ _pdfioObjLoad(pdfio_obj_t *obj)		// I - Object
   PDFIO_DEBUG("_pdfioObjLoad(obj=%p(%lu)), offset=%lu\n", (void *)obj, (unsigned long)obj->number, (unsigned long)obj->offset);
 
   // Seek to the start of the object and read its header...
-  if (_pdfioFileSeek(obj->pdf, obj->offset, SEEK_SET) != obj->offset)
+  if (_pdfioFileSeek(pdf, obj->offset, SEEK_SET) != obj->offset)
   {
     _pdfioFileError(obj->pdf, "Unable to seek to object %lu.", (unsigned long)obj->number);
     return (false);
   }
 
-  if ((bytes = _pdfioFilePeek(obj->pdf, line, sizeof(line) - 1)) < 0)
+  if ((bytes = _pdfioFilePeek(pdf, line, sizeof(line) - 1)) < 0)
   {
     _pdfioFileError(obj->pdf, "Unable to read header for object %lu.", (unsigned long)obj->number);
     return (false);
@@ -484,10 +507,10 @@ _pdfioObjLoad(pdfio_obj_t *obj)		// I - Object
   while (*ptr && isspace(*ptr & 255))
     ptr ++;
 
-  _pdfioFileConsume(obj->pdf, (size_t)(ptr - line));
+  _pdfioFileConsume(pdf, (size_t)(ptr - line));
 
   // Then grab the object value...
-  _pdfioTokenInit(&tb, obj->pdf, (_pdfio_tconsume_cb_t)_pdfioFileConsume, (_pdfio_tpeek_cb_t)_pdfioFilePeek, obj->pdf);
+  _pdfioTokenInit(&tb, obj->pdf, (_pdfio_tconsume_cb_t)_pdfioFileConsume, (_pdfio_tpeek_cb_t)_pdfioFilePeek, pdf);
 
   if (!_pdfioValueRead(obj->pdf, obj, &tb, &obj->value, 0))
   {
@@ -509,7 +532,7 @@ _pdfioObjLoad(pdfio_obj_t *obj)		// I - Object
   if (!strcmp(line, "stream"))
   {
     // Yes, this is an embedded stream so save its location...
-    obj->stream_offset = _pdfioFileTell(obj->pdf);
+    obj->stream_offset = _pdfioFileTell(pdf);
     PDFIO_DEBUG("_pdfioObjLoad: stream_offset=%lu.\n", (unsigned long)obj->stream_offset);
   }
 
@@ -541,6 +564,7 @@ pdfio_stream_t *			// O - Stream or `NULL` on error
 pdfioObjOpenStream(pdfio_obj_t *obj,	// I - Object
                    bool        decode)	// I - Decode/decompress data?
 {
+  pdfio_file_t		*pdf;		// File to read from
   pdfio_stream_t	*st;		// Stream
 
 
@@ -548,9 +572,11 @@ pdfioObjOpenStream(pdfio_obj_t *obj,	// I - Object
   if (!obj)
     return (NULL);
 
-  if (obj->pdf->current_obj)
+  pdf = _pdfioObjGetReadFile(obj);
+
+  if (pdf->current_obj)
   {
-    _pdfioFileError(obj->pdf, "Another object (%u) is already open.", (unsigned)obj->pdf->current_obj->number);
+    _pdfioFileError(obj->pdf, "Another object (%u) is already open.", (unsigned)pdf->current_obj->number);
     return (NULL);
   }
 
@@ -567,7 +593,7 @@ pdfioObjOpenStream(pdfio_obj_t *obj,	// I - Object
 
   // Open the stream...
   if ((st = _pdfioStreamOpen(obj, decode)) != NULL)
-    obj->pdf->current_obj = obj;
+    pdf->current_obj = obj;
 
   return (st);
 }
@@ -588,6 +614,52 @@ _pdfioObjSetExtension(
 }
 
 
+//
+// 'pdfioObjUpdate()' - Mark an existing object as updated.
+//
+// This function marks an existing object in a PDF file opened with the
+// @link pdfioFileOpenUpdate@ function as updated.  The current value of the
+// object is written to the end of the PDF file when it is closed with
+// @link pdfioObjClose@ or when the PDF file is closed.  For example, to add
+// a key to a page dictionary:
+//
+// ```
+// pdfio_obj_t *page = pdfioFileGetPage(pdf, 0);
+//
+// pdfioObjUpdate(page);
+// pdfioDictSetName(pdfioObjGetDict(page), "Tabs", "S");
+// pdfioObjClose(page);
+// ```
+//
+// Objects with streams cannot be updated - create a new object with the
+// updated stream data instead.
+//
+// @since PDFio v1.7@
+//
+
+bool					// O - `true` on success, `false` on failure
+pdfioObjUpdate(pdfio_obj_t *obj)	// I - Object
+{
+  // Range check input...
+  if (!obj || !obj->pdf->update_pdf)
+    return (false);
+
+  // Make sure we've loaded the object value...
+  if (!obj->value.type && !_pdfioObjLoad(obj))
+    return (false);
+
+  if (obj->stream_offset)
+  {
+    _pdfioFileError(obj->pdf, "Unable to update stream object %lu.", (unsigned long)obj->number);
+    return (false);
+  }
+
+  obj->modified = true;
+
+  return (true);
+}
+
+
 //
 // '_pdfioObjWriteHeader()' - Write the object header...
 //
@@ -605,3 +677,350 @@ _pdfioObjWriteHeader(pdfio_obj_t *obj)	// I - Object
 
   return (_pdfioFilePuts(obj->pdf, "\n"));
 }
+
+
+//
+// 'copy_merged_stream()' - Copy a stream object, reusing an identical stream
+//                          from another source file if possible.
+//
+// The digest is computed from the source dictionary and data, with referenced
+// objects hashed by content, so that the dictionary and the objects it
+// references are only copied when there is no identical stream.
+//
+
+static pdfio_obj_t *			// O - Destination object or `NULL` on error
+copy_merged_stream(
+    pdfio_file_t *pdf,			// I - Destination PDF file
+    pdfio_obj_t  *srcobj)		// I - Source object
+{
+  pdfio_obj_t	*dstobj,		// Destination object
+		*winner;		// Object used for the digest
+  _pdfio_value_t value;			// Destination dictionary value
+  _pdfio_sha256_t sha256;		// SHA-256 context
+  uint8_t	digest[32];		// SHA-256 digest
+  size_t	count = 0;		// Number of objects hashed
+  bool		copied;			// Was the dictionary copied?
+
+
+  // Compute the digest of the source dictionary and encoded stream data...
+  _pdfioCryptoSHA256Init(&sha256);
+
+  if (!hash_merged_obj(srcobj, &sha256, 0, &count))
+    return (NULL);
+
+  _pdfioCryptoSHA256Finish(&sha256, digest);
+
+  // Use the existing object for an identical stream...
+  if ((dstobj = _pdfioFileFindDigest(pdf, digest)) != NULL)
+    return (_pdfioFileAddMappedObj(pdf, dstobj, srcobj) ? dstobj : NULL);
+
+  // Copy the dictionary, which copies any objects it references...
+  pdf->merge_depth ++;
+  copied = _pdfioValueCopy(pdf, &value, srcobj->pdf, &srcobj->value) != NULL;
+  pdf->merge_depth --;
+
+  if (!copied)
+    return (NULL);
+
+  // A reference loop may have copied this stream already...
+  if ((dstobj = _pdfioFileFindMappedObj(pdf, srcobj->pdf, srcobj->number)) != NULL)
+    return (dstobj);
+
+  pdfioDictClear(value.value.dict, "Length");
+
+  if ((dstobj = _pdfioFileCreateObj(pdf, srcobj->pdf, &value)) == NULL)
+    return (NULL);
+
+  // Another thread may have copied an identical stream in the meantime, so
+  // map the source object to whichever copy was added first...
+  winner = _pdfioFileAddDigest(pdf, digest, dstobj);
+
+  if (!_pdfioFileAddMappedObj(pdf, winner, srcobj) || !copy_stream(dstobj, srcobj))
+    return (NULL);
+
+  return (winner);
+}
+
+
+//
+// 'copy_stream()' - Copy the stream data for an object.
+//
+
+static bool				// O - `true` on success, `false` on failure
+copy_stream(pdfio_obj_t *dstobj,	// I - Destination object
+            pdfio_obj_t *srcobj)	// I - Source object
+{
+  pdfio_file_t	*pdf = dstobj->pdf,	// Destination PDF file
+		*srcpdf = _pdfioObjGetReadFile(srcobj);
+					// Source file for stream data
+  size_t	length;			// Length of stream data
+  pdfio_stream_t *srcst,		// Source stream
+		*dstst;			// Destination stream
+  char		buffer[32768];		// Copy buffer
+  ssize_t	bytes;			// Bytes read
+
+
+  if (srcpdf->mode == _PDFIO_MODE_READ && srcpdf->encryption == PDFIO_ENCRYPTION_NONE && pdf->encryption == PDFIO_ENCRYPTION_NONE && !pdf->staged && !pdf->current_obj && dstobj->value.type == PDFIO_VALTYPE_DICT && (length = pdfioObjGetLength(srcobj)) > 0)
+  {
+    // Neither file is encrypted, so copy the raw stream data as-is...
+    pdfioDictSetNumber(dstobj->value.value.dict, "Length", (double)length);
+
+    if (!_pdfioObjWriteHeader(dstobj) || !_pdfioFilePuts(pdf, "stream\n"))
+      return (false);
+
+    dstobj->stream_offset = _pdfioFileTell(pdf);
+    dstobj->stream_length = length;
+
+    return (_pdfioFileCopy(pdf, srcpdf, srcobj->stream_offset, length) && _pdfioFilePuts(pdf, "\nendstream\nendobj\n"));
+  }
+
+  // Copy the stream data through a pair of streams...
+  if ((srcst = pdfioObjOpenStream(srcobj, false)) == NULL)
+  {
+    pdfioObjClose(dstobj);
+    return (false);
+  }
+
+  if ((dstst = pdfioObjCreateStream(dstobj, PDFIO_FILTER_NONE)) == NULL)
+  {
+    pdfioStreamClose(srcst);
+    pdfioObjClose(dstobj);
+    return (false);
+  }
+
+  while ((bytes = pdfioStreamRead(srcst, buffer, sizeof(buffer))) > 0)
+  {
+    if (!pdfioStreamWrite(dstst, buffer, (size_t)bytes))
+    {
+      bytes = -1;
+      break;
+    }
+  }
+
+  pdfioStreamClose(srcst);
+  pdfioStreamClose(dstst);
+
+  return (bytes >= 0);
+}
+
+
+//
+// 'create_stream()' - Create an object (data) stream for writing.
+//
+
+static pdfio_stream_t *			// O - Stream or `NULL` on error
+create_stream(
+    pdfio_obj_t       *obj,		// I - Object
+    pdfio_filter_t    filter,		// I - Type of compression to apply
+    int               level,		// I - Compression level or `-1` for default
+    pdfio_zstrategy_t strategy,		// I - Compression strategy
+    bool              staged)		// I - Always stage the stream data?
+{
+  pdfio_stream_t *st;			// Stream
+  pdfio_obj_t	*length_obj = NULL;	// Length object, if any
+
+
+  // Range check input
+  if (!obj || obj->pdf->mode != _PDFIO_MODE_WRITE || obj->value.type != PDFIO_VALTYPE_DICT)
+    return (NULL);
+
+  if (obj->offset || obj->objstm || obj->stream || (obj->pdf->update_pdf && obj->number <= obj->pdf->update_number))
+  {
+    _pdfioFileError(obj->pdf, "Object has already been written.");
+    return (NULL);
+  }
+
+  if (filter != PDFIO_FILTER_NONE && filter != PDFIO_FILTER_FLATE)
+  {
+    _pdfioFileError(obj->pdf, "Unsupported filter value for PDFioObjCreateStream.");
+    return (NULL);
+  }
+
+  if (staged || obj->pdf->staged)
+  {
+    // Stage the stream data in memory, the header and data are written when
+    // the stream is closed...
+    if ((st = _pdfioStreamCreate(obj, NULL, 0, filter, level, strategy, true)) != NULL)
+      obj->stream = st;
+
+    return (st);
+  }
+
+  if (obj->pdf->current_obj)
+  {
+    _pdfioFileError(obj->pdf, "Another object (%u) is already open.", (unsigned)obj->pdf->current_obj->number);
+    return (NULL);
+  }
+
+  // Write the header...
+  if (!_pdfioDictGetValue(obj->value.value.dict, "Length"))
+  {
+    if (obj->pdf->output_cb)
+    {
+      // Streaming via an output callback, so add a placeholder length object
+      _pdfio_value_t	length_value;	// Length value
+
+      length_value.type         = PDFIO_VALTYPE_NUMBER;
+      length_value.value.number = 0.0f;
+
+      length_obj = _pdfioFileCreateObj(obj->pdf, obj->pdf, &length_value);
+      pdfioDictSetObj(obj->value.value.dict, "Length", length_obj);
+    }
+    else
+    {
+      // Need a Length key for the stream, add a placeholder that we can fill in
+      // later...
+      pdfioDictSetNumber(obj->value.value.dict, "Length", 0.0);
+    }
+  }
+
+  if (!_pdfioObjWriteHeader(obj))
+    return (NULL);
+
+  if (!_pdfioFilePuts(obj->pdf, "stream\n"))
+    return (NULL);
+
+  obj->stream_offset = _pdfioFileTell(obj->pdf);
+
+  // Return the new stream...
+  if ((st = _pdfioStreamCreate(obj, length_obj, 0, filter, level, strategy, false)) != NULL)
+    obj->pdf->current_obj = obj;
+
+  return (st);
+}
+
+
+//
+// 'hash_merged_obj()' - Add a source object and its stream data to a SHA-256
+//                       digest.
+//
+
+static bool				// O - `true` on success, `false` on error
+hash_merged_obj(
+    pdfio_obj_t     *srcobj,		// I - Source object
+    _pdfio_sha256_t *sha256,		// I - SHA-256 context
+    size_t          depth,		// I - Depth of object
+    size_t          *count)		// IO - Number of objects hashed
+{
+  pdfio_stream_t *srcst;		// Source stream
+  uint8_t	buffer[8192];		// Read buffer
+  ssize_t	bytes;			// Bytes read
+
+
+  // Load the object value if needed...
+  if (srcobj->value.type == PDFIO_VALTYPE_NONE && !_pdfioObjLoad(srcobj))
+    return (false);
+
+  // Hash the value, skipping the stream length...
+  if (!hash_merged_value(srcobj->pdf, &srcobj->value, srcobj->stream_offset ? "Length" : NULL, sha256, depth, count))
+    return (false);
+
+  if (!srcobj->stream_offset)
+    return (true);
+
+  // Hash the encoded stream data...
+  if ((srcst = pdfioObjOpenStream(srcobj, false)) == NULL)
+    return (false);
+
+  while ((bytes = pdfioStreamRead(srcst, buffer, sizeof(buffer))) > 0)
+    _pdfioCryptoSHA256Append(sha256, buffer, (size_t)bytes);
+
+  pdfioStreamClose(srcst);
+
+  return (bytes == 0);
+}
+
+
+//
+// 'hash_merged_value()' - Add a source value to a SHA-256 digest.
+//
+// Indirect references are hashed using the content of the referenced object
+// so that the digest does not depend on the object numbers in the source
+// file.  Reference loops and very large object graphs are limited by the
+// depth and number of objects - past those limits the source file identifier
+// and object number are hashed instead, which never matches another file.
+//
+
+static bool				// O - `true` on success, `false` on error
+hash_merged_value(
+    pdfio_file_t    *srcpdf,		// I - Source PDF file
+    _pdfio_value_t  *v,			// I - Value
+    const char      *skip,		// I - Dictionary key to skip or `NULL` for none
+    _pdfio_sha256_t *sha256,		// I - SHA-256 context
+    size_t          depth,		// I - Depth of value
+    size_t          *count)		// IO - Number of objects hashed
+{
+  size_t	i,			// Looping var
+		num_pairs;		// Number of dictionary pairs hashed
+  _pdfio_value_t *av;			// Current array value
+  _pdfio_pair_t	*pair;			// Current dictionary pair
+  pdfio_obj_t	*obj;			// Referenced object
+  uint8_t	type = (uint8_t)v->type;// Value type
+
+
+  switch (v->type)
+  {
+    default :
+        _pdfioValueHash(v, sha256);
+        break;
+
+    case PDFIO_VALTYPE_ARRAY :
+        _pdfioCryptoSHA256Append(sha256, &type, 1);
+        _pdfioCryptoSHA256Append(sha256, (uint8_t *)&v->value.array->num_values, sizeof(v->value.array->num_values));
+
+        for (i = v->value.array->num_values, av = v->value.array->values; i > 0; i --, av ++)
+        {
+          if (!hash_merged_value(srcpdf, av, NULL, sha256, depth, count))
+            return (false);
+        }
+        break;
+
+    case PDFIO_VALTYPE_DICT :
+        // Dictionary pairs are always sorted by key...
+        for (i = v->value.dict->num_pairs, pair = v->value.dict->pairs, num_pairs = 0; i > 0; i --, pair ++)
+        {
+          if (!skip || strcmp(pair->key, skip))
+            num_pairs ++;
+        }
+
+        _pdfioCryptoSHA256Append(sha256, &type, 1);
+        _pdfioCryptoSHA256Append(sha256, (uint8_t *)&num_pairs, sizeof(num_pairs));
+
+        for (i = v->value.dict->num_pairs, pair = v->value.dict->pairs; i > 0; i --, pair ++)
+        {
+          if (skip && !strcmp(pair->key, skip))
+            continue;
+
+          _pdfioCryptoSHA256Append(sha256, (const uint8_t *)pair->key, strlen(pair->key) + 1);
+
+          if (!hash_merged_value(srcpdf, &pair->value, NULL, sha256, depth, count))
+            return (false);
+        }
+        break;
+
+    case PDFIO_VALTYPE_INDIRECT :
+        _pdfioCryptoSHA256Append(sha256, &type, 1);
+
+        if (depth < PDFIO_MAX_DEPTH && *count < _PDFIO_MERGE_HASH_MAX && (obj = pdfioFileFindObj(srcpdf, v->value.indirect.number)) != NULL)
+        {
+          // Hash the referenced object...
+          (*count) ++;
+
+          type = 1;
+          _pdfioCryptoSHA256Append(sha256, &type, 1);
+
+          return (hash_merged_obj(obj, sha256, depth + 1, count));
+        }
+        else
+        {
+          // Hash the source file and object number...
+          type = 0;
+          _pdfioCryptoSHA256Append(sha256, &type, 1);
+          _pdfioCryptoSHA256Append(sha256, srcpdf->file_id, sizeof(srcpdf->file_id));
+          _pdfioCryptoSHA256Append(sha256, (uint8_t *)&v->value.indirect.number, sizeof(v->value.indirect.number));
+        }
+        break;
+  }
+
+  return (true);
+}
@@ -44,6 +44,12 @@ pdfioPageCopy(pdfio_file_t *pdf,	// I - PDF file
     return (false);
   }
 
+  if (pdf->update_pdf)
+  {
+    _pdfioFileError(pdf, "Unable to add pages to a PDF file opened for update.");
+    return (false);
+  }
+
   // Copy the page object and add it to the pages array...
   if ((dstpage = pdfioObjCopy(pdf, srcpage)) == NULL)
     return (false);
@@ -53,6 +53,9 @@
 #    define O_BINARY	0		// Map Windows-specific open flag
 #  endif // _WIN32
 #  include <zlib.h>
+#  ifdef HAVE_PTHREAD
+#    include <pthread.h>
+#  endif // HAVE_PTHREAD
 
 
 //
@@ -95,10 +98,34 @@
 
 #  define PDFIO_MAX_DEPTH	32	// Maximum nesting depth for values
 #  define PDFIO_MAX_STRING	65536	// Maximum length of string
+#  define PDFIO_MAX_THREADS	64	// Maximum number of compression threads
 
 typedef void (*_pdfio_extfree_t)(void *);
 					// Extension data free function
 
+typedef enum _pdfio_gitem_e		// Tracked graphics state items
+{
+  _PDFIO_GITEM_FILL,			// Fill color
+  _PDFIO_GITEM_STROKE,			// Stroke color
+  _PDFIO_GITEM_LINE_WIDTH,		// Line width
+  _PDFIO_GITEM_LINE_CAP,		// Line cap
+  _PDFIO_GITEM_LINE_JOIN,		// Line join
+  _PDFIO_GITEM_DASH,			// Dash pattern
+  _PDFIO_GITEM_FONT,			// Text font and size
+  _PDFIO_GITEM_TEXT_MATRIX,		// Text matrix
+  _PDFIO_GITEM_MAX			// Number of tracked items
+} _pdfio_gitem_t;
+
+typedef struct _pdfio_gstate_s		// Graphics state shadow
+{
+  unsigned	valid;			// Bitmask of known items
+  char		ops[_PDFIO_GITEM_MAX][4];
+					// Operator that set each item
+  double	values[_PDFIO_GITEM_MAX][6];
+					// Values of each item
+  char		font[64];		// Font name
+} _pdfio_gstate_t;
+
 typedef enum _pdfio_mode_e		// Read/write mode
 {
   _PDFIO_MODE_READ,			// Read a PDF file
@@ -114,7 +141,7 @@ typedef enum _pdfio_predictor_e		// PNG predictor constants
   _PDFIO_PREDICTOR_PNG_UP = 12,		// PNG Up predictor
   _PDFIO_PREDICTOR_PNG_AVERAGE = 13,	// PNG Average predictor
   _PDFIO_PREDICTOR_PNG_PAETH = 14,	// PNG Paeth predictor
-  _PDFIO_PREDICTOR_PNG_AUTO = 15	// PNG "auto" predictor (currently mapped to Paeth)
+  _PDFIO_PREDICTOR_PNG_AUTO = 15	// PNG "auto" predictor (best predictor for each line)
 } _pdfio_predictor_t;
 
 typedef enum _pdfio_profile_e		// PDF profile constants
@@ -240,6 +267,22 @@ typedef struct _pdfio_objmap_s		// PDF object map
   size_t	src_number;		// Source object number
 } _pdfio_objmap_t;
 
+typedef struct _pdfio_digest_s		// Stream digest
+{
+  uint8_t	digest[32];		// SHA-256 digest of dictionary and data
+  pdfio_obj_t	*obj;			// Object for this file
+} _pdfio_digest_t;
+
+typedef struct _pdfio_subset_s		// TrueType font subset
+{
+  pdfio_obj_t	*font_obj,		// Type0 font object
+		*file_obj,		// FontFile2 object
+		*cid2gid_obj,		// CIDToGIDMap object
+		*type2_obj;		// CIDFontType2 font object
+  void		*data;			// Copy of font data, if any
+  unsigned char	cids[8192];		// Bit array of CIDs that are used
+} _pdfio_subset_t;
+
 typedef struct _pdfio_strbuf_s		// PDF string buffer
 {
   struct _pdfio_strbuf_s *next;		// Next string buffer
@@ -248,6 +291,34 @@ typedef struct _pdfio_strbuf_s		// PDF string buffer
 					// String buffer
 } _pdfio_strbuf_t;
 
+typedef struct _pdfio_objstm_s		// Compressed object stream being written
+{
+  pdfio_obj_t	*obj;			// Object stream object, if any
+  size_t	num_objs,		// Number of objects in stream
+		alloc_objs;		// Allocated objects
+  pdfio_obj_t	**objs;			// Objects in stream
+  size_t	*offsets;		// Offsets of objects in data
+  char		*data;			// Object data
+  size_t	datalen,		// Length of object data
+		datasize;		// Size of object data buffer
+} _pdfio_objstm_t;
+
+typedef struct _pdfio_zjob_s		// Parallel Flate compression job
+{
+  int		level,			// Compression level
+		strategy;		// ZLIB compression strategy
+  const unsigned char *dict;		// Dictionary (preceding data), if any
+  size_t	dictlen;		// Length of dictionary
+  const unsigned char *in;		// Input data
+  size_t	inlen;			// Length of input data
+  bool		last;			// Last block in stream?
+  unsigned char	*out;			// Output buffer
+  size_t	outsize,		// Size of output buffer
+		outlen;			// Length of output data
+  uLong		adler;			// Adler-32 checksum of input data
+  int		status;			// ZLIB status code
+} _pdfio_zjob_t;
+
 struct _pdfio_file_s			// PDF file structure
 {
   char		*filename;		// Filename
@@ -262,6 +333,18 @@ struct _pdfio_file_s			// PDF file structure
   void		*output_ctx;		// Context for output callback
   pdfio_error_cb_t error_cb;		// Error callback
   void		*error_data;		// Data for error callback
+  int		zlevel;			// Default Flate compression level
+  pdfio_zstrategy_t zstrategy;		// Default Flate compression strategy
+  size_t	zthreads;		// Number of Flate compression threads
+  int		precision;		// Decimal places for coordinates
+  _pdfio_objstm_t *objstm;		// Compressed object stream, if enabled
+  bool		staged;			// Stage streams in memory?
+  bool		linearized;		// Write a linearized PDF file?
+  size_t	*renumber;		// New object numbers when linearizing
+  bool		threaded;		// Shared between threads?
+#  ifdef HAVE_PTHREAD
+  pthread_mutex_t mutex;		// Mutex for threaded access
+#  endif // HAVE_PTHREAD
 
   pdfio_encryption_t encryption;	// Encryption mode
   pdfio_permission_t permissions;	// Access permissions (encrypted PDF files)
@@ -279,6 +362,11 @@ struct _pdfio_file_s			// PDF file structure
 		*bufptr,		// Pointer into buffer
 		*bufend;		// End of buffer
   off_t		bufpos;			// Position in file for start of buffer
+  off_t		xref_offset;		// Offset to cross-reference table
+  bool		xref_stream;		// Is the cross-reference a stream?
+  pdfio_file_t	*update_pdf;		// Original PDF file for incremental updates
+  off_t		update_offset;		// End of original PDF file
+  size_t	update_number;		// Highest object number in original PDF file
   pdfio_dict_t	*trailer_dict;		// Trailer dictionary
   pdfio_obj_t	*root_obj;		// Root object/dictionary
   pdfio_obj_t	*info_obj;		// Information object
@@ -306,9 +394,23 @@ struct _pdfio_file_s			// PDF file structure
   size_t	num_objmaps,		// Number of object maps
 		alloc_objmaps;		// Allocated object maps
   _pdfio_objmap_t *objmaps;		// Object maps
+  bool		merging;		// Deduplicate copied streams?
+  size_t	merge_depth;		// Nesting of deduplicated stream copies
+  size_t	num_digests,		// Number of stream digests
+		alloc_digests;		// Allocated stream digests
+  _pdfio_digest_t *digests;		// Stream digests
+  bool		resource_cache;		// Reuse identical fonts, images, etc.?
+  bool		font_cache;		// Use the shared font cache?
+  bool		subset_fonts;		// Subset embedded TrueType fonts?
+  size_t	num_subsets,		// Number of font subsets
+		alloc_subsets;		// Allocated font subsets
+  _pdfio_subset_t **subsets;		// Font subsets
   size_t	num_pages,		// Number of pages
 		alloc_pages;		// Allocated pages
   pdfio_obj_t	**pages;		// Pages
+  size_t	num_page_nodes,		// Number of leaf page tree nodes
+		alloc_page_nodes;	// Allocated leaf page tree nodes
+  pdfio_obj_t	**page_nodes;		// Leaf page tree nodes
   size_t	num_strings,		// Number of strings
 		alloc_strings;		// Allocated strings
   char		**strings;		// Nul-terminated strings
@@ -328,6 +430,9 @@ struct _pdfio_obj_s			// Object
   pdfio_stream_t *stream;		// Open stream, if any
   void		*data;			// Extension data, if any
   _pdfio_extfree_t datafree;		// Free callback for extension data
+  pdfio_obj_t	*objstm;		// Compressed object stream containing this object, if any
+  size_t	objstm_index;		// Index in compressed object stream
+  bool		modified;		// Has an existing object been modified?
 };
 
 struct _pdfio_stream_s			// Stream
@@ -350,6 +455,26 @@ struct _pdfio_stream_s			// Stream
 		*psbuffer;		// PNG filter buffer, as needed
   _pdfio_crypto_cb_t crypto_cb;		// Encryption/descryption callback, if any
   _pdfio_crypto_ctx_t crypto_ctx;	// Cryptographic context
+  int		zlevel,			// Flate compression level
+		zstrategy;		// ZLIB compression strategy
+  size_t	zthreads;		// Number of parallel compression jobs
+  unsigned char	*zbuffer;		// Parallel compression dictionary+input buffer, if any
+  size_t	zbufsize,		// Maximum size of input buffer
+		zbufalloc,		// Allocated size of input buffer
+		zbufused,		// Bytes used in input buffer
+		zdictlen;		// Bytes of dictionary data before input
+  bool		zstarted;		// Has parallel compression started?
+  uLong		zadler;			// Adler-32 checksum of uncompressed data
+  _pdfio_zjob_t	*zjobs;			// Parallel compression jobs
+  bool		staged;			// Is the stream data staged in memory?
+  unsigned char	*sbuffer;		// Staged stream data, if any
+  size_t	sbufsize,		// Size of staged stream data buffer
+		sbufused;		// Bytes used in staged stream data buffer
+  pdfio_dict_t	*fonts;			// Page font resources, if any
+  _pdfio_subset_t *subset;		// Current font subset, if any
+  size_t	num_gstates,		// Number of graphics states
+		alloc_gstates;		// Allocated graphics states
+  _pdfio_gstate_t *gstates;		// Graphics state stack, if tracking state
 };
 
 
@@ -357,6 +482,7 @@ struct _pdfio_stream_s			// Stream
 // Functions...
 //
 
+extern char		*_pdfio_ftoa(char *buffer, double value, int digits, bool compact) _PDFIO_INTERNAL;
 extern size_t		_pdfio_strlcpy(char *dst, const char *src, size_t dstsize) _PDFIO_INTERNAL;
 extern double		_pdfio_strtod(pdfio_file_t *pdf, const char *s) _PDFIO_INTERNAL;
 extern void		_pdfio_utf16cpy(char *dst, const unsigned char *src, size_t srclen, size_t dstsize) _PDFIO_INTERNAL;
@@ -394,32 +520,43 @@ extern pdfio_dict_t	*_pdfioDictRead(pdfio_file_t *pdf, pdfio_obj_t *obj, _pdfio_
 extern bool		_pdfioDictSetValue(pdfio_dict_t *dict, const char *key, _pdfio_value_t *value) _PDFIO_INTERNAL;
 extern bool		_pdfioDictWrite(pdfio_dict_t *dict, pdfio_obj_t *obj, off_t *length) _PDFIO_INTERNAL;
 
+extern bool		_pdfioFileAddCompressedObj(pdfio_file_t *pdf, pdfio_obj_t *obj) _PDFIO_INTERNAL;
+extern pdfio_obj_t	*_pdfioFileAddDigest(pdfio_file_t *pdf, const uint8_t *digest, pdfio_obj_t *obj) _PDFIO_INTERNAL;
 extern bool		_pdfioFileAddMappedObj(pdfio_file_t *pdf, pdfio_obj_t *dst_obj, pdfio_obj_t *src_obj) _PDFIO_INTERNAL;
 extern bool		_pdfioFileAddPage(pdfio_file_t *pdf, pdfio_obj_t *obj) _PDFIO_INTERNAL;
 extern bool		_pdfioFileConsume(pdfio_file_t *pdf, size_t bytes) _PDFIO_INTERNAL;
+extern bool		_pdfioFileCopy(pdfio_file_t *pdf, pdfio_file_t *src, off_t offset, size_t length) _PDFIO_INTERNAL;
 extern pdfio_obj_t	*_pdfioFileCreateObj(pdfio_file_t *pdf, pdfio_file_t *srcpdf, _pdfio_value_t *value) _PDFIO_INTERNAL;
 extern bool		_pdfioFileDefaultError(pdfio_file_t *pdf, const char *message, void *data) _PDFIO_INTERNAL;
 extern bool		_pdfioFileError(pdfio_file_t *pdf, const char *format, ...) _PDFIO_INTERNAL;
+extern pdfio_obj_t	*_pdfioFileFindDigest(pdfio_file_t *pdf, const uint8_t *digest) _PDFIO_INTERNAL;
 extern pdfio_obj_t	*_pdfioFileFindMappedObj(pdfio_file_t *pdf, pdfio_file_t *src_pdf, size_t src_number) _PDFIO_INTERNAL;
 extern bool		_pdfioFileFlush(pdfio_file_t *pdf) _PDFIO_INTERNAL;
 extern int		_pdfioFileGetChar(pdfio_file_t *pdf) _PDFIO_INTERNAL;
 extern bool		_pdfioFileGets(pdfio_file_t *pdf, char *buffer, size_t bufsize, bool discard) _PDFIO_INTERNAL;
+extern void		_pdfioFileLock(pdfio_file_t *pdf) _PDFIO_INTERNAL;
 extern ssize_t		_pdfioFilePeek(pdfio_file_t *pdf, void *buffer, size_t bytes) _PDFIO_INTERNAL;
 extern bool		_pdfioFilePrintf(pdfio_file_t *pdf, const char *format, ...) _PDFIO_INTERNAL;
 extern bool		_pdfioFilePuts(pdfio_file_t *pdf, const char *s) _PDFIO_INTERNAL;
 extern ssize_t		_pdfioFileRead(pdfio_file_t *pdf, void *buffer, size_t bytes) _PDFIO_INTERNAL;
 extern off_t		_pdfioFileSeek(pdfio_file_t *pdf, off_t offset, int whence) _PDFIO_INTERNAL;
 extern off_t		_pdfioFileTell(pdfio_file_t *pdf) _PDFIO_INTERNAL;
+extern void		_pdfioFileUnlock(pdfio_file_t *pdf) _PDFIO_INTERNAL;
 extern bool		_pdfioFileWrite(pdfio_file_t *pdf, const void *buffer, size_t bytes) _PDFIO_INTERNAL;
+extern bool		_pdfioFileWriteSubsets(pdfio_file_t *pdf) _PDFIO_INTERNAL;
 
+extern pdfio_stream_t	*_pdfioObjCreateStagedStream(pdfio_obj_t *obj, pdfio_filter_t filter) _PDFIO_INTERNAL;
 extern void		_pdfioObjDelete(pdfio_obj_t *obj) _PDFIO_INTERNAL;
 extern void		*_pdfioObjGetExtension(pdfio_obj_t *obj) _PDFIO_INTERNAL;
+extern pdfio_file_t	*_pdfioObjGetReadFile(pdfio_obj_t *obj) _PDFIO_INTERNAL;
 extern bool		_pdfioObjLoad(pdfio_obj_t *obj) _PDFIO_INTERNAL;
 extern void		_pdfioObjSetExtension(pdfio_obj_t *obj, void *data, _pdfio_extfree_t datafree) _PDFIO_INTERNAL;
 extern bool		_pdfioObjWriteHeader(pdfio_obj_t *obj) _PDFIO_INTERNAL;
 
-extern pdfio_stream_t	*_pdfioStreamCreate(pdfio_obj_t *obj, pdfio_obj_t *length_obj, size_t cbsize, pdfio_filter_t compression) _PDFIO_INTERNAL;
+extern pdfio_stream_t	*_pdfioStreamCreate(pdfio_obj_t *obj, pdfio_obj_t *length_obj, size_t cbsize, pdfio_filter_t compression, int level, pdfio_zstrategy_t strategy, bool staged) _PDFIO_INTERNAL;
 extern pdfio_stream_t	*_pdfioStreamOpen(pdfio_obj_t *obj, bool decode) _PDFIO_INTERNAL;
+extern bool		_pdfioStreamWriteCoords(pdfio_stream_t *st, const char *op, size_t num_values, ...) _PDFIO_INTERNAL;
+extern bool		_pdfioStreamWriteReals(pdfio_stream_t *st, const char *op, size_t num_values, ...) _PDFIO_INTERNAL;
 
 extern char		*_pdfioStringAllocBuffer(pdfio_file_t *pdf);
 extern void		_pdfioStringFreeBuffer(pdfio_file_t *pdf, char *buffer);
@@ -436,6 +573,7 @@ extern _pdfio_value_t	*_pdfioValueCopy(pdfio_file_t *pdfdst, _pdfio_value_t *vds
 extern bool		_pdfioValueDecrypt(pdfio_file_t *pdf, pdfio_obj_t *obj, _pdfio_value_t *v, size_t depth) _PDFIO_INTERNAL;
 extern void		_pdfioValueDebug(_pdfio_value_t *v, FILE *fp) _PDFIO_INTERNAL;
 extern void		_pdfioValueDelete(_pdfio_value_t *v) _PDFIO_INTERNAL;
+extern void		_pdfioValueHash(_pdfio_value_t *v, _pdfio_sha256_t *sha256) _PDFIO_INTERNAL;
 extern _pdfio_value_t	*_pdfioValueRead(pdfio_file_t *pdf, pdfio_obj_t *obj, _pdfio_token_t *ts, _pdfio_value_t *v, size_t depth) _PDFIO_INTERNAL;
 extern bool		_pdfioValueWrite(pdfio_file_t *pdf, pdfio_obj_t *obj, _pdfio_value_t *v, off_t *length) _PDFIO_INTERNAL;
 
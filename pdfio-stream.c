@@ -10,13 +10,29 @@
 #include "pdfio-private.h"
 
 
+//
+// Local constants...
+//
+
+#define _PDFIO_ZBLOCK_SIZE	131072	// Size of parallel compression blocks
+#define _PDFIO_ZBUF_INITIAL	16384	// Initial size of parallel compression input buffer
+#define _PDFIO_ZDICT_SIZE	32768	// Size of Flate dictionary/window
+
+
 //
 // Local functions...
 //
 
+static void		stream_filter(unsigned char *dst, const unsigned char *src, const unsigned char *prev, size_t pbline, size_t pbpixel, unsigned char type);
+static size_t		stream_filter_cost(const unsigned char *data, size_t bytes);
+static bool		stream_output(pdfio_stream_t *st, const void *buffer, size_t bytes);
 static unsigned char	stream_paeth(unsigned char a, unsigned char b, unsigned char c);
 static ssize_t		stream_read(pdfio_stream_t *st, char *buffer, size_t bytes);
 static bool		stream_write(pdfio_stream_t *st, const void *buffer, size_t bytes);
+static bool		stream_write_reals(pdfio_stream_t *st, const char *op, int digits, size_t num_values, va_list ap);
+static bool		stream_zflush(pdfio_stream_t *st, bool last);
+static void		*stream_zjob(void *data);
+static bool		stream_zoutput(pdfio_stream_t *st, const unsigned char *data, size_t bytes);
 static const char	*zstrerror(int error);
 
 
@@ -28,6 +44,7 @@ bool					// O - `true` on success, `false` on failure
 pdfioStreamClose(pdfio_stream_t *st)	// I - Stream
 {
   bool ret = true;			// Return value
+  bool locked = false;			// Is the file locked?
 
 
   // Range check input...
@@ -48,7 +65,32 @@ pdfioStreamClose(pdfio_stream_t *st)	// I - Stream
       // Finalize flate compression stream...
       int status;			// Deflate status
 
-      while ((status = deflate(&st->flate, Z_FINISH)) != Z_STREAM_END)
+      if (st->zbuffer && !st->zstarted)
+      {
+        // Too small for parallel compression, compress the buffered data
+        // normally...
+        unsigned char *zbuffer = st->zbuffer;
+					// Buffered data
+
+        st->zbuffer = NULL;
+
+        if (!stream_write(st, zbuffer + _PDFIO_ZDICT_SIZE, st->zbufused))
+        {
+          free(zbuffer);
+          ret = false;
+          goto done;
+        }
+
+        free(zbuffer);
+      }
+      else if (st->zstarted && !stream_zflush(st, true))
+      {
+        // Unable to compress the remaining data in parallel...
+        ret = false;
+        goto done;
+      }
+
+      while (!st->zstarted && (status = deflate(&st->flate, Z_FINISH)) != Z_STREAM_END)
       {
         size_t	bytes = st->cbsize - st->flate.avail_out,
 					// Bytes to write
@@ -72,7 +114,7 @@ pdfioStreamClose(pdfio_stream_t *st)	// I - Stream
 	  outbytes = bytes;
 	}
 
-	if (!_pdfioFileWrite(st->pdf, st->cbuffer, outbytes))
+	if (!stream_output(st, st->cbuffer, outbytes))
 	{
 	  ret = false;
 	  goto done;
@@ -104,14 +146,12 @@ pdfioStreamClose(pdfio_stream_t *st)	// I - Stream
 	  bytes = (st->crypto_cb)(&st->crypto_ctx, st->cbuffer, st->cbuffer, bytes);
 	}
 
-	if (!_pdfioFileWrite(st->pdf, st->cbuffer, bytes))
+	if (!stream_output(st, st->cbuffer, bytes))
 	{
 	  ret = false;
 	  goto done;
 	}
       }
-
-      deflateEnd(&st->flate);
     }
     else if (st->crypto_cb && st->bufptr > st->buffer)
     {
@@ -120,7 +160,44 @@ pdfioStreamClose(pdfio_stream_t *st)	// I - Stream
       size_t	outbytes;		// Output bytes
 
       outbytes = (st->crypto_cb)(&st->crypto_ctx, temp, (uint8_t *)st->buffer, (size_t)(st->bufptr - st->buffer));
-      if (!_pdfioFileWrite(st->pdf, temp, outbytes))
+      if (!stream_output(st, temp, outbytes))
+      {
+        ret = false;
+        goto done;
+      }
+    }
+
+    // Lock the file while writing the object...
+    _pdfioFileLock(st->pdf);
+    locked = true;
+
+    if (st->staged)
+    {
+      // Write the object header and staged stream data...
+      if (st->pdf->current_obj)
+      {
+        _pdfioFileError(st->pdf, "Another object (%u) is already open.", (unsigned)st->pdf->current_obj->number);
+        ret = false;
+        goto done;
+      }
+
+      pdfioDictSetNumber(st->obj->value.value.dict, "Length", (double)st->sbufused);
+
+      // The length of a staged stream is always known, so write it directly
+      // rather than as a placeholder (a zero Length would otherwise be seen as
+      // unknown)...
+      st->obj->offset        = _pdfioFileTell(st->pdf);
+      st->obj->length_offset = 0;
+
+      if (!_pdfioFilePrintf(st->pdf, "%lu %u obj\n", (unsigned long)st->obj->number, st->obj->generation) || !_pdfioValueWrite(st->pdf, st->obj, &st->obj->value, NULL) || !_pdfioFilePuts(st->pdf, "\nstream\n"))
+      {
+        ret = false;
+        goto done;
+      }
+
+      st->obj->stream_offset = _pdfioFileTell(st->pdf);
+
+      if (st->sbufused > 0 && !_pdfioFileWrite(st->pdf, st->sbuffer, st->sbufused))
       {
         ret = false;
         goto done;
@@ -170,11 +247,33 @@ pdfioStreamClose(pdfio_stream_t *st)	// I - Stream
 
   done:
 
-  st->pdf->current_obj = NULL;
+  if (st->pdf->mode == _PDFIO_MODE_WRITE && st->filter == PDFIO_FILTER_FLATE)
+    deflateEnd(&st->flate);
+
+  if (st->staged)
+    st->obj->stream = NULL;
+  else
+    st->pdf->current_obj = NULL;
+
+  if (locked)
+    _pdfioFileUnlock(st->pdf);
+
+  if (st->zjobs)
+  {
+    size_t	i;			// Looping var
+
+    for (i = 0; i < st->zthreads; i ++)
+      free(st->zjobs[i].out);
+
+    free(st->zjobs);
+  }
 
   free(st->cbuffer);
   free(st->prbuffer);
   free(st->psbuffer);
+  free(st->zbuffer);
+  free(st->sbuffer);
+  free(st->gstates);
   free(st);
 
   return (ret);
@@ -186,13 +285,21 @@ pdfioStreamClose(pdfio_stream_t *st)	// I - Stream
 //
 // Note: pdfioObjCreateStream handles writing the object and its dictionary.
 //
+// The "level" and "strategy" arguments are only used for Flate compression.
+// A level of `-1` and/or strategy of `PDFIO_ZSTRATEGY_AUTO` use the file's
+// defaults.  When no strategy has been chosen, streams using a PNG predictor
+// use the filtered strategy and all other streams use the default strategy.
+//
 
 pdfio_stream_t *			// O - Stream or `NULL` on error
 _pdfioStreamCreate(
-    pdfio_obj_t    *obj,		// I - Object
-    pdfio_obj_t    *length_obj,		// I - Length object, if any
-    size_t         cbsize,		// I - Size of compression buffer
-    pdfio_filter_t compression)		// I - Compression to apply
+    pdfio_obj_t       *obj,		// I - Object
+    pdfio_obj_t       *length_obj,	// I - Length object, if any
+    size_t            cbsize,		// I - Size of compression buffer
+    pdfio_filter_t    compression,	// I - Compression to apply
+    int               level,		// I - Compression level (0-9) or `-1` for default
+    pdfio_zstrategy_t strategy,		// I - Compression strategy
+    bool              staged)		// I - Stage the stream data in memory?
 {
   pdfio_stream_t	*st;		// Stream
 
@@ -210,6 +317,15 @@ _pdfioStreamCreate(
   st->filter     = compression;
   st->bufptr     = st->buffer;
   st->bufend     = st->buffer + sizeof(st->buffer);
+  st->staged     = staged;
+
+  // Track the fonts used by form and appearance streams when subsetting...
+  _pdfioFileLock(st->pdf);
+
+  if (st->pdf->num_subsets > 0 && obj->value.type == PDFIO_VALTYPE_DICT)
+    st->fonts = pdfioDictGetDict(pdfioDictGetDict(obj->value.value.dict, "Resources"), "Font");
+
+  _pdfioFileUnlock(st->pdf);
 
   if (obj->pdf->encryption)
   {
@@ -224,7 +340,7 @@ _pdfioStreamCreate(
     }
 
     if (ivlen > 0)
-      _pdfioFileWrite(st->pdf, iv, ivlen);
+      stream_output(st, iv, ivlen);
   }
 
   if (compression == PDFIO_FILTER_FLATE)
@@ -241,6 +357,7 @@ _pdfioStreamCreate(
     int predictor = (int)pdfioDictGetNumber(params, "Predictor");
 					// Predictory value, if any
     int status;				// ZLIB status code
+    int zstrategy;			// ZLIB compression strategy
 
     PDFIO_DEBUG("_pdfioStreamCreate: FlateDecode - BitsPerComponent=%d, Colors=%d, Columns=%d, Predictor=%d\n", bpc, colors, columns, predictor);
 
@@ -292,7 +409,8 @@ _pdfioStreamCreate(
       if (predictor >= 10)
 	st->pbsize ++;		// Add PNG predictor byte
 
-      if ((st->prbuffer = calloc(1, st->pbsize - 1)) == NULL || (st->psbuffer = calloc(1, st->pbsize)) == NULL)
+      // The "auto" predictor needs a filter buffer for each PNG filter type...
+      if ((st->prbuffer = calloc(1, st->pbsize - 1)) == NULL || (st->psbuffer = calloc(predictor == _PDFIO_PREDICTOR_PNG_AUTO ? 5 : 1, st->pbsize)) == NULL)
       {
 	_pdfioFileError(st->pdf, "Unable to allocate %lu bytes for Predictor buffers.", (unsigned long)st->pbsize);
 	free(st->prbuffer);
@@ -320,7 +438,35 @@ _pdfioStreamCreate(
     st->flate.next_out  = (Bytef *)st->cbuffer;
     st->flate.avail_out = (uInt)cbsize;
 
-    if ((status = deflateInit(&(st->flate), 9)) != Z_OK)
+    if (level < 0)
+      level = st->pdf->zlevel;
+
+    if (strategy == PDFIO_ZSTRATEGY_AUTO)
+      strategy = st->pdf->zstrategy;
+
+    switch (strategy)
+    {
+      case PDFIO_ZSTRATEGY_AUTO :
+          zstrategy = st->predictor != _PDFIO_PREDICTOR_NONE ? Z_FILTERED : Z_DEFAULT_STRATEGY;
+          break;
+      default :
+      case PDFIO_ZSTRATEGY_DEFAULT :
+          zstrategy = Z_DEFAULT_STRATEGY;
+          break;
+      case PDFIO_ZSTRATEGY_FILTERED :
+          zstrategy = Z_FILTERED;
+          break;
+      case PDFIO_ZSTRATEGY_HUFFMAN_ONLY :
+          zstrategy = Z_HUFFMAN_ONLY;
+          break;
+      case PDFIO_ZSTRATEGY_RLE :
+          zstrategy = Z_RLE;
+          break;
+    }
+
+    PDFIO_DEBUG("_pdfioStreamCreate: level=%d, zstrategy=%d\n", level, zstrategy);
+
+    if ((status = deflateInit2(&(st->flate), level, Z_DEFLATED, 15, 8, zstrategy)) != Z_OK)
     {
       _pdfioFileError(st->pdf, "Unable to start Flate filter: %s", zstrerror(status));
       free(st->prbuffer);
@@ -328,6 +474,29 @@ _pdfioStreamCreate(
       free(st);
       return (NULL);
     }
+
+    st->zlevel    = level;
+    st->zstrategy = zstrategy;
+
+    if (st->pdf->zthreads > 1)
+    {
+      // Buffer data for parallel compression of large streams, starting with
+      // a small input buffer that grows as data is written...
+      st->zthreads  = st->pdf->zthreads;
+      st->zbufsize  = st->zthreads * _PDFIO_ZBLOCK_SIZE;
+      st->zbufalloc = _PDFIO_ZBUF_INITIAL;
+
+      if ((st->zbuffer = malloc(_PDFIO_ZDICT_SIZE + st->zbufalloc)) == NULL)
+      {
+	_pdfioFileError(st->pdf, "Unable to allocate %lu bytes for parallel Flate compression: %s", (unsigned long)(_PDFIO_ZDICT_SIZE + st->zbufalloc), strerror(errno));
+	deflateEnd(&(st->flate));
+	free(st->cbuffer);
+	free(st->prbuffer);
+	free(st->psbuffer);
+	free(st);
+	return (NULL);
+      }
+    }
   }
 
   return (st);
@@ -436,7 +605,7 @@ _pdfioStreamOpen(pdfio_obj_t *obj,	// I - Object
     return (NULL);
   }
 
-  st->pdf = obj->pdf;
+  st->pdf = _pdfioObjGetReadFile(obj);
   st->obj = obj;
 
   if ((st->remaining = pdfioObjGetLength(obj)) == 0 && !_pdfioDictGetValue(pdfioObjGetDict(obj), "Length"))
@@ -840,12 +1009,9 @@ pdfioStreamWrite(
     size_t         bytes)		// I - Number of bytes to write
 {
   size_t		pbpixel,	// Size of pixel in bytes
-      			pbline,		// Bytes per line
-			remaining;	// Remaining bytes on this line
-  const unsigned char	*bufptr,	// Pointer into buffer
-			*bufsecond;	// Pointer to second pixel in buffer
-  unsigned char		*sptr,		// Pointer into sbuffer
-			*pptr;		// Previous raw buffer
+      			pbline;		// Bytes per line
+  const unsigned char	*bufptr;	// Pointer into buffer
+  unsigned char		*sptr;		// Pointer into sbuffer
 
 
   PDFIO_DEBUG("pdfioStreamWrite(st=%p, buffer=%p, bytes=%lu)\n", (void *)st, buffer, (unsigned long)bytes);
@@ -881,7 +1047,7 @@ pdfioStreamWrite(
           {
             // Encrypt and flush
 	    outbytes = (st->crypto_cb)(&st->crypto_ctx, temp, (uint8_t *)st->buffer, sizeof(st->buffer));
-	    if (!_pdfioFileWrite(st->pdf, temp, outbytes))
+	    if (!stream_output(st, temp, outbytes))
 	      return (false);
 
 	    st->bufptr = st->buffer;
@@ -899,7 +1065,7 @@ pdfioStreamWrite(
           }
 
 	  outbytes = (st->crypto_cb)(&st->crypto_ctx, temp, bufptr, cbytes);
-	  if (!_pdfioFileWrite(st->pdf, temp, outbytes))
+	  if (!stream_output(st, temp, outbytes))
 	    return (false);
         }
 
@@ -912,7 +1078,7 @@ pdfioStreamWrite(
     else
     {
       // Write unencrypted...
-      return (_pdfioFileWrite(st->pdf, buffer, bytes));
+      return (stream_output(st, buffer, bytes));
     }
   }
 
@@ -929,84 +1095,228 @@ pdfioStreamWrite(
     return (false);
   }
 
-  pbpixel   = st->pbpixel;
-  bufptr    = (const unsigned char *)buffer;
-  bufsecond = bufptr + pbpixel;
+  pbpixel = st->pbpixel;
+  bufptr  = (const unsigned char *)buffer;
 
   while (bytes > 0)
   {
-    // Store the PNG predictor in the first byte of the buffer...
     if (st->predictor == _PDFIO_PREDICTOR_PNG_AUTO)
-      st->psbuffer[0] = 4;		// Use Paeth predictor for auto...
-    else
-      st->psbuffer[0] = (unsigned char)(st->predictor - 10);
+    {
+      // Encode the line using all of the PNG filters and pick the one with
+      // the smallest sum of absolute differences...
+      size_t		cost,		// Cost of current filter
+			best_cost;	// Cost of best filter
+      unsigned char	type,		// Current filter type
+			best_type;	// Best filter type
+
+      for (type = 0, best_type = 0, best_cost = 0; type < 5; type ++)
+      {
+        sptr = st->psbuffer + type * st->pbsize;
 
-    // Then process the current line using the specified PNG predictor...
-    sptr = st->psbuffer + 1;
-    pptr = st->prbuffer;
+        stream_filter(sptr, bufptr, st->prbuffer, pbline, pbpixel, type);
 
-    switch (st->predictor)
+        if ((cost = stream_filter_cost(sptr + 1, pbline)) < best_cost || type == 0)
+        {
+          best_type = type;
+          best_cost = cost;
+	}
+      }
+
+      sptr = st->psbuffer + best_type * st->pbsize;
+    }
+    else
     {
-      default :
-          // Anti-compiler-warning code (NONE is handled above, TIFF is not supported for writing)
-	  return (false);
+      // Encode the line using the specified PNG filter...
+      sptr = st->psbuffer;
 
-      case _PDFIO_PREDICTOR_PNG_NONE :
-          // No PNG predictor...
-          memcpy(sptr, buffer, pbline);
-          break;
+      stream_filter(sptr, bufptr, st->prbuffer, pbline, pbpixel, (unsigned char)(st->predictor - _PDFIO_PREDICTOR_PNG_NONE));
+    }
 
-      case _PDFIO_PREDICTOR_PNG_SUB :
-	  // Encode the difference from the previous column
-	  for (remaining = pbline; remaining > 0; remaining --, bufptr ++, sptr ++)
-	  {
-	    if (bufptr >= bufsecond)
-	      *sptr = *bufptr - bufptr[-(int)pbpixel];
-	    else
-	      *sptr = *bufptr;
-	  }
-	  break;
+    // Write the encoded line...
+    if (!stream_write(st, sptr, st->pbsize))
+      return (false);
 
-      case _PDFIO_PREDICTOR_PNG_UP :
-	  // Encode the difference from the previous line
-	  for (remaining = pbline; remaining > 0; remaining --, bufptr ++, sptr ++, pptr ++)
-	  {
-	    *sptr = *bufptr - *pptr;
-	  }
-	  break;
+    memcpy(st->prbuffer, bufptr, pbline);
+    bufptr += pbline;
+    bytes  -= pbline;
+  }
 
-      case _PDFIO_PREDICTOR_PNG_AVERAGE :
-          // Encode the difference with the average of the previous column and line
-	  for (remaining = pbline; remaining > 0; remaining --, bufptr ++, sptr ++, pptr ++)
-	  {
-	    if (bufptr >= bufsecond)
-	      *sptr = *bufptr - (bufptr[-(int)pbpixel] + *pptr) / 2;
-	    else
-	      *sptr = *bufptr - *pptr / 2;
-	  }
-	  break;
+  return (true);
+}
 
-      case _PDFIO_PREDICTOR_PNG_PAETH :
-      case _PDFIO_PREDICTOR_PNG_AUTO :
-          // Encode the difference with a linear transform function
-	  for (remaining = pbline; remaining > 0; remaining --, bufptr ++, sptr ++, pptr ++)
-	  {
-	    if (bufptr >= bufsecond)
-	      *sptr = *bufptr - stream_paeth(bufptr[-(int)pbpixel], *pptr, pptr[-(int)pbpixel]);
-	    else
-	      *sptr = *bufptr - stream_paeth(0, *pptr, 0);
-	  }
-	  break;
-    }
 
-    // Write the encoded line...
-    if (!stream_write(st, st->psbuffer, st->pbsize))
+//
+// '_pdfioStreamWriteCoords()' - Write coordinates and an operator to a stream.
+//
+// This function works like @link _pdfioStreamWriteReals@ but formats the
+// values using the coordinate precision set with
+// @link pdfioFileSetPrecision@.
+//
+
+bool					// O - `true` on success, `false` on failure
+_pdfioStreamWriteCoords(
+    pdfio_stream_t *st,			// I - Stream
+    const char     *op,			// I - Operator
+    size_t         num_values,		// I - Number of values
+    ...)				// I - Values
+{
+  bool		ret;			// Return value
+  va_list	ap;			// Argument pointer
+
+
+  va_start(ap, num_values);
+  ret = stream_write_reals(st, op, st ? st->pdf->precision : 6, num_values, ap);
+  va_end(ap);
+
+  return (ret);
+}
+
+
+//
+// '_pdfioStreamWriteReals()' - Write real numbers and an operator to a stream.
+//
+// This function writes "num_values" `double` arguments separated by spaces,
+// followed by the operator and a newline.  The numbers are formatted using
+// @link _pdfio_ftoa@ instead of printf.
+//
+
+bool					// O - `true` on success, `false` on failure
+_pdfioStreamWriteReals(
+    pdfio_stream_t *st,			// I - Stream
+    const char     *op,			// I - Operator
+    size_t         num_values,		// I - Number of values
+    ...)				// I - Values
+{
+  bool		ret;			// Return value
+  va_list	ap;			// Argument pointer
+
+
+  va_start(ap, num_values);
+  ret = stream_write_reals(st, op, 6, num_values, ap);
+  va_end(ap);
+
+  return (ret);
+}
+
+
+//
+// 'stream_filter()' - Encode a line using a PNG filter.
+//
+// The first byte of the destination buffer is set to the filter type,
+// followed by the encoded line.  The first pixel is handled by its own loop
+// so that the loop for the rest of the line needs no per-byte checks.
+//
+
+static void
+stream_filter(
+    unsigned char       *dst,		// O - Destination buffer (pbline + 1 bytes)
+    const unsigned char *src,		// I - Current line
+    const unsigned char *prev,		// I - Previous line
+    size_t              pbline,		// I - Bytes per line
+    size_t              pbpixel,	// I - Bytes per pixel
+    unsigned char       type)		// I - PNG filter type (0-4)
+{
+  size_t	i;			// Looping var
+
+
+  if (pbpixel > pbline)
+    pbpixel = pbline;
+
+  *dst++ = type;
+
+  switch (type)
+  {
+    default :
+    case 0 : // None
+        memcpy(dst, src, pbline);
+        break;
+
+    case 1 : // Sub
+        for (i = 0; i < pbpixel; i ++)
+          dst[i] = src[i];
+        for (; i < pbline; i ++)
+          dst[i] = (unsigned char)(src[i] - src[i - pbpixel]);
+        break;
+
+    case 2 : // Up
+        for (i = 0; i < pbline; i ++)
+          dst[i] = (unsigned char)(src[i] - prev[i]);
+        break;
+
+    case 3 : // Average
+        for (i = 0; i < pbpixel; i ++)
+          dst[i] = (unsigned char)(src[i] - prev[i] / 2);
+        for (; i < pbline; i ++)
+          dst[i] = (unsigned char)(src[i] - (src[i - pbpixel] + prev[i]) / 2);
+        break;
+
+    case 4 : // Paeth
+        for (i = 0; i < pbpixel; i ++)
+          dst[i] = (unsigned char)(src[i] - prev[i]);
+        for (; i < pbline; i ++)
+          dst[i] = (unsigned char)(src[i] - stream_paeth(src[i - pbpixel], prev[i], prev[i - pbpixel]));
+        break;
+  }
+}
+
+
+//
+// 'stream_filter_cost()' - Compute the sum of absolute differences for a line.
+//
+
+static size_t				// O - Cost of filtered line
+stream_filter_cost(
+    const unsigned char *data,		// I - Filtered line
+    size_t              bytes)		// I - Number of bytes
+{
+  size_t	cost = 0;		// Cost
+
+
+  // Treat each filtered byte as a signed difference...
+  for (; bytes > 0; bytes --, data ++)
+    cost += (size_t)(*data < 128 ? *data : 256 - *data);
+
+  return (cost);
+}
+
+
+//
+// 'stream_output()' - Write stream data to the file or staging buffer.
+//
+
+static bool				// O - `true` on success, `false` on failure
+stream_output(pdfio_stream_t *st,	// I - Stream
+              const void     *buffer,	// I - Data to write
+              size_t         bytes)	// I - Number of bytes to write
+{
+  if (!st->staged)
+    return (_pdfioFileWrite(st->pdf, buffer, bytes));
+
+  // Expand the staging buffer as needed...
+  if ((st->sbufused + bytes) > st->sbufsize)
+  {
+    unsigned char	*temp;		// New staging buffer
+    size_t		tempsize;	// New size of staging buffer
+
+    if ((tempsize = 2 * st->sbufsize) < 65536)
+      tempsize = 65536;
+    if (tempsize < (st->sbufused + bytes))
+      tempsize = st->sbufused + bytes;
+
+    if ((temp = (unsigned char *)realloc(st->sbuffer, tempsize)) == NULL)
+    {
+      _pdfioFileError(st->pdf, "Unable to allocate memory for stream data.");
       return (false);
+    }
 
-    memcpy(st->prbuffer, buffer, pbline);
-    bytes -= pbline;
+    st->sbuffer  = temp;
+    st->sbufsize = tempsize;
   }
 
+  // Copy the data...
+  memcpy(st->sbuffer + st->sbufused, buffer, bytes);
+  st->sbufused += bytes;
+
   return (true);
 }
 
@@ -1311,6 +1621,51 @@ stream_write(pdfio_stream_t *st,	// I - Stream
   int	status;				// Compression status
 
 
+  if (st->zbuffer)
+  {
+    // Buffer the data for parallel compression...
+    const unsigned char	*bufptr = (const unsigned char *)buffer;
+					// Pointer into buffer
+    size_t		count;		// Number of bytes to copy
+
+    while (bytes > 0)
+    {
+      if (st->zbufused >= st->zbufsize && !stream_zflush(st, false))
+        return (false);
+
+      if (st->zbufused >= st->zbufalloc)
+      {
+        // Grow the input buffer...
+        size_t		zbufalloc = 2 * st->zbufalloc;
+					// New size of input buffer
+        unsigned char	*zbuffer;	// New buffer
+
+        if (zbufalloc > st->zbufsize)
+          zbufalloc = st->zbufsize;
+
+        if ((zbuffer = realloc(st->zbuffer, _PDFIO_ZDICT_SIZE + zbufalloc)) == NULL)
+        {
+	  _pdfioFileError(st->pdf, "Unable to allocate %lu bytes for parallel Flate compression: %s", (unsigned long)(_PDFIO_ZDICT_SIZE + zbufalloc), strerror(errno));
+	  return (false);
+        }
+
+        st->zbuffer   = zbuffer;
+        st->zbufalloc = zbufalloc;
+      }
+
+      if ((count = st->zbufalloc - st->zbufused) > bytes)
+        count = bytes;
+
+      memcpy(st->zbuffer + _PDFIO_ZDICT_SIZE + st->zbufused, bufptr, count);
+
+      st->zbufused += count;
+      bufptr       += count;
+      bytes        -= count;
+    }
+
+    return (true);
+  }
+
   // Flate-compress the buffer...
   st->flate.avail_in = (uInt)bytes;
   st->flate.next_in  = (Bytef *)buffer;
@@ -1335,7 +1690,7 @@ stream_write(pdfio_stream_t *st,	// I - Stream
 
 //      fprintf(stderr, "stream_write: bytes=%u, outbytes=%u\n", (unsigned)bytes, (unsigned)outbytes);
 
-      if (!_pdfioFileWrite(st->pdf, st->cbuffer, outbytes))
+      if (!stream_output(st, st->cbuffer, outbytes))
         return (false);
 
       if (cbytes > outbytes)
@@ -1366,6 +1721,330 @@ stream_write(pdfio_stream_t *st,	// I - Stream
 }
 
 
+//
+// 'stream_write_reals()' - Write real numbers and an operator to a stream.
+//
+// Numbers with fewer than 6 decimal places are written without a leading
+// zero to further reduce the size of the content stream.
+//
+
+static bool				// O - `true` on success, `false` on failure
+stream_write_reals(
+    pdfio_stream_t *st,			// I - Stream
+    const char     *op,			// I - Operator
+    int            digits,		// I - Number of decimal places
+    size_t         num_values,		// I - Number of values
+    va_list        ap)			// I - Values
+{
+  char		buffer[512],		// Output buffer
+		*bufptr,		// Pointer into buffer
+		*end;			// End of formatted number
+  double	value;			// Current value
+  bool		compact = digits < 6;	// Omit leading zeros?
+
+
+  // Range check input...
+  if (!st || st->pdf->mode != _PDFIO_MODE_WRITE || !op || num_values > 16 || strlen(op) > 8)
+    return (false);
+
+  // Format the values and operator...
+  for (bufptr = buffer; num_values > 0; num_values --)
+  {
+    value = va_arg(ap, double);
+
+    if ((end = _pdfio_ftoa(bufptr, value, digits, compact)) != NULL)
+    {
+      bufptr    = end;
+      *bufptr++ = ' ';
+    }
+    else if ((bufptr > buffer && !pdfioStreamWrite(st, buffer, (size_t)(bufptr - buffer))) || !pdfioStreamPrintf(st, "%.6f ", value))
+    {
+      // Unable to write out of range number using printf...
+      return (false);
+    }
+    else
+    {
+      bufptr = buffer;
+    }
+  }
+
+  while (*op)
+    *bufptr++ = *op++;
+
+  *bufptr++ = '\n';
+
+  // Write the string...
+  return (pdfioStreamWrite(st, buffer, (size_t)(bufptr - buffer)));
+}
+
+
+//
+// 'stream_zflush()' - Compress buffered data in parallel.
+//
+// The buffered data is split into blocks that are compressed concurrently.
+// Each block is compressed as raw Flate data using the preceding 32k of data
+// as its dictionary and ends on a byte boundary (Z_SYNC_FLUSH), so the blocks
+// can be concatenated into a single ZLIB stream.
+//
+
+static bool				// O - `true` on success, `false` on failure
+stream_zflush(pdfio_stream_t *st,	// I - Stream
+              bool           last)	// I - Last data in stream?
+{
+  size_t	i,			// Looping var
+		num_jobs,		// Number of jobs
+		remaining;		// Remaining bytes
+  _pdfio_zjob_t	*job;			// Current job
+  unsigned char	*data = st->zbuffer + _PDFIO_ZDICT_SIZE,
+					// Start of buffered data
+		*dataptr,		// Pointer into buffered data
+		trailer[4];		// ZLIB trailer
+#ifdef HAVE_PTHREAD
+  pthread_t	threads[PDFIO_MAX_THREADS];
+					// Compression threads
+  bool		started[PDFIO_MAX_THREADS];
+					// Was the thread started?
+#endif // HAVE_PTHREAD
+
+
+  if (!st->zstarted)
+  {
+    // Allocate the job buffers and write the ZLIB header...
+    size_t		outsize = compressBound(_PDFIO_ZBLOCK_SIZE) + 64;
+					// Size of output buffers
+    unsigned char	header[2];	// ZLIB header
+
+    if ((st->zjobs = (_pdfio_zjob_t *)calloc(st->zthreads, sizeof(_pdfio_zjob_t))) == NULL)
+    {
+      _pdfioFileError(st->pdf, "Unable to allocate memory for parallel Flate compression: %s", strerror(errno));
+      return (false);
+    }
+
+    for (i = 0, job = st->zjobs; i < st->zthreads; i ++, job ++)
+    {
+      if ((job->out = malloc(outsize)) == NULL)
+      {
+	_pdfioFileError(st->pdf, "Unable to allocate memory for parallel Flate compression: %s", strerror(errno));
+	return (false);
+      }
+
+      job->outsize = outsize;
+    }
+
+    header[0] = 0x78;			// Deflate with 32k window
+    header[1] = (unsigned char)((st->zlevel < 2 ? 0 : st->zlevel < 6 ? 1 : st->zlevel == 6 ? 2 : 3) << 6);
+    header[1] = (unsigned char)(header[1] + 31 - (header[0] * 256 + header[1]) % 31);
+
+    st->zadler   = adler32(0L, Z_NULL, 0);
+    st->zstarted = true;
+
+    if (!stream_zoutput(st, header, sizeof(header)))
+      return (false);
+  }
+
+  // Split the buffered data into jobs...
+  for (num_jobs = 0, job = st->zjobs, dataptr = data, remaining = st->zbufused; num_jobs == 0 || remaining > 0; num_jobs ++, job ++)
+  {
+    job->level    = st->zlevel;
+    job->strategy = st->zstrategy;
+    job->dictlen  = dataptr == data ? st->zdictlen : _PDFIO_ZDICT_SIZE;
+    job->dict     = dataptr - job->dictlen;
+    job->in       = dataptr;
+    job->inlen    = remaining > _PDFIO_ZBLOCK_SIZE ? _PDFIO_ZBLOCK_SIZE : remaining;
+
+    dataptr   += job->inlen;
+    remaining -= job->inlen;
+
+    job->last = last && remaining == 0;
+  }
+
+  // Run the jobs...
+#ifdef HAVE_PTHREAD
+  for (i = 1; i < num_jobs; i ++)
+  {
+    if (pthread_create(threads + i, NULL, stream_zjob, st->zjobs + i))
+    {
+      // Unable to start a thread, compress in this one...
+      started[i] = false;
+      stream_zjob(st->zjobs + i);
+    }
+    else
+    {
+      started[i] = true;
+    }
+  }
+
+  stream_zjob(st->zjobs);
+
+  for (i = 1; i < num_jobs; i ++)
+  {
+    if (started[i])
+      pthread_join(threads[i], NULL);
+  }
+
+#else
+  for (i = 0; i < num_jobs; i ++)
+    stream_zjob(st->zjobs + i);
+#endif // HAVE_PTHREAD
+
+  // Write the compressed data in order...
+  for (i = 0, job = st->zjobs; i < num_jobs; i ++, job ++)
+  {
+    if (job->status != Z_OK)
+    {
+      _pdfioFileError(st->pdf, "Flate compression failed: %s", zstrerror(job->status));
+      return (false);
+    }
+
+    st->zadler = adler32_combine(st->zadler, job->adler, (z_off_t)job->inlen);
+
+    if (!stream_zoutput(st, job->out, job->outlen))
+      return (false);
+  }
+
+  // Save the last 32k as the dictionary for the next block...
+  if (st->zbufused >= _PDFIO_ZDICT_SIZE)
+  {
+    memmove(st->zbuffer, data + st->zbufused - _PDFIO_ZDICT_SIZE, _PDFIO_ZDICT_SIZE);
+    st->zdictlen = _PDFIO_ZDICT_SIZE;
+  }
+
+  st->zbufused = 0;
+
+  if (!last)
+    return (true);
+
+  // Write the ZLIB trailer with the Adler-32 checksum...
+  trailer[0] = (unsigned char)(st->zadler >> 24);
+  trailer[1] = (unsigned char)(st->zadler >> 16);
+  trailer[2] = (unsigned char)(st->zadler >> 8);
+  trailer[3] = (unsigned char)st->zadler;
+
+  return (stream_zoutput(st, trailer, sizeof(trailer)));
+}
+
+
+//
+// 'stream_zjob()' - Compress a block of data.
+//
+
+static void *				// O - Thread exit status (unused)
+stream_zjob(void *data)			// I - Compression job
+{
+  _pdfio_zjob_t	*job = (_pdfio_zjob_t *)data;
+					// Compression job
+  z_stream	zs;			// Flate compression state
+  int		status;			// ZLIB status code
+
+
+  job->outlen = 0;
+  job->adler  = adler32(adler32(0L, Z_NULL, 0), job->in, (uInt)job->inlen);
+
+  // Start a raw Flate compression stream using the preceding data as the
+  // dictionary...
+  memset(&zs, 0, sizeof(zs));
+
+  if ((status = deflateInit2(&zs, job->level, Z_DEFLATED, -15, 8, job->strategy)) != Z_OK)
+  {
+    job->status = status;
+    return (NULL);
+  }
+
+  if (job->dictlen > 0 && (status = deflateSetDictionary(&zs, job->dict, (uInt)job->dictlen)) != Z_OK)
+  {
+    deflateEnd(&zs);
+    job->status = status;
+    return (NULL);
+  }
+
+  // Compress the block, ending on a byte boundary unless this is the last
+  // block...
+  zs.next_in   = (Bytef *)job->in;
+  zs.avail_in  = (uInt)job->inlen;
+  zs.next_out  = (Bytef *)job->out;
+  zs.avail_out = (uInt)job->outsize;
+
+  status = deflate(&zs, job->last ? Z_FINISH : Z_SYNC_FLUSH);
+
+  if ((job->last && status == Z_STREAM_END) || (!job->last && status == Z_OK && zs.avail_in == 0 && zs.avail_out > 0))
+    job->status = Z_OK;
+  else if (status >= Z_OK)
+    job->status = Z_BUF_ERROR;		// Ran out of output buffer
+  else
+    job->status = status;
+
+  job->outlen = job->outsize - zs.avail_out;
+
+  deflateEnd(&zs);
+
+  return (NULL);
+}
+
+
+//
+// 'stream_zoutput()' - Write parallel-compressed data...
+//
+
+static bool				// O - `true` on success, `false` on failure
+stream_zoutput(
+    pdfio_stream_t      *st,		// I - Stream
+    const unsigned char *data,		// I - Compressed data
+    size_t              bytes)		// I - Number of bytes
+{
+  size_t	count;			// Number of bytes to copy
+
+
+  while (bytes > 0)
+  {
+    // Copy what we can to the compression buffer...
+    if ((count = st->flate.avail_out) > bytes)
+      count = bytes;
+
+    memcpy(st->flate.next_out, data, count);
+
+    st->flate.next_out  += count;
+    st->flate.avail_out -= (uInt)count;
+    data                += count;
+    bytes               -= count;
+
+    if (st->flate.avail_out < (st->cbsize / 8))
+    {
+      // Flush the compression buffer...
+      size_t	cbytes = st->cbsize - st->flate.avail_out,
+		outbytes;
+
+      if (st->crypto_cb)
+      {
+        // Encrypt it first...
+        outbytes = (st->crypto_cb)(&st->crypto_ctx, st->cbuffer, st->cbuffer, cbytes & (size_t)~15);
+      }
+      else
+      {
+        outbytes = cbytes;
+      }
+
+      if (!stream_output(st, st->cbuffer, outbytes))
+        return (false);
+
+      if (cbytes > outbytes)
+      {
+        cbytes -= outbytes;
+        memmove(st->cbuffer, st->cbuffer + outbytes, cbytes);
+      }
+      else
+      {
+        cbytes = 0;
+      }
+
+      st->flate.next_out  = (Bytef *)st->cbuffer + cbytes;
+      st->flate.avail_out = (uInt)(st->cbsize - cbytes);
+    }
+  }
+
+  return (true);
+}
+
+
 //
 // 'zstrerror()' - Return a string for a zlib error number.
 //
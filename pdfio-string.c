@@ -8,6 +8,7 @@
 //
 
 #include "pdfio-private.h"
+#include <math.h>
 
 
 //
@@ -17,6 +18,118 @@
 static size_t	find_string(pdfio_file_t *pdf, const char *s, int *rdiff);
 
 
+//
+// '_pdfio_ftoa()' - Format a real number with up to 6 decimal places.
+//
+// This function formats a number like the "%.Nf" printf format with trailing
+// zeros removed, without using printf or the current locale.  Numbers are
+// rounded the same way as printf, using the exact binary value and rounding
+// ties to even, and negative numbers that round to zero are written as "-0".
+// The "digits" argument specifies the number of decimal places from `0` to
+// `6`.  When "compact" is `true`, the leading zero of numbers between -1 and 1
+// is omitted (".5" instead of "0.5").  The buffer must hold at least 24
+// characters.
+// `NULL` is returned for numbers that are not finite or whose magnitude is 1e12
+// or more so the caller can fall back to printf.
+//
+
+char *					// O - Pointer to nul at end of string or `NULL` if out of range
+_pdfio_ftoa(char   *buffer,		// I - Output buffer
+            double value,		// I - Value
+            int    digits,		// I - Number of decimal places (`0` to `6`)
+            bool   compact)		// I - Omit leading zero?
+{
+  static const unsigned powers[7] =	// Powers of 10
+  {
+    1, 10, 100, 1000, 10000, 100000, 1000000
+  };
+  char		*bufptr = buffer,	// Pointer into buffer
+		temp[16],		// Integer digits in reverse order
+		*tempptr = temp;	// Pointer into integer digits
+  uint64_t	ipart;			// Integer part
+  unsigned	fpart,			// Fractional part in units of the last digit
+		scale,			// Scale for fractional part
+		divisor;		// Digit divisor
+  double	frac,			// Fractional part
+		rem;			// Remainder after the last digit
+  bool		negative;		// Negative value?
+
+
+  // Range check input (also catches NaN)...
+  if (!(value > -1e12 && value < 1e12))
+    return (NULL);
+
+  if (digits < 0)
+    digits = 0;
+  else if (digits > 6)
+    digits = 6;
+
+  // Split into integer and fractional parts, rounding to the last decimal
+  // place...
+  if ((negative = signbit(value) != 0) == true)
+    value = -value;
+
+  scale = powers[digits];
+  ipart = (uint64_t)value;
+  frac  = value - (double)ipart;	// Exact since value < 2^52
+  fpart = (unsigned)(frac * scale);
+  rem   = frac * scale - fpart;
+
+  if (rem > 0.4999 && rem < 0.5001)
+  {
+    // Close to halfway, so use the exact product to round like printf with
+    // ties going to the even digit...
+    rem = fma(frac, (double)scale, -((double)fpart + 0.5));
+
+    if (rem > 0.0 || (rem == 0.0 && ((digits ? fpart : (unsigned)ipart) & 1)))
+      fpart ++;
+  }
+  else if (rem >= 0.5)
+  {
+    fpart ++;
+  }
+
+  if (fpart >= scale)
+  {
+    ipart ++;
+    fpart -= scale;
+  }
+
+  if (negative)
+    *bufptr++ = '-';
+
+  // Integer part...
+  if (ipart || !compact || !fpart)
+  {
+    do
+    {
+      *tempptr++ = (char)('0' + ipart % 10);
+      ipart /= 10;
+    }
+    while (ipart > 0);
+  }
+
+  while (tempptr > temp)
+    *bufptr++ = *--tempptr;
+
+  // Fractional part, without trailing zeros...
+  if (fpart)
+  {
+    *bufptr++ = '.';
+
+    for (divisor = scale / 10; fpart; divisor /= 10)
+    {
+      *bufptr++ = (char)('0' + fpart / divisor);
+      fpart %= divisor;
+    }
+  }
+
+  *bufptr = '\0';
+
+  return (bufptr);
+}
+
+
 //
 // '_pdfio_strlcpy()' - Safe string copy.
 //
@@ -390,7 +503,19 @@ _pdfio_vsnprintf(pdfio_file_t *pdf,	// I - PDF file
 	    if ((size_t)(width + 2) > sizeof(temp))
 	      break;
 
-	    snprintf(temp, sizeof(temp), tformat, va_arg(ap, double));
+            if (!strcmp(tformat, "%.6f"))
+            {
+              // Use the fast formatter for the common "%.6f" format...
+              double value = va_arg(ap, double);
+					// Value to format
+
+              if (!_pdfio_ftoa(temp, value, 6, false))
+		snprintf(temp, sizeof(temp), tformat, value);
+            }
+            else
+            {
+	      snprintf(temp, sizeof(temp), tformat, va_arg(ap, double));
+	    }
 
 	    if ((decptr = strstr(temp, dec)) != NULL)
 	    {
@@ -679,19 +804,25 @@ _pdfioStringAllocBuffer(
   _pdfio_strbuf_t	*current;	// Current string buffer
 
 
+  _pdfioFileLock(pdf);
+
   // See if we have an available string buffer...
   for (current = pdf->strbuffers; current; current = current->next)
   {
     if (!current->bufused)
     {
       current->bufused = true;
+      _pdfioFileUnlock(pdf);
       return (current->buffer);
     }
   }
 
   // Didn't find one, allocate a new one...
   if ((current = calloc(1, sizeof(_pdfio_strbuf_t))) == NULL)
+  {
+    _pdfioFileUnlock(pdf);
     return (NULL);
+  }
 
   // Add to the linked list of string buffers...
   current->next    = pdf->strbuffers;
@@ -699,6 +830,8 @@ _pdfioStringAllocBuffer(
 
   pdf->strbuffers = current;
 
+  _pdfioFileUnlock(pdf);
+
   return (current->buffer);
 }
 
@@ -729,12 +862,18 @@ pdfioStringCreate(
   if (!pdf || !s)
     return (NULL);
 
+  _pdfioFileLock(pdf);
+
   // See if the string has already been added...
   if (pdf->num_strings > 0)
   {
     idx = find_string(pdf, s, &diff);
     if (diff == 0)
-      return (pdf->strings[idx]);
+    {
+      news = pdf->strings[idx];
+      _pdfioFileUnlock(pdf);
+      return (news);
+    }
   }
   else
   {
@@ -744,7 +883,10 @@ pdfioStringCreate(
 
   // Not already added, so add it...
   if ((news = strdup(s)) == NULL)
+  {
+    _pdfioFileUnlock(pdf);
     return (NULL);
+  }
 
   if (pdf->num_strings >= pdf->alloc_strings)
   {
@@ -753,6 +895,7 @@ pdfioStringCreate(
 
     if (!temp)
     {
+      _pdfioFileUnlock(pdf);
       free(news);
       return (NULL);
     }
@@ -775,6 +918,8 @@ pdfioStringCreate(
 
   PDFIO_DEBUG("pdfioStringCreate: %lu strings\n", (unsigned long)pdf->num_strings);
 
+  _pdfioFileUnlock(pdf);
+
   return (news);
 }
 
@@ -825,6 +970,8 @@ _pdfioStringFreeBuffer(
   _pdfio_strbuf_t	*current;	// Current string buffer
 
 
+  _pdfioFileLock(pdf);
+
   for (current = pdf->strbuffers; current; current = current->next)
   {
     if (current->buffer == buffer)
@@ -833,6 +980,8 @@ _pdfioStringFreeBuffer(
       break;
     }
   }
+
+  _pdfioFileUnlock(pdf);
 }
 
 
@@ -845,13 +994,15 @@ _pdfioStringIsAllocated(
     pdfio_file_t *pdf,			// I - PDF file
     const char   *s)			// I - String
 {
-  int	diff;				// Difference
+  int	diff = -1;			// Difference
+
 
+  _pdfioFileLock(pdf);
 
-  if (pdf->num_strings == 0)
-    return (false);
+  if (pdf->num_strings > 0)
+    find_string(pdf, s, &diff);
 
-  find_string(pdf, s, &diff);
+  _pdfioFileUnlock(pdf);
 
   return (diff == 0);
 }
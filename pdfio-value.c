@@ -326,6 +326,74 @@ _pdfioValueDelete(_pdfio_value_t *v)	// I - Value
 }
 
 
+//
+// '_pdfioValueHash()' - Add a value to a SHA-256 digest.
+//
+
+void
+_pdfioValueHash(_pdfio_value_t  *v,	// I - Value
+                _pdfio_sha256_t *sha256)// I - SHA-256 context
+{
+  size_t	i;			// Looping var
+  _pdfio_value_t *av;			// Current array value
+  _pdfio_pair_t	*pair;			// Current dictionary pair
+  uint8_t	type = (uint8_t)v->type;// Value type
+
+
+  _pdfioCryptoSHA256Append(sha256, &type, 1);
+
+  switch (v->type)
+  {
+    default :
+        break;
+
+    case PDFIO_VALTYPE_ARRAY :
+        _pdfioCryptoSHA256Append(sha256, (uint8_t *)&v->value.array->num_values, sizeof(v->value.array->num_values));
+
+        for (i = v->value.array->num_values, av = v->value.array->values; i > 0; i --, av ++)
+          _pdfioValueHash(av, sha256);
+        break;
+
+    case PDFIO_VALTYPE_BINARY :
+        _pdfioCryptoSHA256Append(sha256, (uint8_t *)&v->value.binary.datalen, sizeof(v->value.binary.datalen));
+        _pdfioCryptoSHA256Append(sha256, v->value.binary.data, v->value.binary.datalen);
+        break;
+
+    case PDFIO_VALTYPE_BOOLEAN :
+        _pdfioCryptoSHA256Append(sha256, (uint8_t *)&v->value.boolean, sizeof(v->value.boolean));
+        break;
+
+    case PDFIO_VALTYPE_DATE :
+        _pdfioCryptoSHA256Append(sha256, (uint8_t *)&v->value.date, sizeof(v->value.date));
+        break;
+
+    case PDFIO_VALTYPE_DICT :
+        // Dictionary pairs are always sorted by key...
+        _pdfioCryptoSHA256Append(sha256, (uint8_t *)&v->value.dict->num_pairs, sizeof(v->value.dict->num_pairs));
+
+        for (i = v->value.dict->num_pairs, pair = v->value.dict->pairs; i > 0; i --, pair ++)
+        {
+          _pdfioCryptoSHA256Append(sha256, (const uint8_t *)pair->key, strlen(pair->key) + 1);
+          _pdfioValueHash(&pair->value, sha256);
+        }
+        break;
+
+    case PDFIO_VALTYPE_INDIRECT :
+        _pdfioCryptoSHA256Append(sha256, (uint8_t *)&v->value.indirect.number, sizeof(v->value.indirect.number));
+        break;
+
+    case PDFIO_VALTYPE_NAME :
+    case PDFIO_VALTYPE_STRING :
+        _pdfioCryptoSHA256Append(sha256, (const uint8_t *)v->value.string, strlen(v->value.string) + 1);
+        break;
+
+    case PDFIO_VALTYPE_NUMBER :
+        _pdfioCryptoSHA256Append(sha256, (uint8_t *)&v->value.number, sizeof(v->value.number));
+        break;
+  }
+}
+
+
 //
 // '_pdfioValueRead()' - Read a value from a file.
 //
@@ -729,7 +797,10 @@ _pdfioValueWrite(pdfio_file_t   *pdf,	// I - PDF file
         return (_pdfioDictWrite(v->value.dict, obj, length));
 
     case PDFIO_VALTYPE_INDIRECT :
-        return (_pdfioFilePrintf(pdf, " %lu %u R", (unsigned long)v->value.indirect.number, v->value.indirect.generation));
+        if (pdf->renumber && v->value.indirect.number <= pdf->num_objs)
+          return (_pdfioFilePrintf(pdf, " %lu %u R", (unsigned long)pdf->renumber[v->value.indirect.number], v->value.indirect.generation));
+        else
+          return (_pdfioFilePrintf(pdf, " %lu %u R", (unsigned long)v->value.indirect.number, v->value.indirect.generation));
 
     case PDFIO_VALTYPE_NAME :
         return (_pdfioFilePrintf(pdf, "%N", v->value.name));
@@ -124,6 +124,15 @@ typedef enum pdfio_valtype_e		// PDF value types
   PDFIO_VALTYPE_STRING			// String
 } pdfio_valtype_t;
 
+typedef enum pdfio_zstrategy_e		// Flate compression strategies
+{
+  PDFIO_ZSTRATEGY_AUTO = -1,		// Automatic/file default strategy
+  PDFIO_ZSTRATEGY_DEFAULT,		// Default strategy for general data
+  PDFIO_ZSTRATEGY_FILTERED,		// Strategy for filtered (predicted) image data
+  PDFIO_ZSTRATEGY_HUFFMAN_ONLY,		// Huffman coding only, no string matching
+  PDFIO_ZSTRATEGY_RLE			// Run-length encoding of repeated bytes
+} pdfio_zstrategy_t;
+
 
 //
 // Functions...
@@ -197,6 +206,7 @@ extern pdfio_file_t	*pdfioFileCreateTemporary(char *buffer, size_t bufsize, cons
 extern pdfio_obj_t	*pdfioFileFindObj(pdfio_file_t *pdf, size_t number) _PDFIO_PUBLIC;
 extern const char	*pdfioFileGetAuthor(pdfio_file_t *pdf) _PDFIO_PUBLIC;
 extern pdfio_dict_t	*pdfioFileGetCatalog(pdfio_file_t *pdf) _PDFIO_PUBLIC;
+extern int		pdfioFileGetCompression(pdfio_file_t *pdf, pdfio_zstrategy_t *strategy) _PDFIO_PUBLIC;
 extern time_t		pdfioFileGetCreationDate(pdfio_file_t *pdf) _PDFIO_PUBLIC;
 extern const char	*pdfioFileGetCreator(pdfio_file_t *pdf) _PDFIO_PUBLIC;
 extern pdfio_array_t	*pdfioFileGetID(pdfio_file_t *pdf) _PDFIO_PUBLIC;
@@ -213,19 +223,32 @@ extern const char	*pdfioFileGetProducer(pdfio_file_t *pdf) _PDFIO_PUBLIC;
 extern const char	*pdfioFileGetSubject(pdfio_file_t *pdf) _PDFIO_PUBLIC;
 extern const char	*pdfioFileGetTitle(pdfio_file_t *pdf) _PDFIO_PUBLIC;
 extern const char	*pdfioFileGetVersion(pdfio_file_t *pdf) _PDFIO_PUBLIC;
+extern bool		pdfioFileMergeFiles(pdfio_file_t *pdf, size_t num_files, const char * const *filenames, pdfio_password_cb_t password_cb, void *password_data) _PDFIO_PUBLIC;
 extern pdfio_file_t	*pdfioFileOpen(const char *filename, pdfio_password_cb_t password_cb, void *password_data, pdfio_error_cb_t error_cb, void *error_data) _PDFIO_PUBLIC;
+extern pdfio_file_t	*pdfioFileOpenUpdate(const char *filename, pdfio_error_cb_t error_cb, void *error_data) _PDFIO_PUBLIC;
 extern void		pdfioFileSetAuthor(pdfio_file_t *pdf, const char *value) _PDFIO_PUBLIC;
+extern bool		pdfioFileSetCompression(pdfio_file_t *pdf, int level, pdfio_zstrategy_t strategy) _PDFIO_PUBLIC;
+extern bool		pdfioFileSetCompressionThreads(pdfio_file_t *pdf, size_t num_threads) _PDFIO_PUBLIC;
 extern void		pdfioFileSetCreationDate(pdfio_file_t *pdf, time_t value) _PDFIO_PUBLIC;
 extern void		pdfioFileSetCreator(pdfio_file_t *pdf, const char *value) _PDFIO_PUBLIC;
+extern bool		pdfioFileSetFontCache(pdfio_file_t *pdf, bool value) _PDFIO_PUBLIC;
+extern bool		pdfioFileSetFontSubsetting(pdfio_file_t *pdf, bool value) _PDFIO_PUBLIC;
 extern void		pdfioFileSetKeywords(pdfio_file_t *pdf, const char *value) _PDFIO_PUBLIC;
 extern void		pdfioFileSetLanguage(pdfio_file_t *pdf, const char *value) _PDFIO_PUBLIC;
+extern bool		pdfioFileSetLinearized(pdfio_file_t *pdf, bool value) _PDFIO_PUBLIC;
 extern void		pdfioFileSetModificationDate(pdfio_file_t *pdf, time_t value) _PDFIO_PUBLIC;
+extern bool		pdfioFileSetObjectStreams(pdfio_file_t *pdf, bool value) _PDFIO_PUBLIC;
 extern bool		pdfioFileSetPermissions(pdfio_file_t *pdf, pdfio_permission_t permissions, pdfio_encryption_t encryption, const char *owner_password, const char *user_password) _PDFIO_PUBLIC;
+extern bool		pdfioFileSetPrecision(pdfio_file_t *pdf, int digits) _PDFIO_PUBLIC;
+extern bool		pdfioFileSetResourceCache(pdfio_file_t *pdf, bool value) _PDFIO_PUBLIC;
+extern bool		pdfioFileSetStagedStreams(pdfio_file_t *pdf, bool value) _PDFIO_PUBLIC;
 extern void		pdfioFileSetSubject(pdfio_file_t *pdf, const char *value) _PDFIO_PUBLIC;
+extern bool		pdfioFileSetThreadSafe(pdfio_file_t *pdf, bool value) _PDFIO_PUBLIC;
 extern void		pdfioFileSetTitle(pdfio_file_t *pdf, const char *value) _PDFIO_PUBLIC;
 
 extern bool		pdfioObjClose(pdfio_obj_t *obj) _PDFIO_PUBLIC;
 extern pdfio_obj_t	*pdfioObjCopy(pdfio_file_t *pdf, pdfio_obj_t *srcobj) _PDFIO_PUBLIC;
+extern pdfio_stream_t	*pdfioObjCreateFlateStream(pdfio_obj_t *obj, int level, pdfio_zstrategy_t strategy) _PDFIO_PUBLIC;
 extern pdfio_stream_t	*pdfioObjCreateStream(pdfio_obj_t *obj, pdfio_filter_t compression) _PDFIO_PUBLIC;
 extern pdfio_array_t	*pdfioObjGetArray(pdfio_obj_t *obj) _PDFIO_PUBLIC;
 extern pdfio_dict_t	*pdfioObjGetDict(pdfio_obj_t *obj) _PDFIO_PUBLIC;
@@ -236,6 +259,7 @@ extern size_t		pdfioObjGetNumber(pdfio_obj_t *obj) _PDFIO_PUBLIC;
 extern const char	*pdfioObjGetSubtype(pdfio_obj_t *obj) _PDFIO_PUBLIC;
 extern const char	*pdfioObjGetType(pdfio_obj_t *obj) _PDFIO_PUBLIC;
 extern pdfio_stream_t	*pdfioObjOpenStream(pdfio_obj_t *obj, bool decode) _PDFIO_PUBLIC;
+extern bool		pdfioObjUpdate(pdfio_obj_t *obj) _PDFIO_PUBLIC;
 
 extern bool		pdfioPageCopy(pdfio_file_t *pdf, pdfio_obj_t *srcpage) _PDFIO_PUBLIC;
 extern size_t		pdfioPageGetNumStreams(pdfio_obj_t *page) _PDFIO_PUBLIC;
@@ -15,9 +15,11 @@
 
 #include "pdfio-private.h"
 #include "pdfio-content.h"
+#include "ttf.h"
 #include "test.h"
 #include <math.h>
 #include <locale.h>
+#include <sys/stat.h>
 #ifndef M_PI
 #  define M_PI	3.14159265358979323846264338327950288
 #endif // M_PI
@@ -27,16 +29,27 @@
 // Local functions...
 //
 
+static int	do_cache_tests(void);
 static int	do_crypto_tests(void);
+static int	do_font_cache_tests(void);
+static int	do_image_tests(void);
+static int	do_linear_tests(void);
+static int	do_merge_tests(void);
+static int	do_page_tree_tests(void);
 static int	do_pdfa_tests(void);
+static int	do_stream_tests(void);
+static int	do_subset_tests(void);
 static int	do_test_file(const char *filename, int objnum, const char *password, bool verbose);
+static int	do_thread_tests(void);
 static int	do_unit_tests(void);
+static int	do_update_tests(void);
 static int	draw_image(pdfio_stream_t *st, const char *name, double x, double y, double w, double h, const char *label);
 static bool	error_cb(pdfio_file_t *pdf, const char *message, bool *error);
 static bool	iterate_cb(pdfio_dict_t *dict, const char *key, void *cb_data);
 static ssize_t	output_cb(int *fd, const void *buffer, size_t bytes);
 static const char *password_cb(void *data, const char *filename);
 static int	read_unit_file(const char *filename, size_t num_pages, size_t first_image, bool is_output);
+static void	*thread_cb(pdfio_file_t *pdf);
 static ssize_t	token_consume_cb(const char **s, size_t bytes);
 static ssize_t	token_peek_cb(const char **s, char *buffer, size_t bytes);
 static int	usage(FILE *fp);
@@ -130,6 +143,225 @@ main(int  argc,				// I - Number of command-line arguments
   return (ret);
 }
 
+
+//
+// 'do_cache_tests()' - Test reusing identical fonts, images, and ICC profiles.
+//
+
+static int				// O - 0 on success, 1 on error
+do_cache_tests(void)
+{
+  pdfio_file_t	*pdf;			// PDF file
+  pdfio_obj_t	*obj1,			// First object
+		*obj2;			// Second object
+  bool		error = false;		// Error flag
+  unsigned char	pixels[16 * 16 * 3];	// Image pixels
+  FILE		*fp;			// Image file
+  unsigned char	*data = NULL;		// Encoded image data
+  size_t	datalen;		// Length of encoded image data
+
+
+  testBegin("pdfioFileCreate(\"testpdfio-cache.pdf\", ...)");
+  if ((pdf = pdfioFileCreate("testpdfio-cache.pdf", /*version*/NULL, /*media_box*/NULL, /*crop_box*/NULL, (pdfio_error_cb_t)error_cb, &error)) != NULL)
+  {
+    testEnd(true);
+  }
+  else
+  {
+    testEnd(false);
+    return (1);
+  }
+
+  testBegin("pdfioFileSetResourceCache(true)");
+  if (pdfioFileSetResourceCache(pdf, true))
+  {
+    testEnd(true);
+  }
+  else
+  {
+    testEnd(false);
+    goto fail;
+  }
+
+  testBegin("pdfioFileCreateFontObjFromFile(OpenSans-Regular.ttf, twice)");
+  obj1 = pdfioFileCreateFontObjFromFile(pdf, "testfiles/OpenSans-Regular.ttf", true);
+  obj2 = pdfioFileCreateFontObjFromFile(pdf, "testfiles/OpenSans-Regular.ttf", true);
+  if (obj1 && obj1 == obj2)
+  {
+    testEnd(true);
+  }
+  else
+  {
+    testEndMessage(false, "got objects %u and %u", (unsigned)pdfioObjGetNumber(obj1), (unsigned)pdfioObjGetNumber(obj2));
+    goto fail;
+  }
+
+  testBegin("pdfioFileCreateFontObjFromFile(OpenSans-Regular.ttf, CP1252)");
+  obj2 = pdfioFileCreateFontObjFromFile(pdf, "testfiles/OpenSans-Regular.ttf", false);
+  if (obj2 && obj1 != obj2)
+  {
+    testEnd(true);
+  }
+  else
+  {
+    testEnd(false);
+    goto fail;
+  }
+
+  testBegin("pdfioFileCreateImageObjFromFile(pdfio-color.png, twice)");
+  obj1 = pdfioFileCreateImageObjFromFile(pdf, "testfiles/pdfio-color.png", false);
+  obj2 = pdfioFileCreateImageObjFromFile(pdf, "testfiles/pdfio-color.png", false);
+  if (obj1 && obj1 == obj2)
+  {
+    testEnd(true);
+  }
+  else
+  {
+    testEndMessage(false, "got objects %u and %u", (unsigned)pdfioObjGetNumber(obj1), (unsigned)pdfioObjGetNumber(obj2));
+    goto fail;
+  }
+
+  testBegin("pdfioFileCreateImageObjFromFile(pdfio-color.png, interpolate)");
+  obj2 = pdfioFileCreateImageObjFromFile(pdf, "testfiles/pdfio-color.png", true);
+  if (obj2 && obj1 != obj2)
+  {
+    testEnd(true);
+  }
+  else
+  {
+    testEnd(false);
+    goto fail;
+  }
+
+  if ((data = (unsigned char *)malloc(131072)) == NULL)
+  {
+    perror("Unable to allocate image buffer");
+    goto fail;
+  }
+
+  testBegin("pdfioFileCreateImageObjFromEncodedData(pdfio-color.png)");
+  if ((fp = fopen("testfiles/pdfio-color.png", "rb")) == NULL)
+  {
+    testEndMessage(false, "%s", strerror(errno));
+    goto fail;
+  }
+
+  datalen = fread(data, 1, 131072, fp);
+  fclose(fp);
+
+  obj2 = pdfioFileCreateImageObjFromEncodedData(pdf, data, datalen, false);
+  if (obj1 && obj1 == obj2)
+  {
+    testEnd(true);
+  }
+  else
+  {
+    testEndMessage(false, "got objects %u and %u", (unsigned)pdfioObjGetNumber(obj1), (unsigned)pdfioObjGetNumber(obj2));
+    goto fail;
+  }
+
+  testBegin("pdfioFileCreateImageObjFromEncodedData(color.jpg)");
+  if ((fp = fopen("testfiles/color.jpg", "rb")) == NULL)
+  {
+    testEndMessage(false, "%s", strerror(errno));
+    goto fail;
+  }
+
+  datalen = fread(data, 1, 131072, fp);
+  fclose(fp);
+
+  obj1 = pdfioFileCreateImageObjFromEncodedData(pdf, data, datalen, true);
+  obj2 = pdfioFileCreateImageObjFromFile(pdf, "testfiles/color.jpg", true);
+  if (obj1 && obj1 == obj2 && pdfioDictGetNumber(pdfioObjGetDict(obj1), "Width") == 512 && !strcmp(pdfioDictGetName(pdfioObjGetDict(obj1), "Filter"), "DCTDecode"))
+  {
+    testEnd(true);
+  }
+  else
+  {
+    testEndMessage(false, "got objects %u and %u", (unsigned)pdfioObjGetNumber(obj1), (unsigned)pdfioObjGetNumber(obj2));
+    goto fail;
+  }
+
+  testBegin("pdfioFileCreateImageObjFromEncodedData(bad data)");
+  memset(data, 0, 64);
+  if (!pdfioFileCreateImageObjFromEncodedData(pdf, data, 64, false))
+  {
+    testEnd(true);
+    error = false;
+  }
+  else
+  {
+    testEnd(false);
+    goto fail;
+  }
+
+  free(data);
+  data = NULL;
+
+  memset(pixels, 0x80, sizeof(pixels));
+
+  testBegin("pdfioFileCreateImageObjFromData(twice)");
+  obj1 = pdfioFileCreateImageObjFromData(pdf, pixels, 16, 16, 3, NULL, false, false);
+  obj2 = pdfioFileCreateImageObjFromData(pdf, pixels, 16, 16, 3, NULL, false, false);
+  if (obj1 && obj1 == obj2)
+  {
+    testEnd(true);
+  }
+  else
+  {
+    testEndMessage(false, "got objects %u and %u", (unsigned)pdfioObjGetNumber(obj1), (unsigned)pdfioObjGetNumber(obj2));
+    goto fail;
+  }
+
+  pixels[0] = 0;
+
+  testBegin("pdfioFileCreateImageObjFromData(different pixels)");
+  obj2 = pdfioFileCreateImageObjFromData(pdf, pixels, 16, 16, 3, NULL, false, false);
+  if (obj2 && obj1 != obj2)
+  {
+    testEnd(true);
+  }
+  else
+  {
+    testEnd(false);
+    goto fail;
+  }
+
+  testBegin("pdfioFileCreateICCObjFromFile(iso22028-2-romm-rgb.icc, twice)");
+  obj1 = pdfioFileCreateICCObjFromFile(pdf, "testfiles/iso22028-2-romm-rgb.icc", 3);
+  obj2 = pdfioFileCreateICCObjFromFile(pdf, "testfiles/iso22028-2-romm-rgb.icc", 3);
+  if (obj1 && obj1 == obj2)
+  {
+    testEnd(true);
+  }
+  else
+  {
+    testEndMessage(false, "got objects %u and %u", (unsigned)pdfioObjGetNumber(obj1), (unsigned)pdfioObjGetNumber(obj2));
+    goto fail;
+  }
+
+  testBegin("pdfioFileClose(\"testpdfio-cache.pdf\")");
+  if (pdfioFileClose(pdf))
+  {
+    testEnd(true);
+  }
+  else
+  {
+    testEnd(false);
+    return (1);
+  }
+
+  return (0);
+
+  fail:
+
+  free(data);
+  pdfioFileClose(pdf);
+
+  return (1);
+}
+
+
 //
 // 'do_crypto_tests()' - Test the various cryptographic functions in PDFio.
 //
@@ -374,61 +606,2078 @@ do_crypto_tests(void)
 
 
 //
-// 'do_pdfa_tests()' - Run PDF/A generation and compliance tests.
+// 'do_font_cache_tests()' - Test sharing fonts between PDF files.
 //
 
-static int				// O - 0 on success, 1 on error
-do_pdfa_tests(void)
+static int				// O - Exit status
+do_font_cache_tests(void)
 {
-  int		status = 0;		// Overall status
-  pdfio_file_t	*pdf;			// PDF file for encryption test
+  int		i;			// Looping var
+  pdfio_file_t	*pdfs[2] = { NULL, NULL };
+					// PDF files
+  pdfio_obj_t	*font,			// Font object
+		*page;			// Page object
+  pdfio_dict_t	*dict;			// Page/font dictionary
+  pdfio_stream_t *st;			// Page or font stream
   bool		error = false;		// Error flag
+  char		filename[256],		// PDF filename
+		buffer[16384];		// Read buffer
+  ssize_t	bytes;			// Bytes read
+  size_t	total;			// Total bytes read
+  struct stat	fileinfo;		// Font file information
 
 
-  // Test creation of files using various PDF/A standards
-  status |= write_pdfa_file("testpdfio-pdfa-1a.pdf", "PDF/A-1a");
-  status |= write_pdfa_file("testpdfio-pdfa-1b.pdf", "PDF/A-1b");
-  status |= write_pdfa_file("testpdfio-pdfa-2a.pdf", "PDF/A-2a");
-  status |= write_pdfa_file("testpdfio-pdfa-2b.pdf", "PDF/A-2b");
-  status |= write_pdfa_file("testpdfio-pdfa-2u.pdf", "PDF/A-2u");
-  status |= write_pdfa_file("testpdfio-pdfa-3a.pdf", "PDF/A-3a");
-  status |= write_pdfa_file("testpdfio-pdfa-3b.pdf", "PDF/A-3b");
-  status |= write_pdfa_file("testpdfio-pdfa-3u.pdf", "PDF/A-3u");
-  status |= write_pdfa_file("testpdfio-pdfa-4.pdf", "PDF/A-4");
+  // Write two PDF files at the same time using the same font...
+  for (i = 0; i < 2; i ++)
+  {
+    snprintf(filename, sizeof(filename), "testpdfio-fontcache%d.pdf", i + 1);
 
-  // Test that encryption is not allowed for PDF/A files
-  testBegin("pdfioFileCreate(testpdfio-pdfa-rc4.pdf)");
-  if ((pdf = pdfioFileCreate("testpdfio-pdfa-rc4.pdf", "PDF/A-1b", /*media_box*/NULL, /*crop_box*/NULL, (pdfio_error_cb_t)error_cb, &error)) == NULL)
+    testBegin("pdfioFileCreate(\"%s\", ...)", filename);
+    if ((pdfs[i] = pdfioFileCreate(filename, /*version*/NULL, /*media_box*/NULL, /*crop_box*/NULL, (pdfio_error_cb_t)error_cb, &error)) != NULL)
+    {
+      testEnd(true);
+    }
+    else
+    {
+      testEnd(false);
+      goto fail;
+    }
+
+    testBegin("pdfioFileSetFontCache(true)");
+    if (pdfioFileSetFontCache(pdfs[i], true))
+    {
+      testEnd(true);
+    }
+    else
+    {
+      testEnd(false);
+      goto fail;
+    }
+
+    testBegin("pdfioFileCreateFontObjFromFile(OpenSans-Regular.ttf)");
+    if ((font = pdfioFileCreateFontObjFromFile(pdfs[i], "testfiles/OpenSans-Regular.ttf", true)) != NULL)
+    {
+      testEnd(true);
+    }
+    else
+    {
+      testEnd(false);
+      goto fail;
+    }
+
+    testBegin("pdfioContentTextMeasure(...)");
+    if (pdfioContentTextMeasure(font, "Hello, World!", 24.0) > 0.0)
+    {
+      testEnd(true);
+    }
+    else
+    {
+      testEnd(false);
+      goto fail;
+    }
+
+    testBegin("pdfioFileCreatePage(...)");
+    if ((dict = pdfioDictCreate(pdfs[i])) != NULL && pdfioPageDictAddFont(dict, "F1", font) && (st = pdfioFileCreatePage(pdfs[i], dict)) != NULL && pdfioContentTextBegin(st) && pdfioContentSetTextFont(st, "F1", 24.0) && pdfioContentTextMoveTo(st, 72.0, 720.0) && pdfioContentTextShow(st, true, "Hello, World!") && pdfioContentTextEnd(st) && pdfioStreamClose(st))
+    {
+      testEnd(true);
+    }
+    else
+    {
+      testEnd(false);
+      goto fail;
+    }
+  }
+
+  for (i = 0; i < 2; i ++)
   {
-    testEnd(false);
-    return (1);
+    testBegin("pdfioFileClose(\"testpdfio-fontcache%d.pdf\")", i + 1);
+    if (pdfioFileClose(pdfs[i]))
+    {
+      pdfs[i] = NULL;
+      testEnd(true);
+    }
+    else
+    {
+      pdfs[i] = NULL;
+      testEnd(false);
+      goto fail;
+    }
   }
 
-  testEnd(true);
+  // Check that the second file contains the whole font...
+  testBegin("pdfioFileOpen(\"testpdfio-fontcache2.pdf\", ...)");
+  if ((pdfs[0] = pdfioFileOpen("testpdfio-fontcache2.pdf", /*password_cb*/NULL, /*password_data*/NULL, (pdfio_error_cb_t)error_cb, &error)) != NULL)
+  {
+    testEnd(true);
+  }
+  else
+  {
+    testEnd(false);
+    goto fail;
+  }
 
-  testBegin("pdfioFileSetPermissions(PDFIO_ENCRYPTION_RC4_128)");
-  if (pdfioFileSetPermissions(pdf, PDFIO_PERMISSION_ALL, PDFIO_ENCRYPTION_RC4_128, "owner", "user"))
+  testBegin("FontFile2");
+  if ((page = pdfioFileGetPage(pdfs[0], 0)) != NULL && (font = pdfioDictGetObj(pdfioDictGetDict(pdfioDictGetDict(pdfioObjGetDict(page), "Resources"), "Font"), "F1")) != NULL && (dict = pdfioObjGetDict(pdfioArrayGetObj(pdfioDictGetArray(pdfioObjGetDict(font), "DescendantFonts"), 0))) != NULL && pdfioDictGetArray(dict, "W") != NULL && (st = pdfioObjOpenStream(pdfioDictGetObj(pdfioObjGetDict(pdfioDictGetObj(dict, "FontDescriptor")), "FontFile2"), true)) != NULL)
   {
-    testEndMessage(false, "incorrectly allowed encryption");
-    status = 1;
+    for (total = 0; (bytes = pdfioStreamRead(st, buffer, sizeof(buffer))) > 0; total += (size_t)bytes);
+
+    pdfioStreamClose(st);
+
+    if (!stat("testfiles/OpenSans-Regular.ttf", &fileinfo) && total == (size_t)fileinfo.st_size)
+    {
+      testEndMessage(true, "%u bytes", (unsigned)total);
+    }
+    else
+    {
+      testEndMessage(false, "got %u bytes", (unsigned)total);
+      goto fail;
+    }
   }
   else
   {
-    testEndMessage(true, "correctly prevented encryption");
+    testEnd(false);
+    goto fail;
   }
 
-  pdfioFileClose(pdf);
+  pdfioFileClose(pdfs[0]);
 
-  return (status);
+  pdfioFontCacheClear();
+
+  return (0);
+
+  fail:
+
+  pdfioFileClose(pdfs[0]);
+  pdfioFileClose(pdfs[1]);
+
+  pdfioFontCacheClear();
+
+  return (1);
 }
 
 
 //
-// 'do_test_file()' - Try loading a PDF file and listing pages and objects.
+// 'do_image_tests()' - Test writing images a few lines at a time.
 //
 
 static int				// O - Exit status
-do_test_file(const char *filename,	// I - PDF filename
+do_image_tests(void)
+{
+  pdfio_file_t	*pdf;			// PDF file
+  pdfio_image_t	*image;			// Image
+  pdfio_obj_t	*obj,			// Image object
+		*mask;			// Mask image object
+  pdfio_stream_t *st;			// Page or image stream
+  pdfio_dict_t	*dict;			// Page dictionary
+  bool		error = false;		// Error flag
+  size_t	i,			// Looping var
+		c,			// Byte in pixel
+		bpc,			// Bytes per component
+		bpp,			// Bytes per pixel (less alpha)
+		x, y,			// Looping vars
+		count = 0;		// Number of bad values
+  size_t	number,			// Image object number
+		scaled,			// Scaled image object number
+		huge,			// Oversized image object number
+		wide,			// Wide image object number
+		split[4];		// Alpha image object numbers
+  ssize_t	bytes;			// Bytes read
+  unsigned char	line[4 * 256 * 2],	// RGBA line
+		*lineptr,		// Pointer into line
+		buffer[64 * 64 * 3],	// Read buffer
+		*data;			// Image data
+  static const size_t formats[4][2] =	// Alpha image depths and colors
+  {
+    { 8, 1 },				// 8-bit gray + alpha
+    { 8, 3 },				// 8-bit RGB + alpha
+    { 16, 1 },				// 16-bit gray + alpha
+    { 16, 3 }				// 16-bit RGB + alpha
+  };
+
+
+  testBegin("pdfioFileCreate(testpdfio-image.pdf)");
+  if ((pdf = pdfioFileCreate("testpdfio-image.pdf", /*version*/NULL, /*media_box*/NULL, /*crop_box*/NULL, (pdfio_error_cb_t)error_cb, &error)) != NULL)
+  {
+    testEnd(true);
+  }
+  else
+  {
+    testEnd(false);
+    return (1);
+  }
+
+  // Write a 16-bit RGBA image one line at a time...
+  testBegin("pdfioFileCreateImage(256x256, depth=16, num_colors=3, alpha=true)");
+  if ((image = pdfioFileCreateImage(pdf, 256, 256, 16, 3, /*color_data*/NULL, /*alpha*/true, /*interpolate*/false)) != NULL)
+  {
+    testEnd(true);
+  }
+  else
+  {
+    testEnd(false);
+    pdfioFileClose(pdf);
+    return (1);
+  }
+
+  testBegin("pdfioImageWriteRows(...)");
+  for (y = 0; y < 256; y ++)
+  {
+    for (x = 0, lineptr = line; x < 256; x ++)
+    {
+      *lineptr++ = (unsigned char)y;
+      *lineptr++ = (unsigned char)x;
+      *lineptr++ = (unsigned char)x;
+      *lineptr++ = (unsigned char)y;
+      *lineptr++ = (unsigned char)(x + y);
+      *lineptr++ = 0;
+      *lineptr++ = (unsigned char)(x ^ y);
+      *lineptr++ = 0xff;
+    }
+
+    if (!pdfioImageWriteRows(image, line, 1))
+      break;
+  }
+
+  if (y == 256)
+  {
+    testEnd(true);
+  }
+  else
+  {
+    testEnd(false);
+    pdfioImageClose(image);
+    pdfioFileClose(pdf);
+    return (1);
+  }
+
+  testBegin("pdfioImageWriteRows(too many lines)");
+  if (!pdfioImageWriteRows(image, line, 1))
+  {
+    testEnd(true);
+    error = false;
+  }
+  else
+  {
+    testEnd(false);
+    pdfioImageClose(image);
+    pdfioFileClose(pdf);
+    return (1);
+  }
+
+  testBegin("pdfioImageClose(...)");
+  if ((obj = pdfioImageClose(image)) != NULL)
+  {
+    testEnd(true);
+  }
+  else
+  {
+    testEnd(false);
+    pdfioFileClose(pdf);
+    return (1);
+  }
+
+  number = (size_t)pdfioObjGetNumber(obj);
+
+  // Write gray and RGB images with alpha in a single call, which splits the
+  // color and alpha values for many lines at a time...
+  if ((data = (unsigned char *)malloc(256 * 256 * 8)) == NULL)
+  {
+    perror("Unable to allocate image buffer");
+    pdfioFileClose(pdf);
+    return (1);
+  }
+
+  for (i = 0; i < 4; i ++)
+  {
+    testBegin("pdfioImageWriteRows(256x256, depth=%u, num_colors=%u, alpha=true)", (unsigned)formats[i][0], (unsigned)formats[i][1]);
+
+    bpc = formats[i][0] / 8;
+    bpp = formats[i][1] * bpc;
+
+    for (y = 0, lineptr = data; y < 256; y ++)
+    {
+      for (x = 0; x < 256; x ++)
+      {
+        for (c = 0; c < (bpp + bpc); c ++)
+          *lineptr++ = (unsigned char)(x + 7 * y + 31 * c);
+      }
+    }
+
+    if ((image = pdfioFileCreateImage(pdf, 256, 256, formats[i][0], formats[i][1], /*color_data*/NULL, /*alpha*/true, /*interpolate*/false)) != NULL && pdfioImageWriteRows(image, data, 256) && (obj = pdfioImageClose(image)) != NULL)
+    {
+      testEnd(true);
+      split[i] = (size_t)pdfioObjGetNumber(obj);
+    }
+    else
+    {
+      testEnd(false);
+      free(data);
+      pdfioFileClose(pdf);
+      return (1);
+    }
+  }
+
+  free(data);
+
+  // Downsample a 256x256 RGB gradient to 64x64...
+  if ((data = (unsigned char *)malloc(256 * 256 * 3)) == NULL)
+  {
+    perror("Unable to allocate image buffer");
+    pdfioFileClose(pdf);
+    return (1);
+  }
+
+  for (y = 0, lineptr = data; y < 256; y ++)
+  {
+    for (x = 0; x < 256; x ++)
+    {
+      *lineptr++ = (unsigned char)x;
+      *lineptr++ = (unsigned char)y;
+      *lineptr++ = 0x80;
+    }
+  }
+
+  testBegin("pdfioFileCreateScaledImageObjFromData(256x256, 512x512pt, 72ppi)");
+  if ((obj = pdfioFileCreateScaledImageObjFromData(pdf, data, 256, 256, 3, /*color_data*/NULL, /*alpha*/false, /*interpolate*/false, 512.0, 512.0, 72.0)) != NULL && pdfioImageGetWidth(obj) == 256.0)
+  {
+    testEnd(true);
+  }
+  else
+  {
+    testEndMessage(false, "width=%g", pdfioImageGetWidth(obj));
+    free(data);
+    pdfioFileClose(pdf);
+    return (1);
+  }
+
+  testBegin("pdfioFileCreateScaledImageObjFromData(256x128, 32x32pt, 72ppi)");
+  if ((obj = pdfioFileCreateScaledImageObjFromData(pdf, data, 256, 128, 3, /*color_data*/NULL, /*alpha*/false, /*interpolate*/false, 32.0, 32.0, 72.0)) != NULL && pdfioImageGetWidth(obj) == 32.0 && pdfioImageGetHeight(obj) == 16.0)
+  {
+    testEnd(true);
+  }
+  else
+  {
+    testEndMessage(false, "width=%g, height=%g", pdfioImageGetWidth(obj), pdfioImageGetHeight(obj));
+    free(data);
+    pdfioFileClose(pdf);
+    return (1);
+  }
+
+  testBegin("pdfioFileCreateScaledImageObjFromData(256x256, 64x128pt, 72ppi)");
+  if ((obj = pdfioFileCreateScaledImageObjFromData(pdf, data, 256, 256, 3, /*color_data*/NULL, /*alpha*/false, /*interpolate*/false, 64.0, 128.0, 72.0)) != NULL && pdfioImageGetWidth(obj) == 64.0 && pdfioImageGetHeight(obj) == 64.0)
+  {
+    testEnd(true);
+  }
+  else
+  {
+    testEndMessage(false, "width=%g, height=%g", pdfioImageGetWidth(obj), pdfioImageGetHeight(obj));
+    free(data);
+    pdfioFileClose(pdf);
+    return (1);
+  }
+
+  free(data);
+
+  scaled = (size_t)pdfioObjGetNumber(obj);
+
+  // Write an image whose dimensions are too large to read back...
+  testBegin("pdfioObjCreateStream(oversized image)");
+  if ((dict = pdfioDictCreate(pdf)) != NULL && pdfioDictSetName(dict, "Type", "XObject") && pdfioDictSetName(dict, "Subtype", "Image") && pdfioDictSetNumber(dict, "Width", 1e12) && pdfioDictSetNumber(dict, "Height", 1e12) && pdfioDictSetNumber(dict, "BitsPerComponent", 8) && pdfioDictSetName(dict, "ColorSpace", "DeviceGray") && (mask = pdfioFileCreateObj(pdf, dict)) != NULL && (st = pdfioObjCreateStream(mask, PDFIO_FILTER_NONE)) != NULL && pdfioStreamWrite(st, line, 256) && pdfioStreamClose(st))
+  {
+    testEnd(true);
+  }
+  else
+  {
+    testEnd(false);
+    pdfioFileClose(pdf);
+    return (1);
+  }
+
+  huge = (size_t)pdfioObjGetNumber(mask);
+
+  testBegin("pdfioFileCreatePage(...)");
+  if ((dict = pdfioDictCreate(pdf)) != NULL && pdfioPageDictAddImage(dict, "IM1", obj) && (st = pdfioFileCreatePage(pdf, dict)) != NULL && pdfioContentDrawImage(st, "IM1", 36, 36, 540, 540) && pdfioStreamClose(st))
+  {
+    testEnd(true);
+  }
+  else
+  {
+    testEnd(false);
+    pdfioFileClose(pdf);
+    return (1);
+  }
+
+  // Write an image wider than 16384 pixels, which must still read back...
+  testBegin("pdfioFileCreateImage(20000x2 image)");
+  if ((data = (unsigned char *)malloc(2 * 20000)) == NULL)
+  {
+    testEndMessage(false, "%s", strerror(errno));
+    pdfioFileClose(pdf);
+    return (1);
+  }
+
+  for (i = 0; i < (2 * 20000); i ++)
+    data[i] = (unsigned char)(i * 7);
+
+  if ((image = pdfioFileCreateImage(pdf, 20000, 2, 8, 1, /*color_data*/NULL, /*alpha*/false, /*interpolate*/false)) != NULL && pdfioImageWriteRows(image, data, 2) && (obj = pdfioImageClose(image)) != NULL)
+  {
+    testEnd(true);
+  }
+  else
+  {
+    testEnd(false);
+    free(data);
+    pdfioFileClose(pdf);
+    return (1);
+  }
+
+  free(data);
+
+  wide = (size_t)pdfioObjGetNumber(obj);
+
+  testBegin("pdfioFileClose(...)");
+  if (pdfioFileClose(pdf))
+  {
+    testEnd(true);
+  }
+  else
+  {
+    testEnd(false);
+    return (1);
+  }
+
+  // Read back the image and mask...
+  testBegin("pdfioFileOpen(testpdfio-image.pdf)");
+  if ((pdf = pdfioFileOpen("testpdfio-image.pdf", /*password_cb*/NULL, /*password_data*/NULL, (pdfio_error_cb_t)error_cb, &error)) != NULL)
+  {
+    testEnd(true);
+  }
+  else
+  {
+    testEnd(false);
+    return (1);
+  }
+
+  testBegin("Verify image");
+  if ((obj = pdfioFileFindObj(pdf, number)) != NULL && (st = pdfioObjOpenStream(obj, true)) != NULL)
+  {
+    for (y = 0; y < 256; y ++)
+    {
+      if ((bytes = pdfioStreamRead(st, buffer, 3 * 256 * 2)) != 3 * 256 * 2)
+        break;
+
+      for (x = 0, lineptr = buffer; x < 256; x ++, lineptr += 6)
+      {
+        if (lineptr[0] != y || lineptr[1] != x || lineptr[2] != x || lineptr[3] != y || lineptr[4] != ((x + y) & 255) || lineptr[5] != 0)
+          count ++;
+      }
+    }
+
+    pdfioStreamClose(st);
+
+    if (y == 256 && count == 0)
+    {
+      testEnd(true);
+    }
+    else
+    {
+      testEndMessage(false, "y=%u, count=%u", (unsigned)y, (unsigned)count);
+      pdfioFileClose(pdf);
+      return (1);
+    }
+  }
+  else
+  {
+    testEnd(false);
+    pdfioFileClose(pdf);
+    return (1);
+  }
+
+  testBegin("Verify scaled image");
+  if ((obj = pdfioFileFindObj(pdf, scaled)) != NULL && (st = pdfioObjOpenStream(obj, true)) != NULL)
+  {
+    for (y = 0; y < 64; y ++)
+    {
+      if ((bytes = pdfioStreamRead(st, buffer, 64 * 3)) != 64 * 3)
+        break;
+
+      for (x = 0, lineptr = buffer; x < 64; x ++, lineptr += 3)
+      {
+        // Each output pixel is the average of a 4x4 block of source pixels...
+        if (lineptr[0] != 4 * x + 2 || lineptr[1] != 4 * y + 2 || lineptr[2] != 0x80)
+          count ++;
+      }
+    }
+
+    pdfioStreamClose(st);
+
+    if (y == 64 && count == 0)
+    {
+      testEnd(true);
+    }
+    else
+    {
+      testEndMessage(false, "y=%u, count=%u", (unsigned)y, (unsigned)count);
+      pdfioFileClose(pdf);
+      return (1);
+    }
+  }
+  else
+  {
+    testEnd(false);
+    pdfioFileClose(pdf);
+    return (1);
+  }
+
+  obj = pdfioFileFindObj(pdf, number);
+
+  testBegin("Verify mask");
+  if ((mask = pdfioDictGetObj(pdfioObjGetDict(obj), "SMask")) != NULL && (st = pdfioObjOpenStream(mask, true)) != NULL)
+  {
+    for (y = 0; y < 256; y ++)
+    {
+      if ((bytes = pdfioStreamRead(st, buffer, 512)) != 512)
+        break;
+
+      for (x = 0, lineptr = buffer; x < 256; x ++, lineptr += 2)
+      {
+        if (lineptr[0] != (x ^ y) || lineptr[1] != 0xff)
+          count ++;
+      }
+    }
+
+    pdfioStreamClose(st);
+
+    if (y == 256 && count == 0)
+    {
+      testEnd(true);
+    }
+    else
+    {
+      testEndMessage(false, "y=%u, count=%u", (unsigned)y, (unsigned)count);
+      pdfioFileClose(pdf);
+      return (1);
+    }
+  }
+  else
+  {
+    testEnd(false);
+    pdfioFileClose(pdf);
+    return (1);
+  }
+
+  // Verify the color and alpha values of the other alpha images...
+  for (i = 0; i < 4; i ++)
+  {
+    testBegin("Verify split image (depth=%u, num_colors=%u)", (unsigned)formats[i][0], (unsigned)formats[i][1]);
+
+    bpc = formats[i][0] / 8;
+    bpp = formats[i][1] * bpc;
+
+    if ((obj = pdfioFileFindObj(pdf, split[i])) != NULL && (st = pdfioObjOpenStream(obj, true)) != NULL)
+    {
+      for (y = 0; y < 256; y ++)
+      {
+        if ((bytes = pdfioStreamRead(st, buffer, 256 * bpp)) != (ssize_t)(256 * bpp))
+          break;
+
+        for (x = 0, lineptr = buffer; x < 256; x ++)
+        {
+          for (c = 0; c < bpp; c ++, lineptr ++)
+          {
+            if (*lineptr != (unsigned char)(x + 7 * y + 31 * c))
+              count ++;
+          }
+        }
+      }
+
+      pdfioStreamClose(st);
+    }
+    else
+    {
+      y = 0;
+    }
+
+    if (y == 256 && (mask = pdfioDictGetObj(pdfioObjGetDict(obj), "SMask")) != NULL && (st = pdfioObjOpenStream(mask, true)) != NULL)
+    {
+      for (y = 0; y < 256; y ++)
+      {
+        if ((bytes = pdfioStreamRead(st, buffer, 256 * bpc)) != (ssize_t)(256 * bpc))
+          break;
+
+        for (x = 0, lineptr = buffer; x < 256; x ++)
+        {
+          for (c = bpp; c < (bpp + bpc); c ++, lineptr ++)
+          {
+            if (*lineptr != (unsigned char)(x + 7 * y + 31 * c))
+              count ++;
+          }
+        }
+      }
+
+      pdfioStreamClose(st);
+    }
+    else
+    {
+      y = 0;
+    }
+
+    if (y == 256 && count == 0)
+    {
+      testEnd(true);
+    }
+    else
+    {
+      testEndMessage(false, "y=%u, count=%u", (unsigned)y, (unsigned)count);
+      pdfioFileClose(pdf);
+      return (1);
+    }
+  }
+
+  obj = pdfioFileFindObj(pdf, number);
+
+  // Read back the image as 8-bit RGBA and grayscale...
+  testBegin("pdfioImageOpen(image, num_colors=3, alpha=true)");
+  if ((image = pdfioImageOpen(obj, 3, true)) != NULL)
+  {
+    testEnd(true);
+  }
+  else
+  {
+    testEnd(false);
+    pdfioFileClose(pdf);
+    return (1);
+  }
+
+  testBegin("pdfioImageReadRows(...)");
+  for (y = 0; y < 256; y ++)
+  {
+    if (!pdfioImageReadRows(image, line, 1))
+      break;
+
+    for (x = 0, lineptr = line; x < 256; x ++, lineptr += 4)
+    {
+      if (lineptr[0] != y || lineptr[1] != x || lineptr[2] != ((x + y) & 255) || lineptr[3] != (x ^ y))
+        count ++;
+    }
+  }
+
+  pdfioImageClose(image);
+
+  if (y == 256 && count == 0)
+  {
+    testEnd(true);
+  }
+  else
+  {
+    testEndMessage(false, "y=%u, count=%u", (unsigned)y, (unsigned)count);
+    pdfioFileClose(pdf);
+    return (1);
+  }
+
+  testBegin("pdfioImageOpen(scaled image, num_colors=1, alpha=false)");
+  if ((image = pdfioImageOpen(pdfioFileFindObj(pdf, scaled), 1, false)) != NULL)
+  {
+    testEnd(true);
+  }
+  else
+  {
+    testEnd(false);
+    pdfioFileClose(pdf);
+    return (1);
+  }
+
+  testBegin("pdfioImageReadRows(...)");
+  if (pdfioImageReadRows(image, buffer, 64))
+  {
+    for (y = 0, lineptr = buffer; y < 64; y ++)
+    {
+      for (x = 0; x < 64; x ++, lineptr ++)
+      {
+        if (*lineptr != (((4 * x + 2) * 77 + (4 * y + 2) * 150 + 0x80 * 29) >> 8))
+          count ++;
+      }
+    }
+  }
+  else
+  {
+    count ++;
+  }
+
+  pdfioImageClose(image);
+
+  if (count == 0)
+  {
+    testEnd(true);
+  }
+  else
+  {
+    testEndMessage(false, "count=%u", (unsigned)count);
+    pdfioFileClose(pdf);
+    return (1);
+  }
+
+  testBegin("pdfioImageReadRows(too many lines)");
+  if ((image = pdfioImageOpen(pdfioFileFindObj(pdf, scaled), 3, false)) != NULL && pdfioImageReadRows(image, buffer, 16) && !pdfioImageReadRows(image, buffer, 64))
+  {
+    testEnd(true);
+    error = false;
+  }
+  else
+  {
+    testEnd(false);
+    pdfioImageClose(image);
+    pdfioFileClose(pdf);
+    return (1);
+  }
+
+  pdfioImageClose(image);
+
+  testBegin("pdfioImageOpen(oversized image)");
+  if ((image = pdfioImageOpen(pdfioFileFindObj(pdf, huge), 1, false)) == NULL)
+  {
+    testEnd(true);
+    error = false;
+  }
+  else
+  {
+    testEnd(false);
+    pdfioImageClose(image);
+    pdfioFileClose(pdf);
+    return (1);
+  }
+
+  testBegin("pdfioImageReadRows(20000x2 image)");
+  if ((data = (unsigned char *)malloc(2 * 20000)) != NULL && (image = pdfioImageOpen(pdfioFileFindObj(pdf, wide), 1, false)) != NULL)
+  {
+    if (pdfioImageReadRows(image, data, 2))
+    {
+      for (i = 0; i < (2 * 20000); i ++)
+      {
+        if (data[i] != (unsigned char)(i * 7))
+          count ++;
+      }
+    }
+    else
+    {
+      count ++;
+    }
+
+    pdfioImageClose(image);
+  }
+  else
+  {
+    count ++;
+  }
+
+  free(data);
+
+  if (count == 0)
+  {
+    testEnd(true);
+  }
+  else
+  {
+    testEnd(false);
+    pdfioFileClose(pdf);
+    return (1);
+  }
+
+  pdfioFileClose(pdf);
+
+  return (0);
+}
+
+
+//
+// 'do_linear_tests()' - Test writing and reading a linearized PDF file.
+//
+
+static int				// O - 0 on success, 1 on error
+do_linear_tests(void)
+{
+  pdfio_file_t	*pdf;			// PDF file
+  pdfio_stream_t *st;			// Page contents stream
+  pdfio_dict_t	*dict;			// Page dictionary
+  pdfio_obj_t	*font,			// Shared font object
+		*images[2],		// Shared image objects
+		*page;			// Page object
+  bool		error = false;		// Error flag
+  size_t	i;			// Looping var
+  FILE		*fp;			// File pointer
+  struct stat	fileinfo;		// File information
+  char		buffer[1024],		// Start of file/stream data
+		text[64],		// Expected page text
+		*ptr;			// Pointer into buffer
+  ssize_t	bytes;			// Bytes read
+  long		length,			// Linearized file length (/L)
+		number;			// First page object number (/O)
+  unsigned char	pixels[16 * 16 * 3];	// Image pixels
+  static const size_t num_pages = 40;	// Number of pages, enough for a page tree
+
+
+  // Write the pages...
+  testBegin("pdfioFileCreate(testpdfio-linear.pdf)");
+  if ((pdf = pdfioFileCreate("testpdfio-linear.pdf", "1.7", /*media_box*/NULL, /*crop_box*/NULL, (pdfio_error_cb_t)error_cb, &error)) != NULL)
+  {
+    testEnd(true);
+  }
+  else
+  {
+    testEnd(false);
+    return (1);
+  }
+
+  testBegin("pdfioFileSetLinearized(true)");
+  if (pdfioFileSetLinearized(pdf, true))
+  {
+    testEnd(true);
+  }
+  else
+  {
+    testEnd(false);
+    pdfioFileClose(pdf);
+    return (1);
+  }
+
+  testBegin("pdfioFileSetObjectStreams(true)");
+  if (!pdfioFileSetObjectStreams(pdf, true))
+  {
+    testEndMessage(true, "not allowed");
+  }
+  else
+  {
+    testEndMessage(false, "object streams enabled for linearized file");
+    pdfioFileClose(pdf);
+    return (1);
+  }
+
+  testBegin("pdfioFileCreatePage(%lu pages)", (unsigned long)num_pages);
+
+  // Pages 1 and 2 share the first image, pages 3 and 4 share the second
+  // image, and all pages share the font...
+  font = pdfioFileCreateFontObjFromBase(pdf, "Helvetica");
+
+  for (i = 0; i < 2; i ++)
+  {
+    memset(pixels, (int)(64 + 128 * i), sizeof(pixels));
+    images[i] = pdfioFileCreateImageObjFromData(pdf, pixels, 16, 16, 3, /*color_data*/NULL, /*alpha*/false, /*interpolate*/false);
+  }
+
+  if (!font || !images[0] || !images[1])
+  {
+    testEndMessage(false, "unable to create font and images");
+    pdfioFileClose(pdf);
+    return (1);
+  }
+
+  for (i = 0; i < num_pages; i ++)
+  {
+    if ((dict = pdfioDictCreate(pdf)) == NULL)
+      break;
+
+    pdfioPageDictAddFont(dict, "F1", font);
+    if (i < 4)
+      pdfioPageDictAddImage(dict, "IM1", images[i / 2]);
+
+    if ((st = pdfioFileCreatePage(pdf, dict)) == NULL)
+      break;
+
+    if (i < 4)
+      pdfioContentDrawImage(st, "IM1", 72.0, 72.0, 144.0, 144.0);
+
+    pdfioStreamPrintf(st, "BT /F1 24 Tf 72 720 Td (Page %u) Tj ET\n", (unsigned)(i + 1));
+
+    if (!pdfioStreamClose(st))
+      break;
+  }
+
+  if (i < num_pages)
+  {
+    testEndMessage(false, "page %lu", (unsigned long)i + 1);
+    pdfioFileClose(pdf);
+    return (1);
+  }
+
+  testEnd(true);
+
+  testBegin("pdfioFileClose(testpdfio-linear.pdf)");
+  if (pdfioFileClose(pdf))
+  {
+    testEnd(true);
+  }
+  else
+  {
+    testEnd(false);
+    return (1);
+  }
+
+  // Check the linearization dictionary at the start of the file...
+  testBegin("Linearization dictionary");
+  if ((fp = fopen("testpdfio-linear.pdf", "rb")) == NULL)
+  {
+    testEndMessage(false, "%s", strerror(errno));
+    return (1);
+  }
+
+  bytes = (ssize_t)fread(buffer, 1, sizeof(buffer) - 1, fp);
+  fclose(fp);
+
+  if (bytes < 0 || stat("testpdfio-linear.pdf", &fileinfo))
+  {
+    testEndMessage(false, "%s", strerror(errno));
+    return (1);
+  }
+
+  buffer[bytes] = '\0';
+
+  if (!strstr(buffer, "/Linearized 1") || (ptr = strstr(buffer, "/L ")) == NULL || (length = strtol(ptr + 3, NULL, 10)) != (long)fileinfo.st_size || (ptr = strstr(buffer, "/O ")) == NULL || (number = strtol(ptr + 3, NULL, 10)) <= 0)
+  {
+    testEndMessage(false, "missing or bad values");
+    return (1);
+  }
+
+  testEndMessage(true, "%ld bytes", length);
+
+  // Read the pages back...
+  testBegin("pdfioFileOpen(testpdfio-linear.pdf)");
+  if ((pdf = pdfioFileOpen("testpdfio-linear.pdf", /*password_cb*/NULL, /*password_data*/NULL, (pdfio_error_cb_t)error_cb, &error)) != NULL)
+  {
+    testEnd(true);
+  }
+  else
+  {
+    testEnd(false);
+    return (1);
+  }
+
+  testBegin("pdfioFileGetNumPages");
+  if ((i = pdfioFileGetNumPages(pdf)) == num_pages)
+  {
+    testEndMessage(true, "%lu", (unsigned long)i);
+  }
+  else
+  {
+    testEndMessage(false, "%lu, expected %lu", (unsigned long)i, (unsigned long)num_pages);
+    pdfioFileClose(pdf);
+    return (1);
+  }
+
+  testBegin("pdfioFileGetPage(0)");
+  if ((page = pdfioFileGetPage(pdf, 0)) != NULL && pdfioObjGetNumber(page) == (size_t)number)
+  {
+    testEndMessage(true, "object %ld", number);
+  }
+  else
+  {
+    testEndMessage(false, "object %lu, expected %ld", (unsigned long)pdfioObjGetNumber(page), number);
+    pdfioFileClose(pdf);
+    return (1);
+  }
+
+  testBegin("pdfioPageOpenStream");
+  for (i = 0; i < num_pages; i ++)
+  {
+    if ((st = pdfioPageOpenStream(pdfioFileGetPage(pdf, i), 0, true)) == NULL)
+      break;
+
+    bytes = pdfioStreamRead(st, buffer, sizeof(buffer) - 1);
+    pdfioStreamClose(st);
+
+    snprintf(text, sizeof(text), "(Page %u)", (unsigned)(i + 1));
+
+    if (bytes <= 0)
+      break;
+
+    buffer[bytes] = '\0';
+    if (!strstr(buffer, text))
+      break;
+  }
+
+  if (i < num_pages)
+  {
+    testEndMessage(false, "page %lu", (unsigned long)i + 1);
+    pdfioFileClose(pdf);
+    return (1);
+  }
+
+  testEnd(true);
+
+  pdfioFileClose(pdf);
+
+  // Objects already written to an object stream prevent linearization, even
+  // after object streams are turned off...
+  testBegin("pdfioFileCreate(testpdfio-linear2.pdf)");
+  if ((pdf = pdfioFileCreate("testpdfio-linear2.pdf", "1.7", /*media_box*/NULL, /*crop_box*/NULL, (pdfio_error_cb_t)error_cb, &error)) != NULL)
+  {
+    testEnd(true);
+  }
+  else
+  {
+    testEnd(false);
+    return (1);
+  }
+
+  testBegin("pdfioFileSetObjectStreams(true)");
+  if (pdfioFileSetObjectStreams(pdf, true) && pdfioFileCreateFontObjFromBase(pdf, "Helvetica") && pdfioFileSetObjectStreams(pdf, false))
+  {
+    testEnd(true);
+  }
+  else
+  {
+    testEnd(false);
+    pdfioFileClose(pdf);
+    return (1);
+  }
+
+  testBegin("pdfioFileSetLinearized(true)");
+  if (!pdfioFileSetLinearized(pdf, true))
+  {
+    testEndMessage(true, "not allowed");
+  }
+  else
+  {
+    testEndMessage(false, "linearized file with compressed objects");
+    pdfioFileClose(pdf);
+    return (1);
+  }
+
+  error = false;
+
+  pdfioFileClose(pdf);
+
+  return (0);
+}
+
+
+//
+// 'do_merge_tests()' - Test merging PDF files with shared streams.
+//
+
+static int				// O - 0 on success, 1 on error
+do_merge_tests(void)
+{
+  pdfio_file_t	*pdf,			// Merged PDF file
+		*inpdf;			// Source PDF file
+  bool		error = false;		// Error flag
+  size_t	num_pages,		// Number of pages in source file
+		num_objs,		// Number of objects before merge
+		single_objs,		// Objects added for one file
+		single_streams,		// Unique streams added for one file
+		merged_objs,		// Objects added for two files
+		expected_objs;		// Expected objects for two files
+  static const char * const one[] =	// Single file to merge
+  {
+    "testfiles/testpdfio.pdf"
+  };
+  static const char * const two[] =	// Files to merge
+  {
+    "testfiles/testpdfio.pdf",
+    "testpdfio-merge1.pdf"
+  };
+
+
+  // Get the number of pages in the source file...
+  testBegin("pdfioFileOpen(\"testfiles/testpdfio.pdf\", ...)");
+  if ((inpdf = pdfioFileOpen("testfiles/testpdfio.pdf", /*password_cb*/NULL, /*password_cbdata*/NULL, (pdfio_error_cb_t)error_cb, &error)) != NULL)
+  {
+    testEnd(true);
+  }
+  else
+  {
+    testEnd(false);
+    return (1);
+  }
+
+  num_pages = pdfioFileGetNumPages(inpdf);
+
+  pdfioFileClose(inpdf);
+
+  // Make a copy of the source file with a different file ID...
+  testBegin("pdfioFileCreate(\"testpdfio-merge1.pdf\", ...)");
+  if ((pdf = pdfioFileCreate("testpdfio-merge1.pdf", /*version*/NULL, /*media_box*/NULL, /*crop_box*/NULL, (pdfio_error_cb_t)error_cb, &error)) != NULL)
+  {
+    testEnd(true);
+  }
+  else
+  {
+    testEnd(false);
+    return (1);
+  }
+
+  num_objs = pdfioFileGetNumObjs(pdf);
+
+  testBegin("pdfioFileMergeFiles(1 file)");
+  if (pdfioFileMergeFiles(pdf, 1, one, /*password_cb*/NULL, /*password_cbdata*/NULL) && pdfioFileGetNumPages(pdf) == num_pages)
+  {
+    testEnd(true);
+  }
+  else
+  {
+    testEndMessage(false, "%lu pages, expected %lu", (unsigned long)pdfioFileGetNumPages(pdf), (unsigned long)num_pages);
+    pdfioFileClose(pdf);
+    return (1);
+  }
+
+  single_objs    = pdfioFileGetNumObjs(pdf) - num_objs;
+  single_streams = pdf->num_digests;
+
+  testBegin("pdfioFileClose(\"testpdfio-merge1.pdf\")");
+  if (pdfioFileClose(pdf))
+  {
+    testEnd(true);
+  }
+  else
+  {
+    testEnd(false);
+    return (1);
+  }
+
+  // Merge the original and the copy, which should share all of their streams...
+  testBegin("pdfioFileCreate(\"testpdfio-merge.pdf\", ...)");
+  if ((pdf = pdfioFileCreate("testpdfio-merge.pdf", /*version*/NULL, /*media_box*/NULL, /*crop_box*/NULL, (pdfio_error_cb_t)error_cb, &error)) != NULL)
+  {
+    testEnd(true);
+  }
+  else
+  {
+    testEnd(false);
+    return (1);
+  }
+
+  num_objs = pdfioFileGetNumObjs(pdf);
+
+  testBegin("pdfioFileMergeFiles(2 files)");
+  if (pdfioFileMergeFiles(pdf, 2, two, /*password_cb*/NULL, /*password_cbdata*/NULL) && pdfioFileGetNumPages(pdf) == 2 * num_pages)
+  {
+    testEnd(true);
+  }
+  else
+  {
+    testEndMessage(false, "%lu pages, expected %lu", (unsigned long)pdfioFileGetNumPages(pdf), (unsigned long)(2 * num_pages));
+    pdfioFileClose(pdf);
+    return (1);
+  }
+
+  merged_objs = pdfioFileGetNumObjs(pdf) - num_objs;
+
+  // Every stream from the second file should reuse the identical stream from
+  // the first file, so the only new objects are the pages and other
+  // non-stream objects...
+  expected_objs = 2 * single_objs - single_streams;
+
+  testBegin("pdfioFileMergeFiles(shared streams)");
+  if (merged_objs == expected_objs && pdf->num_digests == single_streams)
+  {
+    testEndMessage(true, "%lu objects, %lu shared streams", (unsigned long)merged_objs, (unsigned long)single_streams);
+  }
+  else
+  {
+    testEndMessage(false, "%lu objects and %lu streams, expected %lu objects and %lu streams", (unsigned long)merged_objs, (unsigned long)pdf->num_digests, (unsigned long)expected_objs, (unsigned long)single_streams);
+    pdfioFileClose(pdf);
+    return (1);
+  }
+
+  testBegin("pdfioFileClose(\"testpdfio-merge.pdf\")");
+  if (pdfioFileClose(pdf))
+  {
+    testEnd(true);
+  }
+  else
+  {
+    testEnd(false);
+    return (1);
+  }
+
+  // Read back the merged file...
+  testBegin("pdfioFileOpen(\"testpdfio-merge.pdf\", ...)");
+  if ((inpdf = pdfioFileOpen("testpdfio-merge.pdf", /*password_cb*/NULL, /*password_cbdata*/NULL, (pdfio_error_cb_t)error_cb, &error)) != NULL)
+  {
+    testEnd(true);
+  }
+  else
+  {
+    testEnd(false);
+    return (1);
+  }
+
+  testBegin("pdfioFileGetNumPages");
+  if (pdfioFileGetNumPages(inpdf) == 2 * num_pages)
+  {
+    testEnd(true);
+  }
+  else
+  {
+    testEndMessage(false, "%lu pages, expected %lu", (unsigned long)pdfioFileGetNumPages(inpdf), (unsigned long)(2 * num_pages));
+    pdfioFileClose(inpdf);
+    return (1);
+  }
+
+  pdfioFileClose(inpdf);
+
+  return (0);
+}
+
+
+//
+// 'do_page_tree_tests()' - Test writing and reading a multi-level page tree.
+//
+
+static int				// O - 0 on success, 1 on error
+do_page_tree_tests(void)
+{
+  pdfio_file_t	*pdf;			// PDF file
+  pdfio_stream_t *st;			// Page contents stream
+  pdfio_obj_t	*page,			// Page object
+		*parent;		// Parent node
+  bool		error = false;		// Error flag
+  size_t	i,			// Looping var
+		depth;			// Depth of page
+  static const size_t num_pages = 1100;	// Number of pages, enough for three levels
+
+
+  // Write the pages...
+  testBegin("pdfioFileCreate(testpdfio-pages.pdf)");
+  if ((pdf = pdfioFileCreate("testpdfio-pages.pdf", "2.0", /*media_box*/NULL, /*crop_box*/NULL, (pdfio_error_cb_t)error_cb, &error)) != NULL)
+  {
+    testEnd(true);
+  }
+  else
+  {
+    testEnd(false);
+    return (1);
+  }
+
+  testBegin("pdfioFileCreatePage(%lu pages)", (unsigned long)num_pages);
+  for (i = 0; i < num_pages; i ++)
+  {
+    if ((st = pdfioFileCreatePage(pdf, NULL)) == NULL)
+      break;
+
+    pdfioContentSetFillColorGray(st, (double)i / (double)num_pages);
+    pdfioContentPathRect(st, 36.0, 36.0, 540.0, 720.0);
+    pdfioContentFill(st, false);
+
+    if (!pdfioStreamClose(st))
+      break;
+  }
+
+  if (i < num_pages)
+  {
+    testEndMessage(false, "page %lu", (unsigned long)i + 1);
+    pdfioFileClose(pdf);
+    return (1);
+  }
+
+  testEnd(true);
+
+  testBegin("pdfioFileClose(testpdfio-pages.pdf)");
+  if (pdfioFileClose(pdf))
+  {
+    testEnd(true);
+  }
+  else
+  {
+    testEnd(false);
+    return (1);
+  }
+
+  // Read the pages back...
+  testBegin("pdfioFileOpen(testpdfio-pages.pdf)");
+  if ((pdf = pdfioFileOpen("testpdfio-pages.pdf", /*password_cb*/NULL, /*password_data*/NULL, (pdfio_error_cb_t)error_cb, &error)) != NULL)
+  {
+    testEnd(true);
+  }
+  else
+  {
+    testEnd(false);
+    return (1);
+  }
+
+  testBegin("pdfioFileGetNumPages");
+  if ((i = pdfioFileGetNumPages(pdf)) == num_pages)
+  {
+    testEndMessage(true, "%lu", (unsigned long)i);
+  }
+  else
+  {
+    testEndMessage(false, "%lu, expected %lu", (unsigned long)i, (unsigned long)num_pages);
+    pdfioFileClose(pdf);
+    return (1);
+  }
+
+  testBegin("pdfioFileGetPage(%lu)", (unsigned long)num_pages - 1);
+  if ((page = pdfioFileGetPage(pdf, num_pages - 1)) != NULL)
+  {
+    for (depth = 0, parent = pdfioDictGetObj(pdfioObjGetDict(page), "Parent"); parent && depth < 10; depth ++)
+      parent = pdfioDictGetObj(pdfioObjGetDict(parent), "Parent");
+
+    if (depth == 3)
+    {
+      testEndMessage(true, "depth %lu", (unsigned long)depth);
+    }
+    else
+    {
+      testEndMessage(false, "depth %lu, expected 3", (unsigned long)depth);
+      pdfioFileClose(pdf);
+      return (1);
+    }
+  }
+  else
+  {
+    testEnd(false);
+    pdfioFileClose(pdf);
+    return (1);
+  }
+
+  pdfioFileClose(pdf);
+
+  return (0);
+}
+
+
+//
+// 'do_pdfa_tests()' - Run PDF/A generation and compliance tests.
+//
+
+static int				// O - 0 on success, 1 on error
+do_pdfa_tests(void)
+{
+  int		status = 0;		// Overall status
+  pdfio_file_t	*pdf;			// PDF file for encryption test
+  bool		error = false;		// Error flag
+
+
+  // Test creation of files using various PDF/A standards
+  status |= write_pdfa_file("testpdfio-pdfa-1a.pdf", "PDF/A-1a");
+  status |= write_pdfa_file("testpdfio-pdfa-1b.pdf", "PDF/A-1b");
+  status |= write_pdfa_file("testpdfio-pdfa-2a.pdf", "PDF/A-2a");
+  status |= write_pdfa_file("testpdfio-pdfa-2b.pdf", "PDF/A-2b");
+  status |= write_pdfa_file("testpdfio-pdfa-2u.pdf", "PDF/A-2u");
+  status |= write_pdfa_file("testpdfio-pdfa-3a.pdf", "PDF/A-3a");
+  status |= write_pdfa_file("testpdfio-pdfa-3b.pdf", "PDF/A-3b");
+  status |= write_pdfa_file("testpdfio-pdfa-3u.pdf", "PDF/A-3u");
+  status |= write_pdfa_file("testpdfio-pdfa-4.pdf", "PDF/A-4");
+
+  // Test that encryption is not allowed for PDF/A files
+  testBegin("pdfioFileCreate(testpdfio-pdfa-rc4.pdf)");
+  if ((pdf = pdfioFileCreate("testpdfio-pdfa-rc4.pdf", "PDF/A-1b", /*media_box*/NULL, /*crop_box*/NULL, (pdfio_error_cb_t)error_cb, &error)) == NULL)
+  {
+    testEnd(false);
+    return (1);
+  }
+
+  testEnd(true);
+
+  testBegin("pdfioFileSetPermissions(PDFIO_ENCRYPTION_RC4_128)");
+  if (pdfioFileSetPermissions(pdf, PDFIO_PERMISSION_ALL, PDFIO_ENCRYPTION_RC4_128, "owner", "user"))
+  {
+    testEndMessage(false, "incorrectly allowed encryption");
+    status = 1;
+  }
+  else
+  {
+    testEndMessage(true, "correctly prevented encryption");
+  }
+
+  pdfioFileClose(pdf);
+
+  return (status);
+}
+
+
+//
+// 'do_stream_tests()' - Test writing and reading large compressed and staged streams.
+//
+
+static int				// O - 0 on success, 1 on error
+do_stream_tests(void)
+{
+  pdfio_file_t	*pdf;			// PDF file
+  pdfio_dict_t	*dict;			// Stream dictionary
+  pdfio_obj_t	*obj;			// Stream object
+  pdfio_stream_t *st,			// Stream
+		*sts[2];		// Staged streams
+  bool		error = false;		// Error flag
+  size_t	i,			// Looping var
+		j,			// Looping var
+		number[7];		// Object numbers
+  int		outfd;			// Output file descriptor
+  const char	*expected;		// Expected content
+  ssize_t	bytes;			// Bytes read
+  unsigned char	*data,			// Stream data
+		*buffer;		// Read buffer
+  static const size_t datasizes[2] =	// Stream sizes
+  {
+    1000,				// Small, compressed normally
+    3000000				// Large, compressed in parallel
+  };
+  static const double points[8] =	// Polygon points
+  {
+    0.0, 0.0,
+    100.5, -0.25,
+    1234567.125, 3.0000004,
+    0.1, 1e-7
+  };
+  static const char *content =		// Expected content stream
+    "0 0 m\n"
+    "100.5 -0.25 l\n"
+    "1234567.125 3 l\n"
+    "0.1 0 l\n"
+    "h\n"
+    "0.5 w\n"
+    "1 0 0 1 -0 10000000000000 cm\n";
+  static const char *ccontent =		// Expected content stream with 2 decimal places
+    "0 0 m\n"
+    "100.5 -.25 l\n"
+    "1234567.12 3 l\n"
+    ".1 0 l\n"
+    "h\n"
+    "0.5 w\n"
+    ".33 1.01 2 -0 re\n";
+  static const char *gcontent =		// Expected content stream with state tracking
+    "1 0 0 rg\n"
+    "2 w\n"
+    "q\n"
+    "3 w\n"
+    "Q\n"
+    "Q\n"
+    "1 0 0 rg\n"
+    "BT\n"
+    "/F1 12 Tf\n"
+    "ET\n";
+  static pdfio_matrix_t identity = { { 1.0, 0.0 }, { 0.0, 1.0 }, { 0.0, 0.0 } };
+					// Identity matrix
+
+
+  // Generate some compressible data...
+  if ((data = malloc(datasizes[1])) == NULL || (buffer = malloc(datasizes[1])) == NULL)
+  {
+    free(data);
+    return (1);
+  }
+
+  for (i = 0; i < datasizes[1]; i ++)
+    data[i] = (unsigned char)((i / 3) ^ (i >> 11) ^ (i % 251 == 0 ? 0xff : 0));
+
+  // Write the streams using multiple compression threads...
+  testBegin("pdfioFileCreate(testpdfio-streams.pdf)");
+  if ((pdf = pdfioFileCreate("testpdfio-streams.pdf", "2.0", /*media_box*/NULL, /*crop_box*/NULL, (pdfio_error_cb_t)error_cb, &error)) != NULL)
+  {
+    testEnd(true);
+  }
+  else
+  {
+    testEnd(false);
+    goto fail;
+  }
+
+  testBegin("pdfioFileSetCompressionThreads(4)");
+  if (pdfioFileSetCompressionThreads(pdf, 4))
+  {
+    testEnd(true);
+  }
+  else
+  {
+    testEnd(false);
+    pdfioFileClose(pdf);
+    goto fail;
+  }
+
+  for (i = 0; i < 2; i ++)
+  {
+    testBegin("pdfioStreamWrite(%lu bytes)", (unsigned long)datasizes[i]);
+
+    dict = pdfioDictCreate(pdf);
+    pdfioDictSetName(dict, "Filter", "FlateDecode");
+
+    if ((obj = pdfioFileCreateObj(pdf, dict)) == NULL || (st = pdfioObjCreateStream(obj, PDFIO_FILTER_FLATE)) == NULL)
+    {
+      testEnd(false);
+      pdfioFileClose(pdf);
+      goto fail;
+    }
+
+    number[i] = pdfioObjGetNumber(obj);
+
+    // Write in odd-sized chunks to exercise the block buffering...
+    for (j = 0; j < datasizes[i]; j += 9999)
+    {
+      if (!pdfioStreamWrite(st, data + j, datasizes[i] - j > 9999 ? 9999 : datasizes[i] - j))
+        break;
+    }
+
+    if (pdfioStreamClose(st) && j >= datasizes[i])
+    {
+      testEnd(true);
+    }
+    else
+    {
+      testEnd(false);
+      pdfioFileClose(pdf);
+      goto fail;
+    }
+  }
+
+  // Write the same streams again at the same time using staged streams...
+  testBegin("pdfioFileSetStagedStreams(true)");
+  if (pdfioFileSetStagedStreams(pdf, true))
+  {
+    testEnd(true);
+  }
+  else
+  {
+    testEnd(false);
+    pdfioFileClose(pdf);
+    goto fail;
+  }
+
+  testBegin("pdfioObjCreateStream(staged)");
+  for (i = 0; i < 2; i ++)
+  {
+    dict = pdfioDictCreate(pdf);
+    pdfioDictSetName(dict, "Filter", "FlateDecode");
+
+    if ((obj = pdfioFileCreateObj(pdf, dict)) == NULL || (sts[i] = pdfioObjCreateStream(obj, PDFIO_FILTER_FLATE)) == NULL)
+      break;
+
+    number[i + 2] = pdfioObjGetNumber(obj);
+  }
+
+  if (i < 2)
+  {
+    testEnd(false);
+    pdfioFileClose(pdf);
+    goto fail;
+  }
+
+  testEnd(true);
+
+  testBegin("pdfioStreamWrite(staged)");
+  for (j = 0; j < datasizes[1]; j += 9999)
+  {
+    if (j < datasizes[0] && !pdfioStreamWrite(sts[0], data + j, datasizes[0] - j > 9999 ? 9999 : datasizes[0] - j))
+      break;
+    if (!pdfioStreamWrite(sts[1], data + j, datasizes[1] - j > 9999 ? 9999 : datasizes[1] - j))
+      break;
+  }
+
+  if (j >= datasizes[1] && pdfioStreamClose(sts[1]) && pdfioStreamClose(sts[0]))
+  {
+    testEnd(true);
+  }
+  else
+  {
+    testEnd(false);
+    pdfioFileClose(pdf);
+    goto fail;
+  }
+
+  // Write content operators with numeric values...
+  testBegin("pdfioContentPathPolygon(...)");
+  dict = pdfioDictCreate(pdf);
+
+  if ((obj = pdfioFileCreateObj(pdf, dict)) != NULL && (st = pdfioObjCreateStream(obj, PDFIO_FILTER_NONE)) != NULL && pdfioContentPathPolygon(st, 4, points) && pdfioContentSetLineWidth(st, 0.5) && pdfioContentMatrixTranslate(st, -1e-9, 1e13) && pdfioStreamClose(st))
+  {
+    testEnd(true);
+  }
+  else
+  {
+    testEnd(false);
+    pdfioFileClose(pdf);
+    goto fail;
+  }
+
+  number[4] = pdfioObjGetNumber(obj);
+
+  testBegin("pdfioFileSetPrecision(7)");
+  if (!pdfioFileSetPrecision(pdf, 7))
+  {
+    testEnd(true);
+  }
+  else
+  {
+    testEnd(false);
+    pdfioFileClose(pdf);
+    goto fail;
+  }
+
+  error = false;
+
+  testBegin("pdfioFileSetPrecision(2)");
+  if (pdfioFileSetPrecision(pdf, 2))
+  {
+    testEnd(true);
+  }
+  else
+  {
+    testEnd(false);
+    pdfioFileClose(pdf);
+    goto fail;
+  }
+
+  testBegin("pdfioContentPathPolygon(..., 2 decimal places)");
+  dict = pdfioDictCreate(pdf);
+
+  if ((obj = pdfioFileCreateObj(pdf, dict)) != NULL && (st = pdfioObjCreateStream(obj, PDFIO_FILTER_NONE)) != NULL && pdfioContentPathPolygon(st, 4, points) && pdfioContentSetLineWidth(st, 0.5) && pdfioContentPathRect(st, 0.333, 1.006, 2.0, -0.004) && pdfioStreamClose(st))
+  {
+    testEnd(true);
+  }
+  else
+  {
+    testEnd(false);
+    pdfioFileClose(pdf);
+    goto fail;
+  }
+
+  number[5] = pdfioObjGetNumber(obj);
+
+  testBegin("pdfioContentSetStateTracking(true)");
+  dict = pdfioDictCreate(pdf);
+
+  if ((obj = pdfioFileCreateObj(pdf, dict)) != NULL && (st = pdfioObjCreateStream(obj, PDFIO_FILTER_NONE)) != NULL && pdfioContentSetStateTracking(st, true))
+  {
+    testEnd(true);
+  }
+  else
+  {
+    testEnd(false);
+    pdfioFileClose(pdf);
+    goto fail;
+  }
+
+  number[6] = pdfioObjGetNumber(obj);
+
+  testBegin("pdfioContentSet...(redundant)");
+  if (pdfioContentSetFillColorDeviceRGB(st, 1.0, 0.0, 0.0) && pdfioContentSetFillColorDeviceRGB(st, 1.0, 0.0, 0.0) && pdfioContentSetLineWidth(st, 2.0) && pdfioContentSave(st) && pdfioContentSetLineWidth(st, 2.0) && pdfioContentSetLineWidth(st, 3.0) && pdfioContentRestore(st) && pdfioContentSetLineWidth(st, 2.0) && pdfioContentRestore(st) && pdfioContentSetFillColorDeviceRGB(st, 1.0, 0.0, 0.0) && pdfioContentTextBegin(st) && pdfioContentSetTextFont(st, "F1", 12.0) && pdfioContentSetTextFont(st, "F1", 12.0) && pdfioContentSetTextMatrix(st, identity) && pdfioContentTextEnd(st) && pdfioStreamClose(st))
+  {
+    testEnd(true);
+  }
+  else
+  {
+    testEnd(false);
+    pdfioFileClose(pdf);
+    goto fail;
+  }
+
+  if (!pdfioFileClose(pdf))
+    goto fail;
+
+  // Read the streams back...
+  testBegin("pdfioFileOpen(testpdfio-streams.pdf)");
+  if ((pdf = pdfioFileOpen("testpdfio-streams.pdf", /*password_cb*/NULL, /*password_data*/NULL, (pdfio_error_cb_t)error_cb, &error)) != NULL)
+  {
+    testEnd(true);
+  }
+  else
+  {
+    testEnd(false);
+    goto fail;
+  }
+
+  for (i = 0; i < 4; i ++)
+  {
+    testBegin("pdfioStreamRead(%lu bytes%s)", (unsigned long)datasizes[i & 1], i > 1 ? ", staged" : "");
+    if ((obj = pdfioFileFindObj(pdf, number[i])) == NULL || (st = pdfioObjOpenStream(obj, true)) == NULL)
+    {
+      testEnd(false);
+      pdfioFileClose(pdf);
+      goto fail;
+    }
+
+    for (j = 0; j < datasizes[i & 1]; j += (size_t)bytes)
+    {
+      if ((bytes = pdfioStreamRead(st, buffer + j, datasizes[i & 1] - j)) <= 0)
+        break;
+    }
+
+    pdfioStreamClose(st);
+
+    if (j != datasizes[i & 1])
+    {
+      testEndMessage(false, "got %lu bytes", (unsigned long)j);
+      pdfioFileClose(pdf);
+      goto fail;
+    }
+    else if (memcmp(data, buffer, datasizes[i & 1]))
+    {
+      testEndMessage(false, "data does not match");
+      pdfioFileClose(pdf);
+      goto fail;
+    }
+    else
+    {
+      testEnd(true);
+    }
+  }
+
+  for (i = 4; i < 7; i ++)
+  {
+    expected = i == 4 ? content : i == 5 ? ccontent : gcontent;
+
+    testBegin("pdfioStreamRead(content%s)", i == 5 ? ", 2 decimal places" : i == 6 ? ", state tracking" : "");
+    if ((obj = pdfioFileFindObj(pdf, number[i])) == NULL || (st = pdfioObjOpenStream(obj, true)) == NULL)
+    {
+      testEnd(false);
+      pdfioFileClose(pdf);
+      goto fail;
+    }
+
+    bytes = pdfioStreamRead(st, buffer, datasizes[1]);
+
+    pdfioStreamClose(st);
+
+    if (bytes == (ssize_t)strlen(expected) && !memcmp(buffer, expected, (size_t)bytes))
+    {
+      testEnd(true);
+    }
+    else
+    {
+      testEndMessage(false, "got \"%.*s\"", (int)(bytes > 0 ? bytes : 0), buffer);
+      pdfioFileClose(pdf);
+      goto fail;
+    }
+  }
+
+  pdfioFileClose(pdf);
+
+  // Write an empty staged stream to an output callback, which cannot seek...
+  if ((outfd = open("testpdfio-staged.pdf", O_CREAT | O_TRUNC | O_WRONLY | O_BINARY, 0666)) < 0)
+  {
+    perror("Unable to open \"testpdfio-staged.pdf\"");
+    goto fail;
+  }
+
+  testBegin("pdfioFileCreateOutput(testpdfio-staged.pdf)");
+  if ((pdf = pdfioFileCreateOutput((pdfio_output_cb_t)output_cb, &outfd, /*version*/NULL, /*media_box*/NULL, /*crop_box*/NULL, (pdfio_error_cb_t)error_cb, &error)) != NULL && pdfioFileSetStagedStreams(pdf, true))
+  {
+    testEnd(true);
+  }
+  else
+  {
+    testEnd(false);
+    close(outfd);
+    goto fail;
+  }
+
+  testBegin("pdfioStreamClose(empty staged)");
+  if ((obj = pdfioFileCreateObj(pdf, pdfioDictCreate(pdf))) != NULL && (st = pdfioObjCreateStream(obj, PDFIO_FILTER_NONE)) != NULL && pdfioStreamClose(st))
+  {
+    testEnd(true);
+    number[0] = pdfioObjGetNumber(obj);
+  }
+  else
+  {
+    testEnd(false);
+    pdfioFileClose(pdf);
+    close(outfd);
+    goto fail;
+  }
+
+  testBegin("pdfioFileClose(testpdfio-staged.pdf)");
+  if (pdfioFileClose(pdf))
+  {
+    testEnd(true);
+  }
+  else
+  {
+    testEnd(false);
+    close(outfd);
+    goto fail;
+  }
+
+  close(outfd);
+
+  testBegin("pdfioObjGetLength(empty staged)");
+  if ((pdf = pdfioFileOpen("testpdfio-staged.pdf", /*password_cb*/NULL, /*password_data*/NULL, (pdfio_error_cb_t)error_cb, &error)) != NULL && (obj = pdfioFileFindObj(pdf, number[0])) != NULL && pdfioObjGetLength(obj) == 0 && pdfioDictGetNumber(pdfioObjGetDict(obj), "Length") == 0.0)
+  {
+    testEnd(true);
+    pdfioFileClose(pdf);
+  }
+  else
+  {
+    testEnd(false);
+    pdfioFileClose(pdf);
+    goto fail;
+  }
+
+  free(data);
+  free(buffer);
+
+  return (0);
+
+  fail:
+
+  free(data);
+  free(buffer);
+
+  return (1);
+}
+
+
+//
+// 'do_subset_tests()' - Test subsetting embedded TrueType fonts.
+//
+
+static int				// O - Exit status
+do_subset_tests(void)
+{
+  pdfio_file_t	*pdf;			// PDF file
+  pdfio_obj_t	*font,			// Font object
+		*page,			// Page object
+		*file_obj,		// FontFile2 object
+		*form;			// Form XObject
+  pdfio_dict_t	*dict,			// Page/font dictionary
+		*desc;			// Font descriptor dictionary
+  pdfio_stream_t *st;			// Page or font stream
+  pdfio_rect_t	bbox;			// Form bounding box
+  unsigned char	cidmap[256];		// Start of CIDToGIDMap
+  char		content[256];		// Start of form content
+  bool		error = false;		// Error flag
+  unsigned char	*data = NULL,		// Font data
+		*temp;			// New font data
+  size_t	datasize = 0,		// Size of font data
+		datalen = 0;		// Length of font data
+  ssize_t	bytes;			// Bytes read
+  const char	*basefont;		// BaseFont name
+  ttf_t		*ttf;			// Subset font
+
+
+  testBegin("pdfioFileCreate(\"testpdfio-subset.pdf\", ...)");
+  if ((pdf = pdfioFileCreate("testpdfio-subset.pdf", /*version*/NULL, /*media_box*/NULL, /*crop_box*/NULL, (pdfio_error_cb_t)error_cb, &error)) != NULL)
+  {
+    testEnd(true);
+  }
+  else
+  {
+    testEnd(false);
+    return (1);
+  }
+
+  testBegin("pdfioFileSetFontSubsetting(true)");
+  if (pdfioFileSetFontSubsetting(pdf, true))
+  {
+    testEnd(true);
+  }
+  else
+  {
+    testEnd(false);
+    goto fail;
+  }
+
+  testBegin("pdfioFileCreateFontObjFromFile(OpenSans-Regular.ttf)");
+  if ((font = pdfioFileCreateFontObjFromFile(pdf, "testfiles/OpenSans-Regular.ttf", true)) != NULL)
+  {
+    testEnd(true);
+  }
+  else
+  {
+    testEnd(false);
+    goto fail;
+  }
+
+  // Glyphs shown in a form XObject need to be part of the subset too...
+  testBegin("pdfioObjCreateStream(form XObject)");
+  bbox.x1 = 0.0;
+  bbox.y1 = 0.0;
+  bbox.x2 = 200.0;
+  bbox.y2 = 50.0;
+
+  if ((dict = pdfioDictCreate(pdf)) != NULL && pdfioDictSetName(dict, "Type", "XObject") && pdfioDictSetName(dict, "Subtype", "Form") && pdfioDictSetName(dict, "Filter", "FlateDecode") && pdfioDictSetRect(dict, "BBox", &bbox) && pdfioPageDictAddFont(dict, "F1", font) && (form = pdfioFileCreateObj(pdf, dict)) != NULL && (st = pdfioObjCreateStream(form, PDFIO_FILTER_FLATE)) != NULL)
+  {
+    testEnd(true);
+  }
+  else
+  {
+    testEnd(false);
+    goto fail;
+  }
+
+  testBegin("pdfioContentTextShow(form XObject)");
+  if (pdfioContentTextBegin(st) && pdfioContentSetTextFont(st, "F1", 24.0) && pdfioContentTextMoveTo(st, 0.0, 12.0) && pdfioContentTextShow(st, true, "Zebra") && pdfioContentTextEnd(st) && pdfioStreamClose(st))
+  {
+    testEnd(true);
+  }
+  else
+  {
+    testEnd(false);
+    goto fail;
+  }
+
+  testBegin("pdfioFileCreatePage(...)");
+  if ((dict = pdfioDictCreate(pdf)) != NULL && pdfioPageDictAddFont(dict, "F1", font) && pdfioPageDictAddImage(dict, "X1", form) && (st = pdfioFileCreatePage(pdf, dict)) != NULL)
+  {
+    testEnd(true);
+  }
+  else
+  {
+    testEnd(false);
+    goto fail;
+  }
+
+  testBegin("pdfioContentTextShow(...)");
+  if (pdfioContentTextBegin(st) && pdfioContentSetTextFont(st, "F1", 24.0) && pdfioContentTextMoveTo(st, 72.0, 720.0) && pdfioContentTextShow(st, true, "Hello, World!\n") && pdfioContentTextShow(st, true, "Привет мир!") && pdfioContentTextEnd(st) && pdfioContentDrawImage(st, "X1", 72.0, 600.0, 1.0, 1.0) && pdfioStreamClose(st))
+  {
+    testEnd(true);
+  }
+  else
+  {
+    testEnd(false);
+    goto fail;
+  }
+
+  testBegin("pdfioFileClose(\"testpdfio-subset.pdf\")");
+  if (pdfioFileClose(pdf))
+  {
+    testEnd(true);
+  }
+  else
+  {
+    testEnd(false);
+    return (1);
+  }
+
+  // Read back the subset font...
+  testBegin("pdfioFileOpen(\"testpdfio-subset.pdf\", ...)");
+  if ((pdf = pdfioFileOpen("testpdfio-subset.pdf", /*password_cb*/NULL, /*password_data*/NULL, (pdfio_error_cb_t)error_cb, &error)) != NULL)
+  {
+    testEnd(true);
+  }
+  else
+  {
+    testEnd(false);
+    return (1);
+  }
+
+  testBegin("BaseFont");
+  if ((page = pdfioFileGetPage(pdf, 0)) != NULL && (font = pdfioDictGetObj(pdfioDictGetDict(pdfioDictGetDict(pdfioObjGetDict(page), "Resources"), "Font"), "F1")) != NULL && (dict = pdfioObjGetDict(pdfioArrayGetObj(pdfioDictGetArray(pdfioObjGetDict(font), "DescendantFonts"), 0))) != NULL && (basefont = pdfioDictGetName(dict, "BaseFont")) != NULL && strlen(basefont) > 7 && basefont[6] == '+')
+  {
+    testEndMessage(true, "%s", basefont);
+  }
+  else
+  {
+    testEnd(false);
+    goto fail;
+  }
+
+  testBegin("pdfioObjOpenStream(form XObject)");
+  if ((form = pdfioDictGetObj(pdfioDictGetDict(pdfioDictGetDict(pdfioObjGetDict(page), "Resources"), "XObject"), "X1")) != NULL && (st = pdfioObjOpenStream(form, true)) != NULL)
+  {
+    bytes = pdfioStreamRead(st, content, sizeof(content) - 1);
+    pdfioStreamClose(st);
+
+    if (bytes > 3 && !strncmp(content, "BT\n", 3))
+    {
+      testEnd(true);
+    }
+    else
+    {
+      testEndMessage(false, "unable to decode form content");
+      goto fail;
+    }
+  }
+  else
+  {
+    testEnd(false);
+    goto fail;
+  }
+
+  testBegin("CIDToGIDMap");
+  memset(cidmap, 0, sizeof(cidmap));
+
+  if ((file_obj = pdfioDictGetObj(dict, "CIDToGIDMap")) != NULL && (st = pdfioObjOpenStream(file_obj, true)) != NULL)
+  {
+    bytes = pdfioStreamRead(st, cidmap, sizeof(cidmap));
+    pdfioStreamClose(st);
+
+    if (bytes == (ssize_t)sizeof(cidmap) && (cidmap[2 * 'H'] || cidmap[2 * 'H' + 1]) && (cidmap[2 * 'Z'] || cidmap[2 * 'Z' + 1]) && (cidmap[2 * 'b'] || cidmap[2 * 'b' + 1]))
+    {
+      testEnd(true);
+    }
+    else
+    {
+      testEndMessage(false, "glyphs for 'Z' and 'b' are missing");
+      goto fail;
+    }
+  }
+  else
+  {
+    testEnd(false);
+    goto fail;
+  }
+
+  testBegin("FontFile2");
+  if ((desc = pdfioDictGetDict(dict, "FontDescriptor")) == NULL)
+    desc = pdfioObjGetDict(pdfioDictGetObj(dict, "FontDescriptor"));
+
+  if ((file_obj = pdfioDictGetObj(desc, "FontFile2")) != NULL && (st = pdfioObjOpenStream(file_obj, true)) != NULL)
+  {
+    do
+    {
+      if ((datasize - datalen) < 16384)
+      {
+        if ((temp = realloc(data, datasize + 16384)) == NULL)
+          break;
+
+        data     = temp;
+        datasize += 16384;
+      }
+    }
+    while ((bytes = pdfioStreamRead(st, data + datalen, datasize - datalen)) > 0 && (datalen += (size_t)bytes) > 0);
+
+    pdfioStreamClose(st);
+
+    if (datalen > 0 && datalen < 20000)
+    {
+      testEndMessage(true, "%u bytes", (unsigned)datalen);
+    }
+    else
+    {
+      testEndMessage(false, "%u bytes", (unsigned)datalen);
+      free(data);
+      goto fail;
+    }
+  }
+  else
+  {
+    testEnd(false);
+    goto fail;
+  }
+
+  testBegin("ttfCreateData(subset)");
+  if ((ttf = ttfCreateData(data, datalen, 0, NULL, NULL)) != NULL && ttfGetWidth(ttf, 'H') > 0)
+  {
+    testEnd(true);
+  }
+  else
+  {
+    testEnd(false);
+    ttfDelete(ttf);
+    free(data);
+    goto fail;
+  }
+
+  ttfDelete(ttf);
+  free(data);
+
+  pdfioFileClose(pdf);
+
+  return (0);
+
+  fail:
+
+  pdfioFileClose(pdf);
+
+  return (1);
+}
+
+
+//
+// 'do_test_file()' - Try loading a PDF file and listing pages and objects.
+//
+
+static int				// O - Exit status
+do_test_file(const char *filename,	// I - PDF filename
              int        objnum,		// I - Object number to dump, if any
              const char *password,	// I - Password for file
              bool       verbose)	// I - Be verbose?
@@ -510,51 +2759,159 @@ do_test_file(const char *filename,	// I - PDF filename
 	    memset(&media_box, 0, sizeof(media_box));
 	    dict = pdfioObjGetDict(obj);
 
-	    if (!pdfioDictGetRect(dict, "MediaBox", &media_box))
-	    {
-	      if ((obj = pdfioDictGetObj(dict, "Parent")) != NULL)
-	      {
-		dict = pdfioObjGetDict(obj);
-		pdfioDictGetRect(dict, "MediaBox", &media_box);
-	      }
-	    }
+	    if (!pdfioDictGetRect(dict, "MediaBox", &media_box))
+	    {
+	      if ((obj = pdfioDictGetObj(dict, "Parent")) != NULL)
+	      {
+		dict = pdfioObjGetDict(obj);
+		pdfioDictGetRect(dict, "MediaBox", &media_box);
+	      }
+	    }
+
+	    printf("    Page #%d (obj %d) is %gx%g.\n", (int)n + 1, (int)pdfioObjGetNumber(obj), media_box.x2, media_box.y2);
+	  }
+	}
+
+	// Show the associated value with each object...
+	for (n = 0; n < num_objs; n ++)
+	{
+	  if ((obj = pdfioFileGetObj(pdf, n)) == NULL)
+	  {
+	    printf("    Unable to get object #%d.\n", (int)n);
+	  }
+	  else
+	  {
+	    dict = pdfioObjGetDict(obj);
+
+	    printf("    %u %u obj dict=%p(%lu pairs)\n", (unsigned)pdfioObjGetNumber(obj), (unsigned)pdfioObjGetGeneration(obj), (void *)dict, dict ? (unsigned long)dict->num_pairs : 0UL);
+	    fputs("        ", stdout);
+	    _pdfioValueDebug(&obj->value, stdout);
+	    putchar('\n');
+	  }
+	}
+      }
+    }
+
+    // Close the file and return success...
+    pdfioFileClose(pdf);
+    return (0);
+  }
+  else
+  {
+    // Error message will already be displayed so just indicate failure...
+    if (!objnum)
+      testEnd(false);
+
+    return (1);
+  }
+}
+
+
+//
+// 'do_thread_tests()' - Test writing pages from multiple threads.
+//
+
+static int				// O - 0 on success, 1 on error
+do_thread_tests(void)
+{
+#ifdef HAVE_PTHREAD
+  pdfio_file_t	*pdf;			// PDF file
+  bool		error = false;		// Error flag
+  size_t	i,			// Looping var
+		num_pages;		// Number of pages
+  int		err;			// Thread creation error
+  pthread_t	threads[4];		// Threads
+
+
+  // Write the pages...
+  testBegin("pdfioFileCreate(testpdfio-threads.pdf)");
+  if ((pdf = pdfioFileCreate("testpdfio-threads.pdf", "2.0", /*media_box*/NULL, /*crop_box*/NULL, (pdfio_error_cb_t)error_cb, &error)) != NULL)
+  {
+    testEnd(true);
+  }
+  else
+  {
+    testEnd(false);
+    return (1);
+  }
+
+  testBegin("pdfioFileSetThreadSafe(true)");
+  if (pdfioFileSetThreadSafe(pdf, true))
+  {
+    testEnd(true);
+  }
+  else
+  {
+    testEnd(false);
+    pdfioFileClose(pdf);
+    return (1);
+  }
+
+  testBegin("pdfioFileCreatePage(4 threads)");
+  for (i = 0; i < (sizeof(threads) / sizeof(threads[0])); i ++)
+  {
+    if ((err = pthread_create(threads + i, NULL, (void *(*)(void *))thread_cb, pdf)) != 0)
+    {
+      testEndMessage(false, "%s", strerror(err));
+      error = true;
+      break;
+    }
+  }
+
+  while (i > 0)
+    pthread_join(threads[-- i], NULL);
 
-	    printf("    Page #%d (obj %d) is %gx%g.\n", (int)n + 1, (int)pdfioObjGetNumber(obj), media_box.x2, media_box.y2);
-	  }
-	}
+  if (error)
+  {
+    pdfioFileClose(pdf);
+    return (1);
+  }
 
-	// Show the associated value with each object...
-	for (n = 0; n < num_objs; n ++)
-	{
-	  if ((obj = pdfioFileGetObj(pdf, n)) == NULL)
-	  {
-	    printf("    Unable to get object #%d.\n", (int)n);
-	  }
-	  else
-	  {
-	    dict = pdfioObjGetDict(obj);
+  testEnd(true);
 
-	    printf("    %u %u obj dict=%p(%lu pairs)\n", (unsigned)pdfioObjGetNumber(obj), (unsigned)pdfioObjGetGeneration(obj), (void *)dict, dict ? (unsigned long)dict->num_pairs : 0UL);
-	    fputs("        ", stdout);
-	    _pdfioValueDebug(&obj->value, stdout);
-	    putchar('\n');
-	  }
-	}
-      }
-    }
+  testBegin("pdfioFileClose(testpdfio-threads.pdf)");
+  if (pdfioFileClose(pdf))
+  {
+    testEnd(true);
+  }
+  else
+  {
+    testEnd(false);
+    return (1);
+  }
 
-    // Close the file and return success...
-    pdfioFileClose(pdf);
-    return (0);
+  // Read the pages back...
+  testBegin("pdfioFileOpen(testpdfio-threads.pdf)");
+  if ((pdf = pdfioFileOpen("testpdfio-threads.pdf", /*password_cb*/NULL, /*password_data*/NULL, (pdfio_error_cb_t)error_cb, &error)) != NULL)
+  {
+    testEnd(true);
   }
   else
   {
-    // Error message will already be displayed so just indicate failure...
-    if (!objnum)
-      testEnd(false);
+    testEnd(false);
+    return (1);
+  }
 
+  testBegin("pdfioFileGetNumPages");
+  if ((num_pages = pdfioFileGetNumPages(pdf)) == 100)
+  {
+    testEndMessage(true, "%lu", (unsigned long)num_pages);
+  }
+  else
+  {
+    testEndMessage(false, "%lu, expected 100", (unsigned long)num_pages);
+    pdfioFileClose(pdf);
     return (1);
   }
+
+  pdfioFileClose(pdf);
+
+#else
+  testBegin("pdfioFileSetThreadSafe");
+  testEndMessage(true, "skipped, no threading support");
+#endif // HAVE_PTHREAD
+
+  return (0);
 }
 
 
@@ -1027,11 +3384,209 @@ do_unit_tests(void)
     ">\nendobj\n";
 
 
-  setbuf(stdout, NULL);
+  setbuf(stdout, NULL);
+
+  // First open the test PDF file...
+  testBegin("pdfioFileOpen(\"testfiles/testpdfio.pdf\")");
+  if ((inpdf = pdfioFileOpen("testfiles/testpdfio.pdf", /*password_cb*/NULL, /*password_data*/NULL, (pdfio_error_cb_t)error_cb, &error)) != NULL)
+  {
+    testEnd(true);
+  }
+  else
+  {
+    testEnd(false);
+    return (1);
+  }
+
+  // TODO: Test for known values in this test file.
+
+  // Test dictionary APIs
+  testBegin("pdfioDictCreate");
+  if ((dict = pdfioDictCreate(inpdf)) != NULL)
+  {
+    testEnd(true);
+
+    testBegin("pdfioDictSet*");
+    if (pdfioDictSetBoolean(dict, "Boolean", true) && pdfioDictSetName(dict, "Name", "Name") && pdfioDictSetNumber(dict, "Number", 42.0) && pdfioDictSetString(dict, "String", "String"))
+    {
+      testEnd(true);
+    }
+    else
+    {
+      testEnd(false);
+      return (1);
+    }
+
+    testBegin("pdfioDictIterateKeys");
+    pdfioDictIterateKeys(dict, iterate_cb, &count);
+    if (count == 4)
+    {
+      testEnd(true);
+    }
+    else
+    {
+      testEndMessage(false, "got %d, expected 4", count);
+      return (1);
+    }
+  }
+  else
+  {
+    testEnd(false);
+    return (1);
+  }
+
+  // Test the value parsers for edge cases...
+  testBegin("_pdfioValueRead(complex_dict)");
+  s = complex_dict;
+  _pdfioTokenInit(&tb, inpdf, (_pdfio_tconsume_cb_t)token_consume_cb, (_pdfio_tpeek_cb_t)token_peek_cb, (void *)&s);
+  if (_pdfioValueRead(inpdf, NULL, &tb, &value, 0))
+  {
+    // TODO: Check value...
+    testEnd(true);
+    _pdfioValueDebug(&value, stdout);
+  }
+  else
+    goto fail;
+
+  // Test the value parsers for edge cases...
+  testBegin("_pdfioValueRead(cid_dict)");
+  s = cid_dict;
+  _pdfioTokenInit(&tb, inpdf, (_pdfio_tconsume_cb_t)token_consume_cb, (_pdfio_tpeek_cb_t)token_peek_cb, (void *)&s);
+  if (_pdfioValueRead(inpdf, NULL, &tb, &value, 0))
+  {
+    // TODO: Check value...
+    testEnd(true);
+    _pdfioValueDebug(&value, stdout);
+  }
+  else
+    goto fail;
+
+  // Do crypto tests...
+  if (do_crypto_tests())
+    return (1);
+
+  // Create a new PDF file...
+  testBegin("pdfioFileCreate(\"testpdfio-out.pdf\", ...)");
+  if ((outpdf = pdfioFileCreate("testpdfio-out.pdf", /*version*/"1.7", /*media_box*/NULL, /*crop_box*/NULL, (pdfio_error_cb_t)error_cb, &error)) != NULL)
+    testEnd(true);
+  else
+    goto fail;
+
+  if (write_unit_file(inpdf, "testpdfio-out.pdf", outpdf, &num_pages, &first_image))
+    goto fail;
+
+  if (read_unit_file("testpdfio-out.pdf", num_pages, first_image, false))
+    goto fail;
+
+  // Stream a new PDF file...
+  if ((outfd = open("testpdfio-out2.pdf", O_CREAT | O_TRUNC | O_WRONLY | O_BINARY, 0666)) < 0)
+  {
+    perror("Unable to open \"testpdfio-out2.pdf\"");
+    goto fail;
+  }
+
+  testBegin("pdfioFileCreateOutput(...)");
+  if ((outpdf = pdfioFileCreateOutput((pdfio_output_cb_t)output_cb, &outfd, /*version*/"1.7", /*media_box*/NULL, /*crop_box*/NULL, (pdfio_error_cb_t)error_cb, &error)) != NULL)
+    testEnd(true);
+  else
+    goto fail;
+
+  if (write_unit_file(inpdf, "testpdfio-out2.pdf", outpdf, &num_pages, &first_image))
+    goto fail;
+
+  close(outfd);
+
+  if (read_unit_file("testpdfio-out2.pdf", num_pages, first_image, true))
+    goto fail;
+
+  // Create new encrypted PDF files...
+  testBegin("pdfioFileCreate(\"testpdfio-rc4.pdf\", ...)");
+  if ((outpdf = pdfioFileCreate("testpdfio-rc4.pdf", /*version*/"2.0", /*media_box*/NULL, /*crop_box*/NULL, (pdfio_error_cb_t)error_cb, &error)) != NULL)
+  {
+    testEnd(true);
+  }
+  else
+  {
+    testEnd(false);
+    return (1);
+  }
+
+  testBegin("pdfioFileSetPermissions(all, RC4-128, no passwords)");
+  if (pdfioFileSetPermissions(outpdf, PDFIO_PERMISSION_ALL, PDFIO_ENCRYPTION_RC4_128, NULL, NULL))
+  {
+    testEnd(true);
+  }
+  else
+  {
+    testEnd(false);
+    return (1);
+  }
+
+  if (write_unit_file(inpdf, "testpdfio-rc4.pdf", outpdf, &num_pages, &first_image))
+    return (1);
+
+  if (read_unit_file("testpdfio-rc4.pdf", num_pages, first_image, false))
+    return (1);
+
+  // Create new encrypted PDF files...
+  testBegin("pdfioFileCreate(\"testpdfio-rc4p.pdf\", ...)");
+  if ((outpdf = pdfioFileCreate("testpdfio-rc4p.pdf", /*version*/"1.7", /*media_box*/NULL, /*crop_box*/NULL, (pdfio_error_cb_t)error_cb, &error)) != NULL)
+  {
+    testEnd(true);
+  }
+  else
+  {
+    testEnd(false);
+    return (1);
+  }
+
+  testBegin("pdfioFileSetPermissions(no-print, RC4-128, passwords='owner' and 'user')");
+  if (pdfioFileSetPermissions(outpdf, PDFIO_PERMISSION_ALL ^ PDFIO_PERMISSION_PRINT, PDFIO_ENCRYPTION_RC4_128, "owner", "user"))
+  {
+    testEnd(true);
+  }
+  else
+  {
+    testEnd(false);
+    return (1);
+  }
+
+  if (write_unit_file(inpdf, "testpdfio-rc4p.pdf", outpdf, &num_pages, &first_image))
+    return (1);
+
+  if (read_unit_file("testpdfio-rc4p.pdf", num_pages, first_image, false))
+    return (1);
+
+  testBegin("pdfioFileCreate(\"testpdfio-aes.pdf\", ...)");
+  if ((outpdf = pdfioFileCreate("testpdfio-aes.pdf", /*version*/"2.0", /*media_box*/NULL, /*crop_box*/NULL, (pdfio_error_cb_t)error_cb, &error)) != NULL)
+  {
+    testEnd(true);
+  }
+  else
+  {
+    testEnd(false);
+    return (1);
+  }
+
+  testBegin("pdfioFileSetPermissions(all, AES-128, no passwords)");
+  if (pdfioFileSetPermissions(outpdf, PDFIO_PERMISSION_ALL, PDFIO_ENCRYPTION_AES_128, NULL, NULL))
+  {
+    testEnd(true);
+  }
+  else
+  {
+    testEnd(false);
+    return (1);
+  }
+
+  if (write_unit_file(inpdf, "testpdfio-aes.pdf", outpdf, &num_pages, &first_image))
+    return (1);
+
+  if (read_unit_file("testpdfio-aes.pdf", num_pages, first_image, false))
+    return (1);
 
-  // First open the test PDF file...
-  testBegin("pdfioFileOpen(\"testfiles/testpdfio.pdf\")");
-  if ((inpdf = pdfioFileOpen("testfiles/testpdfio.pdf", /*password_cb*/NULL, /*password_data*/NULL, (pdfio_error_cb_t)error_cb, &error)) != NULL)
+  testBegin("pdfioFileCreate(\"testpdfio-aesp.pdf\", ...)");
+  if ((outpdf = pdfioFileCreate("testpdfio-aesp.pdf", /*version*/"2.0", /*media_box*/NULL, /*crop_box*/NULL, (pdfio_error_cb_t)error_cb, &error)) != NULL)
   {
     testEnd(true);
   }
@@ -1041,16 +3596,192 @@ do_unit_tests(void)
     return (1);
   }
 
-  // TODO: Test for known values in this test file.
+  testBegin("pdfioFileSetPermissions(no-print, AES-128, passwords='owner' and 'user')");
+  if (pdfioFileSetPermissions(outpdf, PDFIO_PERMISSION_ALL ^ PDFIO_PERMISSION_PRINT, PDFIO_ENCRYPTION_AES_128, "owner", "user"))
+  {
+    testEnd(true);
+  }
+  else
+  {
+    testEnd(false);
+    return (1);
+  }
 
-  // Test dictionary APIs
-  testBegin("pdfioDictCreate");
-  if ((dict = pdfioDictCreate(inpdf)) != NULL)
+  testBegin("pdfioFileSetStagedStreams(true)");
+  if (pdfioFileSetStagedStreams(outpdf, true))
   {
     testEnd(true);
+  }
+  else
+  {
+    testEnd(false);
+    return (1);
+  }
 
-    testBegin("pdfioDictSet*");
-    if (pdfioDictSetBoolean(dict, "Boolean", true) && pdfioDictSetName(dict, "Name", "Name") && pdfioDictSetNumber(dict, "Number", 42.0) && pdfioDictSetString(dict, "String", "String"))
+  if (write_unit_file(inpdf, "testpdfio-aesp.pdf", outpdf, &num_pages, &first_image))
+    return (1);
+
+  if (read_unit_file("testpdfio-aesp.pdf", num_pages, first_image, false))
+    return (1);
+
+  testBegin("pdfioFileCreateTemporary");
+  if ((outpdf = pdfioFileCreateTemporary(temppdf, sizeof(temppdf), /*version*/"2.0", /*media_box*/NULL, /*crop_box*/NULL, (pdfio_error_cb_t)error_cb, &error)) != NULL)
+  {
+    testEndMessage(true, "%s", temppdf);
+  }
+  else
+  {
+    testEnd(false);
+    return (1);
+  }
+
+  testBegin("pdfioFileSetObjectStreams(true)");
+  if (pdfioFileSetObjectStreams(outpdf, true))
+  {
+    testEnd(true);
+  }
+  else
+  {
+    testEnd(false);
+    return (1);
+  }
+
+  if (write_unit_file(inpdf, "<temporary>", outpdf, &num_pages, &first_image))
+    return (1);
+
+  if (read_unit_file(temppdf, num_pages, first_image, false))
+    return (1);
+
+  pdfioFileClose(inpdf);
+
+  // Do PDF/A tests...
+  if (do_pdfa_tests())
+    return (1);
+
+  // Do page tree tests...
+  if (do_page_tree_tests())
+    return (1);
+
+  // Do stream compression tests...
+  if (do_stream_tests())
+    return (1);
+
+  // Do multi-threaded page generation tests...
+  if (do_thread_tests())
+    return (1);
+
+  // Do incremental update tests...
+  if (do_update_tests())
+    return (1);
+
+  // Do linearized output tests...
+  if (do_linear_tests())
+    return (1);
+
+  // Do merge tests...
+  if (do_merge_tests())
+    return (1);
+
+  // Do resource cache tests...
+  if (do_cache_tests())
+    return (1);
+
+  // Do font subsetting tests...
+  if (do_subset_tests())
+    return (1);
+
+  // Do shared font cache tests...
+  if (do_font_cache_tests())
+    return (1);
+
+  // Do streaming image tests...
+  if (do_image_tests())
+    return (1);
+
+  return (0);
+
+  fail:
+
+  pdfioFileClose(inpdf);
+
+  return (1);
+}
+
+
+//
+// 'do_update_tests()' - Test incremental updates of existing PDF files.
+//
+
+static int				// O - 0 on success, 1 on error
+do_update_tests(void)
+{
+  int		i;			// Looping var
+  pdfio_file_t	*pdf;			// PDF file
+  pdfio_stream_t *st;			// Page contents stream
+  pdfio_obj_t	*page,			// Page object
+		*contents;		// New contents object
+  pdfio_dict_t	*dict;			// Contents dictionary
+  pdfio_array_t	*array;			// Contents array
+  bool		error = false;		// Error flag
+  size_t	n;			// Number of pages/streams
+  struct stat	fileinfo;		// File information
+  off_t		filesize;		// Original file size
+  char		filename[256],		// Filename
+		buffer[256];		// Stream data
+  ssize_t	bytes;			// Bytes read
+  FILE		*fp;			// File to pad
+  size_t	pad;			// Number of padding bytes
+  static const char * const versions[] =// PDF versions to test
+  {
+    "1.4",				// Cross-reference table
+    "2.0"				// Cross-reference stream
+  };
+
+
+  for (i = 0; i < (int)(sizeof(versions) / sizeof(versions[0])); i ++)
+  {
+    // Write the original file...
+    snprintf(filename, sizeof(filename), "testpdfio-update%d.pdf", i + 1);
+
+    testBegin("pdfioFileCreate(%s, \"%s\")", filename, versions[i]);
+    if ((pdf = pdfioFileCreate(filename, versions[i], /*media_box*/NULL, /*crop_box*/NULL, (pdfio_error_cb_t)error_cb, &error)) == NULL)
+    {
+      testEnd(false);
+      return (1);
+    }
+
+    for (n = 0; n < 3; n ++)
+    {
+      if ((st = pdfioFileCreatePage(pdf, NULL)) == NULL)
+        break;
+
+      pdfioContentSetFillColorGray(st, 0.25 * (double)n);
+      pdfioContentPathRect(st, 36.0, 36.0, 540.0, 720.0);
+      pdfioContentFill(st, false);
+
+      if (!pdfioStreamClose(st))
+        break;
+    }
+
+    if (n < 3 || !pdfioFileClose(pdf))
+    {
+      testEnd(false);
+      return (1);
+    }
+
+    if (stat(filename, &fileinfo))
+    {
+      testEndMessage(false, "%s", strerror(errno));
+      return (1);
+    }
+
+    filesize = fileinfo.st_size;
+
+    testEndMessage(true, "%ld bytes", (long)filesize);
+
+    // Open it for update and add a second content stream to the first page...
+    testBegin("pdfioFileOpenUpdate(%s)", filename);
+    if ((pdf = pdfioFileOpenUpdate(filename, (pdfio_error_cb_t)error_cb, &error)) != NULL)
     {
       testEnd(true);
     }
@@ -1060,232 +3791,215 @@ do_unit_tests(void)
       return (1);
     }
 
-    testBegin("pdfioDictIterateKeys");
-    pdfioDictIterateKeys(dict, iterate_cb, &count);
-    if (count == 4)
+    if (i > 0)
     {
-      testEnd(true);
+      testBegin("pdfioFileSetObjectStreams(true)");
+      if (pdfioFileSetObjectStreams(pdf, true))
+      {
+        testEnd(true);
+      }
+      else
+      {
+        testEnd(false);
+        pdfioFileClose(pdf);
+        return (1);
+      }
+    }
+
+    testBegin("pdfioFileCreatePage");
+    if (pdfioFileCreatePage(pdf, NULL) == NULL)
+    {
+      testEndMessage(true, "not allowed");
     }
     else
     {
-      testEndMessage(false, "got %d, expected 4", count);
+      testEndMessage(false, "page added to updated file");
+      pdfioFileClose(pdf);
       return (1);
     }
-  }
-  else
-  {
-    testEnd(false);
-    return (1);
-  }
 
-  // Test the value parsers for edge cases...
-  testBegin("_pdfioValueRead(complex_dict)");
-  s = complex_dict;
-  _pdfioTokenInit(&tb, inpdf, (_pdfio_tconsume_cb_t)token_consume_cb, (_pdfio_tpeek_cb_t)token_peek_cb, (void *)&s);
-  if (_pdfioValueRead(inpdf, NULL, &tb, &value, 0))
-  {
-    // TODO: Check value...
-    testEnd(true);
-    _pdfioValueDebug(&value, stdout);
-  }
-  else
-    goto fail;
+    testBegin("pdfioObjUpdate(page 1)");
+    if ((page = pdfioFileGetPage(pdf, 0)) == NULL || !pdfioObjUpdate(page))
+    {
+      testEnd(false);
+      pdfioFileClose(pdf);
+      return (1);
+    }
 
-  // Test the value parsers for edge cases...
-  testBegin("_pdfioValueRead(cid_dict)");
-  s = cid_dict;
-  _pdfioTokenInit(&tb, inpdf, (_pdfio_tconsume_cb_t)token_consume_cb, (_pdfio_tpeek_cb_t)token_peek_cb, (void *)&s);
-  if (_pdfioValueRead(inpdf, NULL, &tb, &value, 0))
-  {
-    // TODO: Check value...
-    testEnd(true);
-    _pdfioValueDebug(&value, stdout);
-  }
-  else
-    goto fail;
+    if ((dict = pdfioDictCreate(pdf)) == NULL || (contents = pdfioFileCreateObj(pdf, dict)) == NULL || (st = pdfioObjCreateStream(contents, PDFIO_FILTER_NONE)) == NULL)
+    {
+      testEnd(false);
+      pdfioFileClose(pdf);
+      return (1);
+    }
 
-  // Do crypto tests...
-  if (do_crypto_tests())
-    return (1);
+    pdfioStreamPuts(st, "BT /F1 48 Tf 100 400 Td (DRAFT) Tj ET\n");
+    pdfioStreamClose(st);
 
-  // Create a new PDF file...
-  testBegin("pdfioFileCreate(\"testpdfio-out.pdf\", ...)");
-  if ((outpdf = pdfioFileCreate("testpdfio-out.pdf", /*version*/"1.7", /*media_box*/NULL, /*crop_box*/NULL, (pdfio_error_cb_t)error_cb, &error)) != NULL)
-    testEnd(true);
-  else
-    goto fail;
+    if ((array = pdfioArrayCreate(pdf)) == NULL)
+    {
+      testEnd(false);
+      pdfioFileClose(pdf);
+      return (1);
+    }
 
-  if (write_unit_file(inpdf, "testpdfio-out.pdf", outpdf, &num_pages, &first_image))
-    goto fail;
+    pdfioArrayAppendObj(array, pdfioDictGetObj(pdfioObjGetDict(page), "Contents"));
+    pdfioArrayAppendObj(array, contents);
+    pdfioDictSetArray(pdfioObjGetDict(page), "Contents", array);
+    pdfioFileSetTitle(pdf, "Updated Document");
 
-  if (read_unit_file("testpdfio-out.pdf", num_pages, first_image, false))
-    goto fail;
+    if (pdfioObjClose(page))
+    {
+      testEnd(true);
+    }
+    else
+    {
+      testEnd(false);
+      pdfioFileClose(pdf);
+      return (1);
+    }
 
-  // Stream a new PDF file...
-  if ((outfd = open("testpdfio-out2.pdf", O_CREAT | O_TRUNC | O_WRONLY | O_BINARY, 0666)) < 0)
-  {
-    perror("Unable to open \"testpdfio-out2.pdf\"");
-    goto fail;
-  }
+    testBegin("pdfioFileClose(%s)", filename);
+    if (!pdfioFileClose(pdf))
+    {
+      testEnd(false);
+      return (1);
+    }
+    else if (stat(filename, &fileinfo))
+    {
+      testEndMessage(false, "%s", strerror(errno));
+      return (1);
+    }
 
-  testBegin("pdfioFileCreateOutput(...)");
-  if ((outpdf = pdfioFileCreateOutput((pdfio_output_cb_t)output_cb, &outfd, /*version*/"1.7", /*media_box*/NULL, /*crop_box*/NULL, (pdfio_error_cb_t)error_cb, &error)) != NULL)
-    testEnd(true);
-  else
-    goto fail;
+    testEndMessage(true, "%ld bytes appended", (long)(fileinfo.st_size - filesize));
 
-  if (write_unit_file(inpdf, "testpdfio-out2.pdf", outpdf, &num_pages, &first_image))
-    goto fail;
+    // Read the updated file back...
+    testBegin("pdfioFileOpen(%s)", filename);
+    if ((pdf = pdfioFileOpen(filename, /*password_cb*/NULL, /*password_data*/NULL, (pdfio_error_cb_t)error_cb, &error)) != NULL)
+    {
+      testEnd(true);
+    }
+    else
+    {
+      testEnd(false);
+      return (1);
+    }
 
-  close(outfd);
+    testBegin("pdfioFileGetNumPages");
+    if ((n = pdfioFileGetNumPages(pdf)) == 3)
+    {
+      testEndMessage(true, "%lu", (unsigned long)n);
+    }
+    else
+    {
+      testEndMessage(false, "%lu, expected 3", (unsigned long)n);
+      pdfioFileClose(pdf);
+      return (1);
+    }
+
+    testBegin("pdfioFileGetTitle");
+    if (pdfioFileGetTitle(pdf) && !strcmp(pdfioFileGetTitle(pdf), "Updated Document"))
+    {
+      testEndMessage(true, "%s", pdfioFileGetTitle(pdf));
+    }
+    else
+    {
+      testEndMessage(false, "got '%s', expected 'Updated Document'", pdfioFileGetTitle(pdf));
+      pdfioFileClose(pdf);
+      return (1);
+    }
 
-  if (read_unit_file("testpdfio-out2.pdf", num_pages, first_image, true))
-    goto fail;
+    testBegin("pdfioPageGetNumStreams(page 1)");
+    if ((n = pdfioPageGetNumStreams(pdfioFileGetPage(pdf, 0))) == 2)
+    {
+      testEndMessage(true, "%lu", (unsigned long)n);
+    }
+    else
+    {
+      testEndMessage(false, "%lu, expected 2", (unsigned long)n);
+      pdfioFileClose(pdf);
+      return (1);
+    }
 
-  // Create new encrypted PDF files...
-  testBegin("pdfioFileCreate(\"testpdfio-rc4.pdf\", ...)");
-  if ((outpdf = pdfioFileCreate("testpdfio-rc4.pdf", /*version*/"2.0", /*media_box*/NULL, /*crop_box*/NULL, (pdfio_error_cb_t)error_cb, &error)) != NULL)
-  {
-    testEnd(true);
-  }
-  else
-  {
-    testEnd(false);
-    return (1);
-  }
+    testBegin("pdfioPageOpenStream(page 1, 1)");
+    if ((st = pdfioPageOpenStream(pdfioFileGetPage(pdf, 0), 1, true)) == NULL)
+    {
+      testEnd(false);
+      pdfioFileClose(pdf);
+      return (1);
+    }
 
-  testBegin("pdfioFileSetPermissions(all, RC4-128, no passwords)");
-  if (pdfioFileSetPermissions(outpdf, PDFIO_PERMISSION_ALL, PDFIO_ENCRYPTION_RC4_128, NULL, NULL))
-  {
-    testEnd(true);
-  }
-  else
-  {
-    testEnd(false);
-    return (1);
-  }
+    bytes = pdfioStreamRead(st, buffer, sizeof(buffer) - 1);
+    pdfioStreamClose(st);
 
-  if (write_unit_file(inpdf, "testpdfio-rc4.pdf", outpdf, &num_pages, &first_image))
-    return (1);
+    if (bytes > 0)
+      buffer[bytes] = '\0';
+    else
+      buffer[0] = '\0';
 
-  if (read_unit_file("testpdfio-rc4.pdf", num_pages, first_image, false))
-    return (1);
+    if (!strncmp(buffer, "BT /F1 48 Tf", 12))
+    {
+      testEnd(true);
+    }
+    else
+    {
+      testEndMessage(false, "got '%s'", buffer);
+      pdfioFileClose(pdf);
+      return (1);
+    }
 
-  // Create new encrypted PDF files...
-  testBegin("pdfioFileCreate(\"testpdfio-rc4p.pdf\", ...)");
-  if ((outpdf = pdfioFileCreate("testpdfio-rc4p.pdf", /*version*/"1.7", /*media_box*/NULL, /*crop_box*/NULL, (pdfio_error_cb_t)error_cb, &error)) != NULL)
-  {
-    testEnd(true);
-  }
-  else
-  {
-    testEnd(false);
-    return (1);
+    pdfioFileClose(pdf);
   }
 
-  testBegin("pdfioFileSetPermissions(no-print, RC4-128, passwords='owner' and 'user')");
-  if (pdfioFileSetPermissions(outpdf, PDFIO_PERMISSION_ALL ^ PDFIO_PERMISSION_PRINT, PDFIO_ENCRYPTION_RC4_128, "owner", "user"))
-  {
-    testEnd(true);
-  }
-  else
+  // Pad the end of the last file so that the final "startxref" is at the
+  // very start of the 1k of data that pdfioFileOpen reads from the end...
+  testBegin("pdfioFileOpen(%s, startxref at start of trailer data)", filename);
+  if ((fp = fopen(filename, "r+b")) == NULL)
   {
-    testEnd(false);
+    testEndMessage(false, "%s", strerror(errno));
     return (1);
   }
 
-  if (write_unit_file(inpdf, "testpdfio-rc4p.pdf", outpdf, &num_pages, &first_image))
-    return (1);
-
-  if (read_unit_file("testpdfio-rc4p.pdf", num_pages, first_image, false))
-    return (1);
-
-  testBegin("pdfioFileCreate(\"testpdfio-aes.pdf\", ...)");
-  if ((outpdf = pdfioFileCreate("testpdfio-aes.pdf", /*version*/"2.0", /*media_box*/NULL, /*crop_box*/NULL, (pdfio_error_cb_t)error_cb, &error)) != NULL)
-  {
-    testEnd(true);
-  }
-  else
+  if (fseek(fp, -64, SEEK_END) || (bytes = (ssize_t)fread(buffer, 1, 64, fp)) != 64)
   {
-    testEnd(false);
+    testEndMessage(false, "unable to read end of file");
+    fclose(fp);
     return (1);
   }
 
-  testBegin("pdfioFileSetPermissions(all, AES-128, no passwords)");
-  if (pdfioFileSetPermissions(outpdf, PDFIO_PERMISSION_ALL, PDFIO_ENCRYPTION_AES_128, NULL, NULL))
-  {
-    testEnd(true);
-  }
-  else
+  for (n = 55; n > 0; n --)
   {
-    testEnd(false);
-    return (1);
+    if (!memcmp(buffer + n, "startxref", 9))
+      break;
   }
 
-  if (write_unit_file(inpdf, "testpdfio-aes.pdf", outpdf, &num_pages, &first_image))
-    return (1);
-
-  if (read_unit_file("testpdfio-aes.pdf", num_pages, first_image, false))
-    return (1);
+  pad = 1024 - (64 - n);
 
-  testBegin("pdfioFileCreate(\"testpdfio-aesp.pdf\", ...)");
-  if ((outpdf = pdfioFileCreate("testpdfio-aesp.pdf", /*version*/"2.0", /*media_box*/NULL, /*crop_box*/NULL, (pdfio_error_cb_t)error_cb, &error)) != NULL)
-  {
-    testEnd(true);
-  }
-  else
-  {
-    testEnd(false);
-    return (1);
-  }
+  memset(buffer, '\n', sizeof(buffer));
+  fseek(fp, 0, SEEK_END);
 
-  testBegin("pdfioFileSetPermissions(no-print, AES-128, passwords='owner' and 'user')");
-  if (pdfioFileSetPermissions(outpdf, PDFIO_PERMISSION_ALL ^ PDFIO_PERMISSION_PRINT, PDFIO_ENCRYPTION_AES_128, "owner", "user"))
-  {
-    testEnd(true);
-  }
-  else
+  for (; pad > 0; pad -= (size_t)bytes)
   {
-    testEnd(false);
-    return (1);
+    if ((bytes = (ssize_t)fwrite(buffer, 1, pad > sizeof(buffer) ? sizeof(buffer) : pad, fp)) <= 0)
+      break;
   }
 
-  if (write_unit_file(inpdf, "testpdfio-aesp.pdf", outpdf, &num_pages, &first_image))
-    return (1);
+  fclose(fp);
 
-  if (read_unit_file("testpdfio-aesp.pdf", num_pages, first_image, false))
-    return (1);
+  error = false;
 
-  testBegin("pdfioFileCreateTemporary");
-  if ((outpdf = pdfioFileCreateTemporary(temppdf, sizeof(temppdf), /*version*/"2.0", /*media_box*/NULL, /*crop_box*/NULL, (pdfio_error_cb_t)error_cb, &error)) != NULL)
+  if (pad == 0 && (pdf = pdfioFileOpen(filename, /*password_cb*/NULL, /*password_data*/NULL, (pdfio_error_cb_t)error_cb, &error)) != NULL && !error && pdfioFileGetNumPages(pdf) == 3)
   {
-    testEndMessage(true, "%s", temppdf);
+    testEnd(true);
+    pdfioFileClose(pdf);
   }
   else
   {
-    testEnd(false);
+    testEndMessage(false, "pad=%u, error=%s", (unsigned)pad, error ? "true" : "false");
     return (1);
   }
 
-  if (write_unit_file(inpdf, "<temporary>", outpdf, &num_pages, &first_image))
-    return (1);
-
-  if (read_unit_file(temppdf, num_pages, first_image, false))
-    return (1);
-
-  pdfioFileClose(inpdf);
-
-  // Do PDF/A tests...
-  if (do_pdfa_tests())
-    return (1);
-
   return (0);
-
-  fail:
-
-  pdfioFileClose(inpdf);
-
-  return (1);
 }
 
 
@@ -1687,6 +4401,34 @@ read_unit_file(const char *filename,	// I - File to read
 }
 
 
+//
+// 'thread_cb()' - Write 25 pages from a thread.
+//
+
+static void *				// O - Thread exit status
+thread_cb(pdfio_file_t *pdf)		// I - PDF file
+{
+  int		i;			// Looping var
+  pdfio_stream_t *st;			// Page contents stream
+
+
+  for (i = 0; i < 25; i ++)
+  {
+    if ((st = pdfioFileCreatePage(pdf, NULL)) == NULL)
+      break;
+
+    pdfioContentSetFillColorGray(st, (double)i / 25.0);
+    pdfioContentPathRect(st, 36.0, 36.0, 540.0, 720.0);
+    pdfioContentFill(st, false);
+
+    if (!pdfioStreamClose(st))
+      break;
+  }
+
+  return (NULL);
+}
+
+
 //
 // 'token_consume_cb()' - Consume bytes from a test string.
 //
@@ -2624,11 +5366,20 @@ write_font_test(
 {
   pdfio_dict_t		*dict;		// Page dictionary
   pdfio_stream_t	*st;		// Page contents stream
-  pdfio_obj_t		*textfont;	// Text font
+  pdfio_obj_t		*textfont,	// Text font
+			*symfont,	// Symbol font
+			*dingfont;	// ZapfDingbats font
+  pdfio_fontmetrics_t	*fm = NULL,	// Text font measurement context
+			*basefm = NULL,	// Page number font measurement context
+			*symfm = NULL,	// Symbol font measurement context
+			*dingfm = NULL;	// ZapfDingbats font measurement context
   char			title[256],	// Page title
 			textname[256],	// Name of text font
 			*ptr;		// Pointer into name
-  double		width;		// Text width
+  double		width,		// Text width
+			expected,	// Expected text width
+			advances[256];	// Cumulative text widths
+  size_t		len;		// Length of text
   int			i;		// Looping var
   static const char * const welcomes[] =// "Welcome" in many languages
   {
@@ -2795,6 +5546,82 @@ write_font_test(
     return (1);
   }
 
+  testBegin("pdfioFontMetricsCreate");
+  if ((fm = pdfioFontMetricsCreate(textfont)) != NULL && (basefm = pdfioFontMetricsCreate(font)) != NULL && (symfont = pdfioFileCreateFontObjFromBase(pdf, "Symbol")) != NULL && (symfm = pdfioFontMetricsCreate(symfont)) != NULL && (dingfont = pdfioFileCreateFontObjFromBase(pdf, "ZapfDingbats")) != NULL && (dingfm = pdfioFontMetricsCreate(dingfont)) != NULL)
+  {
+    testEnd(true);
+  }
+  else
+  {
+    testEnd(false);
+    pdfioFontMetricsDelete(fm);
+    pdfioFontMetricsDelete(basefm);
+    pdfioFontMetricsDelete(symfm);
+    return (1);
+  }
+
+  // TrueType widths are rounded to 1/1000th of an em, the same as the PDF
+  // font widths, so allow a small difference from pdfioContentTextMeasure...
+  testBegin("pdfioFontMetricsMeasure");
+  for (i = 0, width = expected = 0.0; i < (int)(sizeof(welcomes) / sizeof(welcomes[0])); i ++)
+  {
+    if ((len = strlen(welcomes[i])) >= (sizeof(advances) / sizeof(advances[0])))
+      continue;
+
+    width    = pdfioFontMetricsMeasure(fm, welcomes[i], 10.0, advances);
+    expected = pdfioContentTextMeasure(textfont, welcomes[i], 10.0);
+
+    if (fabs(width - expected) > 0.01 * len || advances[0] != 0.0 || advances[len] != width)
+      break;
+
+    width    = pdfioFontMetricsMeasure(basefm, welcomes[i], 10.0, NULL);
+    expected = pdfioContentTextMeasure(font, welcomes[i], 10.0);
+
+    if (width != expected)
+      break;
+
+    width    = pdfioFontMetricsMeasure(symfm, welcomes[i], 10.0, NULL);
+    expected = pdfioContentTextMeasure(symfont, welcomes[i], 10.0);
+
+    if (width != expected)
+      break;
+
+    width    = pdfioFontMetricsMeasure(dingfm, welcomes[i], 10.0, NULL);
+    expected = pdfioContentTextMeasure(dingfont, welcomes[i], 10.0);
+
+    if (width != expected)
+      break;
+  }
+
+  pdfioFontMetricsDelete(fm);
+  pdfioFontMetricsDelete(basefm);
+  pdfioFontMetricsDelete(symfm);
+  pdfioFontMetricsDelete(dingfm);
+
+  if (i < (int)(sizeof(welcomes) / sizeof(welcomes[0])))
+  {
+    testEndMessage(false, "\"%s\": got %g, expected %g", welcomes[i], width, expected);
+    return (1);
+  }
+  else
+  {
+    testEnd(true);
+  }
+
+  // Characters from U+0100 up map to the CP1252 characters from 0x80 to 0x9F,
+  // or to "?" if there is no CP1252 character (Helvetica widths 222 + 221 +
+  // 333 + 333 + 1000 + 667 + 556)...
+  testBegin("pdfioContentTextMeasure(CP1252)");
+  if (fabs((width = pdfioContentTextMeasure(font, "‘’“”™ŸĀ", 1.0)) - 3.332) < 0.001)
+  {
+    testEnd(true);
+  }
+  else
+  {
+    testEndMessage(false, "got %g, expected 3.332", width);
+    return (1);
+  }
+
   testBegin("pdfioDictCreate");
   if ((dict = pdfioDictCreate(pdf)) != NULL)
   {
@@ -3115,7 +5942,7 @@ write_image_object(
   pdfio_obj_t	*obj;			// Image object
   pdfio_stream_t *st;			// Image stream
   int		x, y;			// Coordinates in image
-  unsigned char	buffer[768],		// Buffer for image
+  unsigned char	buffer[1536],		// Buffer for two lines of image
 		*bufptr;		// Pointer into buffer
 
 
@@ -3145,18 +5972,25 @@ write_image_object(
   if ((obj = pdfioFileCreateObj(pdf, dict)) == NULL)
     return (NULL);
 
-  // Create the image stream and write the image...
-  if ((st = pdfioObjCreateStream(obj, PDFIO_FILTER_FLATE)) == NULL)
+  // Create the image stream and write the image, using an explicit level and
+  // strategy for the unpredicted image...
+  if (predictor == _PDFIO_PREDICTOR_NONE)
+    st = pdfioObjCreateFlateStream(obj, 6, PDFIO_ZSTRATEGY_RLE);
+  else
+    st = pdfioObjCreateStream(obj, PDFIO_FILTER_FLATE);
+
+  if (!st)
     return (NULL);
 
-  // This creates a useful criss-cross image that highlights predictor errors...
-  for (y = 0; y < 256; y ++)
+  // This creates a useful criss-cross image that highlights predictor errors,
+  // written two lines at a time...
+  for (y = 0; y < 256; y += 2)
   {
-    for (x = 0, bufptr = buffer; x < 256; x ++, bufptr += 3)
+    for (x = 0, bufptr = buffer; x < 512; x ++, bufptr += 3)
     {
-      bufptr[0] = (unsigned char)y;
-      bufptr[1] = (unsigned char)(y + x);
-      bufptr[2] = (unsigned char)(y - x);
+      bufptr[0] = (unsigned char)(y + x / 256);
+      bufptr[1] = (unsigned char)(y + x / 256 + x % 256);
+      bufptr[2] = (unsigned char)(y + x / 256 - x % 256);
     }
 
     if (!pdfioStreamWrite(st, buffer, sizeof(buffer)))
@@ -3697,6 +6531,17 @@ write_png_tests(pdfio_file_t *pdf,	// I - PDF file
     return (1);
   }
 
+  testBegin("pdfioFileCreateImageObjFromFile(\"testfiles/pdfio-color.png\") DecodeParms");
+  if (pdfioDictGetNumber(pdfioDictGetDict(pdfioObjGetDict(color), "DecodeParms"), "Predictor") == 15.0)
+  {
+    testEnd(true);
+  }
+  else
+  {
+    testEndMessage(false, "expected PNG image data to be copied");
+    return (1);
+  }
+
   testBegin("pdfioFileCreateImageObjFromFile(\"testfiles/pdfio-gray.png\")");
   if ((gray = pdfioFileCreateImageObjFromFile(pdf, "testfiles/pdfio-gray.png", false)) != NULL)
   {
@@ -4283,9 +7128,14 @@ write_unit_file(
   pdfio_obj_t		*color_jpg,	// color.jpg image
 			*gray_jpg,	// gray.jpg image
 			*helvetica,	// Helvetica font
-			*page;		// Page from test PDF file
-  int			pagenum = 1;	// Current page number
+			*page,		// Page from test PDF file
+			*obj;		// Stream object
+  int			i,		// Looping/result var
+			pagenum = 1;	// Current page number
+  size_t		num_objmaps;	// Number of mapped objects
   pdfio_dict_t		*catalog;	// Catalog dictionary
+  pdfio_zstrategy_t	strategy;	// Compression strategy
+  pdfio_stream_t	*st;		// Stream
 
 
   // Get the root object/catalog dictionary
@@ -4407,6 +7257,49 @@ write_unit_file(
     return (1);
   }
 
+  testBegin("pdfioFileGet/SetCompression");
+  if (pdfioFileSetCompression(outpdf, 10, PDFIO_ZSTRATEGY_AUTO))
+  {
+    testEndMessage(false, "level 10 accepted");
+    return (1);
+  }
+  else if (!pdfioFileSetCompression(outpdf, 9, PDFIO_ZSTRATEGY_AUTO))
+  {
+    testEndMessage(false, "level 9 not accepted");
+    return (1);
+  }
+  else if ((i = pdfioFileGetCompression(outpdf, &strategy)) != 9 || strategy != PDFIO_ZSTRATEGY_AUTO)
+  {
+    testEndMessage(false, "got level %d and strategy %d, expected 9 and %d", i, (int)strategy, (int)PDFIO_ZSTRATEGY_AUTO);
+    return (1);
+  }
+  else
+  {
+    testEnd(true);
+  }
+
+  testBegin("pdfioObjCreateFlateStream(bad strategy)");
+  if ((obj = pdfioFileCreateObj(outpdf, pdfioDictCreate(outpdf))) == NULL)
+  {
+    testEnd(false);
+    return (1);
+  }
+  else if ((st = pdfioObjCreateFlateStream(obj, 6, (pdfio_zstrategy_t)42)) != NULL)
+  {
+    testEndMessage(false, "strategy 42 accepted");
+    pdfioStreamClose(st);
+    return (1);
+  }
+  else if (!pdfioObjClose(obj))
+  {
+    testEnd(false);
+    return (1);
+  }
+  else
+  {
+    testEnd(true);
+  }
+
   // Create some image objects...
   testBegin("pdfioFileCreateImageObjFromFile(\"testfiles/color.jpg\")");
   if ((color_jpg = pdfioFileCreateImageObjFromFile(outpdf, "testfiles/color.jpg", true)) != NULL)
@@ -4465,6 +7358,35 @@ write_unit_file(
     return (1);
   }
 
+  // Map the same source page again, which must not add another map entry...
+  testBegin("_pdfioFileAddMappedObj(first page again)");
+  num_objmaps = outpdf->num_objmaps;
+
+  if ((obj = _pdfioFileFindMappedObj(outpdf, inpdf, pdfioObjGetNumber(page))) == NULL)
+  {
+    testEndMessage(false, "first page not mapped");
+    return (1);
+  }
+  else if (!_pdfioFileAddMappedObj(outpdf, obj, page))
+  {
+    testEnd(false);
+    return (1);
+  }
+  else if (outpdf->num_objmaps != num_objmaps)
+  {
+    testEndMessage(false, "got %u mapped objects, expected %u", (unsigned)outpdf->num_objmaps, (unsigned)num_objmaps);
+    return (1);
+  }
+  else if (_pdfioFileFindMappedObj(outpdf, inpdf, pdfioObjGetNumber(page)) != obj || pdfioObjCopy(outpdf, page) != obj)
+  {
+    testEndMessage(false, "first page mapped to a different object");
+    return (1);
+  }
+  else
+  {
+    testEnd(true);
+  }
+
   pagenum ++;
 
   // Write a page with a color image...
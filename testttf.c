@@ -97,6 +97,12 @@ test_font(const char *filename)		// I - Font filename
   size_t	num_fonts;		// Number of fonts
   ttf_style_t	style;			// Font style
   ttf_weight_t	weight;			// Font weight
+  const int	*cmap;			// Character to glyph map
+  size_t	num_cmap;		// Number of characters
+  unsigned char	glyphs[8192];		// Glyph bit array for subset
+  unsigned char	*subset;		// Subset font data
+  size_t	subset_size;		// Size of subset font data
+  ttf_t		*subfont;		// Subset font
   static const char * const stretches[] =
   {					// Font stretch strings
     "TTF_STRETCH_NORMAL",		// normal
@@ -310,6 +316,57 @@ test_font(const char *filename)		// I - Font filename
   else
     puts("PASS (false)");
 
+  fputs("ttfCreateSubset: ", stdout);
+  memset(glyphs, 0, sizeof(glyphs));
+  if ((cmap = ttfGetCMap(font, &num_cmap)) != NULL)
+  {
+    for (value = strings[0]; *value; value ++)
+    {
+      if ((size_t)*value < num_cmap && cmap[(int)*value] >= 0)
+        glyphs[cmap[(int)*value] / 8] |= 1 << (cmap[(int)*value] & 7);
+    }
+  }
+
+  if ((subset = ttfCreateSubset(font, glyphs, &subset_size)) != NULL)
+  {
+    printf("PASS (%u bytes)\n", (unsigned)subset_size);
+
+    fputs("ttfCreateData(subset): ", stdout);
+    if ((subfont = ttfCreateData(subset, subset_size, /*idx*/0, error_cb, /*err_data*/NULL)) != NULL)
+    {
+      puts("PASS");
+
+      fputs("ttfGetWidth(subset, 'H'): ", stdout);
+      if ((intvalue = ttfGetWidth(subfont, 'H')) == ttfGetWidth(font, 'H'))
+      {
+        printf("PASS (%d)\n", intvalue);
+      }
+      else
+      {
+        printf("FAIL (got %d, expected %d)\n", intvalue, ttfGetWidth(font, 'H'));
+        errors ++;
+      }
+
+      ttfDelete(subfont);
+    }
+    else
+    {
+      puts("FAIL");
+      errors ++;
+    }
+
+    free(subset);
+  }
+  else if (!strstr(filename, ".ttf"))
+  {
+    puts("PASS (not TrueType outlines)");
+  }
+  else
+  {
+    puts("FAIL");
+    errors ++;
+  }
+
   ttfDelete(font);
   font = NULL;
 
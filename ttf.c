@@ -108,13 +108,18 @@ typedef __int64 ssize_t;		// POSIX type not present on Windows... @private@
 //
 
 #define TTF_OFF_cmap	0x636d6170	// Character to glyph mapping
+#define TTF_OFF_cvt	0x63767420	// Control value table
+#define TTF_OFF_fpgm	0x6670676d	// Font program
+#define TTF_OFF_glyf	0x676c7966	// Glyph data
 #define TTF_OFF_head	0x68656164	// Font header
 #define TTF_OFF_hhea	0x68686561	// Horizontal header
 #define TTF_OFF_hmtx	0x686d7478	// Horizontal metrics
+#define TTF_OFF_loca	0x6c6f6361	// Index to location
 #define TTF_OFF_maxp	0x6d617870	// Maximum profile
 #define TTF_OFF_name	0x6e616d65	// Naming table
 #define TTF_OFF_OS_2	0x4f532f32	// OS/2 and Windows specific metrics
 #define TTF_OFF_post	0x706f7374	// PostScript information
+#define TTF_OFF_prep	0x70726570	// Control value program
 
 #define TTF_OFF_Unicode	0	// Unicode platform ID
 
@@ -292,12 +297,18 @@ typedef struct _ttf_off_post_s		// PostScript information
 //
 
 static char	*copy_name(ttf_t *font, unsigned name_id);
+static unsigned char *copy_table(ttf_t *font, unsigned tag, unsigned *length);
 static ttf_t	*create_font(const char *filename, const void *data, size_t datasize, size_t idx, ttf_err_cb_t err_cb, void *err_data);
 static void	errorf(ttf_t *font, const char *message, ...) TTF_FORMAT_ARGS(2,3);
 static size_t	fd_read_cb(ttf_t *font, void *buffer, size_t bytes);
 static bool	fd_seek_cb(ttf_t *font, size_t offset);
+static unsigned	get_checksum(const unsigned char *data, unsigned length);
+static unsigned	get_ulong(const unsigned char *data);
+static unsigned	get_ushort(const unsigned char *data);
 static size_t	mem_read_cb(ttf_t *font, void *buffer, size_t bytes);
 static bool	mem_seek_cb(ttf_t *font, size_t offset);
+static void	put_ulong(unsigned char *data, unsigned value);
+static void	put_ushort(unsigned char *data, unsigned value);
 static bool	read_cmap(ttf_t *font);
 static bool	read_head(ttf_t *font, _ttf_off_head_t *head);
 static bool	read_hhea(ttf_t *font, _ttf_off_hhea_t *hhea);
@@ -407,6 +418,535 @@ ttfCreateData(const void   *data,	// I - Buffer
 }
 
 
+//
+// 'ttfCreateSubset()' - Create a subset of a TrueType font.
+//
+// This function creates a new TrueType font file in memory that contains only
+// the glyphs marked in the "glyphs" bit array.  The bit array holds one bit for
+// each of the 65536 possible glyph numbers, in least-significant-bit order -
+// glyph `N` is used when `glyphs[N / 8] & (1 << (N & 7))` is non-zero.
+//
+// The ".notdef" glyph (glyph 0) and any glyphs referenced by the marked
+// composite glyphs are added to the bit array, and bits for glyph numbers not
+// present in the font are cleared.  Glyphs in the subset keep the same order
+// as the original font, so the new number for a glyph is the number of bits
+// set before it in the array.
+//
+// The subset contains rebuilt "cmap", "glyf", "head", "hhea", "hmtx", "loca",
+// "maxp", and "post" tables along with copies of the "cvt ", "fpgm", "name",
+// "OS/2", and "prep" tables from the original font.  `NULL` is returned for
+// fonts without TrueType outlines, such as CFF-based OpenType fonts.
+//
+// The returned buffer must be freed using `free`.
+//
+
+unsigned char *				// O - Subset font data or `NULL` on error
+ttfCreateSubset(ttf_t         *font,	// I - Font
+                unsigned char *glyphs,	// IO - Glyph bit array (8192 bytes)
+                size_t        *subset_size)
+					// O - Size of subset font data
+{
+  int		i,			// Looping var
+		num_glyphs,		// Number of glyphs in font
+		num_subset,		// Number of glyphs in subset
+		num_hmetrics,		// Number of long horizontal metrics
+		num_segs,		// Number of cmap segments
+		loca_format;		// Format of original loca table
+  bool		changed;		// Did the closure add glyphs?
+  unsigned	g,			// Current glyph
+		length,			// Length of glyph data
+		flags,			// Composite glyph flags
+		cg,			// Component glyph
+		num_tables,		// Number of output tables
+		offset,			// Offset in output
+		head_offset = 0,	// Offset of head table in output
+		sum;			// Font checksum
+  unsigned	*loca = NULL;		// Original glyph offsets
+  int		*newgid = NULL;		// Subset glyph numbers
+  unsigned char	checked[8192],		// Glyphs checked for components
+		*gdata = NULL,		// Glyph data buffer
+		*gptr,			// Pointer into glyph data
+		*gend,			// End of glyph data
+		*temp,			// Temporary pointer
+		*data = NULL,		// Subset font data
+		*dptr;			// Pointer into subset font data
+  unsigned	gsize = 0,		// Size of glyph data buffer
+		glyf_size = 0;		// Size of subset glyf table
+  unsigned	*seg_start = NULL,	// cmap segment start codes
+		*seg_end = NULL,	// cmap segment end codes
+		*seg_delta = NULL;	// cmap segment deltas
+  struct
+  {
+    unsigned	tag;			// Table tag
+    unsigned char *data;		// Table data
+    unsigned	length;			// Table length
+  }		tables[13],		// Output tables
+		*t;			// Current table
+  unsigned char	*head = NULL,		// head table
+		*hhea = NULL,		// hhea table
+		*hmtx = NULL,		// Original hmtx table
+		*newhmtx = NULL,	// Subset hmtx table
+		*maxp = NULL,		// maxp table
+		*cmap = NULL,		// Subset cmap table
+		*post = NULL,		// Subset post table
+		*glyf = NULL,		// Subset glyf table
+		*loca_data = NULL,	// loca table data
+		*cvt = NULL,		// cvt table
+		*fpgm = NULL,		// fpgm table
+		*name = NULL,		// name table
+		*os_2 = NULL,		// OS/2 table
+		*prep = NULL;		// prep table
+  unsigned	head_len, hhea_len, hmtx_len, maxp_len, cmap_len, post_len,
+		loca_len, cvt_len, fpgm_len, name_len, os_2_len, prep_len;
+					// Table lengths
+
+
+  // Range check input...
+  if (subset_size)
+    *subset_size = 0;
+
+  if (!font || !glyphs || !subset_size)
+  {
+    errno = EINVAL;
+    return (NULL);
+  }
+
+  // Only TrueType outlines can be subset...
+  if (seek_table(font, TTF_OFF_glyf, 0, false) == 0 || seek_table(font, TTF_OFF_loca, 0, false) == 0)
+    return (NULL);
+
+  if ((num_glyphs = read_maxp(font)) <= 0)
+    return (NULL);
+
+  // Load the tables we need to update...
+  if ((head = copy_table(font, TTF_OFF_head, &head_len)) == NULL || head_len < 54)
+    goto error;
+
+  if ((hhea = copy_table(font, TTF_OFF_hhea, &hhea_len)) == NULL || hhea_len < 36)
+    goto error;
+
+  if ((maxp = copy_table(font, TTF_OFF_maxp, &maxp_len)) == NULL || maxp_len < 6)
+    goto error;
+
+  if ((hmtx = copy_table(font, TTF_OFF_hmtx, &hmtx_len)) == NULL)
+    goto error;
+
+  if ((num_hmetrics = (int)get_ushort(hhea + 34)) < 1 || (unsigned)num_hmetrics * 4 > hmtx_len)
+  {
+    errorf(font, "Bad number of horizontal metrics.");
+    goto error;
+  }
+
+  // Read the glyph locations...
+  loca_format = (short)get_ushort(head + 50);
+
+  if ((loca_data = copy_table(font, TTF_OFF_loca, &loca_len)) == NULL)
+    goto error;
+
+  if ((loca = (unsigned *)calloc((size_t)num_glyphs + 1, sizeof(unsigned))) == NULL)
+  {
+    errorf(font, "Unable to allocate memory for glyph locations.");
+    goto error;
+  }
+
+  if (loca_len < (unsigned)(num_glyphs + 1) * (loca_format ? 4 : 2))
+  {
+    errorf(font, "Glyph location table too small.");
+    goto error;
+  }
+
+  for (i = 0; i <= num_glyphs; i ++)
+  {
+    if (loca_format)
+      loca[i] = get_ulong(loca_data + 4 * i);
+    else
+      loca[i] = 2 * get_ushort(loca_data + 2 * i);
+
+    if (i > 0 && loca[i] < loca[i - 1])
+    {
+      errorf(font, "Bad glyph location for glyph %d.", i - 1);
+      goto error;
+    }
+  }
+
+  free(loca_data);
+  loca_data = NULL;
+
+  // Always include .notdef and drop glyphs the font doesn't have...
+  glyphs[0] |= 1;
+
+  for (g = (unsigned)num_glyphs; g < 65536; g ++)
+    glyphs[g / 8] &= ~(1 << (g & 7));
+
+  // Add the components of composite glyphs, repeating as needed when a
+  // composite glyph references an earlier glyph...
+  memset(checked, 0, sizeof(checked));
+
+  do
+  {
+    changed = false;
+
+    for (g = 0; g < (unsigned)num_glyphs; g ++)
+    {
+      if (!(glyphs[g / 8] & (1 << (g & 7))) || (checked[g / 8] & (1 << (g & 7))))
+        continue;
+
+      checked[g / 8] |= 1 << (g & 7);
+
+      if ((length = loca[g + 1] - loca[g]) < 10)
+        continue;
+
+      if (length > gsize)
+      {
+        if ((temp = realloc(gdata, length)) == NULL)
+        {
+          errorf(font, "Unable to allocate memory for glyph data.");
+          goto error;
+        }
+
+        gdata = temp;
+        gsize = length;
+      }
+
+      if (seek_table(font, TTF_OFF_glyf, loca[g], true) < length || (font->read_cb)(font, gdata, length) != length)
+      {
+        errorf(font, "Unable to read glyph %u.", g);
+        goto error;
+      }
+
+      if ((short)get_ushort(gdata) >= 0)
+        continue;			// Simple glyph
+
+      for (gptr = gdata + 10, gend = gdata + length; (gptr + 4) <= gend;)
+      {
+        flags = get_ushort(gptr);
+        cg    = get_ushort(gptr + 2);
+
+        if (cg < (unsigned)num_glyphs && !(glyphs[cg / 8] & (1 << (cg & 7))))
+        {
+          glyphs[cg / 8] |= 1 << (cg & 7);
+
+          if (cg < g)
+            changed = true;
+        }
+
+        gptr += (flags & 0x0001) ? 8 : 6;	// ARG_1_AND_2_ARE_WORDS
+
+        if (flags & 0x0008)		// WE_HAVE_A_SCALE
+          gptr += 2;
+        else if (flags & 0x0040)	// WE_HAVE_AN_X_AND_Y_SCALE
+          gptr += 4;
+        else if (flags & 0x0080)	// WE_HAVE_A_TWO_BY_TWO
+          gptr += 8;
+
+        if (!(flags & 0x0020))		// MORE_COMPONENTS
+          break;
+      }
+    }
+  }
+  while (changed);
+
+  // Number the subset glyphs...
+  if ((newgid = (int *)malloc((size_t)num_glyphs * sizeof(int))) == NULL)
+  {
+    errorf(font, "Unable to allocate memory for glyph map.");
+    goto error;
+  }
+
+  for (g = 0, num_subset = 0; g < (unsigned)num_glyphs; g ++)
+  {
+    if (glyphs[g / 8] & (1 << (g & 7)))
+    {
+      newgid[g] = num_subset ++;
+      glyf_size += (loca[g + 1] - loca[g] + 3) & ~3U;
+    }
+    else
+    {
+      newgid[g] = -1;
+    }
+  }
+
+  // Build the glyf and loca tables...
+  if ((glyf = (unsigned char *)calloc(1, glyf_size ? glyf_size : 1)) == NULL || (loca_data = (unsigned char *)malloc(4 * ((size_t)num_subset + 1))) == NULL)
+  {
+    errorf(font, "Unable to allocate memory for glyph data.");
+    goto error;
+  }
+
+  for (g = 0, offset = 0, i = 0; g < (unsigned)num_glyphs; g ++)
+  {
+    if (newgid[g] < 0)
+      continue;
+
+    put_ulong(loca_data + 4 * i, offset);
+    i ++;
+
+    if ((length = loca[g + 1] - loca[g]) == 0)
+      continue;
+
+    if (seek_table(font, TTF_OFF_glyf, loca[g], true) < length || (font->read_cb)(font, glyf + offset, length) != length)
+    {
+      errorf(font, "Unable to read glyph %u.", g);
+      goto error;
+    }
+
+    if (length >= 10 && (short)get_ushort(glyf + offset) < 0)
+    {
+      // Renumber the components of this composite glyph...
+      for (gptr = glyf + offset + 10, gend = glyf + offset + length; (gptr + 4) <= gend;)
+      {
+        flags = get_ushort(gptr);
+        cg    = get_ushort(gptr + 2);
+
+        if (cg < (unsigned)num_glyphs && newgid[cg] >= 0)
+          put_ushort(gptr + 2, (unsigned)newgid[cg]);
+
+        gptr += (flags & 0x0001) ? 8 : 6;
+
+        if (flags & 0x0008)
+          gptr += 2;
+        else if (flags & 0x0040)
+          gptr += 4;
+        else if (flags & 0x0080)
+          gptr += 8;
+
+        if (!(flags & 0x0020))
+          break;
+      }
+    }
+
+    offset += (length + 3) & ~3U;
+  }
+
+  put_ulong(loca_data + 4 * num_subset, offset);
+
+  // Build the hmtx table with a full metric for each glyph...
+  if ((newhmtx = (unsigned char *)malloc(4 * (size_t)num_subset)) == NULL)
+  {
+    errorf(font, "Unable to allocate memory for metrics.");
+    goto error;
+  }
+
+  for (g = 0; g < (unsigned)num_glyphs; g ++)
+  {
+    unsigned	advance,		// Advance width
+		lsb;			// Left side bearing
+
+    if (newgid[g] < 0)
+      continue;
+
+    if (g < (unsigned)num_hmetrics)
+    {
+      advance = get_ushort(hmtx + 4 * g);
+      lsb     = get_ushort(hmtx + 4 * g + 2);
+    }
+    else
+    {
+      advance = get_ushort(hmtx + 4 * (num_hmetrics - 1));
+      offset  = 4 * (unsigned)num_hmetrics + 2 * (g - (unsigned)num_hmetrics);
+      lsb     = (offset + 2) <= hmtx_len ? get_ushort(hmtx + offset) : 0;
+    }
+
+    put_ushort(newhmtx + 4 * newgid[g], advance);
+    put_ushort(newhmtx + 4 * newgid[g] + 2, lsb);
+  }
+
+  // Build a format 4 (Unicode BMP) cmap table...
+  if ((seg_start = (unsigned *)malloc(8192 * sizeof(unsigned))) == NULL || (seg_end = (unsigned *)malloc(8192 * sizeof(unsigned))) == NULL || (seg_delta = (unsigned *)malloc(8192 * sizeof(unsigned))) == NULL)
+  {
+    errorf(font, "Unable to allocate memory for character map.");
+    goto error;
+  }
+
+  for (g = 0, num_segs = 0; g < font->num_cmap && g < 0xffff; g ++)
+  {
+    int	cgid;				// Glyph for character
+
+    if (font->cmap[g] < 0 || font->cmap[g] >= num_glyphs || (cgid = newgid[font->cmap[g]]) <= 0)
+      continue;
+
+    if (num_segs > 0 && seg_end[num_segs - 1] == (g - 1) && seg_delta[num_segs - 1] == (((unsigned)cgid - g) & 0xffff))
+    {
+      seg_end[num_segs - 1] = g;
+    }
+    else if (num_segs < 8191)
+    {
+      // Format 4 tables are limited to 64k, so very sparse subsets only map the
+      // first 8190 ranges - PDF uses the CIDToGIDMap and not the cmap...
+      seg_start[num_segs] = g;
+      seg_end[num_segs]   = g;
+      seg_delta[num_segs] = ((unsigned)cgid - g) & 0xffff;
+      num_segs ++;
+    }
+  }
+
+  seg_start[num_segs] = 0xffff;
+  seg_end[num_segs]   = 0xffff;
+  seg_delta[num_segs] = 1;
+  num_segs ++;
+
+  cmap_len = 12 + 16 + 8 * (unsigned)num_segs;
+
+  if ((cmap = (unsigned char *)calloc(1, cmap_len)) == NULL)
+  {
+    errorf(font, "Unable to allocate memory for character map.");
+    goto error;
+  }
+  else
+  {
+    unsigned	search_range,		// Search range
+		entry_selector;		// Entry selector
+
+    for (search_range = 1, entry_selector = 0; (search_range * 2) <= (unsigned)num_segs; search_range *= 2, entry_selector ++);
+
+    put_ushort(cmap + 2, 1);		// numTables
+    put_ushort(cmap + 4, TTF_OFF_Windows);
+    put_ushort(cmap + 6, TTF_OFF_Windows_UCS2);
+    put_ulong(cmap + 8, 12);		// offset
+    put_ushort(cmap + 12, 4);		// format
+    put_ushort(cmap + 14, cmap_len - 12);
+    put_ushort(cmap + 18, 2 * (unsigned)num_segs);
+    put_ushort(cmap + 20, 2 * search_range);
+    put_ushort(cmap + 22, entry_selector);
+    put_ushort(cmap + 24, 2 * ((unsigned)num_segs - search_range));
+
+    for (i = 0; i < num_segs; i ++)
+    {
+      put_ushort(cmap + 26 + 2 * i, seg_end[i]);
+      put_ushort(cmap + 28 + 2 * (num_segs + i), seg_start[i]);
+      put_ushort(cmap + 28 + 2 * (2 * num_segs + i), seg_delta[i]);
+    }
+  }
+
+  // Build a format 3 post table (no glyph names)...
+  if ((post = copy_table(font, TTF_OFF_post, &post_len)) == NULL || post_len < 32)
+  {
+    free(post);
+
+    if ((post = (unsigned char *)calloc(1, 32)) == NULL)
+    {
+      errorf(font, "Unable to allocate memory for PostScript table.");
+      goto error;
+    }
+  }
+
+  post_len = 32;
+
+  put_ulong(post, 0x00030000);
+  memset(post + 16, 0, 16);
+
+  // Update the header tables...
+  put_ulong(head + 8, 0);		// checkSumAdjustment
+  put_ushort(head + 50, 1);		// indexToLocFormat
+  put_ushort(hhea + 34, (unsigned)num_subset);
+  put_ushort(maxp + 4, (unsigned)num_subset);
+
+  // Copy the hinting and naming tables as-is...
+  cvt  = copy_table(font, TTF_OFF_cvt, &cvt_len);
+  fpgm = copy_table(font, TTF_OFF_fpgm, &fpgm_len);
+  name = copy_table(font, TTF_OFF_name, &name_len);
+  os_2 = copy_table(font, TTF_OFF_OS_2, &os_2_len);
+  prep = copy_table(font, TTF_OFF_prep, &prep_len);
+
+  // Assemble the tables in tag order...
+  num_tables = 0;
+
+#define ADD_TABLE(ttag,tdata,tlength) if (tdata) { tables[num_tables].tag = ttag; tables[num_tables].data = tdata; tables[num_tables].length = tlength; num_tables ++; }
+
+  ADD_TABLE(TTF_OFF_OS_2, os_2, os_2_len)
+  ADD_TABLE(TTF_OFF_cmap, cmap, cmap_len)
+  ADD_TABLE(TTF_OFF_cvt, cvt, cvt_len)
+  ADD_TABLE(TTF_OFF_fpgm, fpgm, fpgm_len)
+  ADD_TABLE(TTF_OFF_glyf, glyf, glyf_size)
+  ADD_TABLE(TTF_OFF_head, head, 54)
+  ADD_TABLE(TTF_OFF_hhea, hhea, hhea_len)
+  ADD_TABLE(TTF_OFF_hmtx, newhmtx, 4 * (unsigned)num_subset)
+  ADD_TABLE(TTF_OFF_loca, loca_data, 4 * ((unsigned)num_subset + 1))
+  ADD_TABLE(TTF_OFF_maxp, maxp, maxp_len)
+  ADD_TABLE(TTF_OFF_name, name, name_len)
+  ADD_TABLE(TTF_OFF_post, post, post_len)
+  ADD_TABLE(TTF_OFF_prep, prep, prep_len)
+
+#undef ADD_TABLE
+
+  for (i = 0, offset = 12 + 16 * num_tables, t = tables; i < (int)num_tables; i ++, t ++)
+    offset += (t->length + 3) & ~3U;
+
+  if ((data = (unsigned char *)calloc(1, offset)) == NULL)
+  {
+    errorf(font, "Unable to allocate memory for subset font.");
+    goto error;
+  }
+
+  *subset_size = offset;
+
+  put_ulong(data, 0x00010000);		// sfntVersion
+  put_ushort(data + 4, num_tables);
+
+  for (i = 1, g = 0; (i * 2) <= (int)num_tables; i *= 2, g ++);
+
+  put_ushort(data + 6, 16 * (unsigned)i);	// searchRange
+  put_ushort(data + 8, g);			// entrySelector
+  put_ushort(data + 10, 16 * (num_tables - (unsigned)i));
+					// rangeShift
+
+  for (i = 0, dptr = data + 12, offset = 12 + 16 * num_tables, t = tables; i < (int)num_tables; i ++, t ++, dptr += 16)
+  {
+    memcpy(data + offset, t->data, t->length);
+
+    put_ulong(dptr, t->tag);
+    put_ulong(dptr + 4, get_checksum(data + offset, t->length));
+    put_ulong(dptr + 8, offset);
+    put_ulong(dptr + 12, t->length);
+
+    if (t->tag == TTF_OFF_head)
+      head_offset = offset;
+
+    offset += (t->length + 3) & ~3U;
+  }
+
+  // Update the font checksum...
+  sum = get_checksum(data, (unsigned)*subset_size);
+  put_ulong(data + head_offset + 8, 0xb1b0afba - sum);
+
+  goto done;
+
+  // If we get here something went wrong...
+  error:
+
+  free(data);
+  data = NULL;
+
+  *subset_size = 0;
+
+  // Free temporary memory and return...
+  done:
+
+  free(loca);
+  free(newgid);
+  free(gdata);
+  free(seg_start);
+  free(seg_end);
+  free(seg_delta);
+  free(head);
+  free(hhea);
+  free(hmtx);
+  free(newhmtx);
+  free(maxp);
+  free(cmap);
+  free(post);
+  free(glyf);
+  free(loca_data);
+  free(cvt);
+  free(fpgm);
+  free(name);
+  free(os_2);
+  free(prep);
+
+  return (data);
+}
+
+
 //
 // 'ttfDelete()' - Free all memory used for a font family object.
 //
@@ -928,6 +1468,40 @@ copy_name(ttf_t    *font,		// I - Font
 }
 
 
+//
+// 'copy_table()' - Copy a table from the font.
+//
+
+static unsigned char *			// O - Table data or `NULL` if not found
+copy_table(ttf_t    *font,		// I - Font
+           unsigned tag,		// I - Table tag
+           unsigned *length)		// O - Length of table
+{
+  unsigned char	*data;			// Table data
+
+
+  if ((*length = seek_table(font, tag, 0, false)) == 0)
+    return (NULL);
+
+  if ((data = (unsigned char *)malloc(*length)) == NULL)
+  {
+    errorf(font, "Unable to allocate memory for %c%c%c%c table.", (tag >> 24) & 255, (tag >> 16) & 255, (tag >> 8) & 255, tag & 255);
+    *length = 0;
+    return (NULL);
+  }
+
+  if ((font->read_cb)(font, data, *length) != *length)
+  {
+    errorf(font, "Unable to read %c%c%c%c table.", (tag >> 24) & 255, (tag >> 16) & 255, (tag >> 8) & 255, tag & 255);
+    free(data);
+    *length = 0;
+    return (NULL);
+  }
+
+  return (data);
+}
+
+
 //
 // 'create_font()' - Create a font object from the file or data.
 //
@@ -1199,6 +1773,56 @@ fd_seek_cb(ttf_t  *font,		// I - Font
 }
 
 
+//
+// 'get_checksum()' - Compute the checksum of a table.
+//
+
+static unsigned				// O - Checksum
+get_checksum(const unsigned char *data,	// I - Table data
+             unsigned            length)// I - Length of table
+{
+  unsigned	sum = 0;		// Checksum
+
+
+  // Tables are summed as big-endian 32-bit values, padded with zeros...
+  for (; length >= 4; data += 4, length -= 4)
+    sum += get_ulong(data);
+
+  if (length > 0)
+  {
+    unsigned char	temp[4] = { 0, 0, 0, 0 };
+					// Final partial value
+
+    memcpy(temp, data, length);
+    sum += get_ulong(temp);
+  }
+
+  return (sum);
+}
+
+
+//
+// 'get_ulong()' - Get a 32-bit unsigned integer from a buffer.
+//
+
+static unsigned				// O - 32-bit unsigned integer value
+get_ulong(const unsigned char *data)	// I - Buffer
+{
+  return ((unsigned)((data[0] << 24) | (data[1] << 16) | (data[2] << 8) | data[3]));
+}
+
+
+//
+// 'get_ushort()' - Get a 16-bit unsigned integer from a buffer.
+//
+
+static unsigned				// O - 16-bit unsigned integer value
+get_ushort(const unsigned char *data)	// I - Buffer
+{
+  return ((unsigned)((data[0] << 8) | data[1]));
+}
+
+
 //
 // 'mem_read_cb()' - Read from a memory buffer.
 //
@@ -1244,6 +1868,34 @@ mem_seek_cb(ttf_t  *font,		// I - Font
 }
 
 
+//
+// 'put_ulong()' - Put a 32-bit unsigned integer in a buffer.
+//
+
+static void
+put_ulong(unsigned char *data,		// I - Buffer
+          unsigned      value)		// I - Value
+{
+  data[0] = (unsigned char)(value >> 24);
+  data[1] = (unsigned char)(value >> 16);
+  data[2] = (unsigned char)(value >> 8);
+  data[3] = (unsigned char)value;
+}
+
+
+//
+// 'put_ushort()' - Put a 16-bit unsigned integer in a buffer.
+//
+
+static void
+put_ushort(unsigned char *data,		// I - Buffer
+           unsigned      value)		// I - Value
+{
+  data[0] = (unsigned char)(value >> 8);
+  data[1] = (unsigned char)value;
+}
+
+
 //
 // 'read_cmap()' - Read the cmap table, getting the Unicode mapping table.
 //
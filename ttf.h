@@ -82,6 +82,7 @@ typedef struct ttf_rect_s	// Bounding rectangle
 
 extern ttf_t		*ttfCreate(const char *filename, size_t idx, ttf_err_cb_t err_cb, void *err_data);
 extern ttf_t		*ttfCreateData(const void *data, size_t data_size, size_t idx, ttf_err_cb_t err_cb, void *err_data);
+extern unsigned char	*ttfCreateSubset(ttf_t *font, unsigned char *glyphs, size_t *subset_size);
 extern void		ttfDelete(ttf_t *font);
 extern int		ttfGetAscent(ttf_t *font);
 extern ttf_rect_t	*ttfGetBounds(ttf_t *font, ttf_rect_t *bounds);